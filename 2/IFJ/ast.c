@@ -23,6 +23,7 @@ ASTNode *create_program_node()
 {
     ASTNode *node = (ASTNode *)safe_malloc(sizeof(ASTNode));
     node->type = NODE_PROGRAM;
+    node->data_type = TYPE_VOID;
     node->left = node->right = node->next = node->condition = NULL;
     node->body = NULL;
     node->name = NULL;
@@ -31,6 +32,9 @@ ASTNode *create_program_node()
     node->param_count = 0;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
 
@@ -50,6 +54,9 @@ ASTNode *create_function_node(char *name, DataType return_type, ASTNode **parame
     node->value = NULL;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
 
@@ -64,10 +71,14 @@ ASTNode *create_variable_declaration_node(char *name, DataType data_type, ASTNod
     node->name = string_duplicate(name);
     node->left = initializer;
     node->right = node->next = node->condition = node->body = NULL;
+    node->value = NULL;
     node->parameters = NULL;
     node->param_count = 0;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
 
@@ -78,13 +89,18 @@ ASTNode *create_assignment_node(char *name, ASTNode *value)
 {
     ASTNode *node = (ASTNode *)safe_malloc(sizeof(ASTNode));
     node->type = NODE_ASSIGNMENT;
+    node->data_type = value != NULL ? value->data_type : TYPE_UNKNOWN;
     node->name = string_duplicate(name);
     node->left = value;
     node->right = node->next = node->condition = node->body = NULL;
+    node->value = NULL;
     node->parameters = NULL;
     node->param_count = 0;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
 
@@ -105,6 +121,9 @@ ASTNode *create_binary_operation_node(const char *operator_name, ASTNode *left,
     node->param_count = 0;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
 
@@ -123,6 +142,9 @@ ASTNode *create_literal_node(DataType type, char *value)
     node->param_count = 0;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
 
@@ -142,6 +164,9 @@ ASTNode *create_identifier_node(char *name)
     node->param_count = 0;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
 
@@ -164,6 +189,9 @@ ASTNode *create_if_node(ASTNode *condition, ASTNode *true_block, ASTNode *false_
     node->param_count = 0;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
 
@@ -174,6 +202,7 @@ ASTNode *create_while_node(ASTNode *condition, ASTNode *body)
 {
     ASTNode *node = (ASTNode *)safe_malloc(sizeof(ASTNode));
     node->type = NODE_WHILE;
+    node->data_type = TYPE_VOID;
     node->condition = condition;
     node->body = body;
     node->left = node->right = node->next = NULL;
@@ -183,6 +212,9 @@ ASTNode *create_while_node(ASTNode *condition, ASTNode *body)
     node->param_count = 0;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
 
@@ -201,6 +233,9 @@ ASTNode *create_return_node(ASTNode *value)
     node->param_count = 0;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     if (value != NULL)
     {
         node->data_type = value->data_type;
@@ -219,6 +254,7 @@ ASTNode *create_function_call_node(char *name, ASTNode **arguments, int arg_coun
 {
     ASTNode *node = (ASTNode *)safe_malloc(sizeof(ASTNode));
     node->type = NODE_FUNCTION_CALL;
+    node->data_type = TYPE_UNKNOWN;
     node->name = string_duplicate(name);
     node->arguments = arguments;
     node->arg_count = arg_count;
@@ -226,6 +262,9 @@ ASTNode *create_function_call_node(char *name, ASTNode **arguments, int arg_coun
     node->value = NULL;
     node->parameters = NULL;
     node->param_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
 
@@ -245,5 +284,8 @@ ASTNode *create_block_node(ASTNode *statements, DataType return_type)
     node->param_count = 0;
     node->arguments = NULL;
     node->arg_count = 0;
+    node->is_non_null = false;
+    node->literal = NULL;
+    node->line = node->column = 0;
     return node;
 }
@@ -15,6 +15,7 @@
 
 #include <stdbool.h>
 #include "symtable.h"
+#include "string_pool.h"
 
 // Enumeration of different types of AST nodes
 typedef enum {
@@ -44,11 +45,17 @@ typedef struct ASTNode {
 
     char* name;  // Name of the variable/function
     char* value; // Value of the literal
+    StringPoolEntry* literal; // Pool entry of a string literal, NULL for other nodes
     struct ASTNode** parameters; // Pointer to an array of parameters (for functions)
     int param_count; // Number of parameters
 
     struct ASTNode** arguments; // Pointer to an array of arguments (for function calls)
     int arg_count;  // Number of arguments
+
+    bool is_non_null; // Nullable value proven to hold a value at this point
+
+    int line;   // Position of the first token of a function, block or statement, 0 if not set
+    int column;
 } ASTNode;
 
 // Functions to create different types of AST nodes
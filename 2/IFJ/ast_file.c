@@ -0,0 +1,579 @@
+/**
+ * @file ast_file.c
+ *
+ * Implementation of the serialized AST format.
+ * The writer numbers every node reachable from the program node and from the
+ * symtable, so each pointer becomes the index of its node. Equal strings are
+ * stored once. The loader maps the file, checks every index and offset and
+ * builds one array of ASTNode and one array of list pointers, the names and
+ * values point directly into the mapping.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "ast_file.h"
+#include "compiler.h"
+#include "error.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Mapped file of the compilation running in this thread
+#define ast_file_state (current_context->ast_file)
+
+#define AST_FILE_INITIAL_CAPACITY 256
+
+/**
+ * Numbering of the nodes and strings while a file is written.
+ * Both maps use open addressing, keys are looked up by pointer or by text.
+ */
+typedef struct {
+    ASTNode **nodes;       // Nodes in the order of their indices
+    size_t node_count;
+    size_t node_capacity;
+    ASTNode **node_keys;   // Pointer to index map
+    uint32_t *node_values;
+    size_t node_slots;
+
+    char *strings;         // String table
+    size_t string_size;
+    size_t string_capacity;
+    const char **string_keys; // Text to offset map
+    uint32_t *string_values;
+    size_t string_slots;
+} AstFileWriter;
+
+/**
+ * FNV-1a, used for the source hash and the string map.
+ */
+static uint64_t fnv1a(uint64_t hash, const unsigned char *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+
+/**
+ * Slot of a node pointer in the pointer map.
+ */
+static size_t node_slot(const AstFileWriter *writer, const ASTNode *node)
+{
+    size_t slot = (size_t)(((uintptr_t)node >> 4) * 11400714819323198485ULL) & (writer->node_slots - 1);
+    while (writer->node_keys[slot] != NULL && writer->node_keys[slot] != node)
+    {
+        slot = (slot + 1) & (writer->node_slots - 1);
+    }
+    return slot;
+}
+
+/**
+ * Doubles the pointer map, the map is kept at most half full.
+ */
+static void grow_node_map(AstFileWriter *writer)
+{
+    ASTNode **old_keys = writer->node_keys;
+    uint32_t *old_values = writer->node_values;
+    size_t old_slots = writer->node_slots;
+
+    writer->node_slots = old_slots ? old_slots * 2 : AST_FILE_INITIAL_CAPACITY * 2;
+    writer->node_keys = safe_malloc(writer->node_slots * sizeof(ASTNode *));
+    writer->node_values = safe_malloc(writer->node_slots * sizeof(uint32_t));
+    memset(writer->node_keys, 0, writer->node_slots * sizeof(ASTNode *));
+
+    for (size_t i = 0; i < old_slots; i++)
+    {
+        if (old_keys[i] != NULL)
+        {
+            size_t slot = node_slot(writer, old_keys[i]);
+            writer->node_keys[slot] = old_keys[i];
+            writer->node_values[slot] = old_values[i];
+        }
+    }
+    safe_free(old_keys);
+    safe_free(old_values);
+}
+
+/**
+ * Returns the index of a node, a node seen for the first time gets the next index.
+ */
+static uint32_t node_index(AstFileWriter *writer, ASTNode *node)
+{
+    if (node == NULL)
+    {
+        return AST_FILE_NONE;
+    }
+    if ((writer->node_count + 1) * 2 > writer->node_slots)
+    {
+        grow_node_map(writer);
+    }
+    size_t slot = node_slot(writer, node);
+    if (writer->node_keys[slot] != NULL)
+    {
+        return writer->node_values[slot];
+    }
+
+    if (writer->node_count == writer->node_capacity)
+    {
+        writer->node_capacity = writer->node_capacity ? writer->node_capacity * 2 : AST_FILE_INITIAL_CAPACITY;
+        writer->nodes = safe_realloc(writer->nodes, writer->node_capacity * sizeof(ASTNode *));
+    }
+    writer->node_keys[slot] = node;
+    writer->node_values[slot] = (uint32_t)writer->node_count;
+    writer->nodes[writer->node_count] = node;
+    return (uint32_t)writer->node_count++;
+}
+
+/**
+ * Slot of a text in the string map.
+ */
+static size_t string_slot(const AstFileWriter *writer, const char *text)
+{
+    size_t slot = (size_t)fnv1a(FNV_OFFSET_BASIS, (const unsigned char *)text, strlen(text)) & (writer->string_slots - 1);
+    while (writer->string_keys[slot] != NULL && strcmp(writer->string_keys[slot], text) != 0)
+    {
+        slot = (slot + 1) & (writer->string_slots - 1);
+    }
+    return slot;
+}
+
+/**
+ * Doubles the string map. Keys point to the texts of the AST, which outlive the writer.
+ */
+static void grow_string_map(AstFileWriter *writer)
+{
+    const char **old_keys = writer->string_keys;
+    uint32_t *old_values = writer->string_values;
+    size_t old_slots = writer->string_slots;
+
+    writer->string_slots = old_slots ? old_slots * 2 : AST_FILE_INITIAL_CAPACITY * 2;
+    writer->string_keys = safe_malloc(writer->string_slots * sizeof(char *));
+    writer->string_values = safe_malloc(writer->string_slots * sizeof(uint32_t));
+    memset(writer->string_keys, 0, writer->string_slots * sizeof(char *));
+
+    for (size_t i = 0; i < old_slots; i++)
+    {
+        if (old_keys[i] != NULL)
+        {
+            size_t slot = string_slot(writer, old_keys[i]);
+            writer->string_keys[slot] = old_keys[i];
+            writer->string_values[slot] = old_values[i];
+        }
+    }
+    safe_free(old_keys);
+    safe_free(old_values);
+}
+
+/**
+ * Returns the offset of a text in the string table, adding it if needed.
+ */
+static uint32_t string_offset(AstFileWriter *writer, size_t *string_count, const char *text)
+{
+    if (text == NULL)
+    {
+        return AST_FILE_NONE;
+    }
+    if ((*string_count + 1) * 2 > writer->string_slots)
+    {
+        grow_string_map(writer);
+    }
+    size_t slot = string_slot(writer, text);
+    if (writer->string_keys[slot] != NULL)
+    {
+        return writer->string_values[slot];
+    }
+
+    size_t length = strlen(text) + 1;
+    if (writer->string_size + length > UINT32_MAX - 1)
+    {
+        error_exit(ERR_INTERNAL, "AST too large for the AST file format");
+    }
+    if (writer->string_size + length > writer->string_capacity)
+    {
+        while (writer->string_size + length > writer->string_capacity)
+        {
+            writer->string_capacity = writer->string_capacity ? writer->string_capacity * 2 : AST_FILE_INITIAL_CAPACITY * 16;
+        }
+        writer->strings = safe_realloc(writer->strings, writer->string_capacity);
+    }
+    uint32_t offset = (uint32_t)writer->string_size;
+    memcpy(writer->strings + offset, text, length);
+    writer->string_size += length;
+
+    writer->string_keys[slot] = text;
+    writer->string_values[slot] = offset;
+    (*string_count)++;
+    return offset;
+}
+
+/**
+ * Computes the FNV-1a hash and the size of the source.
+ * Returns false for a source that cannot be read twice (a pipe).
+ */
+bool ast_file_source_hash(FILE *source, uint64_t *hash, uint64_t *size)
+{
+    long start = ftell(source);
+    if (start < 0)
+    {
+        return false;
+    }
+
+    unsigned char buffer[65536];
+    size_t length;
+    *hash = FNV_OFFSET_BASIS;
+    *size = 0;
+    while ((length = fread(buffer, 1, sizeof(buffer), source)) > 0)
+    {
+        *hash = fnv1a(*hash, buffer, length);
+        *size += length;
+    }
+    bool readable = !ferror(source);
+    clearerr(source);
+    return fseek(source, start, SEEK_SET) == 0 && readable;
+}
+
+/**
+ * Writes the AST and the symtable into a file.
+ */
+void ast_file_write(const char *filename, ASTNode *root, SymTable *symtable, uint64_t source_hash, uint64_t source_size)
+{
+    AstFileWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    size_t string_count = 0;
+
+    // Number the nodes, every numbered node adds its children to the end of the list
+    uint32_t root_index = node_index(&writer, root);
+    for (int i = 0; i < symtable->size; i++)
+    {
+        for (Symbol *symbol = symtable->table[i]; symbol != NULL; symbol = symbol->next)
+        {
+            node_index(&writer, symbol->declaration_node);
+        }
+    }
+    size_t index_count = 0;
+    for (size_t i = 0; i < writer.node_count; i++)
+    {
+        ASTNode *node = writer.nodes[i];
+        node_index(&writer, node->left);
+        node_index(&writer, node->right);
+        node_index(&writer, node->next);
+        node_index(&writer, node->condition);
+        node_index(&writer, node->body);
+        for (int j = 0; j < node->param_count; j++)
+        {
+            node_index(&writer, node->parameters[j]);
+        }
+        for (int j = 0; j < node->arg_count; j++)
+        {
+            node_index(&writer, node->arguments[j]);
+        }
+        index_count += (size_t)node->param_count + (size_t)node->arg_count;
+    }
+    if (writer.node_count >= AST_FILE_NONE || index_count >= AST_FILE_NONE)
+    {
+        error_exit(ERR_INTERNAL, "AST too large for the AST file format");
+    }
+
+    AstFileNode *nodes = safe_malloc((writer.node_count + 1) * sizeof(AstFileNode));
+    uint32_t *indices = safe_malloc((index_count + 1) * sizeof(uint32_t));
+    AstFileSymbol *symbols = safe_malloc(((size_t)symtable->count + 1) * sizeof(AstFileSymbol));
+
+    uint32_t next_index = 0;
+    for (size_t i = 0; i < writer.node_count; i++)
+    {
+        ASTNode *node = writer.nodes[i];
+        AstFileNode *record = &nodes[i];
+        record->type = (uint32_t)node->type;
+        record->data_type = (uint32_t)node->data_type;
+        record->left = node_index(&writer, node->left);
+        record->right = node_index(&writer, node->right);
+        record->next = node_index(&writer, node->next);
+        record->condition = node_index(&writer, node->condition);
+        record->body = node_index(&writer, node->body);
+        record->name = string_offset(&writer, &string_count, node->name);
+        record->value = string_offset(&writer, &string_count, node->value);
+        record->parameters = next_index;
+        record->param_count = (uint32_t)(node->param_count > 0 ? node->param_count : 0);
+        for (uint32_t j = 0; j < record->param_count; j++)
+        {
+            indices[next_index++] = node_index(&writer, node->parameters[j]);
+        }
+        record->arguments = next_index;
+        record->arg_count = (uint32_t)(node->arg_count > 0 ? node->arg_count : 0);
+        for (uint32_t j = 0; j < record->arg_count; j++)
+        {
+            indices[next_index++] = node_index(&writer, node->arguments[j]);
+        }
+        record->line = node->line;
+        record->column = node->column;
+        record->is_non_null = node->is_non_null ? 1u : 0u;
+    }
+
+    uint32_t symbol_count = 0;
+    for (int i = 0; i < symtable->size; i++)
+    {
+        for (Symbol *symbol = symtable->table[i]; symbol != NULL; symbol = symbol->next)
+        {
+            AstFileSymbol *record = &symbols[symbol_count++];
+            record->name = string_offset(&writer, &string_count, symbol->name);
+            record->symbol_type = (uint32_t)symbol->symbol_type;
+            record->data_type = (uint32_t)symbol->data_type;
+            record->parent_function = string_offset(&writer, &string_count, symbol->parent_function);
+            record->flags = (symbol->is_defined ? AST_SYMBOL_DEFINED : 0u) |
+                            (symbol->is_used ? AST_SYMBOL_USED : 0u) |
+                            (symbol->is_constant ? AST_SYMBOL_CONSTANT : 0u);
+            record->declaration_node = node_index(&writer, symbol->declaration_node);
+        }
+    }
+
+    AstFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, AST_FILE_MAGIC, sizeof(header.magic));
+    header.version = AST_FILE_VERSION;
+    header.byte_order = AST_FILE_BYTE_ORDER;
+    header.source_hash = source_hash;
+    header.source_size = source_size;
+    header.node_count = (uint32_t)writer.node_count;
+    header.index_count = (uint32_t)index_count;
+    header.symbol_count = symbol_count;
+    header.string_size = (uint32_t)writer.string_size;
+    header.root = root_index;
+
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        error_exit(ERR_INTERNAL, "Cannot open AST file %s for writing", filename);
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(nodes, sizeof(AstFileNode), writer.node_count, file) == writer.node_count &&
+                   fwrite(indices, sizeof(uint32_t), index_count, file) == index_count &&
+                   fwrite(symbols, sizeof(AstFileSymbol), symbol_count, file) == symbol_count &&
+                   fwrite(writer.strings, 1, writer.string_size, file) == writer.string_size;
+    if (fclose(file) != 0 || !written)
+    {
+        error_exit(ERR_INTERNAL, "Cannot write AST file %s", filename);
+    }
+
+    safe_free(symbols);
+    safe_free(indices);
+    safe_free(nodes);
+    safe_free(writer.strings);
+    safe_free(writer.string_keys);
+    safe_free(writer.string_values);
+    safe_free(writer.node_keys);
+    safe_free(writer.node_values);
+    safe_free(writer.nodes);
+}
+
+/**
+ * Checks a node index read from the file.
+ */
+static bool valid_index(uint32_t index, uint32_t count)
+{
+    return index == AST_FILE_NONE || index < count;
+}
+
+/**
+ * Checks a string offset read from the file, the string table ends with a NUL byte.
+ */
+static bool valid_string(uint32_t offset, uint32_t string_size)
+{
+    return offset == AST_FILE_NONE || offset < string_size;
+}
+
+/**
+ * Checks a list of the index section.
+ */
+static bool valid_list(uint32_t first, uint32_t count, const uint32_t *indices, uint32_t index_count, uint32_t node_count)
+{
+    if (count > index_count || first > index_count - count)
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (indices[first + i] >= node_count)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Checks the header and the size of every section against the file size.
+ */
+static bool valid_header(const AstFileHeader *header, size_t file_size, uint64_t source_hash, uint64_t source_size)
+{
+    if (memcmp(header->magic, AST_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != AST_FILE_VERSION || header->byte_order != AST_FILE_BYTE_ORDER ||
+        header->source_hash != source_hash || header->source_size != source_size)
+    {
+        return false;
+    }
+    uint64_t expected = (uint64_t)sizeof(AstFileHeader) +
+                        (uint64_t)header->node_count * sizeof(AstFileNode) +
+                        (uint64_t)header->index_count * sizeof(uint32_t) +
+                        (uint64_t)header->symbol_count * sizeof(AstFileSymbol) +
+                        (uint64_t)header->string_size;
+    return expected == file_size && header->root < header->node_count &&
+           header->node_count < AST_FILE_NONE && header->index_count < AST_FILE_NONE;
+}
+
+/**
+ * Returns the string at an offset of the mapped string table.
+ */
+static char *mapped_string(char *strings, uint32_t offset)
+{
+    return offset == AST_FILE_NONE ? NULL : strings + offset;
+}
+
+/**
+ * Maps the file and rebuilds the AST and the symtable.
+ * Nothing is allocated before the whole file has been checked.
+ */
+ASTNode *ast_file_load(const char *filename, SymTable *symtable, uint64_t source_hash, uint64_t source_size)
+{
+    ast_file_reset();
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t)sizeof(AstFileHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    size_t file_size = (size_t)file_stat.st_size;
+    void *mapping = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return NULL;
+    }
+    ast_file_state.mapping = mapping;
+    ast_file_state.mapping_size = file_size;
+
+    const AstFileHeader *header = mapping;
+    if (!valid_header(header, file_size, source_hash, source_size))
+    {
+        ast_file_reset();
+        return NULL;
+    }
+    const AstFileNode *records = (const AstFileNode *)(header + 1);
+    const uint32_t *indices = (const uint32_t *)(records + header->node_count);
+    const AstFileSymbol *symbols = (const AstFileSymbol *)(indices + header->index_count);
+    char *strings = (char *)(symbols + header->symbol_count);
+
+    bool valid = header->string_size == 0 || strings[header->string_size - 1] == '\0';
+    for (uint32_t i = 0; valid && i < header->node_count; i++)
+    {
+        const AstFileNode *record = &records[i];
+        valid = record->type <= NODE_BLOCK && record->data_type <= TYPE_U8_NULLABLE &&
+                valid_index(record->left, header->node_count) && valid_index(record->right, header->node_count) &&
+                valid_index(record->next, header->node_count) && valid_index(record->condition, header->node_count) &&
+                valid_index(record->body, header->node_count) &&
+                valid_string(record->name, header->string_size) && valid_string(record->value, header->string_size) &&
+                record->param_count <= INT32_MAX && record->arg_count <= INT32_MAX &&
+                valid_list(record->parameters, record->param_count, indices, header->index_count, header->node_count) &&
+                valid_list(record->arguments, record->arg_count, indices, header->index_count, header->node_count);
+    }
+    for (uint32_t i = 0; valid && i < header->symbol_count; i++)
+    {
+        const AstFileSymbol *record = &symbols[i];
+        valid = record->name != AST_FILE_NONE && valid_string(record->name, header->string_size) &&
+                valid_string(record->parent_function, header->string_size) &&
+                record->symbol_type <= SYMBOL_PARAMETER && record->data_type <= TYPE_U8_NULLABLE &&
+                valid_index(record->declaration_node, header->node_count);
+    }
+    if (!valid)
+    {
+        ast_file_reset();
+        return NULL;
+    }
+
+    // Turn indices back into pointers
+    ASTNode *nodes = safe_malloc((size_t)header->node_count * sizeof(ASTNode));
+    ASTNode **lists = safe_malloc(((size_t)header->index_count + 1) * sizeof(ASTNode *));
+    for (uint32_t i = 0; i < header->index_count; i++)
+    {
+        lists[i] = &nodes[indices[i]];
+    }
+    for (uint32_t i = 0; i < header->node_count; i++)
+    {
+        const AstFileNode *record = &records[i];
+        ASTNode *node = &nodes[i];
+        node->type = (NodeType)record->type;
+        node->data_type = (DataType)record->data_type;
+        node->left = record->left == AST_FILE_NONE ? NULL : &nodes[record->left];
+        node->right = record->right == AST_FILE_NONE ? NULL : &nodes[record->right];
+        node->next = record->next == AST_FILE_NONE ? NULL : &nodes[record->next];
+        node->condition = record->condition == AST_FILE_NONE ? NULL : &nodes[record->condition];
+        node->body = record->body == AST_FILE_NONE ? NULL : &nodes[record->body];
+        node->name = mapped_string(strings, record->name);
+        node->value = mapped_string(strings, record->value);
+        node->literal = NULL;
+        if (node->type == NODE_LITERAL && node->data_type == TYPE_U8 && node->value != NULL)
+        {
+            node->literal = string_pool_intern(node->value); // The pool is not part of the file
+        }
+        node->parameters = record->param_count ? &lists[record->parameters] : NULL;
+        node->param_count = (int)record->param_count;
+        node->arguments = record->arg_count ? &lists[record->arguments] : NULL;
+        node->arg_count = (int)record->arg_count;
+        node->is_non_null = record->is_non_null != 0;
+        node->line = record->line;
+        node->column = record->column;
+    }
+
+    symtable_init(symtable);
+    if (header->symbol_count > 0)
+    {
+        Symbol *symbol_array = safe_malloc((size_t)header->symbol_count * sizeof(Symbol));
+        for (uint32_t i = 0; i < header->symbol_count; i++)
+        {
+            const AstFileSymbol *record = &symbols[i];
+            Symbol *symbol = &symbol_array[i];
+            symbol->name = mapped_string(strings, record->name);
+            symbol->symbol_type = (SymbolType)record->symbol_type;
+            symbol->data_type = (DataType)record->data_type;
+            symbol->parent_function = mapped_string(strings, record->parent_function);
+            symbol->is_defined = (record->flags & AST_SYMBOL_DEFINED) != 0;
+            symbol->is_used = (record->flags & AST_SYMBOL_USED) != 0;
+            symbol->is_constant = (record->flags & AST_SYMBOL_CONSTANT) != 0;
+            symbol->declaration_node = record->declaration_node == AST_FILE_NONE ? NULL : &nodes[record->declaration_node];
+            symbol->next = NULL;
+            symtable_insert(symtable, symbol->name, symbol); // "_" of symtable_init is kept
+        }
+    }
+
+    return &nodes[header->root];
+}
+
+/**
+ * Unmaps the file, the AST built from it is released by cleanup_pointers_storage.
+ */
+void ast_file_reset(void)
+{
+    if (ast_file_state.mapping != NULL)
+    {
+        munmap(ast_file_state.mapping, ast_file_state.mapping_size);
+    }
+    ast_file_state.mapping = NULL;
+    ast_file_state.mapping_size = 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file ast_file.h
+ *
+ * Header file for the serialized AST format (--emit-ast, --ast-cache).
+ * The checked AST and the symtable are stored as arrays of fixed size records
+ * that refer to each other by index, so a file can be mapped with mmap and
+ * turned back into ASTNode structures without parsing the source again.
+ *
+ * Layout: AstFileHeader, AstFileNode[node_count], uint32_t[index_count] (parameter
+ * and argument lists), AstFileSymbol[symbol_count], string table[string_size].
+ * Strings are referenced by their offset in the string table.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef AST_FILE_H
+#define AST_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "ast.h"
+#include "symtable.h"
+
+#define AST_FILE_MAGIC "IFJ24AST"
+#define AST_FILE_VERSION 1u
+#define AST_FILE_BYTE_ORDER 0x01020304u // Files are only loaded on machines with the same byte order
+#define AST_FILE_NONE 0xFFFFFFFFu       // Index of a NULL pointer
+
+/** File header */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_hash; // FNV-1a of the source the AST was parsed from
+    uint64_t source_size;
+    uint32_t node_count;
+    uint32_t index_count;
+    uint32_t symbol_count;
+    uint32_t string_size;
+    uint32_t root; // Program node
+    uint32_t reserved;
+} AstFileHeader;
+
+/** One ASTNode, pointers are replaced by node indices, strings by offsets */
+typedef struct {
+    uint32_t type;
+    uint32_t data_type;
+    uint32_t left;
+    uint32_t right;
+    uint32_t next;
+    uint32_t condition;
+    uint32_t body;
+    uint32_t name;
+    uint32_t value;
+    uint32_t parameters; // First entry in the index list
+    uint32_t param_count;
+    uint32_t arguments;
+    uint32_t arg_count;
+    int32_t line;
+    int32_t column;
+    uint32_t is_non_null;
+} AstFileNode;
+
+/** One Symbol of the symtable */
+typedef struct {
+    uint32_t name;
+    uint32_t symbol_type;
+    uint32_t data_type;
+    uint32_t parent_function;
+    uint32_t flags; // AST_SYMBOL_* bits
+    uint32_t declaration_node;
+} AstFileSymbol;
+
+#define AST_SYMBOL_DEFINED 0x1u
+#define AST_SYMBOL_USED 0x2u
+#define AST_SYMBOL_CONSTANT 0x4u
+
+/** Mapped file of the current compilation (part of CompilerContext) */
+typedef struct {
+    void *mapping;
+    size_t mapping_size;
+} AstFileState;
+
+// Computes the hash and size of a seekable source, the read position is restored
+bool ast_file_source_hash(FILE *source, uint64_t *hash, uint64_t *size);
+
+// Writes the AST and the symtable, error_exit on failure
+void ast_file_write(const char *filename, ASTNode *root, SymTable *symtable, uint64_t source_hash, uint64_t source_size);
+
+// Maps a file written for the same source and rebuilds the AST and the symtable from it.
+// Returns the program node, NULL if the file is missing, invalid or written for another source.
+ASTNode *ast_file_load(const char *filename, SymTable *symtable, uint64_t source_hash, uint64_t source_size);
+
+// Unmaps the file of the previous compilation
+void ast_file_reset(void);
+
+#endif // AST_FILE_H
@@ -0,0 +1,282 @@
+/**
+ * @file batch.c
+ *
+ * Implementation of the batch compilation driver.
+ * Workers take sources from a shared index, compile them in their own
+ * CompilerContext and record the exit code of each source. Errors are
+ * printed with the source name in front and do not stop other sources.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "batch.h"
+#include "compiler.h"
+#include "error.h"
+#include <errno.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_BATCH_JOBS 256
+
+/** Work shared by all workers of one batch */
+typedef struct {
+    char *const *sources;
+    int source_count;
+    char **paths;         // Output file of every source
+    CompileOptions options;
+    int next_source;      // Index of the next source to compile, guarded by lock
+    pthread_mutex_t lock;
+    int *results;         // Exit code of every source
+} BatchWork;
+
+/**
+ * Returns the number of online processors.
+ */
+int batch_default_jobs(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1)
+    {
+        return 1;
+    }
+    return count > MAX_BATCH_JOBS ? MAX_BATCH_JOBS : (int)count;
+}
+
+/**
+ * Builds output_dir/<base name of source without .ifj>.code into a malloc'd string.
+ */
+static char *output_path(const char *output_dir, const char *source)
+{
+    const char *name = strrchr(source, '/');
+    name = name ? name + 1 : source;
+    size_t name_len = strlen(name);
+    if (name_len > 4 && strcmp(name + name_len - 4, ".ifj") == 0)
+    {
+        name_len -= 4;
+    }
+
+    size_t size = strlen(output_dir) + name_len + sizeof("/.code");
+    char *path = malloc(size);
+    if (path != NULL)
+    {
+        snprintf(path, size, "%s/%.*s.code", output_dir, (int)name_len, name);
+    }
+    return path;
+}
+
+/**
+ * Frees the output paths, the array may be only partly filled.
+ */
+static void free_paths(char **paths, int source_count)
+{
+    for (int i = 0; paths != NULL && i < source_count; i++)
+    {
+        free(paths[i]);
+    }
+    free(paths);
+}
+
+/** Output path of one source, sorted to find the sources that share it */
+typedef struct {
+    const char *path;
+    int source;
+} OutputName;
+
+static int compare_output_names(const void *a, const void *b)
+{
+    return strcmp(((const OutputName *)a)->path, ((const OutputName *)b)->path);
+}
+
+/**
+ * Builds the output path of every source into a malloc'd array.
+ * Only the base name is kept, so a/x.ifj and b/x.ifj would overwrite each
+ * other's output. Such a batch is refused before anything is compiled.
+ * Returns NULL after printing the reason.
+ */
+static char **output_paths(char *const *sources, int source_count, const char *output_dir)
+{
+    char **paths = calloc(source_count > 0 ? (size_t)source_count : 1, sizeof(char *));
+    OutputName *names = malloc((source_count > 0 ? (size_t)source_count : 1) * sizeof(OutputName));
+    bool ok = paths != NULL && names != NULL;
+    for (int i = 0; ok && i < source_count; i++)
+    {
+        paths[i] = output_path(output_dir, sources[i]);
+        names[i].path = paths[i];
+        names[i].source = i;
+        ok = paths[i] != NULL;
+    }
+
+    if (ok)
+    {
+        qsort(names, (size_t)source_count, sizeof(OutputName), compare_output_names);
+        for (int i = 1; i < source_count; i++)
+        {
+            if (strcmp(names[i - 1].path, names[i].path) == 0)
+            {
+                fprintf(stderr, "Sources %s and %s would both be compiled into %s\n", sources[names[i - 1].source],
+                        sources[names[i].source], names[i].path);
+                ok = false;
+            }
+        }
+    }
+
+    free(names);
+    if (!ok)
+    {
+        free_paths(paths, source_count);
+        return NULL;
+    }
+    return paths;
+}
+
+/**
+ * Compiles one source in the context of the calling thread.
+ */
+static int compile_source(const char *source, const char *path, const CompileOptions *options)
+{
+    FILE *source_file = fopen(source, "r");
+    if (source_file == NULL)
+    {
+        fprintf(stderr, "Error opening file: %s\n", source);
+        return ERR_INTERNAL;
+    }
+
+    current_context->source_name = source;
+    jmp_buf recovery;
+    int result;
+    if (setjmp(recovery) == 0)
+    {
+        error_set_recovery(&recovery);
+        result = compiler_compile(source_file, path, NULL, options);
+    }
+    else
+    {
+        result = current_context->error_code;
+    }
+    error_set_recovery(NULL);
+    current_context->source_name = NULL;
+
+    // Closes the output file if the error came in the middle of code generation
+    compiler_reset();
+    fclose(source_file);
+    return result;
+}
+
+/**
+ * Worker thread, compiles sources until none are left.
+ */
+static void *batch_worker(void *argument)
+{
+    BatchWork *work = argument;
+    CompilerContext *previous_context = current_context;
+    CompilerContext context;
+    compiler_context_activate(&context);
+
+    for (;;)
+    {
+        pthread_mutex_lock(&work->lock);
+        int index = work->next_source++;
+        pthread_mutex_unlock(&work->lock);
+
+        if (index >= work->source_count)
+        {
+            break;
+        }
+        work->results[index] = compile_source(work->sources[index], work->paths[index], &work->options);
+    }
+
+    current_context = previous_context;
+    return NULL;
+}
+
+/**
+ * Compiles all sources with the given number of worker threads.
+ */
+int batch_compile(char *const *sources, int source_count, const char *output_dir, int jobs, const CompileOptions *options)
+{
+    char **paths = output_paths(sources, source_count, output_dir);
+    if (paths == NULL)
+    {
+        return ERR_INTERNAL;
+    }
+    if (mkdir(output_dir, 0777) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Cannot create output directory %s\n", output_dir);
+        free_paths(paths, source_count);
+        return ERR_INTERNAL;
+    }
+
+    BatchWork work;
+    work.sources = sources;
+    work.source_count = source_count;
+    work.paths = paths;
+    work.options = *options;
+    work.options.null_report = false;
+    work.options.time_passes = false;
+    work.options.tail_call_report = false;
+    work.options.emit_ast = NULL;
+    work.options.ast_cache = NULL;
+    work.next_source = 0;
+    work.results = calloc(source_count > 0 ? (size_t)source_count : 1, sizeof(int));
+    if (work.results == NULL || pthread_mutex_init(&work.lock, NULL) != 0)
+    {
+        free(work.results);
+        free_paths(paths, source_count);
+        return ERR_INTERNAL;
+    }
+
+    if (jobs > source_count)
+    {
+        jobs = source_count;
+    }
+    if (jobs > MAX_BATCH_JOBS)
+    {
+        jobs = MAX_BATCH_JOBS;
+    }
+
+    pthread_t threads[MAX_BATCH_JOBS];
+    int started = 0;
+    // The main thread is a worker too, so -j 1 does not create any thread
+    while (started < jobs - 1 && pthread_create(&threads[started], NULL, batch_worker, &work) == 0)
+    {
+        started++;
+    }
+    batch_worker(&work);
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    int result = ERR_OK;
+    int failed = 0;
+    for (int i = 0; i < source_count; i++)
+    {
+        if (work.results[i] != ERR_OK)
+        {
+            if (failed++ == 0)
+            {
+                result = work.results[i];
+            }
+        }
+    }
+    if (failed > 0)
+    {
+        fprintf(stderr, "%d of %d programs failed\n", failed, source_count);
+    }
+
+    pthread_mutex_destroy(&work.lock);
+    free(work.results);
+    free_paths(paths, source_count);
+    return result;
+}
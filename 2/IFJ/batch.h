@@ -0,0 +1,29 @@
+/**
+ * @file batch.h
+ *
+ * Header file for the batch compilation driver (-j N -o outdir).
+ * Compiles many independent programs concurrently in one process,
+ * every worker thread has its own CompilerContext.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include "compiler.h"
+
+// Returns the number of workers used when -j is not given
+int batch_default_jobs(void);
+
+// Compiles every source into output_dir/<name>.code, returns the error code of the first failed source or ERR_OK
+// Sources with the same base name are refused with ERR_INTERNAL, their outputs would overwrite each other
+// Only the code generation options are used, reports are not printed in batch mode
+int batch_compile(char *const *sources, int source_count, const char *output_dir, int jobs, const CompileOptions *options);
+
+#endif // BATCH_H
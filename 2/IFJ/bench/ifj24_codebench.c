@@ -0,0 +1,174 @@
+/**
+ * @file ifj24_codebench.c
+ *
+ * Compares the text and the binary form of IFJcode24 (ifjcode.h) on generated code:
+ * size of both forms and the time a downstream tool needs to read each of them
+ * into instructions with resolved labels. Also checks that the text written back
+ * from the binary form is the same as the input.
+ *
+ * Usage: ifj24_codebench [-r repeats] code_file...
+ *   -r  how many times each form is read, the best time is reported (default 20)
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "../ifjcode.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Returns the monotonic time in milliseconds.
+ */
+static double now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+/**
+ * Reads the whole file, returns NULL on failure.
+ */
+static char *read_file(const char *filename, size_t *length)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    size_t capacity = 4096;
+    char *text = malloc(capacity);
+    *length = 0;
+    size_t read;
+    while (text != NULL && (read = fread(text + *length, 1, capacity - *length, file)) > 0)
+    {
+        *length += read;
+        if (*length == capacity)
+        {
+            capacity *= 2;
+            char *grown = realloc(text, capacity);
+            if (grown == NULL)
+            {
+                free(text);
+            }
+            text = grown;
+        }
+    }
+    fclose(file);
+    return text;
+}
+
+/**
+ * Measures one code file, returns 0 when both forms were read and the round trip is exact.
+ */
+static int bench_file(const char *filename, int repeats)
+{
+    size_t text_size;
+    char *text = read_file(filename, &text_size);
+    if (text == NULL)
+    {
+        fprintf(stderr, "Cannot read %s\n", filename);
+        return -1;
+    }
+
+    IfjcodeProgram program;
+    memset(&program, 0, sizeof(program));
+    char *binary = NULL;
+    size_t binary_size = 0;
+    char *round_trip = NULL;
+    size_t round_trip_size = 0;
+    int result = -1;
+
+    FILE *binary_stream = open_memstream(&binary, &binary_size);
+    if (binary_stream == NULL || ifjcode_parse_text(&program, text, text_size) != 0 ||
+        ifjcode_write_binary(&program, binary_stream) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", filename, program.error);
+        if (binary_stream != NULL)
+        {
+            fclose(binary_stream);
+        }
+        goto done;
+    }
+    fclose(binary_stream);
+
+    double text_ms = -1.0;
+    double binary_ms = -1.0;
+    for (int i = 0; i < repeats; i++)
+    {
+        double start = now_ms();
+        ifjcode_parse_text(&program, text, text_size);
+        double elapsed = now_ms() - start;
+        text_ms = (text_ms < 0 || elapsed < text_ms) ? elapsed : text_ms;
+
+        start = now_ms();
+        if (ifjcode_load_binary(&program, (const unsigned char *)binary, binary_size) != 0)
+        {
+            fprintf(stderr, "%s: %s\n", filename, program.error);
+            goto done;
+        }
+        elapsed = now_ms() - start;
+        binary_ms = (binary_ms < 0 || elapsed < binary_ms) ? elapsed : binary_ms;
+    }
+
+    FILE *text_stream = open_memstream(&round_trip, &round_trip_size);
+    if (text_stream == NULL || ifjcode_write_text(&program, text_stream) != 0)
+    {
+        fprintf(stderr, "%s: cannot write the text form\n", filename);
+        if (text_stream != NULL)
+        {
+            fclose(text_stream);
+        }
+        goto done;
+    }
+    fclose(text_stream);
+    bool exact = round_trip_size == text_size && memcmp(round_trip, text, text_size) == 0;
+
+    printf("%-32s %12zu %12zu %7.1f%% %10u %10.3f %10.3f %7.1fx %s\n", filename, text_size, binary_size,
+           100.0 * (double)binary_size / (double)text_size, program.instruction_count, text_ms, binary_ms,
+           binary_ms > 0 ? text_ms / binary_ms : 0.0, exact ? "exact" : "DIFFERS");
+    result = exact ? 0 : -1;
+
+done:
+    ifjcode_free(&program);
+    free(round_trip);
+    free(binary);
+    free(text);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int repeats = 20;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-r") == 0)
+    {
+        repeats = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || repeats < 1)
+    {
+        fprintf(stderr, "Usage: %s [-r repeats] code_file...\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-32s %12s %12s %8s %10s %10s %10s %8s %s\n", "file", "text (B)", "binary (B)", "size", "instrs",
+           "text (ms)", "binary (ms)", "speedup", "round trip");
+    int result = 0;
+    for (int i = first; i < argc; i++)
+    {
+        if (bench_file(argv[i], repeats) != 0)
+        {
+            result = 1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file ifj24_gen.c
+ *
+ * Generator of synthetic IFJ24 programs for compiler scaling benchmarks.
+ * The generated programs are valid for ifj24_compiler (every variable and
+ * function is used, no redefinitions, non-void functions end with return).
+ *
+ * Usage: ifj24_gen [-f functions] [-d depth] [-l locals] [-e terms] [-s strings] [-x scale]
+ *   -f  number of functions besides main (default 10)
+ *   -d  nesting depth of if/while blocks in each function (default 3)
+ *   -l  local variables per function (default 8)
+ *   -e  operands in each generated expression (default 6)
+ *   -s  string literals written by each function (default 4)
+ *   -x  multiplier applied to the number of functions (default 1)
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NESTING_DEPTH 40 // Each level opens two parser scopes (MAX_SCOPE_DEPTH 100)
+
+/**
+ * Generator settings
+ */
+typedef struct {
+    int functions;
+    int depth;
+    int locals;
+    int terms;
+    int strings;
+} GeneratorConfig;
+
+static int name_counter = 0; // Makes every nested variable name unique in its function
+
+/**
+ * Prints indentation for the given nesting level.
+ */
+static void indent(int level)
+{
+    for (int i = 0; i < level; i++)
+    {
+        fputs("    ", stdout);
+    }
+}
+
+/**
+ * Prints an i32 expression with the given number of operands.
+ * Operands are taken from locals v0..v(locals-1) and integer literals.
+ */
+static void emit_expression(const GeneratorConfig *config, int seed)
+{
+    static const char *operators[] = {" + ", " * ", " - "};
+
+    for (int i = 0; i < config->terms; i++)
+    {
+        if (i > 0)
+        {
+            fputs(operators[(seed + i) % 3], stdout);
+        }
+        if ((seed + i) % 4 == 3)
+        {
+            printf("%d", (seed * 7 + i) % 97 + 1);
+        }
+        else
+        {
+            printf("v%d", (seed + i) % config->locals);
+        }
+    }
+}
+
+/**
+ * Prints nested if/else and while blocks down to the configured depth.
+ * The result of every level is stored back to v0, so all names are used.
+ */
+static void emit_nested_block(const GeneratorConfig *config, int level, int seed)
+{
+    if (level > config->depth)
+    {
+        return;
+    }
+
+    int id = name_counter++;
+
+    indent(level);
+    printf("var n%d: i32 = ", id);
+    emit_expression(config, seed + level);
+    printf(";\n");
+
+    indent(level);
+    printf("if (n%d < v%d) {\n", id, level % config->locals);
+    indent(level + 1);
+    printf("while (n%d > 1000) {\n", id);
+    indent(level + 2);
+    printf("n%d = n%d - 1000;\n", id, id);
+    indent(level + 1);
+    printf("}\n");
+    emit_nested_block(config, level + 1, seed + 1);
+    indent(level);
+    printf("} else {\n");
+    indent(level + 1);
+    printf("n%d = n%d + v%d;\n", id, id, (level + 1) % config->locals);
+    indent(level);
+    printf("}\n");
+
+    indent(level);
+    printf("v0 = n%d;\n", id);
+}
+
+/**
+ * Prints a string literal write with a deterministic text.
+ */
+static void emit_string_write(int function_index, int string_index)
+{
+    printf("    ifj.write(\"function %d writes literal %d with some padding text to scan\\n\");\n",
+           function_index, string_index);
+}
+
+/**
+ * Prints one generated function funN(a: i32, b: i32) i32.
+ */
+static void emit_function(const GeneratorConfig *config, int index)
+{
+    name_counter = 0;
+
+    printf("pub fn fun%d(a: i32, b: i32) i32 {\n", index);
+    printf("    var v0: i32 = a + b + %d;\n", index % 50 + 1);
+    for (int i = 1; i < config->locals; i++)
+    {
+        printf("    var v%d: i32 = v%d * 2 + b;\n", i, i - 1);
+    }
+    if (config->locals > 1)
+    {
+        printf("    v0 = v0 + v%d;\n", config->locals - 1);
+    }
+    for (int i = 0; i < config->strings; i++)
+    {
+        emit_string_write(index, i);
+    }
+    emit_nested_block(config, 1, index);
+    printf("    const r = ");
+    emit_expression(config, index + 5);
+    printf(";\n");
+    printf("    return r;\n");
+    printf("}\n");
+}
+
+/**
+ * Prints main that calls every generated function.
+ */
+static void emit_main(const GeneratorConfig *config)
+{
+    printf("pub fn main() void {\n");
+    for (int i = 0; i < config->functions; i++)
+    {
+        printf("    const r%d = fun%d(%d, %d);\n", i, i, i % 13, i % 7);
+        printf("    ifj.write(r%d);\n", i);
+    }
+    printf("    ifj.write(\"\\n\");\n");
+    printf("}\n");
+}
+
+/**
+ * Parses a non-negative integer option value.
+ */
+static int parse_count(const char *option, const char *value, int minimum)
+{
+    char *end = NULL;
+    long number = value ? strtol(value, &end, 10) : -1;
+    if (value == NULL || *end != '\0' || number < minimum || number > 1000000)
+    {
+        fprintf(stderr, "Invalid value for %s: %s\n", option, value ? value : "(missing)");
+        exit(1);
+    }
+    return (int)number;
+}
+
+int main(int argc, char *argv[])
+{
+    GeneratorConfig config = {10, 3, 8, 6, 4};
+    int scale = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "-f") == 0)
+            config.functions = parse_count(argv[i], value, 1);
+        else if (strcmp(argv[i], "-d") == 0)
+            config.depth = parse_count(argv[i], value, 0);
+        else if (strcmp(argv[i], "-l") == 0)
+            config.locals = parse_count(argv[i], value, 1);
+        else if (strcmp(argv[i], "-e") == 0)
+            config.terms = parse_count(argv[i], value, 1);
+        else if (strcmp(argv[i], "-s") == 0)
+            config.strings = parse_count(argv[i], value, 0);
+        else if (strcmp(argv[i], "-x") == 0)
+            scale = parse_count(argv[i], value, 1);
+        else
+        {
+            fprintf(stderr, "Usage: %s [-f functions] [-d depth] [-l locals] [-e terms] [-s strings] [-x scale]\n", argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    if (config.depth > MAX_NESTING_DEPTH)
+    {
+        fprintf(stderr, "Nesting depth is limited to %d\n", MAX_NESTING_DEPTH);
+        return 1;
+    }
+    config.functions *= scale;
+
+    printf("const ifj = @import(\"ifj24.zig\");\n");
+    for (int i = 0; i < config.functions; i++)
+    {
+        emit_function(&config, i);
+    }
+    emit_main(&config);
+
+    return 0;
+}
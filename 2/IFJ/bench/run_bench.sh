@@ -0,0 +1,122 @@
+#!/bin/sh
+#
+# @file run_bench.sh
+#
+# Compiler scaling benchmark. Generates programs at 1x, 10x and 100x of a base
+# size, compiles each one with --time-passes=json and prints per phase times,
+# throughput and growth. A phase is reported as super-linear when its growth
+# between two sizes is more than twice the growth of the source size.
+# The largest program is compiled again with --low-memory to compare time and
+# peak memory of both modes.
+#
+# Usage: run_bench.sh [compiler] [generator]
+#   BENCH_FLAGS    generator options of the 1x program (default "-f 1 -d 3 -l 6 -e 5 -s 2")
+#   BENCH_SCALES   scales to run (default "1 10 100")
+#   BENCH_DIR      directory for generated programs and reports (default bench/out)
+#
+# IFJ Project 2024, Team 'xstepa77'
+#
+# @author <xlitvi02> Gleb Litvinchuk
+# @author <xstepa77> Pavel Stepanov
+# @author <xkovin00> Viktoriia Kovina
+# @author <xshmon00> Gleb Shmonin
+#
+
+COMPILER=${1:-./ifj24_compiler}
+GENERATOR=${2:-./bench/ifj24_gen}
+FLAGS=${BENCH_FLAGS:-"-f 1 -d 3 -l 6 -e 5 -s 2"}
+SCALES=${BENCH_SCALES:-"1 10 100"}
+DIR=${BENCH_DIR:-bench/out}
+
+mkdir -p "$DIR" || exit 1
+
+# Pulls one numeric field of one phase out of the single line JSON report
+json_field() {
+    # $1 = report, $2 = phase name or "total", $3 = field
+    if [ "$2" = "total" ]; then
+        sed -e 's/.*"total": {//' "$1"
+    else
+        sed -e 's/}/}\n/g' "$1" | grep "\"name\": \"$2\""
+    fi | sed -e "s/.*\"$3\": \([0-9.]*\).*/\1/" | head -n 1
+}
+
+PHASES="scanner pre_run parse scope_check symtable_check codegen cleanup total"
+PREVIOUS=""
+STATUS=0
+
+for SCALE in $SCALES; do
+    SOURCE="$DIR/bench_x$SCALE.ifj"
+    REPORT="$DIR/bench_x$SCALE.json"
+
+    # shellcheck disable=SC2086
+    "$GENERATOR" $FLAGS -x "$SCALE" > "$SOURCE" || exit 1
+    if ! "$COMPILER" --time-passes=json "$SOURCE" /dev/null 2> "$REPORT"; then
+        echo "bench: compilation of $SOURCE failed" >&2
+        cat "$REPORT" >&2
+        exit 1
+    fi
+    # The report is the last line of stderr
+    tail -n 1 "$REPORT" > "$REPORT.tmp" && mv "$REPORT.tmp" "$REPORT"
+
+    SIZE=$(wc -c < "$SOURCE" | tr -d ' ')
+    TOTAL_MS=$(json_field "$REPORT" total wall_ms)
+
+    echo "== ${SCALE}x: $SIZE bytes, $(awk -v s="$SIZE" -v t="$TOTAL_MS" \
+        'BEGIN { if (t > 0) printf "%.1f KB/s", s / 1024 / (t / 1000); else print "n/a" }')"
+    printf "%-16s %12s %16s %10s %s\n" "phase" "wall (ms)" "registry scans" "growth" ""
+
+    for PHASE in $PHASES; do
+        WALL=$(json_field "$REPORT" "$PHASE" wall_ms)
+        SCANS=$(json_field "$REPORT" "$PHASE" registry_scans)
+        LINE=$(awk -v w="$WALL" -v s="$SCANS" -v p="$PHASE" 'BEGIN { printf "%-16s %12.3f %16.0f", p, w, s }')
+
+        if [ -n "$PREVIOUS" ]; then
+            OLD_WALL=$(json_field "$PREVIOUS" "$PHASE" wall_ms)
+            OLD_SCANS=$(json_field "$PREVIOUS" "$PHASE" registry_scans)
+            # Phases under 1 ms are dominated by noise, registry scans are exact counts
+            VERDICT=$(awk -v w="$WALL" -v ow="$OLD_WALL" -v s="$SCANS" -v os="$OLD_SCANS" \
+                -v size="$SIZE" -v osize="$OLD_SIZE" 'BEGIN {
+                    limit = 2 * size / osize
+                    growth = (ow > 0) ? w / ow : 0
+                    flag = ""
+                    if (ow >= 1 && growth > limit) flag = "SUPER-LINEAR time"
+                    if (os > 0 && s / os > limit) flag = flag (flag == "" ? "" : ", ") "SUPER-LINEAR registry"
+                    printf "%9.1fx %s", growth, flag
+                }')
+            LINE="$LINE $VERDICT"
+            case "$VERDICT" in
+            *SUPER-LINEAR*) STATUS=2 ;;
+            esac
+        fi
+        echo "$LINE"
+    done
+    echo
+
+    PREVIOUS="$REPORT"
+    OLD_SIZE=$SIZE
+done
+
+# The largest program once more in low memory mode (--low-memory)
+if [ -n "$PREVIOUS" ]; then
+    LOW_REPORT="$DIR/bench_low_memory.json"
+    if ! "$COMPILER" --low-memory --time-passes=json "$SOURCE" /dev/null 2> "$LOW_REPORT"; then
+        echo "bench: low memory compilation of $SOURCE failed" >&2
+        exit 1
+    fi
+    tail -n 1 "$LOW_REPORT" > "$LOW_REPORT.tmp" && mv "$LOW_REPORT.tmp" "$LOW_REPORT"
+
+    echo "== low memory mode on $SOURCE"
+    printf "%-16s %12s %16s\n" "mode" "wall (ms)" "peak RSS (kB)"
+    for MODE_REPORT in "$PREVIOUS" "$LOW_REPORT"; do
+        MODE=default
+        [ "$MODE_REPORT" = "$LOW_REPORT" ] && MODE=low_memory
+        printf "%-16s %12s %16s\n" "$MODE" "$(json_field "$MODE_REPORT" total wall_ms)" \
+            "$(sed -e 's/.*"peak_rss_kb": \([0-9]*\).*/\1/' "$MODE_REPORT")"
+    done
+fi
+
+if [ "$STATUS" -ne 0 ]; then
+    echo "bench: super-linear growth detected" >&2
+fi
+# Growth is reported, not enforced, so the target does not fail the build
+exit 0
@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+# @file run_code_bench.sh
+#
+# Binary IFJcode24 benchmark. Generates programs at 1x, 10x and 100x of a base
+# size, compiles each one to the text form and with --binary, checks that the
+# assembler produces the same binary and the disassembler the same text, and
+# compares the size and the read time of both forms with ifj24_codebench.
+#
+# Usage: run_code_bench.sh [compiler] [generator] [codebench] [assembler] [disassembler]
+#   BENCH_FLAGS    generator options of the 1x program (default "-f 1 -d 3 -l 6 -e 5 -s 2")
+#   BENCH_SCALES   scales to run (default "1 10 100")
+#   BENCH_DIR      directory for generated programs and code (default bench/out)
+#
+# IFJ Project 2024, Team 'xstepa77'
+#
+# @author <xlitvi02> Gleb Litvinchuk
+# @author <xstepa77> Pavel Stepanov
+# @author <xkovin00> Viktoriia Kovina
+# @author <xshmon00> Gleb Shmonin
+#
+
+COMPILER=${1:-./ifj24_compiler}
+GENERATOR=${2:-./bench/ifj24_gen}
+CODEBENCH=${3:-./bench/ifj24_codebench}
+ASSEMBLER=${4:-./tools/ifj24_asm}
+DISASSEMBLER=${5:-./tools/ifj24_disasm}
+FLAGS=${BENCH_FLAGS:-"-f 1 -d 3 -l 6 -e 5 -s 2"}
+SCALES=${BENCH_SCALES:-"1 10 100"}
+DIR=${BENCH_DIR:-bench/out}
+
+mkdir -p "$DIR" || exit 1
+
+CODES=""
+for SCALE in $SCALES; do
+    SOURCE="$DIR/code_x$SCALE.ifj"
+    CODE="$DIR/code_x$SCALE.code"
+    BINARY="$DIR/code_x$SCALE.bin"
+
+    # shellcheck disable=SC2086
+    "$GENERATOR" $FLAGS -x "$SCALE" > "$SOURCE" || exit 1
+    if ! "$COMPILER" "$SOURCE" "$CODE" || ! "$COMPILER" --binary "$SOURCE" "$BINARY"; then
+        echo "bench: compilation of $SOURCE failed" >&2
+        exit 1
+    fi
+
+    # Both conversions must be lossless
+    if ! "$ASSEMBLER" "$CODE" | cmp -s - "$BINARY"; then
+        echo "bench: assembled $CODE differs from the --binary output" >&2
+        exit 1
+    fi
+    if ! "$DISASSEMBLER" "$BINARY" | cmp -s - "$CODE"; then
+        echo "bench: disassembled $BINARY differs from the text output" >&2
+        exit 1
+    fi
+    CODES="$CODES $CODE"
+done
+
+# shellcheck disable=SC2086
+"$CODEBENCH" $CODES
@@ -12,36 +12,33 @@
  *   <xshmon00> Gleb Shmonin
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include "codegen.h"
 #include "ast.h"
 #include "parser.h"
 #include "utils.h"
 #include "error.h"
+#include "nullability.h"
+#include "string_pool.h"
+#include "compiler.h"
+#include "ifjcode.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static TempVarMapEntry *temp_var_map = NULL;
-static int unique_var_counter = 0;
-static int temp_var_counter = 0;
-static BuiltinFunctionUsage builtin_function_usage = {false, false, false};
-
-DeclaredVar *declared_vars = NULL;
-TempVar *temp_vars = NULL;
-
-/** Global variable for storing the output file */
-static FILE *output_file;
+/** Code generator state of the compilation running in this thread */
+#define codegen_state (current_context->codegen)
 
 int get_next_temp_var() {
-    return temp_var_counter++;
+    return codegen_state.temp_var_counter++;
 }
 
 /**
  * Adds a temporary variable to the list if not already added.
  */
 void add_temp_var(const char *var_name) {
-    TempVar *current = temp_vars;
+    TempVar *current = codegen_state.temp_vars;
     while (current) {
         if (strcmp(current->name, var_name) == 0) {
             return; // Variable already added
@@ -51,29 +48,29 @@ void add_temp_var(const char *var_name) {
 
     TempVar *new_var = safe_malloc(sizeof(TempVar));
     new_var->name = string_duplicate(var_name);
-    new_var->next = temp_vars;
-    temp_vars = new_var;
+    new_var->next = codegen_state.temp_vars;
+    codegen_state.temp_vars = new_var;
 }
 
 /**
  * Resets the list of temporary variables.
  */
 void reset_temp_vars() {
-    TempVar *current = temp_vars;
+    TempVar *current = codegen_state.temp_vars;
     while (current) {
         TempVar *next = current->next;
         safe_free(current->name);
         safe_free(current);
         current = next;
     }
-    temp_vars = NULL;
+    codegen_state.temp_vars = NULL;
 }
 
 /**
  * Checks if a variable is already declared.
  */
 bool is_variable_declared(const char *var_name) {
-    DeclaredVar *current = declared_vars;
+    DeclaredVar *current = codegen_state.declared_vars;
     while (current) {
         if (strcmp(current->var_name, var_name) == 0) {
             return true;
@@ -93,15 +90,15 @@ void add_declared_variable(const char *var_name) {
     }
     DeclaredVar *new_var = safe_malloc(sizeof(DeclaredVar));
     new_var->var_name = string_duplicate(var_name);
-    new_var->next = declared_vars;
-    declared_vars = new_var;
+    new_var->next = codegen_state.declared_vars;
+    codegen_state.declared_vars = new_var;
 }
 
 /**
  * Resets the temporary variable map.
  */
 void reset_temp_var_map() {
-    TempVarMapEntry *entry = temp_var_map;
+    TempVarMapEntry *entry = codegen_state.temp_var_map;
     while (entry != NULL) {
         TempVarMapEntry *next = entry->next;
         safe_free(entry->var_name);
@@ -109,21 +106,21 @@ void reset_temp_var_map() {
         safe_free(entry);
         entry = next;
     }
-    temp_var_map = NULL;
+    codegen_state.temp_var_map = NULL;
 }
 
 /**
  * Resets the list of declared variables.
  */
 void reset_declared_variables() {
-    DeclaredVar *current = declared_vars;
+    DeclaredVar *current = codegen_state.declared_vars;
     while (current) {
         DeclaredVar *next = current->next;
         safe_free(current->var_name);
         safe_free(current);
         current = next;
     }
-    declared_vars = NULL;
+    codegen_state.declared_vars = NULL;
 }
 
 /**
@@ -132,7 +129,7 @@ void reset_declared_variables() {
  */
 char *generate_unique_var_name(const char *base_name, ASTNode *node, const char *key) {
     char *var_name = safe_malloc(64);
-    snprintf(var_name, 64, "%%%s_%d", base_name, unique_var_counter++);
+    snprintf(var_name, 64, "%%%s_%d", base_name, codegen_state.unique_var_counter++);
     add_temp_var(var_name); // Add to temp variable list
 
     if (node != NULL && key != NULL) {
@@ -141,266 +138,432 @@ char *generate_unique_var_name(const char *base_name, ASTNode *node, const char
         new_entry->node = node;
         new_entry->key = string_duplicate(key);
         new_entry->var_name = var_name;
-        new_entry->next = temp_var_map;
-        temp_var_map = new_entry;
+        new_entry->next = codegen_state.temp_var_map;
+        codegen_state.temp_var_map = new_entry;
     }
 
     return var_name;
 }
 
 /**
- * Retrieves the temporary variable name associated with a given AST node and key.
+ * Looks up the temporary variable name associated with a given AST node and key.
+ * Returns NULL if there is none.
  */
-char *get_temp_var_name_for_node(ASTNode *node, const char *key) {
-    TempVarMapEntry *entry = temp_var_map;
+static char *find_temp_var_name_for_node(ASTNode *node, const char *key) {
+    TempVarMapEntry *entry = codegen_state.temp_var_map;
     while (entry != NULL) {
         if (entry->node == node && strcmp(entry->key, key) == 0) {
             return entry->var_name;
         }
         entry = entry->next;
     }
-    error_exit(ERR_INTERNAL, "Error: Temporary variable for node not found.\n");
     return NULL;
 }
 
 /**
- * Collects usage information of built-in functions in the AST.
+ * Retrieves the temporary variable name associated with a given AST node and key.
  */
-void collect_builtin_function_usage(ASTNode *node) {
-    if (!node)
-        return;
-
-    switch (node->type)
-    {
-    case NODE_PROGRAM:
+char *get_temp_var_name_for_node(ASTNode *node, const char *key) {
+    char *var_name = find_temp_var_name_for_node(node, key);
+    if (var_name == NULL) {
+        error_exit(ERR_INTERNAL, "Error: Temporary variable for node not found.\n");
+    }
+    return var_name;
+}
 
-        for (ASTNode *func = node->body; func != NULL; func = func->next)
-        {
-            collect_builtin_function_usage(func);
-        }
-        break;
+/**
+ * Maps an AST node and key to an existing temporary variable.
+ */
+static void map_temp_var(ASTNode *node, const char *key, const char *var_name) {
+    TempVarMapEntry *new_entry = safe_malloc(sizeof(TempVarMapEntry));
+    new_entry->node = node;
+    new_entry->key = string_duplicate(key);
+    new_entry->var_name = string_duplicate(var_name);
+    new_entry->next = codegen_state.temp_var_map;
+    codegen_state.temp_var_map = new_entry;
+}
 
-    case NODE_FUNCTION:
+/**
+ * Forgets the values of the basic block, called where control flow joins or branches.
+ */
+static void forget_values() {
+    codegen_state.value_count = 0;
+    codegen_state.variable_count = 0;
+}
 
-        collect_builtin_function_usage(node->body);
-        break;
+/**
+ * Frees the value numbering tables of the last generated function.
+ */
+static void reset_value_numbers() {
+    safe_free(codegen_state.values);
+    safe_free(codegen_state.variables);
+    codegen_state.values = NULL;
+    codegen_state.variables = NULL;
+    codegen_state.value_capacity = 0;
+    codegen_state.variable_capacity = 0;
+    codegen_state.reused_values = 0;
+    forget_values();
+}
 
-    case NODE_BLOCK:
+/**
+ * Checks if a built-in function always returns the same value for the same arguments
+ * and has no side effects. Reading and writing are excluded.
+ */
+static bool is_pure_builtin(const char *name) {
+    return strcmp(name, "ifj.length") == 0 ||
+           strcmp(name, "ifj.concat") == 0 ||
+           strcmp(name, "ifj.i2f") == 0 ||
+           strcmp(name, "ifj.f2i") == 0 ||
+           get_builtin_helper(name) != NULL;
+}
 
-        for (ASTNode *stmt = node->body; stmt != NULL; stmt = stmt->next)
-        {
-            collect_builtin_function_usage(stmt);
+/**
+ * Returns the value number of a variable, a new one if the variable was not seen in the block.
+ */
+static int variable_value_number(const char *name, bool renumber) {
+    for (int i = 0; i < codegen_state.variable_count; i++) {
+        if (strcmp(codegen_state.variables[i].name, name) == 0) {
+            if (renumber) {
+                codegen_state.variables[i].number = ++codegen_state.value_number_counter;
+            }
+            return codegen_state.variables[i].number;
         }
+    }
+    if (codegen_state.variable_count == codegen_state.variable_capacity) {
+        codegen_state.variable_capacity = codegen_state.variable_capacity ? codegen_state.variable_capacity * 2 : 16;
+        codegen_state.variables = safe_realloc(codegen_state.variables,
+                                               codegen_state.variable_capacity * sizeof(VariableNumber));
+    }
+    VariableNumber *variable = &codegen_state.variables[codegen_state.variable_count++];
+    variable->name = name;
+    variable->number = ++codegen_state.value_number_counter;
+    return variable->number;
+}
+
+/**
+ * Finds the value of an expression in the current basic block.
+ * With insert set, a value that is not there yet is added with the node as its first occurrence.
+ * Returns NULL for expressions that are not numbered (user and effectful calls, nil tests)
+ * and for values not computed yet when insert is not set.
+ */
+static ValueNumber *find_value(ASTNode *node, bool insert) {
+    ValueNumber key = {NULL, NULL, node->data_type, {0, 0, 0}, 0, node};
+
+    switch (node->type) {
+    case NODE_LITERAL:
+        key.value = node->value;
         break;
 
-    case NODE_FUNCTION_CALL:
-        if (strcmp(node->name, "ifj.substring") == 0)
-        {
-            builtin_function_usage.uses_substring = true;
-        }
-        else if (strcmp(node->name, "ifj.strcmp") == 0)
-        {
-            builtin_function_usage.uses_strcmp = true;
+    case NODE_IDENTIFIER:
+        if (strcmp(node->name, "nil") == 0) {
+            return NULL; // Generated as a comparison with the value on the stack
         }
-        else if (strcmp(node->name, "ifj.string") == 0)
-        {
-            builtin_function_usage.uses_string = true;
+        if (strcmp(node->name, "true") == 0 || strcmp(node->name, "false") == 0) {
+            key.value = node->name;
+            break;
         }
-
-        for (int i = 0; i < node->arg_count; ++i)
-        {
-            collect_builtin_function_usage(node->arguments[i]);
-        }
-        break;
+        // Variables are not stored as values, the number is looked up for the operands
+        return NULL;
 
     case NODE_BINARY_OPERATION:
-        collect_builtin_function_usage(node->left);
-        collect_builtin_function_usage(node->right);
-        break;
-
-    case NODE_VARIABLE_DECLARATION:
-    case NODE_ASSIGNMENT:
-        collect_builtin_function_usage(node->left);
+        key.operation = node->name;
+        for (int i = 0; i < 2; i++) {
+            ASTNode *operand = i == 0 ? node->left : node->right;
+            if (operand->type == NODE_IDENTIFIER && strcmp(operand->name, "nil") != 0 &&
+                strcmp(operand->name, "true") != 0 && strcmp(operand->name, "false") != 0) {
+                key.operands[i] = variable_value_number(operand->name, false);
+            } else {
+                ValueNumber *value = find_value(operand, false);
+                if (value == NULL) {
+                    return NULL;
+                }
+                key.operands[i] = value->number;
+            }
+        }
+        // Operands of commutative operators are ordered, a*b and b*a are the same value
+        if ((strcmp(node->name, "+") == 0 || strcmp(node->name, "*") == 0 ||
+             strcmp(node->name, "==") == 0 || strcmp(node->name, "!=") == 0) &&
+            node->left->data_type == node->right->data_type && key.operands[0] > key.operands[1]) {
+            int swap = key.operands[0];
+            key.operands[0] = key.operands[1];
+            key.operands[1] = swap;
+        }
         break;
 
-    case NODE_IF:
-        collect_builtin_function_usage(node->condition);
-        collect_builtin_function_usage(node->body);
-        if (node->left)
-        {
-            collect_builtin_function_usage(node->left);
+    case NODE_FUNCTION_CALL:
+        if (!is_pure_builtin(node->name) || node->arg_count > 3) {
+            return NULL;
+        }
+        key.operation = node->name;
+        for (int i = 0; i < node->arg_count; i++) {
+            ASTNode *argument = node->arguments[i];
+            if (argument->type == NODE_IDENTIFIER && strcmp(argument->name, "nil") != 0 &&
+                strcmp(argument->name, "true") != 0 && strcmp(argument->name, "false") != 0) {
+                key.operands[i] = variable_value_number(argument->name, false);
+            } else {
+                ValueNumber *value = find_value(argument, false);
+                if (value == NULL) {
+                    return NULL;
+                }
+                key.operands[i] = value->number;
+            }
         }
         break;
 
-    case NODE_WHILE:
-        collect_builtin_function_usage(node->condition);
-        collect_builtin_function_usage(node->body);
-        break;
+    default:
+        return NULL;
+    }
 
-    case NODE_RETURN:
-        if (node->left)
-        {
-            collect_builtin_function_usage(node->left);
+    for (int i = 0; i < codegen_state.value_count; i++) {
+        ValueNumber *value = &codegen_state.values[i];
+        if (value->type == key.type &&
+            (value->operation == NULL) == (key.operation == NULL) &&
+            (value->operation == NULL || strcmp(value->operation, key.operation) == 0) &&
+            (value->value == NULL) == (key.value == NULL) &&
+            (value->value == NULL || strcmp(value->value, key.value) == 0) &&
+            memcmp(value->operands, key.operands, sizeof(key.operands)) == 0) {
+            return value;
         }
-        break;
+    }
+    if (!insert) {
+        return NULL;
+    }
 
-    case NODE_LITERAL:
-    case NODE_IDENTIFIER:
+    if (codegen_state.value_count == codegen_state.value_capacity) {
+        codegen_state.value_capacity = codegen_state.value_capacity ? codegen_state.value_capacity * 2 : 32;
+        codegen_state.values = safe_realloc(codegen_state.values, codegen_state.value_capacity * sizeof(ValueNumber));
+    }
+    key.number = ++codegen_state.value_number_counter;
+    codegen_state.values[codegen_state.value_count] = key;
+    return &codegen_state.values[codegen_state.value_count++];
+}
 
-        break;
+/**
+ * Checks if an operation or pure built-in call was already computed in the basic block.
+ * The first occurrence gets a temporary variable that keeps its result and the node
+ * is mapped to it, so code generation pushes the variable instead of computing again.
+ */
+static bool reuse_computed_value(ASTNode *node) {
+    if (node->type != NODE_BINARY_OPERATION && node->type != NODE_FUNCTION_CALL) {
+        return false;
+    }
+    ValueNumber *value = find_value(node, false);
+    if (value == NULL || value->operation == NULL) {
+        return false;
+    }
 
-    default:
-        error_exit(ERR_INTERNAL, "Unsupported node type in collect_builtin_function_usage: %d\n", node->type);
-        break;
+    char *cse_var = find_temp_var_name_for_node(value->node, "cse_var");
+    if (cse_var == NULL) {
+        cse_var = generate_unique_var_name("cse", value->node, "cse_var");
+        codegen_state.reused_values++;
     }
+    map_temp_var(node, "cse_reuse", cse_var);
+    return true;
 }
 
 /**
- * Generates the built-in 'substring' function code if used.
+ * Checks if a value needs a runtime nil check (nullable and not proven non-null).
  */
-void codegen_generate_substring_function() {
-    fprintf(output_file,
-            "LABEL ifj-substring\n"
-            "CREATEFRAME\n"
-            "PUSHFRAME\n"
-            "DEFVAR LF@str\n"
-            "DEFVAR LF@start\n"
-            "DEFVAR LF@end\n"
-            "DEFVAR LF@length\n"
-            "DEFVAR LF@retval\n"
-            "DEFVAR LF@tmp_bool\n"
-            "DEFVAR LF@tmp_char\n"
-            "POPS LF@end\n"
-            "POPS LF@start\n"
-            "POPS LF@str\n"
-            "STRLEN LF@length LF@str\n"
-
-            "LT LF@tmp_bool LF@start int@0\n"
-            "JUMPIFEQ $substr_null LF@tmp_bool bool@true\n"
-
-            "LT LF@tmp_bool LF@end int@0\n"
-            "JUMPIFEQ $substr_null LF@tmp_bool bool@true\n"
-
-            "GT LF@tmp_bool LF@start LF@end\n"
-            "JUMPIFEQ $substr_null LF@tmp_bool bool@true\n"
-
-            "LT LF@tmp_bool LF@start LF@length\n"
-            "JUMPIFEQ $check_j LF@tmp_bool bool@true\n"
-            "JUMP $substr_null\n"
-
-            "LABEL $check_j\n"
-            "GT LF@tmp_bool LF@end LF@length\n"
-            "JUMPIFEQ $substr_null LF@tmp_bool bool@true\n"
-
-            "SUB LF@length LF@end LF@start\n"
-
-            "MOVE LF@retval string@\n"
-
-            "LABEL $substr_loop\n"
-            "JUMPIFEQ $substr_end LF@length int@0\n"
-
-            "GETCHAR LF@tmp_char LF@str LF@start\n"
-
-            "CONCAT LF@retval LF@retval LF@tmp_char\n"
-
-            "ADD LF@start LF@start int@1\n"
-            "SUB LF@length LF@length int@1\n"
-
-            "JUMP $substr_loop\n"
-            "LABEL $substr_end\n"
-            "PUSHS LF@retval\n"
-            "POPFRAME\n"
-            "RETURN\n"
-            "LABEL $substr_null\n"
-            "PUSHS nil@nil\n"
-            "POPFRAME\n"
-            "RETURN\n");
+bool needs_null_check(ASTNode *node) {
+    return is_nullable(node->data_type) && !node->is_non_null;
 }
 
 /**
- * Generates the built-in 'strcmp' function code if used.
+ * Runtime helper routines of built-in functions.
+ * Every helper takes its arguments from the data stack (first argument pushed first)
+ * and leaves the result on the stack. The bodies are constant text, so they are only
+ * copied to the output, once per program and only when some call site used them.
  */
-void codegen_generate_strcmp_function() {
-    fprintf(output_file,
-            "LABEL ifj-strcmp\n"
-            "CREATEFRAME\n"
-            "PUSHFRAME\n"
-            "DEFVAR LF@str1\n"
-            "DEFVAR LF@str2\n"
-            "DEFVAR LF@len1\n"
-            "DEFVAR LF@len2\n"
-            "DEFVAR LF@i\n"
-            "DEFVAR LF@char1\n"
-            "DEFVAR LF@char2\n"
-            "DEFVAR LF@retval\n"
-            "DEFVAR LF@tmp_int\n"
-            "DEFVAR LF@tmp_bool\n"
-            "POPS LF@str2\n"
-            "POPS LF@str1\n"
-
-            "STRLEN LF@len1 LF@str1\n"
-            "STRLEN LF@len2 LF@str2\n"
-            "MOVE LF@i int@0\n"
-            "LABEL $strcmp_loop\n"
-            "LT LF@tmp_bool LF@i LF@len1\n"
-            "JUMPIFEQ $strcmp_end LF@tmp_bool bool@false\n"
-            "LT LF@tmp_bool LF@i LF@len2\n"
-            "JUMPIFEQ $strcmp_end LF@tmp_bool bool@false\n"
-            "GETCHAR LF@char1 LF@str1 LF@i\n"
-            "GETCHAR LF@char2 LF@str2 LF@i\n"
-            "GT LF@tmp_bool LF@char1 LF@char2\n"
-            "JUMPIFEQ $strcmp_greater LF@tmp_bool bool@true\n"
-            "LT LF@tmp_bool LF@char1 LF@char2\n"
-            "JUMPIFEQ $strcmp_less LF@tmp_bool bool@true\n"
-            "ADD LF@i LF@i int@1\n"
-            "JUMP $strcmp_loop\n"
-            "LABEL $strcmp_end\n"
-            "SUB LF@tmp_int LF@len1 LF@len2\n"
-            "JUMPIFEQ $strcmp_equal LF@tmp_int int@0\n"
-            "GT LF@tmp_bool LF@len1 LF@len2\n"
-            "JUMPIFEQ $strcmp_greater LF@tmp_bool bool@true\n"
-            "JUMP $strcmp_less\n"
-            "LABEL $strcmp_equal\n"
-            "MOVE LF@retval int@0\n"
-            "JUMP $strcmp_finish\n"
-            "LABEL $strcmp_greater\n"
-            "MOVE LF@retval int@1\n"
-            "JUMP $strcmp_finish\n"
-            "LABEL $strcmp_less\n"
-            "MOVE LF@retval int@-1\n"
-            "LABEL $strcmp_finish\n"
-            "PUSHS LF@retval\n"
-            "POPFRAME\n"
-            "RETURN\n");
-}
+static const char substring_helper_code[] =
+    "LABEL ifj-substring\n"
+    "CREATEFRAME\n"
+    "PUSHFRAME\n"
+    "DEFVAR LF@str\n"
+    "DEFVAR LF@start\n"
+    "DEFVAR LF@end\n"
+    "DEFVAR LF@length\n"
+    "DEFVAR LF@retval\n"
+    "DEFVAR LF@tmp_bool\n"
+    "DEFVAR LF@tmp_char\n"
+    "POPS LF@end\n"
+    "POPS LF@start\n"
+    "POPS LF@str\n"
+    "STRLEN LF@length LF@str\n"
+
+    "LT LF@tmp_bool LF@start int@0\n"
+    "JUMPIFEQ $substr_null LF@tmp_bool bool@true\n"
+
+    "LT LF@tmp_bool LF@end int@0\n"
+    "JUMPIFEQ $substr_null LF@tmp_bool bool@true\n"
+
+    "GT LF@tmp_bool LF@start LF@end\n"
+    "JUMPIFEQ $substr_null LF@tmp_bool bool@true\n"
+
+    "LT LF@tmp_bool LF@start LF@length\n"
+    "JUMPIFEQ $check_j LF@tmp_bool bool@true\n"
+    "JUMP $substr_null\n"
+
+    "LABEL $check_j\n"
+    "GT LF@tmp_bool LF@end LF@length\n"
+    "JUMPIFEQ $substr_null LF@tmp_bool bool@true\n"
+
+    "SUB LF@length LF@end LF@start\n"
+
+    "MOVE LF@retval string@\n"
+
+    "LABEL $substr_loop\n"
+    "JUMPIFEQ $substr_end LF@length int@0\n"
+
+    "GETCHAR LF@tmp_char LF@str LF@start\n"
+
+    "CONCAT LF@retval LF@retval LF@tmp_char\n"
+
+    "ADD LF@start LF@start int@1\n"
+    "SUB LF@length LF@length int@1\n"
+
+    "JUMP $substr_loop\n"
+    "LABEL $substr_end\n"
+    "PUSHS LF@retval\n"
+    "POPFRAME\n"
+    "RETURN\n"
+    "LABEL $substr_null\n"
+    "PUSHS nil@nil\n"
+    "POPFRAME\n"
+    "RETURN\n";
+
+static const char strcmp_helper_code[] =
+    "LABEL ifj-strcmp\n"
+    "CREATEFRAME\n"
+    "PUSHFRAME\n"
+    "DEFVAR LF@str1\n"
+    "DEFVAR LF@str2\n"
+    "DEFVAR LF@len1\n"
+    "DEFVAR LF@len2\n"
+    "DEFVAR LF@i\n"
+    "DEFVAR LF@char1\n"
+    "DEFVAR LF@char2\n"
+    "DEFVAR LF@retval\n"
+    "DEFVAR LF@tmp_int\n"
+    "DEFVAR LF@tmp_bool\n"
+    "POPS LF@str2\n"
+    "POPS LF@str1\n"
+
+    "STRLEN LF@len1 LF@str1\n"
+    "STRLEN LF@len2 LF@str2\n"
+    "MOVE LF@i int@0\n"
+    "LABEL $strcmp_loop\n"
+    "LT LF@tmp_bool LF@i LF@len1\n"
+    "JUMPIFEQ $strcmp_end LF@tmp_bool bool@false\n"
+    "LT LF@tmp_bool LF@i LF@len2\n"
+    "JUMPIFEQ $strcmp_end LF@tmp_bool bool@false\n"
+    "GETCHAR LF@char1 LF@str1 LF@i\n"
+    "GETCHAR LF@char2 LF@str2 LF@i\n"
+    "GT LF@tmp_bool LF@char1 LF@char2\n"
+    "JUMPIFEQ $strcmp_greater LF@tmp_bool bool@true\n"
+    "LT LF@tmp_bool LF@char1 LF@char2\n"
+    "JUMPIFEQ $strcmp_less LF@tmp_bool bool@true\n"
+    "ADD LF@i LF@i int@1\n"
+    "JUMP $strcmp_loop\n"
+    "LABEL $strcmp_end\n"
+    "SUB LF@tmp_int LF@len1 LF@len2\n"
+    "JUMPIFEQ $strcmp_equal LF@tmp_int int@0\n"
+    "GT LF@tmp_bool LF@len1 LF@len2\n"
+    "JUMPIFEQ $strcmp_greater LF@tmp_bool bool@true\n"
+    "JUMP $strcmp_less\n"
+    "LABEL $strcmp_equal\n"
+    "MOVE LF@retval int@0\n"
+    "JUMP $strcmp_finish\n"
+    "LABEL $strcmp_greater\n"
+    "MOVE LF@retval int@1\n"
+    "JUMP $strcmp_finish\n"
+    "LABEL $strcmp_less\n"
+    "MOVE LF@retval int@-1\n"
+    "LABEL $strcmp_finish\n"
+    "PUSHS LF@retval\n"
+    "POPFRAME\n"
+    "RETURN\n";
+
+static const char string_helper_code[] =
+    "LABEL ifj-string\n"
+    "CREATEFRAME\n"
+    "PUSHFRAME\n"
+    "DEFVAR LF@str_literal\n"
+    "POPS LF@str_literal\n"
+    "PUSHS LF@str_literal\n"
+    "POPFRAME\n"
+    "RETURN\n";
+
+static const char ord_helper_code[] =
+    "LABEL ifj-ord\n"
+    "CREATEFRAME\n"
+    "PUSHFRAME\n"
+    "DEFVAR LF@str\n"
+    "DEFVAR LF@idx\n"
+    "DEFVAR LF@length\n"
+    "DEFVAR LF@tmp_bool\n"
+    "DEFVAR LF@retval\n"
+    "POPS LF@idx\n"
+    "POPS LF@str\n"
+    "STRLEN LF@length LF@str\n"
+    "LT LF@tmp_bool LF@idx int@0\n"
+    "JUMPIFEQ $ord_error LF@tmp_bool bool@true\n"
+    "SUB LF@length LF@length int@1\n"
+    "GT LF@tmp_bool LF@idx LF@length\n"
+    "JUMPIFEQ $ord_error LF@tmp_bool bool@true\n"
+    "STRI2INT LF@retval LF@str LF@idx\n"
+    "PUSHS LF@retval\n"
+    "POPFRAME\n"
+    "RETURN\n"
+    "LABEL $ord_error\n"
+    "PUSHS int@0\n"
+    "POPFRAME\n"
+    "RETURN\n";
+
+static const char chr_helper_code[] =
+    "LABEL ifj-chr\n"
+    "CREATEFRAME\n"
+    "PUSHFRAME\n"
+    "DEFVAR LF@code\n"
+    "DEFVAR LF@tmp_int\n"
+    "DEFVAR LF@retval\n"
+    "POPS LF@code\n"
+    // Ensure the integer is within valid range (0-255)
+    "IDIV LF@tmp_int LF@code int@256\n"
+    "MUL LF@tmp_int LF@tmp_int int@256\n"
+    "SUB LF@code LF@code LF@tmp_int\n"
+    "INT2CHAR LF@retval LF@code\n"
+    "PUSHS LF@retval\n"
+    "POPFRAME\n"
+    "RETURN\n";
+
+/** Dictionary of built-in functions implemented by a runtime helper */
+static const BuiltinHelperInfo builtin_helpers[BUILTIN_HELPER_COUNT] = {
+    {"ifj.substring", "ifj-substring", substring_helper_code},
+    {"ifj.strcmp", "ifj-strcmp", strcmp_helper_code},
+    {"ifj.string", "ifj-string", string_helper_code},
+    {"ifj.ord", "ifj-ord", ord_helper_code},
+    {"ifj.chr", "ifj-chr", chr_helper_code}};
 
 /**
- * Generates the built-in 'string' function code if used.
+ * Finds the runtime helper of a built-in function, returns NULL for other functions.
  */
-void codegen_generate_ifj_string_function() {
-    fprintf(output_file,
-            "LABEL ifj-string\n"
-            "CREATEFRAME\n"
-            "PUSHFRAME\n"
-            "DEFVAR LF@str_literal\n"
-            "POPS LF@str_literal\n"
-            "PUSHS LF@str_literal\n"
-            "POPFRAME\n"
-            "RETURN\n");
+const BuiltinHelperInfo *get_builtin_helper(const char *function_name) {
+    for (int i = 0; i < BUILTIN_HELPER_COUNT; i++) {
+        if (strcmp(builtin_helpers[i].function_name, function_name) == 0) {
+            return &builtin_helpers[i];
+        }
+    }
+    return NULL;
 }
 
 /**
- * Generates code for all used built-in functions.
+ * Appends the helpers of all built-in functions used by the program.
  */
 void codegen_generate_builtin_functions() {
-    if (builtin_function_usage.uses_substring) {
-        codegen_generate_substring_function();
-    }
-    if (builtin_function_usage.uses_strcmp) {
-        codegen_generate_strcmp_function();
-    }
-    if (builtin_function_usage.uses_string) {
-        codegen_generate_ifj_string_function();
+    for (int i = 0; i < BUILTIN_HELPER_COUNT; i++) {
+        if (codegen_state.builtin_function_usage.used[i]) {
+            fputs(builtin_helpers[i].code, codegen_state.output_file);
+        }
     }
 }
 
@@ -408,13 +571,13 @@ void codegen_generate_builtin_functions() {
  * Removes the first prefix and replaces the second dot with a hyphen.
  */
 const char *remove_last_prefix(const char *name) {
-    static char buffer[1024];
+    char *buffer = codegen_state.name_buffer;
     if (!name) {
         return NULL;
     }
 
     size_t name_len = strlen(name);
-    if (name_len >= sizeof(buffer)) {
+    if (name_len >= sizeof(codegen_state.name_buffer)) {
         error_exit(ERR_INTERNAL, "Error: Buffer overflow in remove_last_prefix.\n");
     }
 
@@ -439,15 +602,52 @@ const char *remove_last_prefix(const char *name) {
 }
 
 
-char *escape_ifj24_string(const char *input);
-
-static int label_counter = 0;
-
 /**
  * Generates a unique label number.
  */
 int generate_unique_label() {
-    return label_counter++;
+    return codegen_state.label_counter++;
+}
+
+/**
+ * Redirects the generated text to a memory buffer, codegen_finalize assembles it
+ * into the binary form and writes it to the original output (--binary).
+ */
+static void codegen_buffer_text() {
+    if (!codegen_state.binary) {
+        return;
+    }
+    codegen_state.binary_output = codegen_state.output_file;
+    codegen_state.binary_output_owned = codegen_state.output_file_owned;
+    codegen_state.output_file = open_memstream(&codegen_state.text_buffer, &codegen_state.text_size);
+    codegen_state.output_file_owned = true;
+    if (!codegen_state.output_file) {
+        error_exit(ERR_INTERNAL, "Cannot buffer the generated code.");
+    }
+}
+
+/**
+ * Assembles the buffered text and writes the binary form to the original output.
+ */
+static void codegen_write_binary() {
+    fclose(codegen_state.output_file);
+    codegen_state.output_file = codegen_state.binary_output;
+    codegen_state.output_file_owned = codegen_state.binary_output_owned;
+    codegen_state.binary_output = NULL;
+    codegen_state.binary_output_owned = false;
+
+    IfjcodeProgram program;
+    memset(&program, 0, sizeof(program));
+    int result = ifjcode_parse_text(&program, codegen_state.text_buffer, codegen_state.text_size);
+    if (result == 0) {
+        result = ifjcode_write_binary(&program, codegen_state.output_file);
+    }
+    ifjcode_free(&program);
+    free(codegen_state.text_buffer);
+    codegen_state.text_buffer = NULL;
+    if (result != 0) {
+        error_exit(ERR_INTERNAL, "Cannot write the binary code: %s", program.error);
+    }
 }
 
 /**
@@ -455,23 +655,122 @@ int generate_unique_label() {
  */
 void codegen_init(const char *filename) {
     if (filename) {
-        output_file = fopen(filename, "w");
-        if (!output_file) {
+        codegen_state.output_file = fopen(filename, "w");
+        if (!codegen_state.output_file) {
             error_exit(ERR_INTERNAL, "Error: Cannot open output file %s for writing.\n", filename);
         }
     } else {
-        output_file = stdout;
+        codegen_state.output_file = stdout;
     }
+    codegen_state.output_file_owned = true;
+    codegen_buffer_text();
+}
+
+/**
+ * Initializes the code generator with a stream owned by the caller.
+ * The stream is not closed by codegen_finalize.
+ */
+void codegen_init_stream(FILE *stream) {
+    codegen_state.output_file = stream;
+    codegen_state.output_file_owned = false;
+    codegen_buffer_text();
 }
 
 /**
  * Finalizes the code generator and closes the output file.
  */
 void codegen_finalize() {
-    if (output_file) {
-        fclose(output_file);
-        output_file = NULL;
+    if (codegen_state.output_file && codegen_state.binary_output) {
+        codegen_write_binary();
+    }
+    if (codegen_state.output_file && codegen_state.output_file_owned) {
+        fclose(codegen_state.output_file);
+    }
+    codegen_state.output_file = NULL;
+    codegen_state.output_file_owned = false;
+}
+
+/**
+ * Resets the global code generator state before the next compilation.
+ * Lists were allocated with safe_malloc and are released by cleanup_pointers_storage.
+ */
+void codegen_reset() {
+    // A file left open by an error in the middle of code generation
+    if (codegen_state.output_file && codegen_state.output_file_owned) {
+        fclose(codegen_state.output_file);
     }
+    free(codegen_state.text_buffer);
+    if (codegen_state.binary_output && codegen_state.binary_output_owned) {
+        fclose(codegen_state.binary_output);
+    }
+    memset(&codegen_state, 0, sizeof(codegen_state));
+}
+
+/**
+ * Turns on execution counters in the generated code (--instrument).
+ */
+void codegen_enable_instrumentation() {
+    codegen_state.instrument = true;
+}
+
+/**
+ * Makes codegen_finalize write the binary form of IFJcode24 (--binary).
+ */
+void codegen_enable_binary() {
+    codegen_state.binary = true;
+}
+
+/**
+ * Emits an increment of a new execution counter for a function, loop or branch arm.
+ */
+static void codegen_count_execution(FILE *output, ProfilePointKind kind, ASTNode *node) {
+    if (!codegen_state.instrument) {
+        return;
+    }
+    if (codegen_state.profile_point_count == codegen_state.profile_point_capacity) {
+        codegen_state.profile_point_capacity = codegen_state.profile_point_capacity ? codegen_state.profile_point_capacity * 2 : 64;
+        codegen_state.profile_points = safe_realloc(codegen_state.profile_points,
+                                                    codegen_state.profile_point_capacity * sizeof(ProfilePoint));
+    }
+    int index = codegen_state.profile_point_count++;
+    codegen_state.profile_points[index].kind = kind;
+    codegen_state.profile_points[index].line = node->line;
+    codegen_state.profile_points[index].column = node->column;
+
+    fprintf(output, "ADD GF@%%prof_%d GF@%%prof_%d int@1\n", index, index);
+}
+
+/**
+ * Generates the routines that create the counters before main and write them after it.
+ * The report starts with the line "#ifj24-profile", then every counter is written
+ * as "<kind> <line> <column> <count>" on its own line.
+ */
+static void codegen_generate_profile_routines() {
+    static const char *kind_names[] = {"function", "loop", "then", "else"};
+    FILE *output = codegen_state.output_file;
+
+    fprintf(output, "LABEL $profile_init\n");
+    for (int i = 0; i < codegen_state.profile_point_count; i++) {
+        fprintf(output, "DEFVAR GF@%%prof_%d\n", i);
+        fprintf(output, "MOVE GF@%%prof_%d int@0\n", i);
+    }
+    fprintf(output, "RETURN\n");
+
+    fprintf(output, "LABEL $profile_report\n");
+    char *escaped_marker = escape_ifj24_string("\n#ifj24-profile\n");
+    fprintf(output, "WRITE string@%s\n", escaped_marker);
+    safe_free(escaped_marker);
+    for (int i = 0; i < codegen_state.profile_point_count; i++) {
+        ProfilePoint *point = &codegen_state.profile_points[i];
+        char prefix[64];
+        snprintf(prefix, sizeof(prefix), "%s %d %d ", kind_names[point->kind], point->line, point->column);
+        char *escaped_prefix = escape_ifj24_string(prefix);
+        fprintf(output, "WRITE string@%s\n", escaped_prefix);
+        safe_free(escaped_prefix);
+        fprintf(output, "WRITE GF@%%prof_%d\n", i);
+        fprintf(output, "WRITE string@\\010\n");
+    }
+    fprintf(output, "RETURN\n");
 }
 
 /**
@@ -482,12 +781,7 @@ void codegen_generate_program(ASTNode *program_node) {
         return;
     }
 
-    collect_builtin_function_usage(program_node);
-
-    fprintf(output_file, ".IFJcode24\n");
-
-    fprintf(output_file, "CALL main\n");
-    fprintf(output_file, "EXIT int@0\n");
+    codegen_begin_program();
 
     ASTNode *current_function = program_node->body;
 
@@ -498,7 +792,62 @@ void codegen_generate_program(ASTNode *program_node) {
         current_function = current_function->next;
     }
 
+    codegen_end_program();
+}
+
+/**
+ * Generates the program header that calls main.
+ * Functions can follow one by one (streaming mode).
+ */
+void codegen_begin_program() {
+    fprintf(codegen_state.output_file, ".IFJcode24\n");
+
+    // Counters are only known at the end, so they are created by a routine emitted last
+    if (codegen_state.instrument) {
+        fprintf(codegen_state.output_file, "CALL $profile_init\n");
+    }
+    fprintf(codegen_state.output_file, "CALL main\n");
+    if (codegen_state.instrument) {
+        fprintf(codegen_state.output_file, "CALL $profile_report\n");
+    }
+    fprintf(codegen_state.output_file, "EXIT int@0\n");
+}
+
+/**
+ * Generates the built-in helpers used by the functions emitted so far.
+ */
+void codegen_end_program() {
     codegen_generate_builtin_functions();
+    if (codegen_state.instrument) {
+        codegen_generate_profile_routines();
+    }
+}
+
+/**
+ * Frees the variable lists of the last generated function.
+ * Streaming mode calls it before releasing the memory of the function.
+ */
+void codegen_release_function_state() {
+    reset_temp_var_map();
+    reset_declared_variables();
+    reset_temp_vars();
+    reset_value_numbers();
+}
+
+/**
+ * Prints the functions whose tail calls were turned into jumps.
+ */
+void codegen_print_tail_call_report(FILE *output) {
+    int total_self = 0;
+    int total_sibling = 0;
+
+    fprintf(output, "%-24s %10s %10s\n", "function", "self", "sibling");
+    for (TailCallStats *stats = codegen_state.tail_calls_head; stats != NULL; stats = stats->next) {
+        fprintf(output, "%-24s %10d %10d\n", stats->function_name, stats->self_calls, stats->sibling_calls);
+        total_self += stats->self_calls;
+        total_sibling += stats->sibling_calls;
+    }
+    fprintf(output, "%-24s %10d %10d\n", "total", total_self, total_sibling);
 }
 
 /**
@@ -517,35 +866,39 @@ bool is_function_parameter(ASTNode *function, const char *var_name) {
  * Generates code for a function.
  */
 void codegen_generate_function(ASTNode *function) {
+    nullability_analyze_function(function);
+
     reset_temp_var_map();
     reset_declared_variables();
     reset_temp_vars(); // Reset temporary variables
 
-    fprintf(output_file, "LABEL %s\n", function->name);
-    fprintf(output_file, "CREATEFRAME\n");
-    fprintf(output_file, "PUSHFRAME\n");
+    fprintf(codegen_state.output_file, "LABEL %s\n", function->name);
+    fprintf(codegen_state.output_file, "CREATEFRAME\n");
+    fprintf(codegen_state.output_file, "PUSHFRAME\n");
 
     // Declare function parameters
     for (int i = 0; i < function->param_count; i++) {
         const char *param_name = remove_last_prefix(function->parameters[i]->name);
-        fprintf(output_file, "DEFVAR LF@%s\n", param_name);
-        fprintf(output_file, "POPS LF@%s\n", param_name);
+        fprintf(codegen_state.output_file, "DEFVAR LF@%s\n", param_name);
+        fprintf(codegen_state.output_file, "POPS LF@%s\n", param_name);
         add_declared_variable(param_name);
     }
 
     // Declare standard temporary variables
-    fprintf(output_file, "DEFVAR LF@%%tmp_type\n");
+    fprintf(codegen_state.output_file, "DEFVAR LF@%%tmp_type\n");
     add_declared_variable("%%tmp_type");
-    fprintf(output_file, "DEFVAR LF@%%tmp_var\n");
+    fprintf(codegen_state.output_file, "DEFVAR LF@%%tmp_var\n");
     add_declared_variable("%%tmp_var");
-    fprintf(output_file, "DEFVAR LF@%%tmp_bool\n");
+    fprintf(codegen_state.output_file, "DEFVAR LF@%%tmp_bool\n");
     add_declared_variable("%%tmp_bool");
 
-    // First Pass: Collect variables (including temporary ones)
+    // First Pass: Collect variables (including temporary ones) and number the computed values
+    forget_values();
+    codegen_state.reused_values = 0;
     collect_variables_in_block(function->body);
 
     // Declare all variables collected (excluding parameters and standard temporary variables)
-    DeclaredVar *current_declared_var = declared_vars;
+    DeclaredVar *current_declared_var = codegen_state.declared_vars;
     while (current_declared_var) {
         const char *var_name = current_declared_var->var_name;
         // Skip parameters and standard temporary variables
@@ -553,24 +906,30 @@ void codegen_generate_function(ASTNode *function) {
             strcmp(var_name, "%%tmp_var") != 0 &&
             strcmp(var_name, "%%tmp_bool") != 0 &&
             !is_function_parameter(function, var_name)) {
-            fprintf(output_file, "DEFVAR LF@%s\n", var_name);
+            fprintf(codegen_state.output_file, "DEFVAR LF@%s\n", var_name);
         }
         current_declared_var = current_declared_var->next;
     }
 
     // Declare all temporary variables collected
-    TempVar *current_temp_var = temp_vars;
+    TempVar *current_temp_var = codegen_state.temp_vars;
     while (current_temp_var) {
         const char *var_name = current_temp_var->name;
-        fprintf(output_file, "DEFVAR LF@%s\n", var_name);
+        fprintf(codegen_state.output_file, "DEFVAR LF@%s\n", var_name);
         current_temp_var = current_temp_var->next;
     }
 
+    // Self tail calls jump here after reassigning the parameters, the frame and its variables are reused
+    fprintf(codegen_state.output_file, "LABEL $%s$body\n", function->name);
+    codegen_count_execution(codegen_state.output_file, PROFILE_FUNCTION, function);
+
     // Second Pass: Generate code
-    codegen_generate_block(output_file, function->body, function->name);
+    codegen_state.current_function = function;
+    codegen_generate_block(codegen_state.output_file, function->body, function->name);
+    codegen_state.current_function = NULL;
 
-    fprintf(output_file, "POPFRAME\n");
-    fprintf(output_file, "RETURN\n");
+    fprintf(codegen_state.output_file, "POPFRAME\n");
+    fprintf(codegen_state.output_file, "RETURN\n");
 }
 
 /**
@@ -600,11 +959,13 @@ void collect_variables_in_statement(ASTNode *node) {
         {
             collect_variables_in_expression(node->left);
         }
+        variable_value_number(node->name, true);
         break;
 
     case NODE_ASSIGNMENT:
         add_declared_variable(remove_last_prefix(node->name));
         collect_variables_in_expression(node->left);
+        variable_value_number(node->name, true);
         break;
 
     case NODE_RETURN:
@@ -615,17 +976,23 @@ void collect_variables_in_statement(ASTNode *node) {
         break;
 
     case NODE_IF:
+        // Values of the condition are available in the then branch, which follows it directly,
+        // the else branch and the code after the statement start at a label
         collect_variables_in_expression(node->condition);
         collect_variables_in_block(node->body);
+        forget_values();
         if (node->left)
         {
             collect_variables_in_block(node->left);
         }
+        forget_values();
         break;
 
     case NODE_WHILE:
+        forget_values();
         collect_variables_in_expression(node->condition);
         collect_variables_in_block(node->body);
+        forget_values();
         break;
 
     case NODE_FUNCTION_CALL:
@@ -653,7 +1020,7 @@ void collect_variables_in_function_call(ASTNode *node) {
         // Associate temp_var_name with 'arg' using key "temp_var"
         generate_unique_var_name("temp", arg, "temp_var");
 
-        if (is_nullable(arg->data_type)) {
+        if (needs_null_check(arg)) {
             // Associate temp_type_name with 'arg' using key "temp_type"
             generate_unique_var_name("tmp_type", arg, "temp_type");
         }
@@ -689,39 +1056,19 @@ void collect_variables_in_function_call(ASTNode *node) {
 
         // Associate retval_var with 'node' using key "retval_var"
         generate_unique_var_name("retval", node, "retval_var");
-    } else if (strcmp(node->name, "ifj.substring") == 0 ||
-               strcmp(node->name, "ifj.strcmp") == 0 ||
-               strcmp(node->name, "ifj.string") == 0) {
+    } else if (get_builtin_helper(node->name) != NULL) {
         for (int i = 0; i < node->arg_count; ++i) {
             collect_variables_in_expression(node->arguments[i]);
         }
         // The built-in function handles variables internally
-    } else if (strcmp(node->name, "ifj.chr") == 0) {
-        collect_variables_in_expression(node->arguments[0]);
-
-        // Associate tmp_int_var with 'node->arguments[0]' using key "tmp_int_var"
-        generate_unique_var_name("tmp_int", node->arguments[0], "tmp_int_var");
-
-        // Associate tmp_temp_var and retval_var with 'node' using unique keys
-        generate_unique_var_name("tmp_temp", node, "tmp_temp_var");
-        generate_unique_var_name("retval", node, "retval_var");
-    } else if (strcmp(node->name, "ifj.ord") == 0) {
-        collect_variables_in_expression(node->arguments[0]); // String argument
-        collect_variables_in_expression(node->arguments[1]); // Index argument
-
-        // Associate variables with 'node' using unique keys
-        generate_unique_var_name("str", node, "str_var");
-        generate_unique_var_name("idx", node, "idx_var");
-        generate_unique_var_name("strlen", node, "strlen_var");
-        generate_unique_var_name("tmp_bool", node, "tmp_bool_var");
-        generate_unique_var_name("retval", node, "retval_var");
     } else {
-        // User-defined function call
-        for (int i = 0; i < node->arg_count; ++i) {
+        // User-defined function call, arguments in the order they are pushed
+        for (int i = node->arg_count - 1; i >= 0; --i) {
             collect_variables_in_expression(node->arguments[i]);
         }
         if (node->left) {
             add_declared_variable(remove_last_prefix(node->left->name));
+            variable_value_number(node->left->name, true);
         }
     }
 }
@@ -734,6 +1081,11 @@ void collect_variables_in_expression(ASTNode *node) {
         return;
     }
 
+    // Value numbering, a value computed earlier in the basic block needs no variables
+    if (reuse_computed_value(node)) {
+        return;
+    }
+
     switch (node->type)
     {
     case NODE_LITERAL:
@@ -764,6 +1116,8 @@ void collect_variables_in_expression(ASTNode *node) {
     default:
         error_exit(ERR_INTERNAL, "Unsupported expression type for variable collection, type: %d, name: %s\n", node->type, node->name ? node->name : "NULL");
     }
+
+    find_value(node, true);
 }
 
 /**
@@ -785,6 +1139,13 @@ void codegen_generate_expression(FILE *output, ASTNode *node, const char *curren
         return;
     }
 
+    // Value computed earlier in the basic block
+    char *cse_var = codegen_state.reused_values ? find_temp_var_name_for_node(node, "cse_reuse") : NULL;
+    if (cse_var != NULL) {
+        fprintf(output, "PUSHS LF@%s\n", cse_var);
+        return;
+    }
+
     switch (node->type)
     {
     case NODE_LITERAL:
@@ -799,9 +1160,8 @@ void codegen_generate_expression(FILE *output, ASTNode *node, const char *curren
         }
         else if (node->data_type == TYPE_U8)
         {
-            char *escaped_value = escape_ifj24_string(node->value);
-            fprintf(output, "PUSHS string@%s\n", escaped_value);
-            safe_free(escaped_value);
+            // Escaped once per distinct literal when it was parsed (string_pool.c)
+            fprintf(output, "PUSHS string@%s\n", node->literal->escaped);
         }
         else if (node->data_type == TYPE_NULL)
         {
@@ -821,14 +1181,6 @@ void codegen_generate_expression(FILE *output, ASTNode *node, const char *curren
             fprintf(output, "EQS\n");
             fprintf(output, "NOTS\n");
         }
-        else if (is_nullable(node->data_type))
-        {
-            fprintf(output, "TYPE LF@%%tmp_type LF@%s\n", remove_last_prefix(node->name));
-            fprintf(output, "PUSHS LF@%%tmp_type\n");
-            fprintf(output, "PUSHS string@nil\n");
-            fprintf(output, "EQS\n");
-            fprintf(output, "NOTS\n");
-        }
         else if (strcmp(node->name, "true") == 0)
         {
             fprintf(output, "PUSHS bool@true\n");
@@ -937,6 +1289,13 @@ void codegen_generate_expression(FILE *output, ASTNode *node, const char *curren
         error_exit(ERR_INTERNAL, "Unsupported expression type for code generation, type: %d, name: %s\n", node->type, node->name);
         break;
     }
+
+    // Keep the value for later occurrences of the same expression
+    cse_var = codegen_state.reused_values ? find_temp_var_name_for_node(node, "cse_var") : NULL;
+    if (cse_var != NULL) {
+        fprintf(output, "POPS LF@%s\n", cse_var);
+        fprintf(output, "PUSHS LF@%s\n", cse_var);
+    }
 }
 
 /**
@@ -955,6 +1314,10 @@ void codegen_generate_function_call(FILE *output, ASTNode *node, const char *cur
         fprintf(output, "POPS LF@%s\n", temp_var_name);
 
         if (is_nullable(arg->data_type)) {
+            nullability_record_check(arg->is_non_null);
+        }
+
+        if (needs_null_check(arg)) {
             char *temp_type_name = get_temp_var_name_for_node(arg, "temp_type");
             int label_num = generate_unique_label();
 
@@ -1024,70 +1387,16 @@ void codegen_generate_function_call(FILE *output, ASTNode *node, const char *cur
         fprintf(output, "FLOAT2INT LF@%s LF@%s\n", retval_var, tmp_var);
         fprintf(output, "PUSHS LF@%s\n", retval_var);
     }
-    else if (strcmp(node->name, "ifj.substring") == 0 ||
-             strcmp(node->name, "ifj.strcmp") == 0 ||
-             strcmp(node->name, "ifj.string") == 0)
+    else if (get_builtin_helper(node->name) != NULL)
     {
-        // Handle substring, strcmp, and string functions
+        // Built-in functions implemented by a runtime helper (substring, strcmp, string, ord, chr)
+        const BuiltinHelperInfo *helper = get_builtin_helper(node->name);
         for (int i = 0; i < node->arg_count; ++i)
         {
             codegen_generate_expression(output, node->arguments[i], current_function);
         }
-        if (strcmp(node->name, "ifj.string") == 0)
-        {
-            fprintf(output, "CALL ifj-string\n");
-        }
-        else if (strcmp(node->name, "ifj.strcmp") == 0)
-        {
-            fprintf(output, "CALL ifj-strcmp\n");
-        }
-        else
-        {
-            fprintf(output, "CALL ifj-substring\n");
-        }
-    }
-    else if (strcmp(node->name, "ifj.chr") == 0)
-    {
-        codegen_generate_expression(output, node->arguments[0], current_function);
-        char *tmp_int_var = get_temp_var_name_for_node(node->arguments[0], "tmp_int_var");
-        char *tmp_temp_var = get_temp_var_name_for_node(node, "tmp_temp_var");
-        char *retval_var = get_temp_var_name_for_node(node, "retval_var");
-
-        fprintf(output, "POPS LF@%s\n", tmp_int_var);
-        // Ensure the integer is within valid range (0-255)
-        fprintf(output, "IDIV LF@%s LF@%s int@256\n", tmp_temp_var, tmp_int_var);
-        fprintf(output, "MUL LF@%s LF@%s int@256\n", tmp_temp_var, tmp_temp_var);
-        fprintf(output, "SUB LF@%s LF@%s LF@%s\n", tmp_int_var, tmp_int_var, tmp_temp_var);
-        fprintf(output, "INT2CHAR LF@%s LF@%s\n", retval_var, tmp_int_var);
-        fprintf(output, "PUSHS LF@%s\n", retval_var);
-    }
-    else if (strcmp(node->name, "ifj.ord") == 0)
-    {
-        codegen_generate_expression(output, node->arguments[0], current_function); // string
-        codegen_generate_expression(output, node->arguments[1], current_function); // index
-
-        // Retrieve variable names using the same keys
-        char *str_var = get_temp_var_name_for_node(node, "str_var");
-        char *idx_var = get_temp_var_name_for_node(node, "idx_var");
-        char *strlen_var = get_temp_var_name_for_node(node, "strlen_var");
-        char *tmp_bool_var = get_temp_var_name_for_node(node, "tmp_bool_var");
-        char *retval_var = get_temp_var_name_for_node(node, "retval_var");
-
-        fprintf(output, "POPS LF@%s\n", idx_var);
-        fprintf(output, "POPS LF@%s\n", str_var);
-        fprintf(output, "STRLEN LF@%s LF@%s\n", strlen_var, str_var);
-        fprintf(output, "LT LF@%s LF@%s int@0\n", tmp_bool_var, idx_var);
-        fprintf(output, "JUMPIFEQ $ord_error_%d LF@%s bool@true\n", label_counter, tmp_bool_var);
-        fprintf(output, "SUB LF@%s LF@%s int@1\n", strlen_var, strlen_var);
-        fprintf(output, "GT LF@%s LF@%s LF@%s\n", tmp_bool_var, idx_var, strlen_var);
-        fprintf(output, "JUMPIFEQ $ord_error_%d LF@%s bool@true\n", label_counter, tmp_bool_var);
-        fprintf(output, "STRI2INT LF@%s LF@%s LF@%s\n", retval_var, str_var, idx_var);
-        fprintf(output, "PUSHS LF@%s\n", retval_var);
-        fprintf(output, "JUMP $ord_end_%d\n", label_counter);
-        fprintf(output, "LABEL $ord_error_%d\n", label_counter);
-        fprintf(output, "PUSHS int@0\n");
-        fprintf(output, "LABEL $ord_end_%d\n", label_counter);
-        label_counter++;
+        fprintf(output, "CALL %s\n", helper->label);
+        codegen_state.builtin_function_usage.used[helper - builtin_helpers] = true;
     }
     else
     {
@@ -1254,10 +1563,72 @@ void codegen_generate_assignment(FILE *output, ASTNode *assignment_node) {
     fprintf(output, "POPS LF@%s\n", remove_last_prefix(assignment_node->name));
 }
 
+/**
+ * Returns the tail call counters of the function being generated, created on the first tail call.
+ */
+static TailCallStats *current_tail_call_stats(const char *function_name) {
+    TailCallStats *stats = codegen_state.tail_calls_tail;
+    if (stats == NULL || strcmp(stats->function_name, function_name) != 0) {
+        stats = (TailCallStats *)safe_malloc(sizeof(TailCallStats));
+        stats->function_name = string_duplicate(function_name);
+        stats->self_calls = 0;
+        stats->sibling_calls = 0;
+        stats->next = NULL;
+        if (codegen_state.tail_calls_tail == NULL) {
+            codegen_state.tail_calls_head = stats;
+        } else {
+            codegen_state.tail_calls_tail->next = stats;
+        }
+        codegen_state.tail_calls_tail = stats;
+    }
+    return stats;
+}
+
+/**
+ * Checks if a return value is a call of a user-defined function.
+ * Built-in functions do not push a frame of their own.
+ */
+static bool is_tail_call(ASTNode *node) {
+    return node != NULL && codegen_state.current_function != NULL && node->type == NODE_FUNCTION_CALL && node->left == NULL &&
+           strncmp(node->name, "ifj.", 4) != 0;
+}
+
+/**
+ * Generates a call in tail position without growing the frame and call stacks.
+ * Arguments are pushed as for CALL. A call of the current function pops them into
+ * its parameters and jumps to the function body. Any other function gets the frame
+ * of the caller popped and is entered by JUMP, its RETURN goes straight to our caller.
+ */
+static void codegen_generate_tail_call(FILE *output, ASTNode *call_node, const char *current_function) {
+    ASTNode *function = codegen_state.current_function;
+
+    for (int i = call_node->arg_count - 1; i >= 0; i--) {
+        codegen_generate_expression(output, call_node->arguments[i], current_function);
+    }
+
+    TailCallStats *stats = current_tail_call_stats(function->name);
+    if (strcmp(call_node->name, function->name) == 0) {
+        // All arguments are evaluated before the first parameter is overwritten
+        for (int i = 0; i < function->param_count; i++) {
+            fprintf(output, "POPS LF@%s\n", remove_last_prefix(function->parameters[i]->name));
+        }
+        fprintf(output, "JUMP $%s$body\n", function->name);
+        stats->self_calls++;
+    } else {
+        fprintf(output, "POPFRAME\n");
+        fprintf(output, "JUMP %s\n", call_node->name);
+        stats->sibling_calls++;
+    }
+}
+
 /**
  * Generates code for a return statement.
  */
 void codegen_generate_return(FILE *output, ASTNode *return_node, const char *current_function) {
+    if (is_tail_call(return_node->left)) {
+        codegen_generate_tail_call(output, return_node->left, current_function);
+        return;
+    }
     if (return_node->left) {
         codegen_generate_expression(output, return_node->left, current_function);
         // The return value is now on the stack
@@ -1270,14 +1641,16 @@ void codegen_generate_return(FILE *output, ASTNode *return_node, const char *cur
  * Generates code for an if statement.
  */
 void codegen_generate_if(FILE *output, ASTNode *if_node) {
-    static int if_label_count = 0;
-
-    int current_label = if_label_count++;
+    int current_label = codegen_state.if_label_count++;
 
     if (if_node->condition->type == NODE_IDENTIFIER && is_nullable(if_node->condition->data_type))
     {
-        fprintf(output, "TYPE LF@%%tmp_type LF@%s\n", remove_last_prefix(if_node->condition->name));
-        fprintf(output, "JUMPIFEQ $else_%d LF@%%tmp_type string@nil\n", current_label);
+        nullability_record_check(if_node->condition->is_non_null);
+        if (!if_node->condition->is_non_null)
+        {
+            fprintf(output, "TYPE LF@%%tmp_type LF@%s\n", remove_last_prefix(if_node->condition->name));
+            fprintf(output, "JUMPIFEQ $else_%d LF@%%tmp_type string@nil\n", current_label);
+        }
     }
     else
     {
@@ -1287,11 +1660,13 @@ void codegen_generate_if(FILE *output, ASTNode *if_node) {
         fprintf(output, "JUMPIFEQS $else_%d\n", current_label);
     }
 
+    codegen_count_execution(output, PROFILE_THEN, if_node->body);
     codegen_generate_block(output, if_node->body, if_node->name);
     fprintf(output, "JUMP $endif_%d\n", current_label);
 
     fprintf(output, "LABEL $else_%d\n", current_label);
     if (if_node->left != NULL) {
+        codegen_count_execution(output, PROFILE_ELSE, if_node->left);
         codegen_generate_block(output, if_node->left, if_node->name);
     }
 
@@ -1304,36 +1679,27 @@ void codegen_generate_if(FILE *output, ASTNode *if_node) {
 void codegen_generate_while(FILE *output, ASTNode *while_node) {
     int label_num = generate_unique_label();
     fprintf(output, "LABEL $while_start_%d\n", label_num);
+    codegen_count_execution(output, PROFILE_LOOP, while_node);
 
-    codegen_generate_expression(output, while_node->condition, while_node->name);
+    if (while_node->condition->type == NODE_IDENTIFIER && is_nullable(while_node->condition->data_type))
+    {
+        nullability_record_check(while_node->condition->is_non_null);
+        if (!while_node->condition->is_non_null)
+        {
+            fprintf(output, "TYPE LF@%%tmp_type LF@%s\n", remove_last_prefix(while_node->condition->name));
+            fprintf(output, "JUMPIFEQ $while_end_%d LF@%%tmp_type string@nil\n", label_num);
+        }
+    }
+    else
+    {
+        codegen_generate_expression(output, while_node->condition, while_node->name);
 
-    fprintf(output, "PUSHS bool@false\n");
-    fprintf(output, "JUMPIFEQS $while_end_%d\n", label_num);
+        fprintf(output, "PUSHS bool@false\n");
+        fprintf(output, "JUMPIFEQS $while_end_%d\n", label_num);
+    }
 
     codegen_generate_block(output, while_node->body, while_node->name);
 
     fprintf(output, "JUMP $while_start_%d\n", label_num);
     fprintf(output, "LABEL $while_end_%d\n", label_num);
 }
-
-/**
- * Escapes special characters in a string for IFJcode24.
- */
-char *escape_ifj24_string(const char *input) {
-    size_t length = strlen(input);
-    size_t buffer_size = length * 4 + 1; // Reserve space for escaping
-    char *escaped_string = safe_malloc(buffer_size);
-    size_t index = 0;
-    for (size_t i = 0; i < length; i++) {
-        unsigned char c = input[i];
-
-        if (c <= 32 || c == 35 || c == 92 || c >= 127) { // ASCII 0-32, 35 (#), 92 (\), 127+ (non-printable)
-            index += snprintf(escaped_string + index, buffer_size - index, "\\%03d", c);
-        } else {
-            escaped_string[index++] = c;
-        }
-    }
-
-    escaped_string[index] = '\0';
-    return escaped_string;
-}
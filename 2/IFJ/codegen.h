@@ -17,11 +17,26 @@
 #include "ast.h"
 #include <stdio.h>
 
-/** Structure to track usage of built-in functions */
+/** Built-in functions implemented by a runtime helper routine */
+typedef enum {
+    BUILTIN_HELPER_SUBSTRING,
+    BUILTIN_HELPER_STRCMP,
+    BUILTIN_HELPER_STRING,
+    BUILTIN_HELPER_ORD,
+    BUILTIN_HELPER_CHR,
+    BUILTIN_HELPER_COUNT
+} BuiltinHelper;
+
+/** Structure describing a runtime helper routine */
+typedef struct {
+    const char *function_name; // Name of the built-in function (ifj.xxx)
+    const char *label;         // Label of the helper routine
+    const char *code;          // Precompiled IFJcode24 body of the helper
+} BuiltinHelperInfo;
+
+/** Structure to track usage of built-in functions, filled during code generation */
 typedef struct {
-    bool uses_substring;
-    bool uses_strcmp;
-    bool uses_string;
+    bool used[BUILTIN_HELPER_COUNT];
 } BuiltinFunctionUsage;
 
 /** Entry for mapping temporary variables to AST nodes */
@@ -44,16 +59,103 @@ typedef struct TempVar {
     struct TempVar *next;
 } TempVar;
 
+/**
+ * Value computed in the current basic block (common subexpression elimination).
+ * Two entries are equal if they apply the same operation to operands with the same value numbers.
+ */
+typedef struct {
+    const char *operation; // Operator or built-in function name, NULL for constants
+    const char *value;     // Text of a constant, NULL for operations
+    DataType type;
+    int operands[3];       // Value numbers of the operands, 0 if unused
+    int number;            // Value number of the result
+    ASTNode *node;         // First expression that computes the value
+} ValueNumber;
+
+/** Value number currently held by a variable */
+typedef struct {
+    const char *name;
+    int number;
+} VariableNumber;
+
+/** Places counted by --instrument */
+typedef enum {
+    PROFILE_FUNCTION, // Function entry
+    PROFILE_LOOP,     // Loop header, once per evaluated condition
+    PROFILE_THEN,     // Branch arms of an if statement
+    PROFILE_ELSE
+} ProfilePointKind;
+
+/** Execution counter in the global frame, GF@%prof_<index> */
+typedef struct {
+    ProfilePointKind kind;
+    int line;   // Source position of the counted function, statement or block
+    int column;
+} ProfilePoint;
+
+/** Tail calls turned into jumps in one function */
+typedef struct TailCallStats {
+    char *function_name;
+    int self_calls;    // Parameters reassigned, JUMP to the body of the function
+    int sibling_calls; // Frame popped, JUMP to the called function instead of CALL
+    struct TailCallStats *next;
+} TailCallStats;
+
+/**
+ * State of the code generator for one compilation (part of CompilerContext).
+ */
+typedef struct {
+    TempVarMapEntry *temp_var_map;
+    int unique_var_counter;
+    int temp_var_counter;
+    BuiltinFunctionUsage builtin_function_usage;
+    DeclaredVar *declared_vars;
+    TempVar *temp_vars;
+    FILE *output_file;          // Output file of the generated code
+    bool output_file_owned;     // True if codegen opened output_file and has to close it
+    int label_counter;
+    int if_label_count;
+    char name_buffer[1024];     // Result of remove_last_prefix
+    ASTNode *current_function;  // Function being generated
+    TailCallStats *tail_calls_head;
+    TailCallStats *tail_calls_tail;
+    ValueNumber *values;        // Values of the current basic block
+    int value_count;
+    int value_capacity;
+    VariableNumber *variables;  // Variables read or assigned in the current basic block
+    int variable_count;
+    int variable_capacity;
+    int value_number_counter;
+    int reused_values;          // Values of the current function stored for reuse, 0 skips the lookups
+    bool instrument;            // Count executions of functions, loops and branches
+    ProfilePoint *profile_points;
+    int profile_point_count;
+    int profile_point_capacity;
+    bool binary;                // Output is assembled into the binary form of IFJcode24 (ifjcode.h)
+    FILE *binary_output;        // Destination of the binary form, output_file then buffers the text
+    bool binary_output_owned;
+    char *text_buffer;          // Text written to the buffer of output_file
+    size_t text_size;
+} CodegenState;
+
 /**
  * Functions to initialize and finalize code generation
  */
 void codegen_init(const char *filename);
+void codegen_init_stream(FILE *stream);
 void codegen_finalize();
+void codegen_reset();
+void codegen_enable_instrumentation();
+void codegen_enable_binary();
 
 /**
  * Functions to generate code for different AST nodes
  */
 void codegen_generate_program(ASTNode *program_node);
+void codegen_begin_program();
+void codegen_end_program();
+void codegen_release_function_state();
+void codegen_print_tail_call_report(FILE *output);
 void codegen_generate_function(ASTNode *function_node);
 void codegen_generate_block(FILE *output, ASTNode *block_node, const char *current_function);
 void codegen_generate_statement(FILE *output, ASTNode *statement_node, const char *current_function);
@@ -69,6 +171,7 @@ void codegen_generate_while(FILE *output, ASTNode *while_node);
  * Functions to generate and declare variables
  */
 void codegen_generate_builtin_functions();
+const BuiltinHelperInfo *get_builtin_helper(const char *function_name);
 void codegen_declare_variables_in_statement(FILE *output, ASTNode *node);
 void codegen_declare_variables_in_block(FILE *output, ASTNode *block_node);
 void collect_variables_in_statement(ASTNode *node);
@@ -80,6 +183,7 @@ void collect_variables_in_expression(ASTNode *node);
  * Utility functions
  */
 int generate_unique_label();
+bool needs_null_check(ASTNode *node);
 const char *get_function_name_from_variable(const char *var_name);
 bool is_function_parameter(ASTNode *function, const char *var_name);
 
@@ -0,0 +1,253 @@
+/**
+ * @file compiler.c
+ *
+ * Implementation of the compilation driver.
+ * Errors are reported by error_exit, which ends the process or, in the
+ * compile server and batch mode, jumps back to the point set by error_set_recovery.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#include "compiler.h"
+#include "scanner.h"
+#include "parser.h"
+#include "error.h"
+#include "ast.h"
+#include "codegen.h"
+#include "nullability.h"
+#include "utils.h"
+#include "ast_file.h"
+#include <string.h>
+
+// Context of the main thread, used by the command line interface and the compile server
+static CompilerContext main_context;
+
+COMPILER_THREAD_LOCAL CompilerContext *current_context = &main_context;
+
+/**
+ * Emits one function in low memory mode and frees everything allocated since
+ * its parsing started. Only the lookahead token, the symtable array (it may have
+ * grown), the nil check and tail call counters of the function and the tables
+ * of execution counters and pooled literals outlive it. Literals of the function
+ * leave the pool.
+ */
+static void emit_function_and_release(ASTNode *function_node, size_t storage_mark)
+{
+    timing_begin(PHASE_CODEGEN);
+    codegen_generate_function(function_node);
+    codegen_release_function_state();
+    timing_end(PHASE_CODEGEN);
+
+    parser_forget_function(function_node);
+
+    string_pool_release_since(storage_mark);
+
+    NullCheckStats *stats = current_context->nullability.stats_tail;
+    TailCallStats *tail_calls = current_context->codegen.tail_calls_tail;
+    void *keep[] = {
+        current_context->parser.current_token.lexeme,
+        current_context->parser.symtable.table,
+        stats,
+        stats ? stats->function_name : NULL,
+        tail_calls,
+        tail_calls ? tail_calls->function_name : NULL,
+        current_context->codegen.profile_points,
+        current_context->string_pool.buckets,
+        current_context->string_pool.entries};
+    release_pointers_since(storage_mark, keep, sizeof(keep) / sizeof(keep[0]));
+}
+
+/**
+ * Parses the program and generates its abstract syntax tree (AST).
+ * With --ast-cache a file written for the same source replaces parsing and the
+ * semantic checks, any other file is replaced. With --emit-ast the AST is written
+ * after parsing. Both need a seekable source, the cache is skipped for a pipe.
+ */
+static ASTNode *parse_or_load_program(FILE *source_file, const CompileOptions *options)
+{
+    uint64_t source_hash = 0;
+    uint64_t source_size = 0;
+    bool hashed = (options->emit_ast || options->ast_cache) &&
+                  ast_file_source_hash(source_file, &source_hash, &source_size);
+    if (options->emit_ast && !hashed)
+    {
+        error_exit(ERR_INTERNAL, "--emit-ast needs a source file that can be read twice");
+    }
+
+    ASTNode *ast_root = NULL;
+    if (options->ast_cache && hashed)
+    {
+        ast_root = ast_file_load(options->ast_cache, &current_context->parser.symtable, source_hash, source_size);
+    }
+    bool loaded = ast_root != NULL;
+
+    if (!loaded)
+    {
+        // Initialize scanner (scanner.c)
+        Scanner *scanner = &current_context->scanner;
+        scanner_init(source_file, scanner);
+
+        // Initialize parser (parser.c)
+        parser_init(scanner);
+
+        ast_root = parse_program(scanner);
+        scanner_close(scanner);
+    }
+
+    if (options->ast_cache && hashed && !loaded)
+    {
+        ast_file_write(options->ast_cache, ast_root, &current_context->parser.symtable, source_hash, source_size);
+    }
+    if (options->emit_ast)
+    {
+        ast_file_write(options->emit_ast, ast_root, &current_context->parser.symtable, source_hash, source_size);
+    }
+    return ast_root;
+}
+
+/**
+ * Opens the output of the generated code.
+ */
+static void open_output(const char *output_filename, FILE *output_stream)
+{
+    if (output_stream)
+    {
+        codegen_init_stream(output_stream);
+    }
+    else
+    {
+        codegen_init(output_filename);
+    }
+}
+
+/**
+ * Compiles one program.
+ * In low memory mode the output is opened before parsing and every function is
+ * generated as soon as it is parsed, so a failing program leaves partial output.
+ * Returns ERR_OK, any other result is reported through error_exit.
+ */
+int compiler_compile(FILE *source_file, const char *output_filename, FILE *output_stream, const CompileOptions *options)
+{
+    compiler_reset();
+
+    // Measure compiler phases (timing.c)
+    if (options->time_passes)
+    {
+        timing_enable();
+    }
+
+    // Count executions of the generated code (codegen.c)
+    if (options->instrument)
+    {
+        codegen_enable_instrumentation();
+    }
+
+    // Assemble the generated code into the binary form (codegen.c, ifjcode.c)
+    if (options->binary)
+    {
+        codegen_enable_binary();
+    }
+
+    // Initialize memory management for pointers (utils.c)
+    init_pointers_storage(5);
+
+    timing_begin(PHASE_PARSE);
+
+    if (options->low_memory)
+    {
+        // Initialize scanner (scanner.c)
+        Scanner *scanner = &current_context->scanner;
+        scanner_init(source_file, scanner);
+
+        // Initialize parser (parser.c)
+        parser_init(scanner);
+
+        // Parse and generate function by function (parser.c, codegen.c)
+        open_output(output_filename, output_stream);
+        codegen_begin_program();
+        parse_program_streaming(scanner, emit_function_and_release);
+        scanner_close(scanner);
+        timing_end(PHASE_PARSE);
+
+        timing_begin(PHASE_CODEGEN);
+        codegen_end_program();
+        codegen_finalize();
+        timing_end(PHASE_CODEGEN);
+    }
+    else
+    {
+        // Parse the source file, or load the AST parsed from the same source before (ast_file.c)
+        ASTNode *ast_root = parse_or_load_program(source_file, options);
+
+        timing_end(PHASE_PARSE);
+        timing_begin(PHASE_CODEGEN);
+
+        // Initialize code generator (codegen.c)
+        open_output(output_filename, output_stream);
+
+        // Generate code from the AST (codegen.c)
+        codegen_generate_program(ast_root);
+
+        // Finalize code generation (codegen.c)
+        codegen_finalize();
+
+        timing_end(PHASE_CODEGEN);
+    }
+
+    // Report runtime nil checks that were kept and removed (nullability.c)
+    if (options->null_report)
+    {
+        nullability_print_report(stderr);
+    }
+
+    // Report tail calls generated as jumps (codegen.c)
+    if (options->tail_call_report)
+    {
+        codegen_print_tail_call_report(stderr);
+    }
+
+    // Cleanup memory used for pointers (utils.c)
+    timing_begin(PHASE_CLEANUP);
+    cleanup_pointers_storage();
+    ast_file_reset();
+    timing_end(PHASE_CLEANUP);
+
+    // Report time and memory spent in each phase (timing.c)
+    if (options->time_passes)
+    {
+        timing_print_report(stderr, options->time_passes_format);
+    }
+
+    return ERR_OK;
+}
+
+/**
+ * Resets the state of the scanner, parser, codegen and report modules.
+ * Memory owned by that state is released by cleanup_pointers_storage,
+ * which runs at the end of every compilation and in error_exit.
+ * The copy of a piped source is still open when an error ended the compilation.
+ */
+void compiler_reset(void)
+{
+    scanner_close(&current_context->scanner);
+    parser_reset();
+    codegen_reset();
+    nullability_reset();
+    string_pool_reset();
+    ast_file_reset();
+    timing_reset();
+}
+
+/**
+ * Makes a new context current in the calling thread.
+ */
+void compiler_context_activate(CompilerContext *context)
+{
+    memset(context, 0, sizeof(*context));
+    current_context = context;
+    compiler_reset();
+}
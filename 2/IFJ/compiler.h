@@ -0,0 +1,80 @@
+/**
+ * @file compiler.h
+ *
+ * Header file for the compilation driver.
+ * Runs the whole pipeline (scanner, parser, codegen) on one source,
+ * used by the command line interface, the compile server and batch mode.
+ *
+ * All mutable state of the modules lives in a CompilerContext. Every thread
+ * works with its own context through current_context, so independent
+ * programs can be compiled concurrently in one process.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "utils.h"
+#include "parser.h"
+#include "codegen.h"
+#include "nullability.h"
+#include "timing.h"
+#include "string_pool.h"
+#include "ast_file.h"
+
+// Storage class of the per-thread context pointer
+#define COMPILER_THREAD_LOCAL __thread
+
+/**
+ * State of one compilation, formerly the global variables of the modules.
+ */
+typedef struct {
+    PointerStorage storage;        // Pointers allocated by safe_malloc (utils.c)
+    Scanner scanner;               // scanner.c, its copy of a piped source is closed by compiler_reset
+    ParserState parser;            // parser.c
+    CodegenState codegen;          // codegen.c
+    NullabilityState nullability;  // nullability.c
+    TimingState timing;            // timing.c
+    StringPoolState string_pool;   // string_pool.c
+    AstFileState ast_file;         // ast_file.c
+    jmp_buf *error_recovery;       // Where error_exit continues, NULL ends the process (error.c)
+    int error_code;                // Code of the error that jumped to error_recovery
+    const char *source_name;       // Printed before error messages in batch mode, may be NULL
+    char *error_message;           // When set, error_exit stores the message here instead of printing it
+    size_t error_message_size;
+} CompilerContext;
+
+// Context of the compilation running in the current thread
+extern COMPILER_THREAD_LOCAL CompilerContext *current_context;
+
+/** Options of one compilation */
+typedef struct {
+    bool null_report;              // Print emitted and elided nil checks to stderr
+    bool time_passes;              // Print phase times to stderr
+    TimingFormat time_passes_format;
+    bool low_memory;               // Emit and free every function right after it is parsed
+    bool tail_call_report;         // Print tail calls turned into jumps to stderr
+    bool instrument;               // Generate execution counters written when main returns
+    const char *emit_ast;          // Write the checked AST to this file, NULL if not requested
+    const char *ast_cache;         // Load the AST from this file when it matches the source, else parse and write it
+    bool binary;                   // Write the compact binary form of IFJcode24 instead of the text (ifjcode.h)
+} CompileOptions;
+
+// Compiles source_file into output_stream, or into output_filename (stdout if NULL) when the stream is NULL
+int compiler_compile(FILE *source_file, const char *output_filename, FILE *output_stream, const CompileOptions *options);
+
+// Resets the state of all modules in the current context, so the next compilation starts from scratch
+void compiler_reset(void);
+
+// Clears the context and makes it current in the calling thread
+void compiler_context_activate(CompilerContext *context);
+
+#endif // COMPILER_H
@@ -10,9 +10,19 @@
  * @author <xkovin00> Viktoriia Kovina
  * @author <xshmon00> Gleb Shmonin
  */
+#define _POSIX_C_SOURCE 200809L
 
 #include "error.h"
 #include "utils.h"
+#include "compiler.h"
+
+/**
+ * Sets the point error_exit jumps to instead of calling exit.
+ * The error code is left in current_context->error_code, setjmp only tells that the jump came.
+ */
+void error_set_recovery(jmp_buf *recovery) {
+    current_context->error_recovery = recovery;
+}
 
 /**
  * Print an error message and exit the program with the given error code.
@@ -20,10 +30,25 @@
 void error_exit(int error_code, const char *format, ...) {
     va_list args;
     va_start(args, format);
-    fprintf(stderr, "ERROR %i: ", error_code);
-    vfprintf(stderr, format, args);
-    fprintf(stderr, "\n");
+    if (current_context->error_message) {
+        // Diagnostics of the incremental analysis are returned to the caller (incremental.c)
+        vsnprintf(current_context->error_message, current_context->error_message_size, format, args);
+    } else {
+        // Keep the message in one piece when several threads compile at once
+        flockfile(stderr);
+        if (current_context->source_name) {
+            fprintf(stderr, "%s: ", current_context->source_name);
+        }
+        fprintf(stderr, "ERROR %i: ", error_code);
+        vfprintf(stderr, format, args);
+        fprintf(stderr, "\n");
+        funlockfile(stderr);
+    }
     va_end(args);
     cleanup_pointers_storage();
+    if (current_context->error_recovery) {
+        current_context->error_code = error_code;
+        longjmp(*current_context->error_recovery, 1);
+    }
     exit(error_code);
 }
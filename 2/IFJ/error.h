@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <setjmp.h>
 #include "utils.h"
 
 // Error codes as per specification
@@ -35,5 +36,8 @@
 
 // Functions for error handling
 void error_exit(int error_code, const char *format, ...);
+// Makes error_exit jump to the given point instead of ending the process (NULL restores exit),
+// the code of the error is then in current_context->error_code
+void error_set_recovery(jmp_buf *recovery);
 
 #endif // ERROR_H
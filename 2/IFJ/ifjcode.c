@@ -0,0 +1,1184 @@
+/**
+ * @file ifjcode.c
+ *
+ * Implementation of the IFJcode24 text and binary forms.
+ * The text parser interns every operand in an open addressing map, so equal
+ * operands share one constant, and resolves labels after the last line.
+ * The binary loader checks every index and offset, a damaged file is reported
+ * and never read out of bounds.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#include "ifjcode.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IFJCODE_HEADER_LINE ".IFJcode24"
+#define IFJCODE_NONE 0xFFFFFFFFu
+#define IFJCODE_INITIAL_CAPACITY 256
+#define IFJCODE_NUMBER_LENGTH 64 // Longer int and float operands are kept as written
+
+/**
+ * Operands of an instruction, one character per operand:
+ * v variable, s variable or constant, t type, l label reference, d label definition
+ */
+typedef struct {
+    const char *name;
+    const char *operands;
+} IfjcodeOpcodeInfo;
+
+static const IfjcodeOpcodeInfo opcode_info[IFJCODE_OPCODE_COUNT] = {
+    [IFJCODE_MOVE] = {"MOVE", "vs"},
+    [IFJCODE_CREATEFRAME] = {"CREATEFRAME", ""},
+    [IFJCODE_PUSHFRAME] = {"PUSHFRAME", ""},
+    [IFJCODE_POPFRAME] = {"POPFRAME", ""},
+    [IFJCODE_DEFVAR] = {"DEFVAR", "v"},
+    [IFJCODE_CALL] = {"CALL", "l"},
+    [IFJCODE_RETURN] = {"RETURN", ""},
+    [IFJCODE_PUSHS] = {"PUSHS", "s"},
+    [IFJCODE_POPS] = {"POPS", "v"},
+    [IFJCODE_CLEARS] = {"CLEARS", ""},
+    [IFJCODE_ADD] = {"ADD", "vss"},
+    [IFJCODE_SUB] = {"SUB", "vss"},
+    [IFJCODE_MUL] = {"MUL", "vss"},
+    [IFJCODE_DIV] = {"DIV", "vss"},
+    [IFJCODE_IDIV] = {"IDIV", "vss"},
+    [IFJCODE_ADDS] = {"ADDS", ""},
+    [IFJCODE_SUBS] = {"SUBS", ""},
+    [IFJCODE_MULS] = {"MULS", ""},
+    [IFJCODE_DIVS] = {"DIVS", ""},
+    [IFJCODE_IDIVS] = {"IDIVS", ""},
+    [IFJCODE_LT] = {"LT", "vss"},
+    [IFJCODE_GT] = {"GT", "vss"},
+    [IFJCODE_EQ] = {"EQ", "vss"},
+    [IFJCODE_LTS] = {"LTS", ""},
+    [IFJCODE_GTS] = {"GTS", ""},
+    [IFJCODE_EQS] = {"EQS", ""},
+    [IFJCODE_AND] = {"AND", "vss"},
+    [IFJCODE_OR] = {"OR", "vss"},
+    [IFJCODE_NOT] = {"NOT", "vs"},
+    [IFJCODE_ANDS] = {"ANDS", ""},
+    [IFJCODE_ORS] = {"ORS", ""},
+    [IFJCODE_NOTS] = {"NOTS", ""},
+    [IFJCODE_INT2FLOAT] = {"INT2FLOAT", "vs"},
+    [IFJCODE_FLOAT2INT] = {"FLOAT2INT", "vs"},
+    [IFJCODE_INT2CHAR] = {"INT2CHAR", "vs"},
+    [IFJCODE_STRI2INT] = {"STRI2INT", "vss"},
+    [IFJCODE_INT2FLOATS] = {"INT2FLOATS", ""},
+    [IFJCODE_FLOAT2INTS] = {"FLOAT2INTS", ""},
+    [IFJCODE_INT2CHARS] = {"INT2CHARS", ""},
+    [IFJCODE_STRI2INTS] = {"STRI2INTS", ""},
+    [IFJCODE_READ] = {"READ", "vt"},
+    [IFJCODE_WRITE] = {"WRITE", "s"},
+    [IFJCODE_CONCAT] = {"CONCAT", "vss"},
+    [IFJCODE_STRLEN] = {"STRLEN", "vs"},
+    [IFJCODE_GETCHAR] = {"GETCHAR", "vss"},
+    [IFJCODE_SETCHAR] = {"SETCHAR", "vss"},
+    [IFJCODE_TYPE] = {"TYPE", "vs"},
+    [IFJCODE_LABEL] = {"LABEL", "d"},
+    [IFJCODE_JUMP] = {"JUMP", "l"},
+    [IFJCODE_JUMPIFEQ] = {"JUMPIFEQ", "lss"},
+    [IFJCODE_JUMPIFNEQ] = {"JUMPIFNEQ", "lss"},
+    [IFJCODE_JUMPIFEQS] = {"JUMPIFEQS", "l"},
+    [IFJCODE_JUMPIFNEQS] = {"JUMPIFNEQS", "l"},
+    [IFJCODE_EXIT] = {"EXIT", "s"},
+    [IFJCODE_BREAK] = {"BREAK", ""},
+    [IFJCODE_DPRINT] = {"DPRINT", "s"},
+};
+
+/** Prefix of the constant kinds in the text form, NULL for kinds without one */
+static const char *const constant_prefix[IFJCODE_CONST_KIND_COUNT] = {
+    [IFJCODE_CONST_GF] = "GF@",
+    [IFJCODE_CONST_LF] = "LF@",
+    [IFJCODE_CONST_TF] = "TF@",
+    [IFJCODE_CONST_STRING] = "string@",
+};
+
+static const char *const type_names[] = {"int", "float", "string", "bool", "nil"};
+
+/** Growable byte buffer of the binary writer */
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+    bool failed; // Out of memory, later writes are ignored
+} ByteBuffer;
+
+/** State of the text parser */
+typedef struct {
+    IfjcodeProgram *program;
+    uint32_t *slots;         // Constant index + 1 of the interned operands, 0 is a free slot
+    uint32_t slot_count;
+    uint32_t *label_targets; // LABEL instruction of every label constant, IFJCODE_NONE if not defined yet
+    int line;
+} TextParser;
+
+const char *ifjcode_opcode_name(IfjcodeOpcode opcode)
+{
+    return opcode_info[opcode].name;
+}
+
+/**
+ * Stores the reason of a failure, always returns -1.
+ */
+static int fail(IfjcodeProgram *program, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vsnprintf(program->error, sizeof(program->error), format, args);
+    va_end(args);
+    return -1;
+}
+
+/**
+ * Grows an array to hold one more item, returns false when out of memory.
+ */
+static bool reserve(void **items, uint32_t *capacity, uint32_t count, size_t item_size)
+{
+    if (count < *capacity)
+    {
+        return true;
+    }
+    uint32_t new_capacity = *capacity ? *capacity * 2 : IFJCODE_INITIAL_CAPACITY;
+    void *grown = realloc(*items, (size_t)new_capacity * item_size);
+    if (grown == NULL)
+    {
+        return false;
+    }
+    *items = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+/**
+ * Appends an instruction, returns -1 when out of memory.
+ */
+static int add_instruction(IfjcodeProgram *program, const IfjcodeInstruction *instruction)
+{
+    if (!reserve((void **)&program->instructions, &program->instruction_capacity, program->instruction_count,
+                 sizeof(IfjcodeInstruction)))
+    {
+        return fail(program, "out of memory");
+    }
+    program->instructions[program->instruction_count++] = *instruction;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Text form
+// ---------------------------------------------------------------------------
+
+/**
+ * FNV-1a of an operand and its kind.
+ */
+static uint32_t hash_operand(IfjcodeConstantKind kind, const char *text, size_t length)
+{
+    uint32_t hash = 2166136261u ^ (uint32_t)kind;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Slot of an operand in the intern map.
+ */
+static uint32_t operand_slot(const TextParser *parser, IfjcodeConstantKind kind, const char *text, size_t length)
+{
+    const IfjcodeProgram *program = parser->program;
+    uint32_t slot = hash_operand(kind, text, length) & (parser->slot_count - 1);
+    while (parser->slots[slot] != 0)
+    {
+        const IfjcodeConstant *constant = &program->constants[parser->slots[slot] - 1];
+        if (constant->kind == kind && constant->length == length && memcmp(constant->text, text, length) == 0)
+        {
+            break;
+        }
+        slot = (slot + 1) & (parser->slot_count - 1);
+    }
+    return slot;
+}
+
+/**
+ * Doubles the intern map, it is kept at most half full.
+ */
+static bool grow_slots(TextParser *parser)
+{
+    uint32_t old_count = parser->slot_count;
+    uint32_t *old_slots = parser->slots;
+    parser->slot_count = old_count ? old_count * 2 : IFJCODE_INITIAL_CAPACITY * 2;
+    parser->slots = calloc(parser->slot_count, sizeof(uint32_t));
+    if (parser->slots == NULL)
+    {
+        parser->slots = old_slots;
+        parser->slot_count = old_count;
+        return false;
+    }
+    for (uint32_t i = 0; i < old_count; i++)
+    {
+        if (old_slots[i] != 0)
+        {
+            const IfjcodeConstant *constant = &parser->program->constants[old_slots[i] - 1];
+            parser->slots[operand_slot(parser, constant->kind, constant->text, constant->length)] = old_slots[i];
+        }
+    }
+    free(old_slots);
+    return true;
+}
+
+/**
+ * Returns the index of the constant, an operand seen for the first time is added.
+ * The constant is filled by the caller when *added is set. IFJCODE_NONE when out of memory.
+ */
+static uint32_t intern(TextParser *parser, IfjcodeConstantKind kind, const char *text, size_t length, bool *added)
+{
+    IfjcodeProgram *program = parser->program;
+    *added = false;
+    if (((size_t)program->constant_count + 1) * 2 > parser->slot_count && !grow_slots(parser))
+    {
+        return IFJCODE_NONE;
+    }
+    uint32_t slot = operand_slot(parser, kind, text, length);
+    if (parser->slots[slot] != 0)
+    {
+        return parser->slots[slot] - 1;
+    }
+
+    uint32_t capacity = program->constant_capacity;
+    if (!reserve((void **)&program->constants, &program->constant_capacity, program->constant_count,
+                 sizeof(IfjcodeConstant)))
+    {
+        return IFJCODE_NONE;
+    }
+    if (program->constant_capacity != capacity)
+    {
+        uint32_t *grown = realloc(parser->label_targets, (size_t)program->constant_capacity * sizeof(uint32_t));
+        if (grown == NULL)
+        {
+            return IFJCODE_NONE;
+        }
+        parser->label_targets = grown;
+    }
+
+    uint32_t index = program->constant_count++;
+    IfjcodeConstant *constant = &program->constants[index];
+    memset(constant, 0, sizeof(*constant));
+    constant->kind = kind;
+    constant->text = text;
+    constant->length = (uint32_t)length;
+    parser->label_targets[index] = IFJCODE_NONE;
+    parser->slots[slot] = index + 1;
+    *added = true;
+    return index;
+}
+
+/**
+ * Whether the token equals the word.
+ */
+static bool token_is(const char *token, size_t length, const char *word)
+{
+    return strlen(word) == length && memcmp(token, word, length) == 0;
+}
+
+/**
+ * Copies a number operand into a terminated buffer, false if it is too long.
+ */
+static bool copy_number(char *buffer, const char *text, size_t length)
+{
+    if (length == 0 || length >= IFJCODE_NUMBER_LENGTH)
+    {
+        return false;
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    return true;
+}
+
+/**
+ * Reads an int in the canonical decimal form, false for any other spelling.
+ */
+static bool canonical_int(const char *text, size_t length, int64_t *value)
+{
+    char buffer[IFJCODE_NUMBER_LENGTH];
+    char printed[IFJCODE_NUMBER_LENGTH];
+    if (!copy_number(buffer, text, length))
+    {
+        return false;
+    }
+    char *end;
+    long long parsed = strtoll(buffer, &end, 10);
+    snprintf(printed, sizeof(printed), "%lld", parsed);
+    *value = parsed;
+    return *end == '\0' && strcmp(printed, buffer) == 0;
+}
+
+/**
+ * Reads a float in the form written by the code generator (%.13a), false for any other spelling.
+ */
+static bool canonical_float(const char *text, size_t length, double *value)
+{
+    char buffer[IFJCODE_NUMBER_LENGTH];
+    char printed[IFJCODE_NUMBER_LENGTH];
+    if (!copy_number(buffer, text, length))
+    {
+        return false;
+    }
+    char *end;
+    *value = strtod(buffer, &end);
+    snprintf(printed, sizeof(printed), "%.13a", *value);
+    return *end == '\0' && strcmp(printed, buffer) == 0;
+}
+
+/**
+ * Turns one operand into a constant index.
+ * Returns IFJCODE_NONE with the error set when the operand does not fit the instruction.
+ */
+static uint32_t parse_operand(TextParser *parser, char expected, const char *token, size_t length)
+{
+    IfjcodeProgram *program = parser->program;
+    IfjcodeConstantKind kind;
+    const char *payload = token;
+    size_t payload_length = length;
+    int64_t integer = 0;
+    double number = 0.0;
+
+    if (expected == 'l' || expected == 'd')
+    {
+        kind = IFJCODE_CONST_LABEL;
+    }
+    else if (expected == 't')
+    {
+        kind = IFJCODE_CONST_RAW;
+        for (size_t i = 0; i < sizeof(type_names) / sizeof(type_names[0]); i++)
+        {
+            if (token_is(token, length, type_names[i]))
+            {
+                kind = IFJCODE_CONST_TYPE;
+            }
+        }
+        if (kind != IFJCODE_CONST_TYPE)
+        {
+            fail(program, "line %d: invalid type %.*s", parser->line, (int)length, token);
+            return IFJCODE_NONE;
+        }
+    }
+    else
+    {
+        const char *at = memchr(token, '@', length);
+        if (at == NULL)
+        {
+            fail(program, "line %d: invalid operand %.*s", parser->line, (int)length, token);
+            return IFJCODE_NONE;
+        }
+        size_t prefix_length = (size_t)(at - token);
+        payload = at + 1;
+        payload_length = length - prefix_length - 1;
+
+        if (token_is(token, prefix_length, "GF"))
+            kind = IFJCODE_CONST_GF;
+        else if (token_is(token, prefix_length, "LF"))
+            kind = IFJCODE_CONST_LF;
+        else if (token_is(token, prefix_length, "TF"))
+            kind = IFJCODE_CONST_TF;
+        else if (token_is(token, prefix_length, "int"))
+            kind = canonical_int(payload, payload_length, &integer) ? IFJCODE_CONST_INT : IFJCODE_CONST_RAW;
+        else if (token_is(token, prefix_length, "float"))
+            kind = canonical_float(payload, payload_length, &number) ? IFJCODE_CONST_FLOAT : IFJCODE_CONST_RAW;
+        else if (token_is(token, prefix_length, "string"))
+            kind = IFJCODE_CONST_STRING;
+        else if (token_is(token, prefix_length, "bool") &&
+                 (token_is(payload, payload_length, "true") || token_is(payload, payload_length, "false")))
+            kind = IFJCODE_CONST_BOOL;
+        else if (token_is(token, prefix_length, "nil") && token_is(payload, payload_length, "nil"))
+            kind = IFJCODE_CONST_NIL;
+        else
+        {
+            fail(program, "line %d: invalid operand %.*s", parser->line, (int)length, token);
+            return IFJCODE_NONE;
+        }
+
+        if (kind == IFJCODE_CONST_RAW)
+        {
+            payload = token;
+            payload_length = length;
+        }
+        if (kind <= IFJCODE_CONST_TF ? payload_length == 0 : expected == 'v')
+        {
+            fail(program, "line %d: expected a variable, got %.*s", parser->line, (int)length, token);
+            return IFJCODE_NONE;
+        }
+    }
+
+    bool added;
+    uint32_t index = intern(parser, kind, payload, payload_length, &added);
+    if (index == IFJCODE_NONE)
+    {
+        fail(program, "out of memory");
+    }
+    else if (added)
+    {
+        program->constants[index].integer = kind == IFJCODE_CONST_BOOL ? payload[0] == 't' : integer;
+        program->constants[index].number = number;
+    }
+    return index;
+}
+
+/**
+ * Whether the token equals the upper case word when its letters are converted to upper case.
+ */
+static bool upper_equal(const char *token, size_t length, const char *word)
+{
+    size_t i = 0;
+    for (; i < length && word[i] != '\0'; i++)
+    {
+        char c = token[i];
+        if (((c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c) != word[i])
+        {
+            return false;
+        }
+    }
+    return i == length && word[i] == '\0';
+}
+
+/**
+ * Finds an instruction by its name, the text form is case insensitive.
+ */
+static int find_opcode(const char *token, size_t length)
+{
+    // Most instructions of generated code are DEFVAR, PUSHS and POPS, a linear scan in enum order is short enough
+    for (int opcode = 0; opcode < IFJCODE_OPCODE_COUNT; opcode++)
+    {
+        if (upper_equal(token, length, opcode_info[opcode].name))
+        {
+            return opcode;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Parses one line that holds an instruction.
+ */
+static int parse_instruction(TextParser *parser, const char **tokens, const size_t *lengths, int token_count)
+{
+    IfjcodeProgram *program = parser->program;
+    int opcode = find_opcode(tokens[0], lengths[0]);
+    if (opcode < 0)
+    {
+        return fail(program, "line %d: unknown instruction %.*s", parser->line, (int)lengths[0], tokens[0]);
+    }
+    const char *operands = opcode_info[opcode].operands;
+    if ((size_t)(token_count - 1) != strlen(operands))
+    {
+        return fail(program, "line %d: %s takes %d operands", parser->line, opcode_info[opcode].name,
+                    (int)strlen(operands));
+    }
+
+    IfjcodeInstruction instruction = {(IfjcodeOpcode)opcode, {IFJCODE_NONE, IFJCODE_NONE, IFJCODE_NONE}};
+    for (int i = 1; i < token_count; i++)
+    {
+        instruction.operands[i - 1] = parse_operand(parser, operands[i - 1], tokens[i], lengths[i]);
+        if (instruction.operands[i - 1] == IFJCODE_NONE)
+        {
+            return -1;
+        }
+    }
+
+    if (opcode == IFJCODE_LABEL)
+    {
+        uint32_t label = instruction.operands[0];
+        if (parser->label_targets[label] != IFJCODE_NONE)
+        {
+            return fail(program, "line %d: label %.*s is defined twice", parser->line, (int)lengths[1], tokens[1]);
+        }
+        parser->label_targets[label] = program->instruction_count;
+        program->label_count++;
+    }
+    return add_instruction(program, &instruction);
+}
+
+/**
+ * Replaces the label constants of jumps and calls by the LABEL instructions.
+ */
+static int resolve_labels(TextParser *parser)
+{
+    IfjcodeProgram *program = parser->program;
+    for (uint32_t i = 0; i < program->instruction_count; i++)
+    {
+        IfjcodeInstruction *instruction = &program->instructions[i];
+        const char *operands = opcode_info[instruction->opcode].operands;
+        for (int j = 0; operands[j] != '\0'; j++)
+        {
+            if (operands[j] != 'l')
+            {
+                continue;
+            }
+            const IfjcodeConstant *label = &program->constants[instruction->operands[j]];
+            uint32_t target = parser->label_targets[instruction->operands[j]];
+            if (target == IFJCODE_NONE)
+            {
+                return fail(program, "instruction %u: undefined label %.*s", i + 1, (int)label->length, label->text);
+            }
+            instruction->operands[j] = target;
+        }
+    }
+    return 0;
+}
+
+int ifjcode_parse_text(IfjcodeProgram *program, const char *text, size_t length)
+{
+    program->constant_count = 0;
+    program->instruction_count = 0;
+    program->label_count = 0;
+    program->error[0] = '\0';
+
+    TextParser parser = {program, NULL, 0, NULL, 0};
+    bool header = false;
+    int result = 0;
+    // The constant array of a previous parse is reused, the label targets grow with it
+    if (program->constant_capacity > 0)
+    {
+        parser.label_targets = malloc((size_t)program->constant_capacity * sizeof(uint32_t));
+        if (parser.label_targets == NULL)
+        {
+            return fail(program, "out of memory");
+        }
+    }
+    const char *end = text + length;
+
+    for (const char *line = text; line < end && result == 0;)
+    {
+        const char *line_end = memchr(line, '\n', (size_t)(end - line));
+        if (line_end == NULL)
+        {
+            line_end = end;
+        }
+        parser.line++;
+
+        // Operands never contain '#', string constants escape it
+        const char *comment = memchr(line, '#', (size_t)(line_end - line));
+        const char *content_end = comment ? comment : line_end;
+
+        const char *tokens[IFJCODE_MAX_OPERANDS + 2];
+        size_t lengths[IFJCODE_MAX_OPERANDS + 2];
+        int token_count = 0;
+        for (const char *p = line; p < content_end && token_count < IFJCODE_MAX_OPERANDS + 2;)
+        {
+            while (p < content_end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            {
+                p++;
+            }
+            const char *start = p;
+            while (p < content_end && *p != ' ' && *p != '\t' && *p != '\r')
+            {
+                p++;
+            }
+            if (p > start)
+            {
+                tokens[token_count] = start;
+                lengths[token_count++] = (size_t)(p - start);
+            }
+        }
+
+        if (token_count > IFJCODE_MAX_OPERANDS + 1)
+        {
+            result = fail(program, "line %d: too many operands", parser.line);
+        }
+        else if (token_count > 0 && !header)
+        {
+            header = token_count == 1 && upper_equal(tokens[0], lengths[0], ".IFJCODE24");
+            if (!header)
+            {
+                result = fail(program, "line %d: expected the %s header", parser.line, IFJCODE_HEADER_LINE);
+            }
+        }
+        else if (token_count > 0)
+        {
+            result = parse_instruction(&parser, tokens, lengths, token_count);
+        }
+        line = line_end + 1;
+    }
+
+    if (result == 0 && !header)
+    {
+        result = fail(program, "missing the %s header", IFJCODE_HEADER_LINE);
+    }
+    if (result == 0)
+    {
+        result = resolve_labels(&parser);
+    }
+    if (result != 0)
+    {
+        // Label references of a partly parsed program are not resolved
+        program->instruction_count = 0;
+        program->label_count = 0;
+    }
+    free(parser.slots);
+    free(parser.label_targets);
+    return result;
+}
+
+/**
+ * Writes one operand in the text form.
+ */
+static void write_constant(const IfjcodeConstant *constant, FILE *output)
+{
+    switch (constant->kind)
+    {
+    case IFJCODE_CONST_INT:
+        fprintf(output, "int@%lld", (long long)constant->integer);
+        break;
+    case IFJCODE_CONST_FLOAT:
+        fprintf(output, "float@%.13a", constant->number);
+        break;
+    case IFJCODE_CONST_BOOL:
+        fputs(constant->integer ? "bool@true" : "bool@false", output);
+        break;
+    case IFJCODE_CONST_NIL:
+        fputs("nil@nil", output);
+        break;
+    default:
+        if (constant_prefix[constant->kind] != NULL)
+        {
+            fputs(constant_prefix[constant->kind], output);
+        }
+        fwrite(constant->text, 1, constant->length, output);
+        break;
+    }
+}
+
+int ifjcode_write_text(IfjcodeProgram *program, FILE *output)
+{
+    fputs(IFJCODE_HEADER_LINE "\n", output);
+    for (uint32_t i = 0; i < program->instruction_count; i++)
+    {
+        const IfjcodeInstruction *instruction = &program->instructions[i];
+        const char *operands = opcode_info[instruction->opcode].operands;
+        fputs(opcode_info[instruction->opcode].name, output);
+        for (int j = 0; operands[j] != '\0'; j++)
+        {
+            uint32_t constant = instruction->operands[j];
+            if (operands[j] == 'l')
+            {
+                // Name of the label defined by the target instruction
+                constant = program->instructions[constant].operands[0];
+            }
+            fputc(' ', output);
+            write_constant(&program->constants[constant], output);
+        }
+        fputc('\n', output);
+    }
+    if (fflush(output) != 0 || ferror(output))
+    {
+        return fail(program, "write error");
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Binary form
+// ---------------------------------------------------------------------------
+
+/**
+ * Appends bytes to the buffer.
+ */
+static void put_bytes(ByteBuffer *buffer, const void *bytes, size_t size)
+{
+    if (buffer->failed)
+    {
+        return;
+    }
+    if (buffer->size + size > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity : IFJCODE_INITIAL_CAPACITY;
+        while (buffer->size + size > capacity)
+        {
+            capacity *= 2;
+        }
+        unsigned char *grown = realloc(buffer->data, capacity);
+        if (grown == NULL)
+        {
+            buffer->failed = true;
+            return;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, bytes, size);
+    buffer->size += size;
+}
+
+static void put_byte(ByteBuffer *buffer, unsigned char byte)
+{
+    put_bytes(buffer, &byte, 1);
+}
+
+static void put_u32(ByteBuffer *buffer, uint32_t value)
+{
+    unsigned char bytes[4] = {(unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16),
+                              (unsigned char)(value >> 24)};
+    put_bytes(buffer, bytes, sizeof(bytes));
+}
+
+/**
+ * Appends an unsigned LEB128 number.
+ */
+static void put_varint(ByteBuffer *buffer, uint64_t value)
+{
+    unsigned char bytes[10];
+    size_t size = 0;
+    do
+    {
+        bytes[size] = (unsigned char)(value & 0x7Fu);
+        value >>= 7;
+        if (value != 0)
+        {
+            bytes[size] |= 0x80u;
+        }
+        size++;
+    } while (value != 0);
+    put_bytes(buffer, bytes, size);
+}
+
+/**
+ * Number of bytes of an unsigned LEB128 number.
+ */
+static uint32_t varint_size(uint64_t value)
+{
+    uint32_t size = 1;
+    while (value >= 0x80u)
+    {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+/**
+ * Appends one constant: kind byte and payload.
+ */
+static void put_constant(ByteBuffer *buffer, const IfjcodeConstant *constant)
+{
+    put_byte(buffer, (unsigned char)constant->kind);
+    switch (constant->kind)
+    {
+    case IFJCODE_CONST_INT:
+        // Zigzag keeps small negative numbers short
+        put_varint(buffer, ((uint64_t)constant->integer << 1) ^ (uint64_t)(constant->integer >> 63));
+        break;
+    case IFJCODE_CONST_FLOAT:
+    {
+        uint64_t bits;
+        memcpy(&bits, &constant->number, sizeof(bits));
+        put_u32(buffer, (uint32_t)bits);
+        put_u32(buffer, (uint32_t)(bits >> 32));
+        break;
+    }
+    case IFJCODE_CONST_BOOL:
+        put_byte(buffer, constant->integer ? 1 : 0);
+        break;
+    case IFJCODE_CONST_NIL:
+        break;
+    default:
+        put_varint(buffer, constant->length);
+        put_bytes(buffer, constant->text, constant->length);
+        break;
+    }
+}
+
+int ifjcode_write_binary(IfjcodeProgram *program, FILE *output)
+{
+    ByteBuffer constants = {NULL, 0, 0, false};
+    ByteBuffer labels = {NULL, 0, 0, false};
+    ByteBuffer code = {NULL, 0, 0, false};
+    uint32_t *offsets = malloc(((size_t)program->instruction_count + 1) * sizeof(uint32_t));
+    int result = 0;
+
+    if (offsets == NULL)
+    {
+        return fail(program, "out of memory");
+    }
+
+    // Code offsets first, label references have a fixed size so one pass is enough
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < program->instruction_count; i++)
+    {
+        const IfjcodeInstruction *instruction = &program->instructions[i];
+        const char *operands = opcode_info[instruction->opcode].operands;
+        offsets[i] = (uint32_t)offset;
+        offset++;
+        for (int j = 0; operands[j] != '\0'; j++)
+        {
+            offset += operands[j] == 'l' ? 4 : varint_size(instruction->operands[j]);
+        }
+        if (offset > UINT32_MAX)
+        {
+            free(offsets);
+            return fail(program, "program is too large for the binary form");
+        }
+    }
+
+    for (uint32_t i = 0; i < program->constant_count; i++)
+    {
+        put_constant(&constants, &program->constants[i]);
+    }
+
+    for (uint32_t i = 0; i < program->instruction_count; i++)
+    {
+        const IfjcodeInstruction *instruction = &program->instructions[i];
+        const char *operands = opcode_info[instruction->opcode].operands;
+        if (instruction->opcode == IFJCODE_LABEL)
+        {
+            put_u32(&labels, offsets[i]);
+            put_u32(&labels, i);
+            put_u32(&labels, instruction->operands[0]);
+        }
+        put_byte(&code, (unsigned char)instruction->opcode);
+        for (int j = 0; operands[j] != '\0'; j++)
+        {
+            if (operands[j] == 'l')
+            {
+                put_u32(&code, offsets[instruction->operands[j]]);
+            }
+            else
+            {
+                put_varint(&code, instruction->operands[j]);
+            }
+        }
+    }
+
+    ByteBuffer header = {NULL, 0, 0, false};
+    put_bytes(&header, IFJCODE_MAGIC, 8);
+    put_u32(&header, IFJCODE_VERSION);
+    put_u32(&header, program->constant_count);
+    put_u32(&header, (uint32_t)constants.size);
+    put_u32(&header, program->label_count);
+    put_u32(&header, program->instruction_count);
+    put_u32(&header, (uint32_t)code.size);
+
+    if (header.failed || constants.failed || labels.failed || code.failed || constants.size > UINT32_MAX)
+    {
+        result = fail(program, "out of memory");
+    }
+    else if (fwrite(header.data, 1, header.size, output) != header.size ||
+             fwrite(constants.data, 1, constants.size, output) != constants.size ||
+             (labels.size > 0 && fwrite(labels.data, 1, labels.size, output) != labels.size) ||
+             (code.size > 0 && fwrite(code.data, 1, code.size, output) != code.size) || fflush(output) != 0)
+    {
+        result = fail(program, "write error");
+    }
+
+    free(header.data);
+    free(constants.data);
+    free(labels.data);
+    free(code.data);
+    free(offsets);
+    return result;
+}
+
+/** Read position in a binary section */
+typedef struct {
+    const unsigned char *data;
+    size_t position;
+    size_t size;
+} ByteReader;
+
+static bool get_u32(ByteReader *reader, uint32_t *value)
+{
+    if (reader->size - reader->position < 4)
+    {
+        return false;
+    }
+    const unsigned char *bytes = reader->data + reader->position;
+    *value = (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    reader->position += 4;
+    return true;
+}
+
+static bool get_varint(ByteReader *reader, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && reader->position < reader->size; shift += 7)
+    {
+        unsigned char byte = reader->data[reader->position++];
+        *value |= (uint64_t)(byte & 0x7Fu) << shift;
+        if ((byte & 0x80u) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Reads one constant, false if it is damaged.
+ */
+static bool get_constant(ByteReader *reader, IfjcodeConstant *constant)
+{
+    uint64_t value;
+    uint32_t low;
+    uint32_t high;
+    if (reader->position >= reader->size || reader->data[reader->position] >= IFJCODE_CONST_KIND_COUNT)
+    {
+        return false;
+    }
+    memset(constant, 0, sizeof(*constant));
+    constant->kind = (IfjcodeConstantKind)reader->data[reader->position++];
+
+    switch (constant->kind)
+    {
+    case IFJCODE_CONST_INT:
+        if (!get_varint(reader, &value))
+        {
+            return false;
+        }
+        constant->integer = (int64_t)(value >> 1) ^ -(int64_t)(value & 1u);
+        return true;
+    case IFJCODE_CONST_FLOAT:
+        if (!get_u32(reader, &low) || !get_u32(reader, &high))
+        {
+            return false;
+        }
+        value = (uint64_t)high << 32 | low;
+        memcpy(&constant->number, &value, sizeof(value));
+        return true;
+    case IFJCODE_CONST_BOOL:
+        if (reader->position >= reader->size || reader->data[reader->position] > 1)
+        {
+            return false;
+        }
+        constant->integer = reader->data[reader->position++];
+        return true;
+    case IFJCODE_CONST_NIL:
+        return true;
+    default:
+        if (!get_varint(reader, &value) || value > reader->size - reader->position)
+        {
+            return false;
+        }
+        constant->text = (const char *)reader->data + reader->position;
+        constant->length = (uint32_t)value;
+        reader->position += (size_t)value;
+        return true;
+    }
+}
+
+/**
+ * Whether a constant kind fits an operand of the given class.
+ */
+static bool operand_fits(char expected, IfjcodeConstantKind kind)
+{
+    switch (expected)
+    {
+    case 'v':
+        return kind <= IFJCODE_CONST_TF;
+    case 's':
+        return kind <= IFJCODE_CONST_NIL || kind == IFJCODE_CONST_RAW;
+    case 't':
+        return kind == IFJCODE_CONST_TYPE;
+    default:
+        return kind == IFJCODE_CONST_LABEL;
+    }
+}
+
+/**
+ * Finds the label entry with the code offset, labels are sorted by offset.
+ */
+static uint32_t find_label(const unsigned char *labels, uint32_t label_count, uint32_t offset)
+{
+    uint32_t low = 0;
+    uint32_t high = label_count;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        ByteReader reader = {labels + (size_t)middle * 12, 0, 12};
+        uint32_t label_offset;
+        get_u32(&reader, &label_offset);
+        if (label_offset == offset)
+        {
+            uint32_t instruction;
+            get_u32(&reader, &instruction);
+            return instruction;
+        }
+        if (label_offset < offset)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return IFJCODE_NONE;
+}
+
+int ifjcode_load_binary(IfjcodeProgram *program, const unsigned char *data, size_t size)
+{
+    program->constant_count = 0;
+    program->instruction_count = 0;
+    program->label_count = 0;
+    program->error[0] = '\0';
+
+    ByteReader header = {data, 8, size};
+    uint32_t version;
+    uint32_t constant_count;
+    uint32_t constant_size;
+    uint32_t label_count;
+    uint32_t instruction_count;
+    uint32_t code_size;
+    if (size < IFJCODE_HEADER_SIZE || memcmp(data, IFJCODE_MAGIC, 8) != 0)
+    {
+        return fail(program, "not a binary IFJcode24 file");
+    }
+    get_u32(&header, &version);
+    get_u32(&header, &constant_count);
+    get_u32(&header, &constant_size);
+    get_u32(&header, &label_count);
+    get_u32(&header, &instruction_count);
+    get_u32(&header, &code_size);
+    if (version != IFJCODE_VERSION)
+    {
+        return fail(program, "unsupported version %u", version);
+    }
+    if ((uint64_t)IFJCODE_HEADER_SIZE + constant_size + (uint64_t)label_count * 12 + code_size != size ||
+        constant_count > constant_size || instruction_count > code_size || label_count > instruction_count)
+    {
+        return fail(program, "damaged file: section sizes do not match");
+    }
+
+    // Constants
+    if (constant_count > program->constant_capacity)
+    {
+        IfjcodeConstant *grown = realloc(program->constants, (size_t)constant_count * sizeof(IfjcodeConstant));
+        if (grown == NULL)
+        {
+            return fail(program, "out of memory");
+        }
+        program->constants = grown;
+        program->constant_capacity = constant_count;
+    }
+    ByteReader constants = {data + IFJCODE_HEADER_SIZE, 0, constant_size};
+    for (uint32_t i = 0; i < constant_count; i++)
+    {
+        if (!get_constant(&constants, &program->constants[i]))
+        {
+            return fail(program, "damaged file: constant %u", i);
+        }
+    }
+    if (constants.position != constant_size)
+    {
+        return fail(program, "damaged file: constant table size");
+    }
+    program->constant_count = constant_count;
+
+    // Labels, sorted by offset and checked again while the code is read
+    const unsigned char *labels = data + IFJCODE_HEADER_SIZE + constant_size;
+    ByteReader label_reader = {labels, 0, (size_t)label_count * 12};
+    uint32_t previous_offset = 0;
+    for (uint32_t i = 0; i < label_count; i++)
+    {
+        uint32_t offset;
+        uint32_t index;
+        uint32_t name;
+        get_u32(&label_reader, &offset);
+        get_u32(&label_reader, &index);
+        get_u32(&label_reader, &name);
+        if ((i > 0 && offset <= previous_offset) || index >= instruction_count || name >= constant_count)
+        {
+            return fail(program, "damaged file: label %u", i);
+        }
+        previous_offset = offset;
+    }
+    label_reader.position = 0;
+
+    // Code
+    if (instruction_count > program->instruction_capacity)
+    {
+        IfjcodeInstruction *grown =
+            realloc(program->instructions, (size_t)instruction_count * sizeof(IfjcodeInstruction));
+        if (grown == NULL)
+        {
+            return fail(program, "out of memory");
+        }
+        program->instructions = grown;
+        program->instruction_capacity = instruction_count;
+    }
+    ByteReader code = {labels + (size_t)label_count * 12, 0, code_size};
+    for (uint32_t i = 0; i < instruction_count; i++)
+    {
+        uint32_t offset = (uint32_t)code.position;
+        if (code.position >= code.size || code.data[code.position] >= IFJCODE_OPCODE_COUNT)
+        {
+            return fail(program, "damaged file: instruction %u", i);
+        }
+        IfjcodeInstruction *instruction = &program->instructions[i];
+        instruction->opcode = (IfjcodeOpcode)code.data[code.position++];
+        const char *operands = opcode_info[instruction->opcode].operands;
+
+        for (int j = 0; j < IFJCODE_MAX_OPERANDS; j++)
+        {
+            uint64_t value;
+            uint32_t target;
+            instruction->operands[j] = IFJCODE_NONE;
+            if (j >= (int)strlen(operands))
+            {
+                continue;
+            }
+            if (operands[j] == 'l')
+            {
+                if (!get_u32(&code, &target) || (target = find_label(labels, label_count, target)) == IFJCODE_NONE)
+                {
+                    return fail(program, "damaged file: label reference of instruction %u", i);
+                }
+                instruction->operands[j] = target;
+            }
+            else
+            {
+                if (!get_varint(&code, &value) || value >= constant_count ||
+                    !operand_fits(operands[j], program->constants[value].kind))
+                {
+                    return fail(program, "damaged file: operand of instruction %u", i);
+                }
+                instruction->operands[j] = (uint32_t)value;
+            }
+        }
+
+        if (instruction->opcode == IFJCODE_LABEL)
+        {
+            uint32_t label_offset;
+            uint32_t index;
+            uint32_t name;
+            if (!get_u32(&label_reader, &label_offset) || !get_u32(&label_reader, &index) ||
+                !get_u32(&label_reader, &name) || label_offset != offset || index != i ||
+                name != instruction->operands[0])
+            {
+                return fail(program, "damaged file: label table does not match instruction %u", i);
+            }
+        }
+    }
+    if (code.position != code_size || label_reader.position != label_reader.size)
+    {
+        return fail(program, "damaged file: code size");
+    }
+    program->instruction_count = instruction_count;
+    program->label_count = label_count;
+    return 0;
+}
+
+void ifjcode_free(IfjcodeProgram *program)
+{
+    free(program->constants);
+    free(program->instructions);
+    program->constants = NULL;
+    program->instructions = NULL;
+    program->constant_count = 0;
+    program->constant_capacity = 0;
+    program->instruction_count = 0;
+    program->instruction_capacity = 0;
+    program->label_count = 0;
+}
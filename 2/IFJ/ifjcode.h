@@ -0,0 +1,165 @@
+/**
+ * @file ifjcode.h
+ *
+ * Header file for the IFJcode24 instruction set in text and binary form (--binary).
+ * Both forms are read into the same IfjcodeProgram: an instruction array whose
+ * operands are indices into a table of distinct constants, label references are
+ * resolved to the index of the LABEL instruction.
+ *
+ * Binary layout, all numbers little endian:
+ *   header:    magic[8], version, constant_count, constant_size, label_count,
+ *              instruction_count, code_size (uint32_t each)
+ *   constants: kind byte and payload, strings are stored escaped as in the text form
+ *   labels:    label_count times code offset, instruction index, name constant (uint32_t each)
+ *   code:      opcode byte, then per operand a varint constant index, or the
+ *              uint32_t code offset of the LABEL instruction for label references
+ *
+ * Conversion is lossless for the canonical text written by ifjcode_write_text and
+ * by the code generator: one instruction per line, operands separated by one space.
+ * Comments and blank lines are not kept.
+ *
+ * The module uses no compiler state, the tools link it on its own.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef IFJCODE_H
+#define IFJCODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define IFJCODE_MAGIC "IFJ24BIN"
+#define IFJCODE_VERSION 1u
+#define IFJCODE_HEADER_SIZE 32
+#define IFJCODE_MAX_OPERANDS 3
+#define IFJCODE_ERROR_LENGTH 256
+
+/** Instructions, the value is the opcode byte of the binary form */
+typedef enum {
+    IFJCODE_MOVE,
+    IFJCODE_CREATEFRAME,
+    IFJCODE_PUSHFRAME,
+    IFJCODE_POPFRAME,
+    IFJCODE_DEFVAR,
+    IFJCODE_CALL,
+    IFJCODE_RETURN,
+    IFJCODE_PUSHS,
+    IFJCODE_POPS,
+    IFJCODE_CLEARS,
+    IFJCODE_ADD,
+    IFJCODE_SUB,
+    IFJCODE_MUL,
+    IFJCODE_DIV,
+    IFJCODE_IDIV,
+    IFJCODE_ADDS,
+    IFJCODE_SUBS,
+    IFJCODE_MULS,
+    IFJCODE_DIVS,
+    IFJCODE_IDIVS,
+    IFJCODE_LT,
+    IFJCODE_GT,
+    IFJCODE_EQ,
+    IFJCODE_LTS,
+    IFJCODE_GTS,
+    IFJCODE_EQS,
+    IFJCODE_AND,
+    IFJCODE_OR,
+    IFJCODE_NOT,
+    IFJCODE_ANDS,
+    IFJCODE_ORS,
+    IFJCODE_NOTS,
+    IFJCODE_INT2FLOAT,
+    IFJCODE_FLOAT2INT,
+    IFJCODE_INT2CHAR,
+    IFJCODE_STRI2INT,
+    IFJCODE_INT2FLOATS,
+    IFJCODE_FLOAT2INTS,
+    IFJCODE_INT2CHARS,
+    IFJCODE_STRI2INTS,
+    IFJCODE_READ,
+    IFJCODE_WRITE,
+    IFJCODE_CONCAT,
+    IFJCODE_STRLEN,
+    IFJCODE_GETCHAR,
+    IFJCODE_SETCHAR,
+    IFJCODE_TYPE,
+    IFJCODE_LABEL,
+    IFJCODE_JUMP,
+    IFJCODE_JUMPIFEQ,
+    IFJCODE_JUMPIFNEQ,
+    IFJCODE_JUMPIFEQS,
+    IFJCODE_JUMPIFNEQS,
+    IFJCODE_EXIT,
+    IFJCODE_BREAK,
+    IFJCODE_DPRINT,
+    IFJCODE_OPCODE_COUNT
+} IfjcodeOpcode;
+
+/** Kinds of constants, the value is the kind byte of the binary form */
+typedef enum {
+    IFJCODE_CONST_GF,     // Variable, text is the name
+    IFJCODE_CONST_LF,
+    IFJCODE_CONST_TF,
+    IFJCODE_CONST_INT,    // integer
+    IFJCODE_CONST_FLOAT,  // number
+    IFJCODE_CONST_STRING, // Text is the escaped string
+    IFJCODE_CONST_BOOL,   // integer is 0 or 1
+    IFJCODE_CONST_NIL,
+    IFJCODE_CONST_TYPE,   // Text is the type name of READ
+    IFJCODE_CONST_LABEL,  // Text is the label name
+    IFJCODE_CONST_RAW,    // Text is the whole operand, for int and float written in a non-canonical form
+    IFJCODE_CONST_KIND_COUNT
+} IfjcodeConstantKind;
+
+/** One distinct operand */
+typedef struct {
+    IfjcodeConstantKind kind;
+    int64_t integer;
+    double number;
+    const char *text; // Points into the parsed buffer, not terminated
+    uint32_t length;
+} IfjcodeConstant;
+
+/** One instruction */
+typedef struct {
+    IfjcodeOpcode opcode;
+    uint32_t operands[IFJCODE_MAX_OPERANDS]; // Constant indices, label references hold the index of the LABEL instruction
+} IfjcodeInstruction;
+
+/** Program in either form, zero initialized before the first use. The parsed buffer must outlive it. */
+typedef struct {
+    IfjcodeConstant *constants;
+    uint32_t constant_count;
+    uint32_t constant_capacity;
+    IfjcodeInstruction *instructions;
+    uint32_t instruction_count;
+    uint32_t instruction_capacity;
+    uint32_t label_count;
+    char error[IFJCODE_ERROR_LENGTH]; // Reason of the last failure
+} IfjcodeProgram;
+
+// Parses IFJcode24 text, returns 0 on success and -1 with program->error set otherwise
+int ifjcode_parse_text(IfjcodeProgram *program, const char *text, size_t length);
+
+// Reads the binary form, returns 0 on success and -1 with program->error set otherwise
+int ifjcode_load_binary(IfjcodeProgram *program, const unsigned char *data, size_t size);
+
+// Writes the canonical text form, returns 0 on success and -1 on a write error
+int ifjcode_write_text(IfjcodeProgram *program, FILE *output);
+
+// Writes the binary form, returns 0 on success and -1 on a write error or when out of memory
+int ifjcode_write_binary(IfjcodeProgram *program, FILE *output);
+
+// Releases the arrays of the program, it can be parsed into again
+void ifjcode_free(IfjcodeProgram *program);
+
+// Name of an instruction
+const char *ifjcode_opcode_name(IfjcodeOpcode opcode);
+
+#endif // IFJCODE_H
@@ -0,0 +1,1280 @@
+/**
+ * @file incremental.c
+ *
+ * Implementation of the incremental analysis.
+ *
+ * Lexing restarts at the last token that ends before the edit and stops at the
+ * first new token that starts where an old token started behind the edit, the
+ * scanner is in the same state there, so the rest of the token list is only
+ * shifted. A lexical error turns the rest of its line into a TOKEN_UNKNOWN token
+ * and lexing goes on, which keeps the token list a function of the text alone.
+ *
+ * Functions are found on the token list by matching braces. Every function is
+ * parsed on its own from its part of the text: the declaration with only the
+ * builtins in the symtable, the body with the declarations of all functions.
+ * The functions a body looked up are remembered, so the unused function check
+ * and the callers of a changed declaration are found without parsing again.
+ *
+ * The analysis runs in the context of the session. error_exit stores its
+ * message there and releases the memory of the analysis, the session itself
+ * is allocated with malloc and survives errors.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "incremental.h"
+#include "error.h"
+#include "parser.h"
+#include "string_pool.h"
+#include "utils.h"
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INCREMENTAL_INITIAL_CAPACITY 64
+
+// Read instead of an empty part of the text, fmemopen needs at least one character
+static char empty_source[] = " ";
+
+/** One part of the analysis, run by run_step */
+typedef void (*AnalysisStep)(IncrementalSession *session, void *data);
+
+/** State of lexing after an edit */
+typedef struct {
+    size_t start;          // Offset where the scanner starts
+    int line;
+    int column;
+    size_t inserted_end;   // End of the inserted text, later tokens may match old ones
+    size_t removed_end;    // End of the removed text in the old text
+    size_t old_index;      // First old token that may still match
+    bool synchronized;     // A new token matched the old token old_index
+    int sync_line;         // Position of the matching token in the new text
+    int sync_column;
+    IncrementalToken *tokens; // New tokens before the match
+    size_t count;
+    size_t capacity;
+    bool out_of_memory;
+} Relex;
+
+/**
+ * Makes room for needed elements, returns the array or NULL if realloc failed.
+ */
+static void *reserve(void *array, size_t *capacity, size_t needed, size_t element_size)
+{
+    if (needed <= *capacity)
+    {
+        return array;
+    }
+    size_t new_capacity = *capacity ? *capacity : INCREMENTAL_INITIAL_CAPACITY;
+    while (new_capacity < needed)
+    {
+        new_capacity *= 2;
+    }
+    void *grown = realloc(array, new_capacity * element_size);
+    if (grown != NULL)
+    {
+        *capacity = new_capacity;
+    }
+    return grown;
+}
+
+/**
+ * Copies a string into memory of the session.
+ */
+static char *copy_string(const char *text)
+{
+    char *copy = malloc(strlen(text) + 1);
+    if (copy != NULL)
+    {
+        strcpy(copy, text);
+    }
+    return copy;
+}
+
+/**
+ * Frees the declaration and the callees of a function.
+ */
+static void release_function(IncrementalFunction *function)
+{
+    free(function->name);
+    free(function->param_types);
+    for (int i = 0; i < function->param_count; i++)
+    {
+        free(function->param_names[i]);
+    }
+    free(function->param_names);
+    for (int i = 0; i < function->callee_count; i++)
+    {
+        free(function->callees[i]);
+    }
+    free(function->callees);
+    function->name = NULL;
+    function->param_types = NULL;
+    function->param_names = NULL;
+    function->param_count = 0;
+    function->callees = NULL;
+    function->callee_count = 0;
+}
+
+/**
+ * Fills a diagnostic.
+ */
+static void set_diagnostic(IncrementalDiagnostic *diagnostic, int error_code, int line, int column, const char *message)
+{
+    diagnostic->error_code = error_code;
+    diagnostic->line = line;
+    diagnostic->column = column;
+    snprintf(diagnostic->message, sizeof(diagnostic->message), "%s", message);
+}
+
+/**
+ * Closes the part of the text the scanner read.
+ */
+static void close_source(IncrementalSession *session)
+{
+    if (session->source != NULL)
+    {
+        fclose(session->source);
+        session->source = NULL;
+    }
+}
+
+/**
+ * Starts the scanner on size characters of text, the first character is at line and column.
+ */
+static void open_text(IncrementalSession *session, char *text, size_t size, int line, int column)
+{
+    close_source(session);
+    if (size > 0)
+    {
+        session->source = fmemopen(text, size, "r");
+    }
+    else
+    {
+        session->source = fmemopen(empty_source, 1, "r");
+    }
+    if (session->source == NULL)
+    {
+        error_exit(ERR_INTERNAL, "Cannot open the source text.");
+    }
+    scanner_init(session->source, &session->scanner);
+    session->scanner.line = line;
+    session->scanner.column = column;
+}
+
+/**
+ * Starts the scanner on the text from start to end.
+ */
+static void open_range(IncrementalSession *session, size_t start, size_t end, int line, int column)
+{
+    open_text(session, session->text + start, end - start, line, column);
+}
+
+/**
+ * Releases all memory of the analysis, the symtable is built again when it is needed.
+ */
+static void reset_analysis(IncrementalSession *session)
+{
+    cleanup_pointers_storage();
+    compiler_reset();
+    init_pointers_storage(INCREMENTAL_INITIAL_CAPACITY);
+    session->symtable_ready = false;
+    session->declared = NULL;
+}
+
+/**
+ * Runs one step of the analysis with error_exit redirected back here.
+ * On an error the diagnostic gets the message and the position of the scanner
+ * (lexical errors) or of the current token, the context is set up again.
+ */
+static bool run_step(IncrementalSession *session, AnalysisStep step, void *data, IncrementalDiagnostic *diagnostic)
+{
+    jmp_buf recovery;
+    if (setjmp(recovery) == 0)
+    {
+        error_set_recovery(&recovery);
+        step(session, data);
+        error_set_recovery(NULL);
+        close_source(session);
+        return true;
+    }
+
+    int error_code = session->context.error_code;
+    error_set_recovery(NULL);
+    close_source(session);
+    if (diagnostic != NULL)
+    {
+        if (error_code == ERR_LEXICAL)
+        {
+            set_diagnostic(diagnostic, error_code, session->scanner.line, session->scanner.column, session->message);
+        }
+        else
+        {
+            set_diagnostic(diagnostic, error_code, session->context.parser.current_token.line,
+                           session->context.parser.current_token.column, session->message);
+        }
+    }
+
+    // error_exit released all memory of the analysis, the rest of the state goes too
+    reset_analysis(session);
+    return false;
+}
+
+/**
+ * Adds a new token, or stops lexing when the token starts where an old one
+ * started behind the edit. Returns true when lexing is finished.
+ */
+static bool relex_add(IncrementalSession *session, Relex *relex, const IncrementalToken *token)
+{
+    if (token->offset >= relex->inserted_end)
+    {
+        size_t old_offset = token->offset - relex->inserted_end + relex->removed_end;
+        while (relex->old_index < session->token_count && session->tokens[relex->old_index].offset < old_offset)
+        {
+            relex->old_index++;
+        }
+        if (relex->old_index < session->token_count && session->tokens[relex->old_index].offset == old_offset)
+        {
+            relex->synchronized = true;
+            relex->sync_line = token->line;
+            relex->sync_column = token->column;
+            return true;
+        }
+    }
+
+    IncrementalToken *tokens = reserve(relex->tokens, &relex->capacity, relex->count + 1, sizeof(IncrementalToken));
+    if (tokens == NULL)
+    {
+        relex->out_of_memory = true;
+        return true;
+    }
+    relex->tokens = tokens;
+    relex->tokens[relex->count++] = *token;
+    return token->type == TOKEN_EOF;
+}
+
+/**
+ * Lexes from relex->start until relex_add finds the end.
+ */
+static void lex_step(IncrementalSession *session, void *data)
+{
+    Relex *relex = data;
+    open_range(session, relex->start, session->length, relex->line, relex->column);
+
+    // Lexemes are not kept, they are released right away so the pointer storage stays small
+    size_t storage_mark = pointers_storage_mark();
+    bool finished = false;
+    while (!finished)
+    {
+        Token token = get_next_token(&session->scanner);
+        release_pointers_since(storage_mark, NULL, 0);
+
+        IncrementalToken lexed;
+        lexed.type = token.type;
+        lexed.offset = relex->start + (size_t)session->scanner.token_offset;
+        lexed.length = relex->start + (size_t)session->scanner.offset - 1 - lexed.offset;
+        lexed.line = token.line;
+        lexed.column = session->scanner.token_column;
+        if (token.type == TOKEN_EOF)
+        {
+            // The empty range of a restart at the end is read as one space
+            lexed.offset = session->length;
+            lexed.length = 0;
+        }
+        finished = relex_add(session, relex, &lexed);
+    }
+}
+
+/**
+ * Lexes the changed part of the text. A lexical error makes the rest of its
+ * line one TOKEN_UNKNOWN token and lexing continues at the line break.
+ */
+static bool relex_text(IncrementalSession *session, Relex *relex)
+{
+    for (;;)
+    {
+        IncrementalDiagnostic diagnostic;
+        if (run_step(session, lex_step, relex, &diagnostic))
+        {
+            return !relex->out_of_memory;
+        }
+        if (diagnostic.error_code != ERR_LEXICAL)
+        {
+            return false;
+        }
+
+        IncrementalToken unknown;
+        unknown.type = TOKEN_UNKNOWN;
+        unknown.offset = relex->start + (size_t)session->scanner.token_offset;
+        const char *newline = memchr(session->text + unknown.offset, '\n', session->length - unknown.offset);
+        size_t end = newline != NULL ? (size_t)(newline - session->text) : session->length;
+        unknown.length = end - unknown.offset;
+        unknown.line = session->scanner.line;
+        unknown.column = session->scanner.token_column;
+        if (relex_add(session, relex, &unknown))
+        {
+            return !relex->out_of_memory;
+        }
+
+        relex->start = end;
+        relex->line = unknown.line;
+        relex->column = session->scanner.column;
+    }
+}
+
+/**
+ * Lexes a TOKEN_UNKNOWN token again to get the message of its lexical error.
+ */
+static void unknown_token_step(IncrementalSession *session, void *data)
+{
+    const IncrementalToken *token = data;
+    open_range(session, token->offset, token->offset + token->length, token->line, token->column);
+    get_next_token(&session->scanner);
+}
+
+/**
+ * Finds the first TOKEN_UNKNOWN token from first to last and reports its lexical error,
+ * like a full compilation reports it before any syntax error.
+ */
+static bool find_lexical_error(IncrementalSession *session, size_t first, size_t last, IncrementalDiagnostic *diagnostic)
+{
+    for (size_t i = first; i <= last; i++)
+    {
+        if (session->tokens[i].type == TOKEN_UNKNOWN)
+        {
+            IncrementalToken token = session->tokens[i];
+            run_step(session, unknown_token_step, &token, diagnostic);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Adds a function to the list of the session.
+ */
+static bool add_function(IncrementalSession *session, size_t first_token, size_t last_token, bool terminated)
+{
+    IncrementalFunction *functions = reserve(session->functions, &session->function_capacity,
+                                             session->function_count + 1, sizeof(IncrementalFunction));
+    if (functions == NULL)
+    {
+        return false;
+    }
+    session->functions = functions;
+    IncrementalFunction *function = &functions[session->function_count++];
+    memset(function, 0, sizeof(*function));
+    function->first_token = first_token;
+    function->last_token = last_token;
+    function->terminated = terminated;
+    function->changed = true;
+    return true;
+}
+
+/**
+ * Finds the functions on the token list. The import line ends at the first
+ * 'pub' or 'fn', other tokens between functions are a layout error.
+ * The functions in front of the new tokens are the old ones. Behind them the
+ * search stops at the first old function start outside a function, the old
+ * functions from there on only move by the change of the token count.
+ */
+static bool find_functions(IncrementalSession *session, const IncrementalFunction *old_functions, size_t old_count,
+                           size_t first_new, size_t new_count, size_t old_after)
+{
+    const IncrementalToken *tokens = session->tokens;
+    size_t eof = session->token_count - 1;
+    size_t old_stray = session->first_stray;
+    size_t i = 0;
+    size_t k = 0;
+    if (old_count > 0 && first_new > session->import_end)
+    {
+        while (k < old_count && old_functions[k].last_token < first_new && old_functions[k].terminated)
+        {
+            if (!add_function(session, old_functions[k].first_token, old_functions[k].last_token, true))
+            {
+                return false;
+            }
+            k++;
+        }
+        i = k > 0 ? old_functions[k - 1].last_token + 1 : session->import_end;
+        if (session->first_stray >= i)
+        {
+            session->first_stray = SIZE_MAX;
+        }
+    }
+    else
+    {
+        while (i < eof && tokens[i].type != TOKEN_PUB && tokens[i].type != TOKEN_FN)
+        {
+            i++;
+        }
+        session->import_end = i;
+        session->first_stray = SIZE_MAX;
+    }
+
+    size_t tail = first_new + new_count; // First token that was there before the edit
+    while (i < eof)
+    {
+        if (i >= tail)
+        {
+            size_t old_index = i - tail + old_after;
+            while (k < old_count && old_functions[k].first_token < old_index)
+            {
+                k++;
+            }
+            if (k < old_count && old_functions[k].first_token == old_index)
+            {
+                size_t resynchronized = session->function_count;
+                for (; k < old_count; k++)
+                {
+                    if (!add_function(session, old_functions[k].first_token - old_after + tail,
+                                      old_functions[k].last_token - old_after + tail, old_functions[k].terminated))
+                    {
+                        return false;
+                    }
+                }
+                // Without the old first stray token the next one is in a gap between the moved functions
+                for (size_t m = resynchronized; m < session->function_count && session->first_stray == SIZE_MAX &&
+                                                 old_stray != SIZE_MAX; m++)
+                {
+                    size_t next = m + 1 < session->function_count ? session->functions[m + 1].first_token : eof;
+                    if (session->functions[m].last_token + 1 < next)
+                    {
+                        session->first_stray = session->functions[m].last_token + 1;
+                    }
+                }
+                break;
+            }
+        }
+
+        if (tokens[i].type != TOKEN_PUB && tokens[i].type != TOKEN_FN)
+        {
+            if (session->first_stray == SIZE_MAX)
+            {
+                session->first_stray = i;
+            }
+            i++;
+            continue;
+        }
+
+        // The body starts at the first brace, the header has none
+        size_t j = i;
+        while (j < eof && tokens[j].type != TOKEN_LEFT_BRACE)
+        {
+            j++;
+        }
+        int depth = 0;
+        for (; j < eof; j++)
+        {
+            if (tokens[j].type == TOKEN_LEFT_BRACE)
+            {
+                depth++;
+            }
+            else if (tokens[j].type == TOKEN_RIGHT_BRACE && --depth == 0)
+            {
+                break;
+            }
+        }
+        if (!add_function(session, i, j < eof ? j : eof - 1, j < eof))
+        {
+            return false;
+        }
+        i = session->functions[session->function_count - 1].last_token + 1;
+    }
+
+    memset(&session->program_diagnostic, 0, sizeof(session->program_diagnostic));
+    size_t stray = session->first_stray;
+    if (stray != SIZE_MAX && !find_lexical_error(session, stray, stray, &session->program_diagnostic))
+    {
+        char message[INCREMENTAL_MESSAGE_LENGTH];
+        snprintf(message, sizeof(message), "Expected function definition. Line: %d, Column: %d",
+                 tokens[stray].line, tokens[stray].column);
+        set_diagnostic(&session->program_diagnostic, ERR_SYNTAX, tokens[stray].line, tokens[stray].column, message);
+    }
+    return true;
+}
+
+/**
+ * Starts the parser at the first token of a function, the scanner only sees the function.
+ * Scope numbers start again, so the names of variables do not depend on other functions.
+ */
+static void start_function(IncrementalSession *session, const IncrementalFunction *function)
+{
+    const IncrementalToken *first = &session->tokens[function->first_token];
+    const IncrementalToken *last = &session->tokens[function->last_token];
+    open_range(session, first->offset, last->offset + last->length, first->line, first->column);
+    session->context.parser.scope_counter = 0;
+    session->context.parser.current_token = get_next_token(&session->scanner);
+}
+
+/**
+ * Parses the import line.
+ */
+static void import_step(IncrementalSession *session, void *data)
+{
+    (void)data;
+    size_t storage_mark = pointers_storage_mark();
+    open_range(session, 0, session->tokens[session->import_end].offset, 1, 1);
+    session->context.parser.current_token = get_next_token(&session->scanner);
+    parse_program_import(&session->scanner);
+    if (session->context.parser.current_token.type != TOKEN_EOF)
+    {
+        error_exit(ERR_SYNTAX, "Expected function definition. Line: %d, Column: %d",
+                   session->context.parser.current_token.line, session->context.parser.current_token.column);
+    }
+    release_pointers_since(storage_mark, NULL, 0);
+}
+
+/**
+ * Parses the declaration of a function with only the builtins in the symtable
+ * and keeps its name and parameter types.
+ */
+static void declaration_step(IncrementalSession *session, void *data)
+{
+    IncrementalFunction *function = data;
+    SymTable *symtable = &session->context.parser.symtable;
+    SymTable declarations = *symtable;
+    size_t storage_mark = pointers_storage_mark();
+    symtable_init_builtins(symtable);
+
+    // Only the header is lexed, the body is replaced by an empty one
+    size_t brace = function->first_token;
+    while (session->tokens[brace].type != TOKEN_LEFT_BRACE)
+    {
+        brace++;
+    }
+    const IncrementalToken *first = &session->tokens[function->first_token];
+    size_t size = session->tokens[brace].offset + 1 - first->offset;
+    char *header = safe_malloc(size + 1);
+    memcpy(header, session->text + first->offset, size);
+    header[size] = '}';
+    open_text(session, header, size + 1, first->line, first->column);
+    session->context.parser.current_token = get_next_token(&session->scanner);
+    ASTNode *node = parse_function_declaration(&session->scanner);
+
+    function->name = copy_string(node->name);
+    function->return_type = node->data_type;
+    function->param_count = node->param_count;
+    function->param_types = malloc((size_t)node->param_count * sizeof(DataType) + 1);
+    function->param_names = calloc((size_t)node->param_count + 1, sizeof(char *));
+    if (function->name == NULL || function->param_types == NULL || function->param_names == NULL)
+    {
+        function->param_count = 0;
+        error_exit(ERR_INTERNAL, "Out of memory.");
+    }
+    for (int i = 0; i < node->param_count; i++)
+    {
+        function->param_types[i] = node->parameters[i]->data_type;
+        function->param_names[i] = copy_string(node->parameters[i]->name);
+        if (function->param_names[i] == NULL)
+        {
+            error_exit(ERR_INTERNAL, "Out of memory.");
+        }
+    }
+
+    // The symtable with the declarations of all functions stays for the next bodies
+    *symtable = declarations;
+    release_pointers_since(storage_mark, NULL, 0);
+}
+
+/**
+ * Checks if the symtable of the analysis still has the declaration of every function.
+ */
+static bool declarations_match(const IncrementalSession *session)
+{
+    if (!session->symtable_ready)
+    {
+        return true;
+    }
+    if (session->declared_count != session->function_count)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        const char *name = session->functions[i].name;
+        const Symbol *symbol = session->declared[i];
+        if (symbol == NULL || name == NULL ? symbol != NULL || name != NULL : strcmp(symbol->name, name) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Puts the builtins and the declarations of all functions into a new symtable,
+ * like the pre-run does. The first of two functions with the same name wins.
+ */
+static void prepare_declarations(IncrementalSession *session)
+{
+    if (session->symtable_ready)
+    {
+        return;
+    }
+    SymTable *symtable = &session->context.parser.symtable;
+    symtable_init_builtins(symtable);
+
+    session->declared = safe_malloc((session->function_count + 1) * sizeof(Symbol *));
+    session->declared_count = session->function_count;
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        IncrementalFunction *function = &session->functions[i];
+        session->declared[i] = NULL;
+        if (function->name == NULL)
+        {
+            continue;
+        }
+
+        ASTNode **parameters = NULL;
+        if (function->param_count > 0)
+        {
+            parameters = safe_malloc((size_t)function->param_count * sizeof(ASTNode *));
+            for (int j = 0; j < function->param_count; j++)
+            {
+                parameters[j] = create_variable_declaration_node(function->param_names[j], function->param_types[j], NULL);
+            }
+        }
+        ASTNode *node = create_function_node(function->name, function->return_type, parameters, function->param_count, NULL);
+
+        Symbol *symbol = safe_malloc(sizeof(Symbol));
+        symbol->name = string_duplicate(function->name);
+        symbol->symbol_type = SYMBOL_FUNCTION;
+        symbol->parent_function = string_duplicate(function->name);
+        symbol->data_type = function->return_type;
+        symbol->is_defined = true;
+        symbol->declaration_node = node;
+        symbol->is_used = strcmp(function->name, "main") == 0;
+        symbol->is_constant = false;
+        symbol->next = NULL;
+        session->declared[i] = symtable_insert(symtable, symbol->name, symbol);
+    }
+    session->symtable_ready = true;
+}
+
+/**
+ * Parses and checks the body of a function and keeps the functions it looked up.
+ */
+static void definition_step(IncrementalSession *session, void *data)
+{
+    IncrementalFunction *function = data;
+    prepare_declarations(session);
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        if (session->declared[i] != NULL)
+        {
+            session->declared[i]->is_used = false;
+        }
+    }
+
+    // A duplicate is checked against the declaration of the first function with its name
+    Symbol *symbol = NULL;
+    for (size_t i = 0; i < session->function_count && symbol == NULL; i++)
+    {
+        if (session->declared[i] != NULL && strcmp(session->declared[i]->name, function->name) == 0)
+        {
+            symbol = session->declared[i];
+        }
+    }
+
+    // A body with an error calls nothing
+    for (int i = 0; i < function->callee_count; i++)
+    {
+        free(function->callees[i]);
+    }
+    free(function->callees);
+    function->callees = NULL;
+    function->callee_count = 0;
+
+    size_t storage_mark = pointers_storage_mark();
+    start_function(session, function);
+    ASTNode declaration = *symbol->declaration_node;
+    ASTNode *node = parse_function_definition(&session->scanner, symbol->declaration_node);
+    parser_forget_function(node);
+    *symbol->declaration_node = declaration;
+
+    // Like streaming mode, only the tables that may have grown meanwhile are kept
+    string_pool_release_since(storage_mark);
+    void *keep[] = {
+        session->context.parser.symtable.table,
+        session->context.string_pool.buckets,
+        session->context.string_pool.entries};
+    release_pointers_since(storage_mark, keep, sizeof(keep) / sizeof(keep[0]));
+
+    function->callees = malloc((session->function_count + 1) * sizeof(char *));
+    if (function->callees == NULL)
+    {
+        error_exit(ERR_INTERNAL, "Out of memory.");
+    }
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        if (session->declared[i] != NULL && session->declared[i]->is_used)
+        {
+            char *callee = copy_string(session->declared[i]->name);
+            if (callee == NULL)
+            {
+                error_exit(ERR_INTERNAL, "Out of memory.");
+            }
+            function->callees[function->callee_count++] = callee;
+        }
+    }
+}
+
+/**
+ * Looks for functions declared twice, checks main and looks for functions no body calls.
+ * Only a duplicate has a position, the other errors are reported at line 0.
+ */
+static void program_step(IncrementalSession *session, void *data)
+{
+    (void)data;
+    Token *position = &session->context.parser.current_token;
+    position->line = 0;
+    position->column = 0;
+    prepare_declarations(session);
+    SymTable *symtable = &session->context.parser.symtable;
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        if (session->functions[i].name != NULL && session->declared[i] == NULL)
+        {
+            position->line = session->tokens[session->functions[i].first_token].line;
+            position->column = session->tokens[session->functions[i].first_token].column;
+            error_exit(ERR_SEMANTIC_OTHER, "Function already defined.");
+        }
+    }
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        if (session->declared[i] != NULL)
+        {
+            session->declared[i]->is_used = strcmp(session->declared[i]->name, "main") == 0;
+        }
+    }
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        for (int j = 0; j < session->functions[i].callee_count; j++)
+        {
+            symtable_search(symtable, session->functions[i].callees[j]);
+        }
+    }
+    is_main_correct(symtable);
+    is_symtable_all_used(symtable);
+}
+
+/**
+ * Compares the declarations of two functions.
+ */
+static bool same_declaration(const IncrementalFunction *a, const IncrementalFunction *b)
+{
+    if (a->name == NULL || b->name == NULL)
+    {
+        return a->name == b->name;
+    }
+    if (strcmp(a->name, b->name) != 0 || a->return_type != b->return_type || a->param_count != b->param_count)
+    {
+        return false;
+    }
+    for (int i = 0; i < a->param_count; i++)
+    {
+        if (a->param_types[i] != b->param_types[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Checks if an identifier of a function is one of the names. A new function
+ * may also turn a variable of the same name into a call.
+ */
+static bool uses_any(const IncrementalSession *session, const IncrementalFunction *function,
+                     const IncrementalFunction *declarations, size_t count)
+{
+    for (size_t i = function->first_token; i <= function->last_token; i++)
+    {
+        const IncrementalToken *token = &session->tokens[i];
+        if (token->type != TOKEN_IDENTIFIER)
+        {
+            continue;
+        }
+        for (size_t j = 0; j < count; j++)
+        {
+            const char *name = declarations[j].name;
+            if (name != NULL && strlen(name) == token->length && memcmp(session->text + token->offset, name, token->length) == 0)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Marks the unchanged functions that depend on a changed declaration:
+ * the ones that use a removed, changed or new name and the ones with errors,
+ * which may refer to a function that exists now.
+ * Returns true if any declaration changed.
+ */
+static bool mark_dependents(IncrementalSession *session, IncrementalFunction *removed, size_t removed_count)
+{
+    bool *matched = calloc(removed_count + 1, sizeof(bool));
+    bool declarations_changed = matched == NULL;
+    for (size_t i = 0; i < session->function_count && !declarations_changed; i++)
+    {
+        const IncrementalFunction *function = &session->functions[i];
+        if (!function->changed)
+        {
+            continue;
+        }
+        bool found = false;
+        for (size_t j = 0; j < removed_count && !found; j++)
+        {
+            if (!matched[j] && same_declaration(function, &removed[j]))
+            {
+                matched[j] = found = true;
+            }
+        }
+        declarations_changed = !found;
+    }
+    for (size_t j = 0; j < removed_count && !declarations_changed; j++)
+    {
+        declarations_changed = !matched[j];
+    }
+    free(matched);
+    if (!declarations_changed)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        IncrementalFunction *function = &session->functions[i];
+        if (function->changed || function->name == NULL)
+        {
+            continue;
+        }
+        bool depends = function->diagnostic.error_code != ERR_OK || uses_any(session, function, removed, removed_count);
+        for (size_t j = 0; j < session->function_count && !depends; j++)
+        {
+            depends = session->functions[j].changed && uses_any(session, function, &session->functions[j], 1);
+        }
+        function->changed = depends;
+    }
+    return true;
+}
+
+/**
+ * Moves the analysis of unchanged functions from the old list. A function is
+ * unchanged when it has no relexed token and an old function had the same tokens.
+ * Returns the number of old functions left in old_functions (changed or removed).
+ */
+static size_t keep_unchanged(IncrementalSession *session, IncrementalFunction *old_functions, size_t old_count,
+                             size_t first_new, size_t new_count, size_t first_old_after)
+{
+    size_t k = 0;
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        IncrementalFunction *function = &session->functions[i];
+        size_t old_first;
+        size_t old_last;
+        if (function->last_token < first_new)
+        {
+            old_first = function->first_token;
+            old_last = function->last_token;
+        }
+        else if (function->first_token >= first_new + new_count)
+        {
+            old_first = function->first_token - first_new - new_count + first_old_after;
+            old_last = function->last_token - first_new - new_count + first_old_after;
+        }
+        else
+        {
+            continue;
+        }
+
+        while (k < old_count && old_functions[k].first_token < old_first)
+        {
+            k++;
+        }
+        // The error of an unterminated function is at the end of the text, it is always set again
+        if (k < old_count && old_functions[k].first_token == old_first && old_functions[k].last_token == old_last &&
+            old_functions[k].terminated && function->terminated)
+        {
+            size_t first_token = function->first_token;
+            size_t last_token = function->last_token;
+            *function = old_functions[k];
+            function->first_token = first_token;
+            function->last_token = last_token;
+            function->changed = false;
+            memset(&old_functions[k], 0, sizeof(IncrementalFunction));
+            old_functions[k].first_token = SIZE_MAX; // Moved
+            k++;
+        }
+    }
+
+    size_t left = 0;
+    for (size_t j = 0; j < old_count; j++)
+    {
+        if (old_functions[j].first_token != SIZE_MAX)
+        {
+            old_functions[left++] = old_functions[j];
+        }
+    }
+    return left;
+}
+
+/**
+ * Analyses a changed function: declaration first, then the body.
+ */
+static void analyse_function(IncrementalSession *session, IncrementalFunction *function, bool declaration)
+{
+    int first_line = session->tokens[function->first_token].line;
+    if (declaration)
+    {
+        release_function(function);
+        memset(&function->diagnostic, 0, sizeof(function->diagnostic));
+        if (!function->terminated)
+        {
+            const IncrementalToken *last = &session->tokens[session->token_count - 1];
+            if (find_lexical_error(session, function->first_token, function->last_token, &function->diagnostic))
+            {
+                function->diagnostic.line -= first_line;
+            }
+            else
+            {
+                set_diagnostic(&function->diagnostic, ERR_SYNTAX, last->line - first_line, last->column,
+                               "Expected '}' at the end of function body.");
+            }
+            return;
+        }
+        if (!run_step(session, declaration_step, function, &function->diagnostic))
+        {
+            release_function(function);
+            function->diagnostic.line -= first_line;
+        }
+        return;
+    }
+
+    if (function->name == NULL)
+    {
+        return;
+    }
+    memset(&function->diagnostic, 0, sizeof(function->diagnostic));
+    session->reparsed_functions++;
+    if (find_lexical_error(session, function->first_token, function->last_token, &function->diagnostic))
+    {
+        // The body is not parsed, it calls nothing
+        for (int i = 0; i < function->callee_count; i++)
+        {
+            free(function->callees[i]);
+        }
+        free(function->callees);
+        function->callees = NULL;
+        function->callee_count = 0;
+        function->diagnostic.line -= first_line;
+    }
+    else if (!run_step(session, definition_step, function, &function->diagnostic))
+    {
+        function->diagnostic.line -= first_line;
+    }
+}
+
+/**
+ * Collects the diagnostics of the current text.
+ */
+static bool collect_diagnostics(IncrementalSession *session)
+{
+    IncrementalDiagnostic *diagnostics = reserve(session->diagnostics, &session->diagnostic_capacity,
+                                                 session->function_count + 2, sizeof(IncrementalDiagnostic));
+    if (diagnostics == NULL)
+    {
+        return false;
+    }
+    session->diagnostics = diagnostics;
+    session->diagnostic_count = 0;
+    if (session->import_diagnostic.error_code != ERR_OK)
+    {
+        diagnostics[session->diagnostic_count++] = session->import_diagnostic;
+    }
+    if (session->program_diagnostic.error_code != ERR_OK)
+    {
+        diagnostics[session->diagnostic_count++] = session->program_diagnostic;
+    }
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        const IncrementalFunction *function = &session->functions[i];
+        if (function->diagnostic.error_code != ERR_OK)
+        {
+            IncrementalDiagnostic *diagnostic = &diagnostics[session->diagnostic_count++];
+            *diagnostic = function->diagnostic;
+            diagnostic->line += session->tokens[function->first_token].line;
+        }
+    }
+    return true;
+}
+
+/**
+ * Lexes the edited part of the text, replaces the changed tokens and analyses
+ * the changed functions. With no tokens yet the whole text is analysed.
+ */
+static bool update(IncrementalSession *session, size_t offset, size_t removed_length, size_t inserted_length)
+{
+    Relex relex;
+    memset(&relex, 0, sizeof(relex));
+    relex.line = 1;
+    relex.column = 1;
+    relex.inserted_end = offset + inserted_length;
+    relex.removed_end = offset + removed_length;
+
+    // Restart at the last token that ends before the edit
+    size_t restart = 0;
+    if (session->token_count > 0)
+    {
+        size_t low = 0;
+        size_t high = session->token_count - 1;
+        while (low < high)
+        {
+            size_t middle = (low + high) / 2;
+            if (session->tokens[middle].offset + session->tokens[middle].length >= offset)
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1;
+            }
+        }
+        if (low > 0)
+        {
+            restart = low - 1;
+            relex.start = session->tokens[restart].offset;
+            relex.line = session->tokens[restart].line;
+            relex.column = session->tokens[restart].column;
+        }
+        relex.old_index = restart;
+    }
+
+    CompilerContext *previous_context = current_context;
+    current_context = &session->context;
+    if (!session->storage_ready)
+    {
+        init_pointers_storage(INCREMENTAL_INITIAL_CAPACITY);
+        session->storage_ready = true;
+    }
+    session->reparsed_functions = 0;
+
+    bool ok = relex_text(session, &relex);
+    session->relexed_tokens = relex.count;
+
+    // Tokens equal to the old ones at the restart point do not count as changed
+    size_t first_new = restart;
+    size_t old_after = relex.synchronized ? relex.old_index : session->token_count;
+    IncrementalToken *lexed = relex.tokens;
+    size_t lexed_count = relex.count;
+    while (ok && lexed_count > 0 && first_new < old_after && lexed->type == session->tokens[first_new].type &&
+           lexed->offset == session->tokens[first_new].offset && lexed->length == session->tokens[first_new].length &&
+           lexed->line == session->tokens[first_new].line && lexed->column == session->tokens[first_new].column)
+    {
+        lexed++;
+        lexed_count--;
+        first_new++;
+    }
+
+    // Replace the tokens, the ones behind the edit move by the size difference
+    size_t tail = session->token_count - old_after;
+    IncrementalToken *tokens = ok ? reserve(session->tokens, &session->token_capacity, first_new + lexed_count + tail,
+                                            sizeof(IncrementalToken))
+                                  : NULL;
+    if (tokens != NULL)
+    {
+        session->tokens = tokens;
+        memmove(&tokens[first_new + lexed_count], &tokens[old_after], tail * sizeof(IncrementalToken));
+        memcpy(&tokens[first_new], lexed, lexed_count * sizeof(IncrementalToken));
+        if (tail > 0)
+        {
+            int sync_old_line = tokens[first_new + lexed_count].line;
+            int line_shift = relex.sync_line - sync_old_line;
+            int column_shift = relex.sync_column - tokens[first_new + lexed_count].column;
+            for (size_t i = first_new + lexed_count; i < first_new + lexed_count + tail; i++)
+            {
+                tokens[i].offset = tokens[i].offset - relex.removed_end + relex.inserted_end;
+                if (tokens[i].line == sync_old_line)
+                {
+                    tokens[i].column += column_shift;
+                }
+                tokens[i].line += line_shift;
+            }
+        }
+        session->token_count = first_new + lexed_count + tail;
+    }
+    free(relex.tokens);
+    ok = tokens != NULL;
+
+    // Find the functions again and keep the analysis of unchanged ones
+    IncrementalFunction *old_functions = session->functions;
+    size_t old_count = session->function_count;
+    session->functions = NULL;
+    session->function_count = 0;
+    session->function_capacity = 0;
+    size_t removed_count = 0;
+    if (ok)
+    {
+        ok = find_functions(session, old_functions, old_count, first_new, lexed_count, old_after);
+    }
+    if (ok)
+    {
+        removed_count = keep_unchanged(session, old_functions, old_count, first_new, lexed_count, old_after);
+
+        memset(&session->import_diagnostic, 0, sizeof(session->import_diagnostic));
+        run_step(session, import_step, NULL, &session->import_diagnostic);
+
+        for (size_t i = 0; i < session->function_count; i++)
+        {
+            if (session->functions[i].changed)
+            {
+                analyse_function(session, &session->functions[i], true);
+            }
+        }
+        // The symtable of the previous update is used while the declarations stay the same
+        if (mark_dependents(session, old_functions, removed_count) || !declarations_match(session))
+        {
+            reset_analysis(session);
+        }
+        for (size_t i = 0; i < session->function_count; i++)
+        {
+            // A moved function with an error gets the new position into its message
+            IncrementalFunction *function = &session->functions[i];
+            const IncrementalToken *first = &session->tokens[function->first_token];
+            if (!function->changed && function->diagnostic.error_code != ERR_OK &&
+                (function->line != first->line || function->column != first->column))
+            {
+                function->changed = true;
+                analyse_function(session, function, true);
+            }
+            function->line = first->line;
+            function->column = first->column;
+        }
+        for (size_t i = 0; i < session->function_count; i++)
+        {
+            if (session->functions[i].changed)
+            {
+                analyse_function(session, &session->functions[i], false);
+                session->functions[i].changed = false;
+            }
+        }
+
+        if (session->program_diagnostic.error_code == ERR_OK)
+        {
+            run_step(session, program_step, NULL, &session->program_diagnostic);
+        }
+        ok = collect_diagnostics(session);
+    }
+    for (size_t i = 0; i < (ok ? removed_count : old_count); i++)
+    {
+        release_function(&old_functions[i]);
+    }
+    free(old_functions);
+
+    current_context = previous_context;
+    return ok;
+}
+
+/**
+ * Starts a session for a text.
+ */
+IncrementalSession *incremental_open(const char *text, size_t length)
+{
+    IncrementalSession *session = calloc(1, sizeof(IncrementalSession));
+    if (session == NULL)
+    {
+        return NULL;
+    }
+    session->text = reserve(NULL, &session->capacity, length + 1, 1);
+    if (session->text == NULL)
+    {
+        free(session);
+        return NULL;
+    }
+    memcpy(session->text, text, length);
+    session->text[length] = '\0';
+    session->length = length;
+
+    CompilerContext *previous_context = current_context;
+    compiler_context_activate(&session->context);
+    session->context.error_message = session->message;
+    session->context.error_message_size = sizeof(session->message);
+    current_context = previous_context;
+
+    if (!update(session, 0, 0, length))
+    {
+        incremental_close(session);
+        return NULL;
+    }
+    return session;
+}
+
+/**
+ * Applies an edit to the text and updates the analysis.
+ */
+bool incremental_edit(IncrementalSession *session, size_t offset, size_t removed_length,
+                      const char *inserted, size_t inserted_length)
+{
+    if (offset > session->length || removed_length > session->length - offset)
+    {
+        return false;
+    }
+    size_t length = session->length - removed_length + inserted_length;
+    char *text = reserve(session->text, &session->capacity, length + 1, 1);
+    if (text == NULL)
+    {
+        return false;
+    }
+    session->text = text;
+    memmove(text + offset + inserted_length, text + offset + removed_length, session->length - offset - removed_length + 1);
+    memcpy(text + offset, inserted, inserted_length);
+    session->length = length;
+
+    return update(session, offset, removed_length, inserted_length);
+}
+
+/**
+ * Returns the diagnostics of the last update.
+ */
+const IncrementalDiagnostic *incremental_diagnostics(const IncrementalSession *session, size_t *count)
+{
+    *count = session->diagnostic_count;
+    return session->diagnostics;
+}
+
+/**
+ * Frees the session.
+ */
+void incremental_close(IncrementalSession *session)
+{
+    if (session == NULL)
+    {
+        return;
+    }
+    if (session->storage_ready)
+    {
+        CompilerContext *previous_context = current_context;
+        current_context = &session->context;
+        cleanup_pointers_storage();
+        compiler_reset();
+        current_context = previous_context;
+    }
+    for (size_t i = 0; i < session->function_count; i++)
+    {
+        release_function(&session->functions[i]);
+    }
+    free(session->functions);
+    free(session->tokens);
+    free(session->diagnostics);
+    free(session->text);
+    free(session);
+}
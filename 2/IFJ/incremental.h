@@ -0,0 +1,117 @@
+/**
+ * @file incremental.h
+ *
+ * Header file for the incremental analysis used by editor integrations.
+ * A session keeps the source text, its tokens and the declarations and
+ * diagnostics of every function. After a text edit only the tokens around the
+ * edit are lexed again and only the functions containing changed tokens (and
+ * the callers of a function whose declaration changed) are parsed again.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "compiler.h"
+#include "scanner.h"
+#include "symtable.h"
+#include "tokens.h"
+
+#define INCREMENTAL_MESSAGE_LENGTH 256
+
+/** Error found in a function or in the program */
+typedef struct {
+    int error_code; // ERR_OK when there is nothing to report
+    int line;       // Token the parser stopped at, 0 for errors of the whole program
+    int column;
+    char message[INCREMENTAL_MESSAGE_LENGTH];
+} IncrementalDiagnostic;
+
+/** Token of the session, lexemes are not kept */
+typedef struct {
+    TokenType type; // TOKEN_UNKNOWN for the rest of a line with a lexical error
+    size_t offset;  // First character in the text
+    size_t length;
+    int line;
+    int column;     // Column of the scanner at the first character, lexing restarts from it
+} IncrementalToken;
+
+/** Top level function of the session */
+typedef struct {
+    size_t first_token; // 'pub'
+    size_t last_token;  // Closing brace of the body
+    bool terminated;    // false when the body is not closed before the end of the text
+    bool changed;       // Declaration and body are analysed in the current update
+    int line;           // Position of first_token in the last update,
+    int column;         // messages of the parser may contain positions
+
+    char *name;         // NULL when the declaration has errors
+    DataType return_type;
+    int param_count;
+    DataType *param_types;
+    char **param_names;
+
+    char **callees;     // Functions looked up while the body was parsed
+    int callee_count;
+    IncrementalDiagnostic diagnostic; // line is relative to the line of first_token
+} IncrementalFunction;
+
+/** Editor session for one source */
+typedef struct {
+    CompilerContext context; // Context of the analysis, its memory is released after every update
+    Scanner scanner;
+    FILE *source;            // Part of the text the scanner reads
+
+    char *text;
+    size_t length;
+    size_t capacity;
+
+    IncrementalToken *tokens; // Ends with TOKEN_EOF
+    size_t token_count;
+    size_t token_capacity;
+    size_t import_end;        // First token after the import line
+    size_t first_stray;       // First token outside the import line and the functions, SIZE_MAX if there is none
+
+    IncrementalFunction *functions;
+    size_t function_count;
+    size_t function_capacity;
+
+    bool storage_ready;       // The pointer storage of the context is kept between updates
+    Symbol **declared;        // Symbol of every function in the symtable of the analysis, NULL for duplicates
+    size_t declared_count;
+    bool symtable_ready;      // The symtable holds the builtins and all declarations
+
+    IncrementalDiagnostic import_diagnostic;
+    IncrementalDiagnostic program_diagnostic;   // Layout, main, duplicate and unused functions
+    IncrementalDiagnostic *diagnostics;         // Result of the last update
+    size_t diagnostic_count;
+    size_t diagnostic_capacity;
+    char message[INCREMENTAL_MESSAGE_LENGTH];   // Message buffer of error_exit
+
+    size_t relexed_tokens;     // Statistics of the last update
+    size_t reparsed_functions;
+} IncrementalSession;
+
+// Starts a session and analyses the whole text, returns NULL if there is not enough memory
+IncrementalSession *incremental_open(const char *text, size_t length);
+
+// Replaces removed_length characters at offset with the inserted text and updates the diagnostics.
+// Returns false if the range is outside the text or there is not enough memory.
+bool incremental_edit(IncrementalSession *session, size_t offset, size_t removed_length,
+                      const char *inserted, size_t inserted_length);
+
+// Diagnostics of the current text: the import line and the program first, then the functions in order
+const IncrementalDiagnostic *incremental_diagnostics(const IncrementalSession *session, size_t *count);
+
+// Releases the session
+void incremental_close(IncrementalSession *session);
+
+#endif // INCREMENTAL_H
@@ -13,67 +13,110 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include "scanner.h"
-#include "parser.h"
+#include <string.h>
+#include <stdbool.h>
 #include "error.h"
-#include "ast.h"
-#include "codegen.h"
-#include "utils.h"
+#include "compiler.h"
+#include "server.h"
+#include "batch.h"
 
 /**
  * Main function of the compiler project.
- * Initializes scanner, parser, and code generator.
+ * Parses the command line and compiles one source, a batch of sources or runs the compile server.
  */
 int main(int argc, char *argv[]) {
     FILE *source_file = stdin; // Default source file is standard input
+    const char *source_filename = NULL; // Default source filename is NULL
     const char *output_filename = NULL; // Default output filename is NULL
+    const char *server_socket = NULL; // Socket of the compile server, NULL compiles directly
+    const char *output_dir = NULL; // Output directory of batch mode, NULL compiles one source
+    int jobs = 0; // Worker threads of batch mode, 0 means one per processor
+    CompileOptions options = {false, false, TIMING_FORMAT_TABLE, false, false, false, NULL, NULL, false};
 
-    // Check the number of arguments passed to the program
-    if (argc > 3) {
-        fprintf(stderr, "Usage: %s [source_file] [output_file]\n", argv[0]);
-        return ERR_INTERNAL;
-    }
-    // If a source file is specified, open it
-    if (argc > 1) {
-        source_file = fopen(argv[1], "r");
-        if (!source_file) {
-            fprintf(stderr, "Error opening file: %s\n", argv[1]);
-            return ERR_INTERNAL;
+    // Split arguments into options and positional file names
+    char **positional = argv + 1;
+    int positional_count = 0;
+    bool usage_error = false;
+    for (int i = 1; i < argc && !usage_error; i++) {
+        if (strcmp(argv[i], "--null-report") == 0) {
+            options.null_report = true;
+        } else if (strcmp(argv[i], "--time-passes") == 0) {
+            options.time_passes = true;
+        } else if (strcmp(argv[i], "--time-passes=json") == 0) {
+            options.time_passes = true;
+            options.time_passes_format = TIMING_FORMAT_JSON;
+        } else if (strcmp(argv[i], "--low-memory") == 0) {
+            options.low_memory = true;
+        } else if (strcmp(argv[i], "--tail-call-report") == 0) {
+            options.tail_call_report = true;
+        } else if (strcmp(argv[i], "--instrument") == 0) {
+            options.instrument = true;
+        } else if (strcmp(argv[i], "--binary") == 0) {
+            options.binary = true;
+        } else if (strncmp(argv[i], "--emit-ast=", 11) == 0 && argv[i][11] != '\0') {
+            options.emit_ast = argv[i] + 11;
+        } else if (strncmp(argv[i], "--ast-cache=", 12) == 0 && argv[i][12] != '\0') {
+            options.ast_cache = argv[i] + 12;
+        } else if (strcmp(argv[i], "--server") == 0) {
+            server_socket = SERVER_DEFAULT_SOCKET;
+        } else if (strncmp(argv[i], "--server=", 9) == 0 && argv[i][9] != '\0') {
+            server_socket = argv[i] + 9;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+            usage_error = jobs < 1;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_dir = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            usage_error = true;
+        } else {
+            // Positional arguments are collected in place at the front of argv
+            positional[positional_count++] = argv[i];
         }
     }
 
-    // If an output file is specified, set the output filename
-    if (argc > 2) {
-        output_filename = argv[2];
+    // Batch mode takes any number of sources and no report options
+    if (output_dir) {
+        usage_error = usage_error || positional_count == 0 || options.null_report || options.time_passes ||
+                     options.tail_call_report || options.emit_ast || options.ast_cache;
+    } else {
+        usage_error = usage_error || jobs != 0 || positional_count > 2;
+    }
+    // Function by function generation never holds the whole AST
+    usage_error = usage_error || (options.low_memory && (options.emit_ast || options.ast_cache));
+    if (usage_error) {
+        fprintf(stderr, "Usage: %s [--null-report] [--tail-call-report] [--time-passes[=json]] [--low-memory] [--instrument] [--binary] [--emit-ast=file] [--ast-cache=file] [source_file] [output_file]\n", argv[0]);
+        fprintf(stderr, "       %s [-j jobs] [--low-memory] [--instrument] [--binary] -o output_dir source_file...\n", argv[0]);
+        fprintf(stderr, "       %s --server[=socket_path]\n", argv[0]);
+        return ERR_INTERNAL;
     }
 
-    // Initialize memory management for pointers (utils.c)
-    init_pointers_storage(5);
-
-    // Initialize scanner (scanner.c)
-    Scanner scanner;
-    scanner_init(source_file, &scanner);
-
-    // Initialize parser (parser.c)
-    parser_init(&scanner);
+    // Serve compile requests until a client asks for shutdown (server.c)
+    if (server_socket) {
+        return server_run(server_socket);
+    }
 
-    // Parse the source file and generate an abstract syntax tree (AST) (ast.c)
-    ASTNode* ast_root = parse_program(&scanner);
+    // Compile all sources concurrently into the output directory (batch.c)
+    if (output_dir) {
+        return batch_compile(positional, positional_count, output_dir, jobs > 0 ? jobs : batch_default_jobs(), &options);
+    }
 
-    // Initialize code generator (codegen.c)
-    codegen_init(output_filename);
+    source_filename = positional_count > 0 ? positional[0] : NULL;
+    output_filename = positional_count > 1 ? positional[1] : NULL;
 
-    // Generate code from the AST (codegen.c)
-    codegen_generate_program(ast_root);
+    // If a source file is specified, open it
+    if (source_filename) {
+        source_file = fopen(source_filename, "r");
+        if (!source_file) {
+            fprintf(stderr, "Error opening file: %s\n", source_filename);
+            return ERR_INTERNAL;
+        }
+    }
 
-    // Finalize code generation (codegen.c)
-    codegen_finalize();
+    // Scan, parse and generate the program (compiler.c)
+    int result = compiler_compile(source_file, output_filename, NULL, &options);
 
     // Close the source file
     fclose(source_file);
 
-    // Cleanup memory used for pointers (utils.c)
-    cleanup_pointers_storage();
-
-    return ERR_OK;  // Return success status
+    return result;
 }
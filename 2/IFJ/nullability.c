@@ -0,0 +1,442 @@
+/**
+ * @file nullability.c
+ *
+ * Implementation of the flow-sensitive nullability analysis.
+ * The analysis walks a function body in execution order and keeps the set of
+ * nullable variables that are definitely non-null at the current point.
+ * Identifier nodes read while their variable is in the set are marked
+ * with is_non_null, which lets codegen drop the TYPE/JUMPIFEQ pair.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#include "nullability.h"
+#include "parser.h"
+#include "utils.h"
+#include "compiler.h"
+#include <string.h>
+
+// Report counters of the compilation running in this thread
+#define nullability_state (current_context->nullability)
+
+static void analyze_block(ASTNode *block_node, NullState *state);
+static void analyze_statement(ASTNode *node, NullState *state);
+
+/**
+ * Checks if a variable is in the non-null set.
+ */
+static bool state_contains(NullState *state, const char *name)
+{
+    for (NonNullVar *var = state->vars; var != NULL; var = var->next)
+    {
+        if (strcmp(var->name, name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Adds a variable to the non-null set.
+ */
+static void state_add(NullState *state, const char *name)
+{
+    if (state_contains(state, name))
+    {
+        return;
+    }
+    NonNullVar *var = (NonNullVar *)safe_malloc(sizeof(NonNullVar));
+    var->name = string_duplicate(name);
+    var->next = state->vars;
+    state->vars = var;
+}
+
+/**
+ * Removes a variable from the non-null set.
+ */
+static void state_remove(NullState *state, const char *name)
+{
+    NonNullVar *prev = NULL;
+    for (NonNullVar *var = state->vars; var != NULL; prev = var, var = var->next)
+    {
+        if (strcmp(var->name, name) == 0)
+        {
+            if (prev == NULL)
+            {
+                state->vars = var->next;
+            }
+            else
+            {
+                prev->next = var->next;
+            }
+            safe_free(var->name);
+            safe_free(var);
+            return;
+        }
+    }
+}
+
+/**
+ * Frees all variables of the set.
+ */
+static void state_clear(NullState *state)
+{
+    NonNullVar *var = state->vars;
+    while (var != NULL)
+    {
+        NonNullVar *next = var->next;
+        safe_free(var->name);
+        safe_free(var);
+        var = next;
+    }
+    state->vars = NULL;
+}
+
+/**
+ * Creates a copy of the state.
+ */
+static NullState state_copy(NullState *state)
+{
+    NullState copy = {NULL, state->unreachable};
+    for (NonNullVar *var = state->vars; var != NULL; var = var->next)
+    {
+        state_add(&copy, var->name);
+    }
+    return copy;
+}
+
+/**
+ * Joins two states at a control flow merge point.
+ * A variable stays non-null only if it is non-null on every reachable path.
+ * The result is stored in target, other is released.
+ */
+static void state_join(NullState *target, NullState *other)
+{
+    if (other->unreachable)
+    {
+        state_clear(other);
+        return;
+    }
+    if (target->unreachable)
+    {
+        state_clear(target);
+        *target = *other;
+        return;
+    }
+
+    NonNullVar *var = target->vars;
+    while (var != NULL)
+    {
+        NonNullVar *next = var->next;
+        if (!state_contains(other, var->name))
+        {
+            state_remove(target, var->name);
+        }
+        var = next;
+    }
+    state_clear(other);
+}
+
+/**
+ * Checks if the node is an identifier of a nullable variable.
+ */
+static bool is_nullable_identifier(ASTNode *node)
+{
+    return node != NULL && node->type == NODE_IDENTIFIER && is_nullable(node->data_type);
+}
+
+/**
+ * Marks identifiers in an expression whose variables are known to be non-null.
+ */
+static void mark_expression(ASTNode *node, NullState *state)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+
+    switch (node->type)
+    {
+    case NODE_IDENTIFIER:
+        node->is_non_null = !state->unreachable && state_contains(state, node->name);
+        break;
+
+    case NODE_BINARY_OPERATION:
+        mark_expression(node->left, state);
+        mark_expression(node->right, state);
+        break;
+
+    case NODE_FUNCTION_CALL:
+        for (int i = 0; i < node->arg_count; i++)
+        {
+            mark_expression(node->arguments[i], state);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * Checks if the value of an expression can never be null.
+ */
+static bool is_expression_non_null(ASTNode *node, NullState *state)
+{
+    if (node == NULL)
+    {
+        return false;
+    }
+
+    switch (node->type)
+    {
+    case NODE_LITERAL:
+        return node->data_type != TYPE_NULL;
+
+    case NODE_IDENTIFIER:
+        // Identifiers created for |id| have unknown type and are resolved by the set
+        if (is_nullable(node->data_type) || node->data_type == TYPE_UNKNOWN)
+        {
+            return state_contains(state, node->name);
+        }
+        return true;
+
+    case NODE_BINARY_OPERATION:
+        // Arithmetic and relational operators never produce null
+        return true;
+
+    case NODE_FUNCTION_CALL:
+        return !is_nullable(node->data_type) && node->data_type != TYPE_NULL;
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * Updates the state after a variable got a new value.
+ */
+static void assign_variable(NullState *state, const char *name, ASTNode *value)
+{
+    if (is_expression_non_null(value, state))
+    {
+        state_add(state, name);
+    }
+    else
+    {
+        state_remove(state, name);
+    }
+}
+
+/**
+ * Removes all variables that are written anywhere inside the node from the state.
+ * Used for loops, where a write at the end of the body reaches the loop header.
+ */
+static void kill_assigned_variables(ASTNode *node, NullState *state)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+
+    if (node->type == NODE_ASSIGNMENT || node->type == NODE_VARIABLE_DECLARATION)
+    {
+        state_remove(state, node->name);
+    }
+
+    kill_assigned_variables(node->body, state);
+    kill_assigned_variables(node->left, state);
+    kill_assigned_variables(node->next, state);
+}
+
+/**
+ * Analyzes an if statement.
+ * In the true branch of "if (x)" the variable x is known to be non-null.
+ */
+static void analyze_if(ASTNode *node, NullState *state)
+{
+    mark_expression(node->condition, state);
+
+    NullState true_state = state_copy(state);
+    NullState false_state = state_copy(state);
+
+    if (is_nullable_identifier(node->condition))
+    {
+        state_add(&true_state, node->condition->name);
+        state_remove(&false_state, node->condition->name);
+    }
+
+    analyze_block(node->body, &true_state);
+    if (node->left != NULL)
+    {
+        analyze_block(node->left, &false_state);
+    }
+
+    state_join(&true_state, &false_state);
+    state_clear(state);
+    *state = true_state;
+}
+
+/**
+ * Analyzes a while loop.
+ * Variables written in the body are not trusted at the loop header,
+ * the condition variable is non-null inside the body.
+ */
+static void analyze_while(ASTNode *node, NullState *state)
+{
+    kill_assigned_variables(node->body, state);
+    mark_expression(node->condition, state);
+
+    NullState body_state = state_copy(state);
+    if (is_nullable_identifier(node->condition))
+    {
+        state_add(&body_state, node->condition->name);
+        state_remove(state, node->condition->name);
+    }
+
+    analyze_block(node->body, &body_state);
+    state_clear(&body_state);
+}
+
+/**
+ * Analyzes a statement and updates the state.
+ */
+static void analyze_statement(ASTNode *node, NullState *state)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+
+    switch (node->type)
+    {
+    case NODE_VARIABLE_DECLARATION:
+        mark_expression(node->left, state);
+        if (node->left != NULL)
+        {
+            assign_variable(state, node->name, node->left);
+        }
+        break;
+
+    case NODE_ASSIGNMENT:
+        mark_expression(node->left, state);
+        if (strcmp(node->name, "_") != 0)
+        {
+            assign_variable(state, node->name, node->left);
+        }
+        break;
+
+    case NODE_RETURN:
+        mark_expression(node->left, state);
+        state->unreachable = true;
+        break;
+
+    case NODE_IF:
+        analyze_if(node, state);
+        break;
+
+    case NODE_WHILE:
+        analyze_while(node, state);
+        break;
+
+    case NODE_FUNCTION_CALL:
+        mark_expression(node, state);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * Analyzes a block of statements.
+ */
+static void analyze_block(ASTNode *block_node, NullState *state)
+{
+    if (block_node == NULL)
+    {
+        return;
+    }
+    for (ASTNode *statement = block_node->body; statement != NULL; statement = statement->next)
+    {
+        analyze_statement(statement, state);
+    }
+}
+
+/**
+ * Runs the analysis on a function body.
+ * Parameters start as possibly null, there are no global variables in IFJ24,
+ * so function calls can not change the state.
+ */
+void nullability_analyze_function(ASTNode *function_node)
+{
+    NullState state = {NULL, false};
+    analyze_block(function_node->body, &state);
+    state_clear(&state);
+
+    NullCheckStats *stats = (NullCheckStats *)safe_malloc(sizeof(NullCheckStats));
+    stats->function_name = string_duplicate(function_node->name);
+    stats->checks_emitted = 0;
+    stats->checks_elided = 0;
+    stats->next = NULL;
+    if (nullability_state.stats_tail == NULL)
+    {
+        nullability_state.stats_head = stats;
+    }
+    else
+    {
+        nullability_state.stats_tail->next = stats;
+    }
+    nullability_state.stats_tail = stats;
+}
+
+/**
+ * Records a nil check of the last analyzed function.
+ */
+void nullability_record_check(bool elided)
+{
+    if (nullability_state.stats_tail == NULL)
+    {
+        return;
+    }
+    if (elided)
+    {
+        nullability_state.stats_tail->checks_elided++;
+    }
+    else
+    {
+        nullability_state.stats_tail->checks_emitted++;
+    }
+}
+
+/**
+ * Forgets the counters, the list itself is released by cleanup_pointers_storage.
+ */
+void nullability_reset(void)
+{
+    nullability_state.stats_head = NULL;
+    nullability_state.stats_tail = NULL;
+}
+
+/**
+ * Prints the report of runtime nil checks.
+ */
+void nullability_print_report(FILE *output)
+{
+    int total_emitted = 0;
+    int total_elided = 0;
+
+    fprintf(output, "%-24s %10s %10s\n", "function", "emitted", "elided");
+    for (NullCheckStats *stats = nullability_state.stats_head; stats != NULL; stats = stats->next)
+    {
+        fprintf(output, "%-24s %10d %10d\n", stats->function_name, stats->checks_emitted, stats->checks_elided);
+        total_emitted += stats->checks_emitted;
+        total_elided += stats->checks_elided;
+    }
+    fprintf(output, "%-24s %10d %10d\n", "total", total_emitted, total_elided);
+}
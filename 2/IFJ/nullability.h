@@ -0,0 +1,60 @@
+/**
+ * @file nullability.h
+ *
+ * Header file for the nullability analysis module.
+ * Finds uses of nullable variables that are known to hold a value,
+ * so code generation can skip the runtime nil check for them.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef NULLABILITY_H
+#define NULLABILITY_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "ast.h"
+
+/** Structure to keep track of variables known to be non-null */
+typedef struct NonNullVar {
+    char *name;
+    struct NonNullVar *next;
+} NonNullVar;
+
+/** Analysis state at one point of the function body */
+typedef struct {
+    NonNullVar *vars;
+    bool unreachable; // Code after return, joins as "everything is non-null"
+} NullState;
+
+/** Runtime nil check counters of one function */
+typedef struct NullCheckStats {
+    char *function_name;
+    int checks_emitted;
+    int checks_elided;
+    struct NullCheckStats *next;
+} NullCheckStats;
+
+/** Report counters of one compilation (part of CompilerContext) */
+typedef struct {
+    NullCheckStats *stats_head;
+    NullCheckStats *stats_tail;
+} NullabilityState;
+
+// Runs the analysis on a function and sets is_non_null on identifier nodes
+void nullability_analyze_function(ASTNode *function_node);
+
+// Records a nil check of the function being generated (elided or emitted)
+void nullability_record_check(bool elided);
+
+// Prints the per-function table of emitted and elided nil checks
+void nullability_print_report(FILE *output);
+
+// Forgets the counters of the previous compilation
+void nullability_reset(void);
+
+#endif // NULLABILITY_H
@@ -12,15 +12,12 @@
  * @author <xshmon00> Gleb Shmonin
  */
 #include "parser.h"
+#include "timing.h"
+#include "string_pool.h"
+#include "compiler.h"
 
-#define MAX_SCOPE_DEPTH 100
-
-// Global symbol table for the program
-static SymTable symtable;
-
-static int scope_stack[MAX_SCOPE_DEPTH];
-static int scope_stack_top = -1;
-static int scope_counter = 0;
+// Parser state of the compilation running in this thread
+#define parser_state (current_context->parser)
 
 // Function to make sure that current token us expected_type
 static void expect_token(TokenType expected_type, Scanner *scanner);
@@ -44,9 +41,6 @@ static ASTNode *parse_idendifier(Scanner *scanner, Symbol *symbol, char *identif
 static ASTNode *check_and_convert_expression(ASTNode *node, DataType expected_type, const char *variable_name);
 static ASTNode **parse_arguments(Scanner *scanner, Symbol *symbol, ASTNode **arguments, int param_count, int *arg_count, char *function_name, char *builtin_function_name);
 
-// Global token storage
-static Token current_token;
-
 /**
  * Dictionary of builtin functions
  */
@@ -69,43 +63,43 @@ BuiltinFunctionInfo builtin_functions[] = {
  * Function that enters a new scope
  */
 void enter_scope() {
-    scope_counter++;
-    if (scope_stack_top >= MAX_SCOPE_DEPTH - 1) {
+    parser_state.scope_counter++;
+    if (parser_state.scope_stack_top >= MAX_SCOPE_DEPTH - 1) {
         error_exit(ERR_INTERNAL, "Scope stack overflow");
     }
-    scope_stack[++scope_stack_top] = scope_counter;
+    parser_state.scope_stack[++parser_state.scope_stack_top] = parser_state.scope_counter;
 }
 
 /**
  * Function that exits the current scope
  */
 void exit_scope() {
-    if (scope_stack_top < 0) {
+    if (parser_state.scope_stack_top < 0) {
         error_exit(ERR_INTERNAL, "Scope stack underflow");
     }
-    scope_stack_top--;
+    parser_state.scope_stack_top--;
 }
 
 /**
  * Function that returns the current scope ID
  */
 int current_scope_id() {
-    if (scope_stack_top < 0) {
+    if (parser_state.scope_stack_top < 0) {
         return 0;
     }
-    return scope_stack[scope_stack_top];
+    return parser_state.scope_stack[parser_state.scope_stack_top];
 }
 
 /**
  * Function that finds variables in scopes in the format "variable.scope.function_name"
  */
 Symbol *search_variable_in_scopes(const char *variable_name, const char *function_name) {
-    for (int i = scope_stack_top; i >= -1; i--) {
-        int scope_id = (i >= 0) ? scope_stack[i] : 0;
+    for (int i = parser_state.scope_stack_top; i >= -1; i--) {
+        int scope_id = (i >= 0) ? parser_state.scope_stack[i] : 0;
         size_t len = strlen(function_name) + strlen(variable_name) + 20;
         char *full_name = (char *)safe_malloc(len);
         snprintf(full_name, len, "%s.%d.%s", variable_name, scope_id, function_name);
-        Symbol *symbol = symtable_search(&symtable, full_name);
+        Symbol *symbol = symtable_search(&parser_state.symtable, full_name);
         if (symbol != NULL) {
             return symbol;
         }
@@ -117,12 +111,12 @@ Symbol *search_variable_in_scopes(const char *variable_name, const char *functio
  * Function that checks variables in outer scopes in the format "variable.scope.function_name"
  */
 Symbol *search_variable_in_outer_scopes(const char *variable_name, const char *function_name) {
-    for (int i = scope_stack_top - 1; i >= -1; i--) {
-        int scope_id = (i >= 0) ? scope_stack[i] : 0;
+    for (int i = parser_state.scope_stack_top - 1; i >= -1; i--) {
+        int scope_id = (i >= 0) ? parser_state.scope_stack[i] : 0;
         size_t len = strlen(function_name) + strlen(variable_name) + 20;
         char *full_name = (char *)safe_malloc(len);
         snprintf(full_name, len, "%s.%d.%s", variable_name, scope_id, function_name);
-        Symbol *symbol = symtable_search(&symtable, full_name);
+        Symbol *symbol = symtable_search(&parser_state.symtable, full_name);
         safe_free(full_name);
         if (symbol != NULL) {
             return symbol;
@@ -136,22 +130,43 @@ Symbol *search_variable_in_outer_scopes(const char *variable_name, const char *f
  */
 void parser_init(Scanner *scanner)
 {
-    // Initialize the symbol table
-    symtable_init(&symtable);
+    // Initialize the symbol table with the builtin functions
+    symtable_init_builtins(&parser_state.symtable);
     // Get the first token to start parsing
-    current_token = get_next_token(scanner);
+    parser_state.current_token = get_next_token(scanner);
+}
+
+/**
+ * Resets the global parser state.
+ * The memory of the previous symtable was already released by cleanup_pointers_storage.
+ */
+void parser_reset(void)
+{
+    memset(&parser_state, 0, sizeof(parser_state));
+    parser_state.scope_stack_top = -1;
 }
 
 /**
  * Main function to parse program.
  * 1. Parses import
- * 2. Loading builtin functions
- * 3. Declaring all functions (Pre-run)
- * 4. Parsing all functions
- * 5. Semantic controll of symtable and scope check
+ * 2. Declaring all functions (Pre-run), builtin functions are in the symtable since parser_init
+ * 3. Parsing all functions
+ * 4. Semantic controll of symtable and scope check
  * Returns pointer to the root node of AST
  */
 ASTNode *parse_program(Scanner *scanner)
+{
+    return parse_program_streaming(scanner, NULL);
+}
+
+/**
+ * Parses the program like parse_program.
+ * With emit_function set, every function is scope checked and checked for unused
+ * variables as soon as it is parsed, then it is handed to emit_function, which may
+ * release its memory. The function node is restored to its pre-run state afterwards,
+ * so calls in later functions still see its signature.
+ */
+ASTNode *parse_program_streaming(Scanner *scanner, FunctionEmitter emit_function)
 {
     ASTNode *program_node = create_program_node();
 
@@ -162,10 +177,10 @@ ASTNode *parse_program(Scanner *scanner)
     ASTNode *import_node = parse_import(scanner);
     program_node->next = import_node;
 
-    load_builtin_functions(&symtable, import_node);
-
     // Pre-run
+    timing_begin(PHASE_PRE_RUN);
     parse_functions_declaration(scanner, program_node);
+    timing_end(PHASE_PRE_RUN);
 
     /* At this point program currently have functions ASTNode created
     now program need to prevent rewriting this nodes and continue.
@@ -175,16 +190,33 @@ ASTNode *parse_program(Scanner *scanner)
     program_node_pointer = *program_node->body;
     current_function_pointer = program_node->body;
 
-    while (current_token.type != TOKEN_EOF)
+    while (parser_state.current_token.type != TOKEN_EOF)
     {
-        if ((current_token.type == TOKEN_PUB) || (current_token.type == TOKEN_FN))
+        if ((parser_state.current_token.type == TOKEN_PUB) || (parser_state.current_token.type == TOKEN_FN))
         {
+            ASTNode prerun_function = *current_function_pointer;
+            size_t storage_mark = pointers_storage_mark();
+
             // Creating function node again with all deeper nodes
             *current_function_pointer = *(parse_function(scanner, true));
 
             // Pointing to next funtion node according with pre-run
             current_function_pointer->next = program_node_pointer.next;
 
+            if (emit_function != NULL)
+            {
+                timing_begin(PHASE_SCOPE_CHECK);
+                scope_check_identifiers_in_tree(current_function_pointer->body);
+                timing_end(PHASE_SCOPE_CHECK);
+
+                timing_begin(PHASE_SYMTABLE_CHECK);
+                is_function_all_used(&parser_state.symtable, current_function_pointer->name);
+                timing_end(PHASE_SYMTABLE_CHECK);
+
+                emit_function(current_function_pointer, storage_mark);
+                *current_function_pointer = prerun_function;
+            }
+
             // Moving to the next function node from pre-run tree
             current_function_pointer = program_node_pointer.next;
 
@@ -194,19 +226,70 @@ ASTNode *parse_program(Scanner *scanner)
         }
         else
         {
-            error_exit(ERR_SYNTAX, "Expected function definition. Line: %d, Column: %d", current_token.line, current_token.column);
+            error_exit(ERR_SYNTAX, "Expected function definition. Line: %d, Column: %d", parser_state.current_token.line, parser_state.current_token.column);
         }
     }
 
     // Semantics check
 
-    is_main_correct(&symtable);
-    is_symtable_all_used(&symtable);
-    scope_check_identifiers_in_tree(program_node);
+    timing_begin(PHASE_SYMTABLE_CHECK);
+    is_main_correct(&parser_state.symtable);
+    is_symtable_all_used(&parser_state.symtable);
+    timing_end(PHASE_SYMTABLE_CHECK);
+
+    // Functions of streaming mode were checked one by one
+    if (emit_function == NULL)
+    {
+        timing_begin(PHASE_SCOPE_CHECK);
+        scope_check_identifiers_in_tree(program_node);
+        timing_end(PHASE_SCOPE_CHECK);
+    }
 
     return program_node;
 }
 
+/**
+ * Removes parameters and variables of a function from the symtable.
+ * Only function symbols are needed after the function was emitted.
+ */
+void parser_forget_function(ASTNode *function_node)
+{
+    symtable_remove_function_symbols(&parser_state.symtable, function_node->name);
+}
+
+/**
+ * Parses the import line on its own (incremental.c).
+ */
+ASTNode *parse_program_import(Scanner *scanner)
+{
+    return parse_import(scanner);
+}
+
+/**
+ * Parses one function declaration like the pre-run, the function is inserted into the symtable.
+ */
+ASTNode *parse_function_declaration(Scanner *scanner)
+{
+    return parse_function(scanner, false);
+}
+
+/**
+ * Parses one function definition and checks it like streaming mode does.
+ * The declarations of the called functions must already be in the symtable.
+ * The parsed function is copied over its declaration node, which the scope check
+ * of parameters looks at, the caller restores the node afterwards.
+ */
+ASTNode *parse_function_definition(Scanner *scanner, ASTNode *declaration_node)
+{
+    ASTNode *function_node = parse_function(scanner, true);
+    function_node->next = declaration_node->next;
+    *declaration_node = *function_node;
+
+    scope_check_identifiers_in_tree(declaration_node->body);
+    is_function_all_used(&parser_state.symtable, declaration_node->name);
+    return declaration_node;
+}
+
 /**
  * Function that parses function declaration or definition.
  * bool is_definition is responsive for 2 types of execution (Definition and Declaration)
@@ -221,30 +304,31 @@ ASTNode *parse_program(Scanner *scanner)
  */
 ASTNode *parse_function(Scanner *scanner, bool is_definition)
 {
+    Token start_token = parser_state.current_token;
     expect_token(TOKEN_PUB, scanner);
     expect_token(TOKEN_FN, scanner);
 
-    if (current_token.type != TOKEN_IDENTIFIER)
+    if (parser_state.current_token.type != TOKEN_IDENTIFIER)
     {
         error_exit(ERR_SYNTAX, "Expected function name.");
     }
 
-    char *function_name = string_duplicate(current_token.lexeme);
+    char *function_name = string_duplicate(parser_state.current_token.lexeme);
 
-    current_token = get_next_token(scanner);
+    parser_state.current_token = get_next_token(scanner);
 
     expect_token(TOKEN_LEFT_PAREN, scanner); // '('
     enter_scope();
     ASTNode **parameters = NULL;
     int param_count = 0;
 
-    if (current_token.type != TOKEN_RIGHT_PAREN)
+    if (parser_state.current_token.type != TOKEN_RIGHT_PAREN)
     {
         parameters = (ASTNode **)safe_malloc(sizeof(ASTNode *));
         parameters[param_count++] = parse_parameter(scanner, function_name, is_definition);
-        while (current_token.type == TOKEN_COMMA)
+        while (parser_state.current_token.type == TOKEN_COMMA)
         {
-            current_token = get_next_token(scanner);
+            parser_state.current_token = get_next_token(scanner);
             parameters = (ASTNode **)safe_realloc(parameters, (param_count + 1) * sizeof(ASTNode *));
             parameters[param_count++] = parse_parameter(scanner, function_name, is_definition);
         }
@@ -260,34 +344,42 @@ ASTNode *parse_function(Scanner *scanner, bool is_definition)
         ASTNode *body_node = parse_block(scanner, function_name, false);
         function_node = create_function_node(function_name, return_type, parameters, param_count, body_node);
 
+        function_node->line = start_token.line;
+        function_node->column = start_token.column;
+
         int block_layer = 0;
         check_return_types(function_node->body->body, return_type, &block_layer);
     }
     else
     {
-        if (current_token.type != TOKEN_LEFT_BRACE)
+        if (parser_state.current_token.type != TOKEN_LEFT_BRACE)
         {
             error_exit(ERR_SYNTAX, "Expected '{' at the start of function body.");
         }
         int brace_count = 1;
+        size_t storage_mark = pointers_storage_mark();
 
         while (brace_count > 0)
         {
-            current_token = get_next_token(scanner);
+            parser_state.current_token = get_next_token(scanner);
 
-            if (current_token.type == TOKEN_LEFT_BRACE)
+            if (parser_state.current_token.type == TOKEN_LEFT_BRACE)
             {
                 brace_count++;
             }
-            else if (current_token.type == TOKEN_RIGHT_BRACE)
+            else if (parser_state.current_token.type == TOKEN_RIGHT_BRACE)
             {
                 brace_count--;
             }
         }
+
+        // Lexemes of the skipped body are not referenced anywhere, the body is parsed again later
+        void *keep[] = {parser_state.current_token.lexeme};
+        release_pointers_since(storage_mark, keep, 1);
         function_node = create_function_node(function_name, return_type, parameters, param_count, NULL);
 
         char *function_name_symtable = string_duplicate(function_name);
-        Symbol *function_symbol = symtable_search(&symtable, function_name_symtable);
+        Symbol *function_symbol = symtable_search(&parser_state.symtable, function_name_symtable);
         if (function_symbol != NULL)
         {
             error_exit(ERR_SEMANTIC_OTHER, "Function already defined.");
@@ -301,10 +393,11 @@ ASTNode *parse_function(Scanner *scanner, bool is_definition)
         new_function->is_defined = true;
         new_function->declaration_node = function_node;
         new_function->is_used = strcmp(new_function->name, "main") == 0 ? true : false;
+        new_function->is_constant = false;
         new_function->next = NULL;
 
-        symtable_insert(&symtable, function_name_symtable, new_function);
-        current_token = get_next_token(scanner);
+        symtable_insert(&parser_state.symtable, function_name_symtable, new_function);
+        parser_state.current_token = get_next_token(scanner);
     }
     exit_scope();
 
@@ -322,20 +415,20 @@ ASTNode *parse_function(Scanner *scanner, bool is_definition)
  */
 ASTNode *parse_parameter(Scanner *scanner, char *function_name, bool is_definition)
 {
-    if (current_token.type != TOKEN_IDENTIFIER)
+    if (parser_state.current_token.type != TOKEN_IDENTIFIER)
     {
         error_exit(ERR_SYNTAX, "Expected parameter name.");
     }
 
-    char *param_name = construct_variable_name(current_token.lexeme, function_name);
+    char *param_name = construct_variable_name(parser_state.current_token.lexeme, function_name);
 
-    current_token = get_next_token(scanner);
+    parser_state.current_token = get_next_token(scanner);
 
     expect_token(TOKEN_COLON, scanner);
 
     DataType param_type = parse_type(scanner);
 
-    Symbol *param_symbol = symtable_search(&symtable, param_name);
+    Symbol *param_symbol = symtable_search(&parser_state.symtable, param_name);
     if (param_symbol != NULL && is_definition)
     {
         safe_free(param_name);
@@ -351,10 +444,12 @@ ASTNode *parse_parameter(Scanner *scanner, char *function_name, bool is_definiti
         new_param->parent_function = string_duplicate(function_name);
         new_param->data_type = param_type;
         new_param->is_defined = true;
+        new_param->is_used = false;
+        new_param->is_constant = false;
         new_param->next = NULL;
         new_param->declaration_node = param_node;
 
-        symtable_insert(&symtable, param_name, new_param);
+        symtable_insert(&parser_state.symtable, param_name, new_param);
     }
 
     return param_node;
@@ -368,6 +463,7 @@ ASTNode *parse_parameter(Scanner *scanner, char *function_name, bool is_definiti
  */
 ASTNode *parse_block(Scanner *scanner, char *function_name, bool enter_new_scope)
 {
+    Token start_token = parser_state.current_token;
     expect_token(TOKEN_LEFT_BRACE, scanner);
 
     if (enter_new_scope)
@@ -376,9 +472,11 @@ ASTNode *parse_block(Scanner *scanner, char *function_name, bool enter_new_scope
     }
 
     ASTNode *block_node = create_block_node(NULL, TYPE_NULL);
+    block_node->line = start_token.line;
+    block_node->column = start_token.column;
     ASTNode *current_statement = NULL;
 
-    while (current_token.type != TOKEN_RIGHT_BRACE)
+    while (parser_state.current_token.type != TOKEN_RIGHT_BRACE)
     {
         ASTNode *statement_node = parse_statement(scanner, function_name);
 
@@ -409,23 +507,23 @@ ASTNode *parse_block(Scanner *scanner, char *function_name, bool enter_new_scope
  */
 ASTNode *parse_statement(Scanner *scanner, char *function_name)
 {
-    if (current_token.type == TOKEN_VAR || current_token.type == TOKEN_CONST)
+    if (parser_state.current_token.type == TOKEN_VAR || parser_state.current_token.type == TOKEN_CONST)
     {
         return parse_variable_declaration(scanner, function_name);
     }
-    else if (current_token.type == TOKEN_IF)
+    else if (parser_state.current_token.type == TOKEN_IF)
     {
         return parse_if_statement(scanner, function_name);
     }
-    else if (current_token.type == TOKEN_WHILE)
+    else if (parser_state.current_token.type == TOKEN_WHILE)
     {
         return parse_while_statement(scanner, function_name);
     }
-    else if (current_token.type == TOKEN_RETURN)
+    else if (parser_state.current_token.type == TOKEN_RETURN)
     {
         return parse_return_statement(scanner, function_name);
     }
-    else if (current_token.type == TOKEN_IDENTIFIER)
+    else if (parser_state.current_token.type == TOKEN_IDENTIFIER)
     {
         return parse_variable_assigning(scanner, function_name);
     }
@@ -451,10 +549,10 @@ ASTNode *parse_variable_assigning(Scanner *scanner, char *function_name)
     char *name = NULL;
     Symbol *symbol = NULL;
     ASTNode *function_node;
-    bool is_builtin = is_builtin_function(current_token.lexeme, scanner);
+    bool is_builtin = is_builtin_function(parser_state.current_token.lexeme, scanner);
     bool is_function = false;
     bool is_underscore = false;
-    symbol = symtable_search(&symtable, current_token.lexeme);
+    symbol = symtable_search(&parser_state.symtable, parser_state.current_token.lexeme);
     if (symbol != NULL)
     {
         if (symbol->symbol_type == SYMBOL_FUNCTION)
@@ -474,8 +572,8 @@ ASTNode *parse_variable_assigning(Scanner *scanner, char *function_name)
     }
     else if (is_function)
     {
-        char *function_call_name = string_duplicate(current_token.lexeme);
-        symbol = symtable_search(&symtable, function_call_name);
+        char *function_call_name = string_duplicate(parser_state.current_token.lexeme);
+        symbol = symtable_search(&parser_state.symtable, function_call_name);
         if (symbol == NULL || symbol->symbol_type != SYMBOL_FUNCTION)
         {
             error_exit(ERR_SEMANTIC_UNDEF, "Undefined function %s.", function_call_name);
@@ -494,27 +592,22 @@ ASTNode *parse_variable_assigning(Scanner *scanner, char *function_name)
     }
     else if (is_underscore)
     {
-        name = string_duplicate(current_token.lexeme);
-        symbol = symtable_search(&symtable, name);
+        name = string_duplicate(parser_state.current_token.lexeme);
+        symbol = symtable_search(&parser_state.symtable, name);
 
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
 
         expect_token(TOKEN_ASSIGN, scanner);
 
         ASTNode *value_node = parse_expression(scanner, function_name);
 
-        if (symbol->data_type != TYPE_ALL)
+        const TypeRule *rule = type_rule(TYPE_OPERATOR_ASSIGN, symbol->data_type, value_node->data_type);
+        if (symbol->data_type != TYPE_ALL && rule->error_code != ERR_OK)
         {
-            if (is_nullable(symbol->data_type) && value_node->data_type == TYPE_NULL)
-            {
-            }
-            else if (!can_assign_type(symbol->data_type, value_node->data_type))
-            {
-                error_exit(ERR_SEMANTIC_TYPE, "Cannot assign null to non-nullable variable %s.", name);
-            }
+            error_exit(ERR_SEMANTIC_TYPE, "Cannot assign null to non-nullable variable %s.", name);
         }
 
-        if (symbol->data_type == TYPE_FLOAT && value_node->data_type == TYPE_INT)
+        if (rule->conversion == CONVERSION_RIGHT)
         {
             value_node = convert_to_float_node(value_node);
         }
@@ -524,13 +617,13 @@ ASTNode *parse_variable_assigning(Scanner *scanner, char *function_name)
     }
     else
     {
-        symbol = search_variable_in_scopes(current_token.lexeme, function_name);
+        symbol = search_variable_in_scopes(parser_state.current_token.lexeme, function_name);
         if (symbol == NULL)
         {
-            error_exit(ERR_SEMANTIC_UNDEF, "Variable or function %s is not defined.", current_token.lexeme);
+            error_exit(ERR_SEMANTIC_UNDEF, "Variable or function %s is not defined.", parser_state.current_token.lexeme);
         }
         name = string_duplicate(symbol->name);
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
 
         expect_token(TOKEN_ASSIGN, scanner);
 
@@ -562,11 +655,12 @@ ASTNode *check_and_convert_expression(ASTNode *node, DataType expected_type, con
     if (!node)
         return NULL;
 
-    if (!can_assign_type(expected_type, node->data_type))
+    const TypeRule *rule = type_rule(TYPE_OPERATOR_ASSIGN, expected_type, node->data_type);
+    if (rule->error_code != ERR_OK)
     {
         error_exit(ERR_SEMANTIC_TYPE, "Type mismatch in assignment to variable %s.", variable_name);
     }
-    if (expected_type == TYPE_FLOAT && node->data_type == TYPE_INT)
+    if (rule->conversion == CONVERSION_RIGHT)
     {
         node = convert_to_float_node(node);
     }
@@ -586,33 +680,33 @@ ASTNode *check_and_convert_expression(ASTNode *node, DataType expected_type, con
  */
 ASTNode *parse_variable_declaration(Scanner *scanner, char *function_name)
 {
-    TokenType var_type = current_token.type;
-    current_token = get_next_token(scanner);
+    TokenType var_type = parser_state.current_token.type;
+    parser_state.current_token = get_next_token(scanner);
 
-    if (current_token.type != TOKEN_IDENTIFIER)
+    if (parser_state.current_token.type != TOKEN_IDENTIFIER)
     {
         error_exit(ERR_SYNTAX, "Expected variable name.");
     }
-    if (current_token.lexeme == NULL)
+    if (parser_state.current_token.lexeme == NULL)
     {
         error_exit(ERR_INTERNAL, "Lexeme is NULL before strdup.");
     }
-    if (strcmp(current_token.lexeme, "_") == 0)
+    if (strcmp(parser_state.current_token.lexeme, "_") == 0)
     {
         error_exit(ERR_SEMANTIC, "Variable _ is already declared.");
     }
     // Saving the base name of the variable for checking
-    const char *base_variable_name = current_token.lexeme;
+    const char *base_variable_name = parser_state.current_token.lexeme;
 
     // We create the full name of the variable taking into account the scope
     char *variable_name = construct_variable_name(base_variable_name, function_name);
-    current_token = get_next_token(scanner);
+    parser_state.current_token = get_next_token(scanner);
 
     DataType declaration_type = TYPE_UNKNOWN;
 
-    if (current_token.type == TOKEN_COLON)
+    if (parser_state.current_token.type == TOKEN_COLON)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         declaration_type = parse_type(scanner);
     }
 
@@ -654,7 +748,7 @@ ASTNode *parse_variable_declaration(Scanner *scanner, char *function_name)
     }
 
     // Checking whether a variable with the same name exists in the current scope
-    symbol = symtable_search(&symtable, variable_name);
+    symbol = symtable_search(&parser_state.symtable, variable_name);
     if (symbol != NULL)
     {
         error_exit(ERR_SEMANTIC_OTHER, "Variable '%s' is already defined in the current scope.", base_variable_name);
@@ -667,11 +761,12 @@ ASTNode *parse_variable_declaration(Scanner *scanner, char *function_name)
     new_var->parent_function = string_duplicate(function_name);
     new_var->data_type = declaration_type;
     new_var->is_defined = true;
+    new_var->is_used = false;
     new_var->is_constant = (var_type == TOKEN_CONST) ? true : false;
     new_var->declaration_node = variable_declaration_node;
     new_var->next = NULL;
 
-    symtable_insert(&symtable, variable_name, new_var);
+    symtable_insert(&parser_state.symtable, variable_name, new_var);
 
     return variable_declaration_node;
 }
@@ -685,6 +780,7 @@ ASTNode *parse_variable_declaration(Scanner *scanner, char *function_name)
  */
 ASTNode *parse_if_statement(Scanner *scanner, char *function_name)
 {
+    Token start_token = parser_state.current_token;
     expect_token(TOKEN_IF, scanner);         // 'if'
     expect_token(TOKEN_LEFT_PAREN, scanner); // '('
 
@@ -700,15 +796,15 @@ ASTNode *parse_if_statement(Scanner *scanner, char *function_name)
 
     expect_token(TOKEN_RIGHT_PAREN, scanner); // ')'
 
-    if (current_token.type == TOKEN_PIPE)
+    if (parser_state.current_token.type == TOKEN_PIPE)
     {
-        current_token = get_next_token(scanner);
-        if (current_token.type != TOKEN_IDENTIFIER)
+        parser_state.current_token = get_next_token(scanner);
+        if (parser_state.current_token.type != TOKEN_IDENTIFIER)
         {
             error_exit(ERR_SEMANTIC, "Expected identifier |id|");
         }
-        char *variable_name = construct_variable_name(current_token.lexeme, function_name);
-        Symbol *symbol = symtable_search(&symtable, current_token.lexeme);
+        char *variable_name = construct_variable_name(parser_state.current_token.lexeme, function_name);
+        Symbol *symbol = symtable_search(&parser_state.symtable, parser_state.current_token.lexeme);
         if (symbol != NULL)
         {
             error_exit(ERR_SEMANTIC_OTHER, "Variable is already defined");
@@ -720,13 +816,14 @@ ASTNode *parse_if_statement(Scanner *scanner, char *function_name)
         new_var->parent_function = string_duplicate(function_name);
         new_var->data_type = detach_nullable(condition_node->data_type);
         new_var->is_defined = true;
+        new_var->is_used = false;
         new_var->is_constant = true;
         new_var->declaration_node = variable_declaration_node;
         new_var->next = NULL;
 
-        symtable_insert(&symtable, variable_name, new_var);
+        symtable_insert(&parser_state.symtable, variable_name, new_var);
 
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         expect_token(TOKEN_PIPE, scanner);
 
         is_pipe = true;
@@ -742,9 +839,9 @@ ASTNode *parse_if_statement(Scanner *scanner, char *function_name)
         variable_declaration_node->left = create_identifier_node(condition_node->name);
     }
     ASTNode *false_block = NULL;
-    if (current_token.type == TOKEN_ELSE)
+    if (parser_state.current_token.type == TOKEN_ELSE)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         enter_scope();
         false_block = parse_block(scanner, function_name, true);
         exit_scope();
@@ -757,7 +854,10 @@ ASTNode *parse_if_statement(Scanner *scanner, char *function_name)
             error_exit(ERR_SEMANTIC_TYPE, "Incompabile type of return expression");
         }
     }
-    return create_if_node(condition_node, true_block, false_block, variable_declaration_node);
+    ASTNode *if_node = create_if_node(condition_node, true_block, false_block, variable_declaration_node);
+    if_node->line = start_token.line;
+    if_node->column = start_token.column;
+    return if_node;
 }
 /**
  * Function that parses while statement
@@ -767,6 +867,7 @@ ASTNode *parse_if_statement(Scanner *scanner, char *function_name)
  */
 ASTNode *parse_while_statement(Scanner *scanner, char *function_name)
 {
+    Token start_token = parser_state.current_token;
     expect_token(TOKEN_WHILE, scanner);      // 'while'
     expect_token(TOKEN_LEFT_PAREN, scanner); // '('
     ASTNode *condition_node = parse_expression(scanner, function_name);
@@ -779,15 +880,15 @@ ASTNode *parse_while_statement(Scanner *scanner, char *function_name)
 
     expect_token(TOKEN_RIGHT_PAREN, scanner); // ')'
 
-    if (current_token.type == TOKEN_PIPE)
+    if (parser_state.current_token.type == TOKEN_PIPE)
     {
-        current_token = get_next_token(scanner);
-        if (current_token.type != TOKEN_IDENTIFIER)
+        parser_state.current_token = get_next_token(scanner);
+        if (parser_state.current_token.type != TOKEN_IDENTIFIER)
         {
             error_exit(ERR_SEMANTIC, "Expected identifier |id|");
         }
-        char *variable_name = construct_variable_name(current_token.lexeme, function_name);
-        Symbol *symbol = symtable_search(&symtable, current_token.lexeme);
+        char *variable_name = construct_variable_name(parser_state.current_token.lexeme, function_name);
+        Symbol *symbol = symtable_search(&parser_state.symtable, parser_state.current_token.lexeme);
         if (symbol != NULL)
         {
             error_exit(ERR_SEMANTIC_OTHER, "Variable is already defined");
@@ -799,13 +900,14 @@ ASTNode *parse_while_statement(Scanner *scanner, char *function_name)
         new_var->parent_function = string_duplicate(function_name);
         new_var->data_type = detach_nullable(condition_node->data_type);
         new_var->is_defined = true;
+        new_var->is_used = false;
         new_var->is_constant = true;
         new_var->declaration_node = variable_declaration_node;
         new_var->next = NULL;
 
-        symtable_insert(&symtable, variable_name, new_var);
+        symtable_insert(&parser_state.symtable, variable_name, new_var);
 
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         expect_token(TOKEN_PIPE, scanner);
         is_pipe = true;
     }
@@ -819,7 +921,10 @@ ASTNode *parse_while_statement(Scanner *scanner, char *function_name)
         variable_declaration_node->next = tmp;
         variable_declaration_node->left = create_identifier_node(condition_node->name);
     }
-    return create_while_node(condition_node, body_node);
+    ASTNode *while_node = create_while_node(condition_node, body_node);
+    while_node->line = start_token.line;
+    while_node->column = start_token.column;
+    return while_node;
 }
 
 /**
@@ -833,7 +938,7 @@ ASTNode *parse_return_statement(Scanner *scanner, char *function_name)
 
     ASTNode *return_value_node = NULL;
 
-    if (current_token.type != TOKEN_SEMICOLON)
+    if (parser_state.current_token.type != TOKEN_SEMICOLON)
     {
         return_value_node = parse_expression(scanner, function_name);
     }
@@ -862,153 +967,47 @@ ASTNode *convert_to_float_node(ASTNode *node)
     return conversion_node;
 }
 
-ASTNode *perform_type_checking_and_create_node(const char *operator_name, ASTNode *left_node, ASTNode *right_node)
+/**
+ * Type checks a binary operation with the rule of its operator and operand types
+ * 1. Converts the int literal operand to float if the rule asks for it
+ * 2. Reports the error of the rule otherwise
+ * Returns a pointer to the binary operation node
+ */
+ASTNode *perform_type_checking_and_create_node(TokenType operator_type, const char *operator_name, ASTNode *left_node, ASTNode *right_node)
 {
-    DataType left_type = left_node->data_type;
-    DataType right_type = right_node->data_type;
-
-    // Determine if the operation is a boolean operation
-    bool is_boolean = false;
-    bool is_equality = false;
-    if (strcmp(operator_name, ">=") == 0 || strcmp(operator_name, "<=") == 0 ||
-        strcmp(operator_name, "<") == 0 || strcmp(operator_name, ">") == 0 ||
-        strcmp(operator_name, "==") == 0 || strcmp(operator_name, "!=") == 0)
-    {
-        is_boolean = true;
-        if (strcmp(operator_name, "==") == 0 || strcmp(operator_name, "!=") == 0)
-        {
-            is_equality = true;
-        }
-    }
+    const TypeRule *rule = type_rule(type_operator_of(operator_type), left_node->data_type, right_node->data_type);
 
-    // If either operand is of type U8 or U8 nullable, error
-    if (left_type == TYPE_U8 || left_type == TYPE_U8_NULLABLE ||
-        right_type == TYPE_U8 || right_type == TYPE_U8_NULLABLE)
+    if (rule->conversion == CONVERSION_LEFT_LITERAL && left_node->type == NODE_LITERAL)
     {
-        error_exit(ERR_SEMANTIC_TYPE, "Invalid operand types for operator '%s'", operator_name);
+        left_node = convert_to_float_node(left_node);
     }
-
-    DataType left_base_type = is_nullable(left_type) ? detach_nullable(left_type) : left_type;
-    DataType right_base_type = is_nullable(right_type) ? detach_nullable(right_type) : right_type;
-
-    // Handle == and != operators
-    if (is_equality)
+    else if (rule->conversion == CONVERSION_RIGHT_LITERAL && right_node->type == NODE_LITERAL)
     {
-        // Comparing with null
-        if (left_type == TYPE_NULL || right_type == TYPE_NULL)
-        {
-            // Only nullable types can be compared with null
-            if ((is_nullable(left_type) && right_type == TYPE_NULL) ||
-                (left_type == TYPE_NULL && is_nullable(right_type)))
-            {
-                // Create the node for comparison
-                ASTNode *node = create_binary_operation_node(operator_name, left_node, right_node);
-                node->data_type = TYPE_BOOL;
-                return node;
-            }
-            else
-            {
-                error_exit(ERR_SEMANTIC_TYPE, "Cannot compare non-nullable type with null");
-            }
-        }
-        else
-        {
-            // Handle implicit conversion between int and float if one operand is a literal
-            if (left_base_type != right_base_type)
-            {
-                if ((left_base_type == TYPE_INT && right_base_type == TYPE_FLOAT && left_node->type == NODE_LITERAL))
-                {
-                    left_node = convert_to_float_node(left_node);
-                    left_base_type = TYPE_FLOAT;
-                }
-                else if (left_base_type == TYPE_FLOAT && right_base_type == TYPE_INT && right_node->type == NODE_LITERAL)
-                {
-                    right_node = convert_to_float_node(right_node);
-                    right_base_type = TYPE_FLOAT;
-                }
-            }
-
-            // After conversions, check if base types match
-            if (left_base_type != right_base_type)
-            {
-                error_exit(ERR_SEMANTIC_TYPE, "Cannot compare types '%d' and '%d' with operator '%s'", left_type, right_type, operator_name);
-            }
-
-            // Create the node for comparison
-            ASTNode *node = create_binary_operation_node(operator_name, left_node, right_node);
-            node->data_type = TYPE_BOOL;
-            return node;
-        }
+        right_node = convert_to_float_node(right_node);
     }
-    else
+    else if (rule->error_code != ERR_OK)
     {
-        // For other operators, operands must be non-nullable
-        if (is_nullable(left_type) || is_nullable(right_type) || left_type == TYPE_NULL || right_type == TYPE_NULL)
-        {
-            error_exit(ERR_SEMANTIC_TYPE, "Cannot perform operator '%s' on nullable types or null", operator_name);
-        }
-
-        // Now both operands are non-nullable
-        if (left_base_type == right_base_type)
-        {
-            if (left_base_type == TYPE_INT || left_base_type == TYPE_FLOAT)
-            {
-                ASTNode *node = create_binary_operation_node(operator_name, left_node, right_node);
-                node->data_type = is_boolean ? TYPE_BOOL : left_base_type;
-                return node;
-            }
-            else
-            {
-                error_exit(ERR_SEMANTIC_TYPE, "Invalid operand types for operator '%s'", operator_name);
-            }
-        }
-        else if ((left_base_type == TYPE_INT && right_base_type == TYPE_FLOAT) ||
-                 (left_base_type == TYPE_FLOAT && right_base_type == TYPE_INT))
-        {
-            // Implicit conversion allowed if int operand is a literal
-            if (left_base_type == TYPE_INT && left_node->type == NODE_LITERAL)
-            {
-                left_node = convert_to_float_node(left_node);
-                left_base_type = TYPE_FLOAT;
-            }
-            else if (right_base_type == TYPE_INT && right_node->type == NODE_LITERAL)
-            {
-                right_node = convert_to_float_node(right_node);
-                right_base_type = TYPE_FLOAT;
-            }
-            else
-            {
-                error_exit(ERR_SEMANTIC_TYPE, "Cannot implicitly convert int variable to float");
-            }
-
-            // Now both operands are float
-            ASTNode *node = create_binary_operation_node(operator_name, left_node, right_node);
-            node->data_type = is_boolean ? TYPE_BOOL : TYPE_FLOAT;
-            return node;
-        }
-        else
-        {
-            error_exit(ERR_SEMANTIC_TYPE, "Incompatible operand types for operator '%s'", operator_name);
-        }
+        error_exit(rule->error_code, rule->message, operator_name);
     }
 
-    // Should not reach here
-    error_exit(ERR_INTERNAL, "Unhandled type checking case");
-    return NULL; // For compiler warnings
+    ASTNode *node = create_binary_operation_node(operator_name, left_node, right_node);
+    node->data_type = rule->result;
+    return node;
 }
 
 ASTNode *parse_multiplicative(Scanner *scanner, char *function_name)
 {
     ASTNode *node = parse_primary_expression(scanner, function_name);
 
-    while (current_token.type == TOKEN_MULTIPLY || current_token.type == TOKEN_DIVIDE)
+    while (parser_state.current_token.type == TOKEN_MULTIPLY || parser_state.current_token.type == TOKEN_DIVIDE)
     {
-        const char *operator_name = current_token.lexeme;
-        current_token = get_next_token(scanner);
+        TokenType operator_type = parser_state.current_token.type;
+        const char *operator_name = parser_state.current_token.lexeme;
+        parser_state.current_token = get_next_token(scanner);
         ASTNode *right_node = parse_primary_expression(scanner, function_name);
 
         // Perform type checking and set data_type
-        node = perform_type_checking_and_create_node(operator_name, node, right_node);
+        node = perform_type_checking_and_create_node(operator_type, operator_name, node, right_node);
     }
 
     return node;
@@ -1018,14 +1017,15 @@ ASTNode *parse_additive(Scanner *scanner, char *function_name)
 {
     ASTNode *node = parse_multiplicative(scanner, function_name);
 
-    while (current_token.type == TOKEN_PLUS || current_token.type == TOKEN_MINUS)
+    while (parser_state.current_token.type == TOKEN_PLUS || parser_state.current_token.type == TOKEN_MINUS)
     {
-        const char *operator_name = current_token.lexeme;
-        current_token = get_next_token(scanner);
+        TokenType operator_type = parser_state.current_token.type;
+        const char *operator_name = parser_state.current_token.lexeme;
+        parser_state.current_token = get_next_token(scanner);
         ASTNode *right_node = parse_multiplicative(scanner, function_name);
 
         // Perform type checking and set data_type
-        node = perform_type_checking_and_create_node(operator_name, node, right_node);
+        node = perform_type_checking_and_create_node(operator_type, operator_name, node, right_node);
     }
 
     return node;
@@ -1035,17 +1035,16 @@ ASTNode *parse_relational(Scanner *scanner, char *function_name)
 {
     ASTNode *node = parse_additive(scanner, function_name);
 
-    while (current_token.type == TOKEN_LESS || current_token.type == TOKEN_LESS_EQUAL ||
-           current_token.type == TOKEN_GREATER || current_token.type == TOKEN_GREATER_EQUAL)
+    while (parser_state.current_token.type == TOKEN_LESS || parser_state.current_token.type == TOKEN_LESS_EQUAL ||
+           parser_state.current_token.type == TOKEN_GREATER || parser_state.current_token.type == TOKEN_GREATER_EQUAL)
     {
-        const char *operator_name = current_token.lexeme;
-        current_token = get_next_token(scanner);
+        TokenType operator_type = parser_state.current_token.type;
+        const char *operator_name = parser_state.current_token.lexeme;
+        parser_state.current_token = get_next_token(scanner);
         ASTNode *right_node = parse_additive(scanner, function_name);
 
         // Perform type checking and create a node
-        node = perform_type_checking_and_create_node(operator_name, node, right_node);
-        // Set the result type to TYPE_BOOL
-        node->data_type = TYPE_BOOL;
+        node = perform_type_checking_and_create_node(operator_type, operator_name, node, right_node);
     }
 
     return node;
@@ -1055,15 +1054,14 @@ ASTNode *parse_equality(Scanner *scanner, char *function_name)
 {
     ASTNode *node = parse_relational(scanner, function_name);
 
-    while (current_token.type == TOKEN_EQUAL || current_token.type == TOKEN_NOT_EQUAL)
+    while (parser_state.current_token.type == TOKEN_EQUAL || parser_state.current_token.type == TOKEN_NOT_EQUAL)
     {
-        const char *operator_name = current_token.lexeme;
-        current_token = get_next_token(scanner);
+        TokenType operator_type = parser_state.current_token.type;
+        const char *operator_name = parser_state.current_token.lexeme;
+        parser_state.current_token = get_next_token(scanner);
         ASTNode *right_node = parse_relational(scanner, function_name);
         // Perform type checking and create a node
-        node = perform_type_checking_and_create_node(operator_name, node, right_node);
-        // Set the result type to TYPE_BOOL
-        node->data_type = TYPE_BOOL;
+        node = perform_type_checking_and_create_node(operator_type, operator_name, node, right_node);
     }
 
     return node;
@@ -1079,39 +1077,40 @@ ASTNode *parse_expression(Scanner *scanner, char *function_name)
  */
 ASTNode *parse_primary_expression(Scanner *scanner, char *function_name)
 {
-    if (current_token.type == TOKEN_INT_LITERAL)
+    if (parser_state.current_token.type == TOKEN_INT_LITERAL)
     {
-        char *value = string_duplicate(current_token.lexeme);
+        char *value = string_duplicate(parser_state.current_token.lexeme);
         ASTNode *literal_node = create_literal_node(TYPE_INT, value);
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return literal_node;
     }
-    else if (current_token.type == TOKEN_FLOAT_LITERAL)
+    else if (parser_state.current_token.type == TOKEN_FLOAT_LITERAL)
     {
-        char *value = string_duplicate(current_token.lexeme);
+        char *value = string_duplicate(parser_state.current_token.lexeme);
         ASTNode *literal_node = create_literal_node(TYPE_FLOAT, value);
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return literal_node;
     }
-    else if (current_token.type == TOKEN_STRING_LITERAL)
+    else if (parser_state.current_token.type == TOKEN_STRING_LITERAL)
     {
-        char *value = string_duplicate(current_token.lexeme);
-        ASTNode *literal_node = create_literal_node(TYPE_U8, value);
-        current_token = get_next_token(scanner);
+        StringPoolEntry *literal = string_pool_intern(parser_state.current_token.lexeme);
+        ASTNode *literal_node = create_literal_node(TYPE_U8, literal->text);
+        literal_node->literal = literal; // codegen takes the escaped form from here
+        parser_state.current_token = get_next_token(scanner);
         return literal_node;
     }
-    else if (current_token.type == TOKEN_IDENTIFIER)
+    else if (parser_state.current_token.type == TOKEN_IDENTIFIER)
     {
         char *identifier_name = NULL;
         Symbol *symbol = NULL;
-        bool is_builtin = is_builtin_function(current_token.lexeme, scanner);
+        bool is_builtin = is_builtin_function(parser_state.current_token.lexeme, scanner);
         if (is_builtin)
         {
             return parse_builtin_function_call(scanner, symbol, identifier_name, function_name);
         }
         else
         {
-            symbol = symtable_search(&symtable, current_token.lexeme);
+            symbol = symtable_search(&parser_state.symtable, parser_state.current_token.lexeme);
 
             if (symbol != NULL && symbol->symbol_type == SYMBOL_FUNCTION)
             {
@@ -1123,18 +1122,18 @@ ASTNode *parse_primary_expression(Scanner *scanner, char *function_name)
             }
         }
     }
-    else if (current_token.type == TOKEN_LEFT_PAREN)
+    else if (parser_state.current_token.type == TOKEN_LEFT_PAREN)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         ASTNode *expr_node = parse_expression(scanner, function_name);
         expect_token(TOKEN_RIGHT_PAREN, scanner);
         return expr_node;
     }
-    else if (current_token.type == TOKEN_NULL)
+    else if (parser_state.current_token.type == TOKEN_NULL)
     {
-        char *value = string_duplicate(current_token.lexeme);
+        char *value = string_duplicate(parser_state.current_token.lexeme);
         ASTNode *literal_node = create_literal_node(TYPE_NULL, value);
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return literal_node;
     }
     else
@@ -1150,28 +1149,28 @@ ASTNode *parse_import(Scanner *scanner)
 {
     expect_token(TOKEN_CONST, scanner);
 
-    if (current_token.type != TOKEN_IDENTIFIER || strcmp(current_token.lexeme, "ifj") != 0)
+    if (parser_state.current_token.type != TOKEN_IDENTIFIER || strcmp(parser_state.current_token.lexeme, "ifj") != 0)
     {
         error_exit(ERR_SYNTAX, "Expected identifier 'ifj'.");
     }
-    current_token = get_next_token(scanner);
+    parser_state.current_token = get_next_token(scanner);
 
     expect_token(TOKEN_ASSIGN, scanner);
 
-    if (current_token.type != TOKEN_IMPORT)
+    if (parser_state.current_token.type != TOKEN_IMPORT)
     {
         error_exit(ERR_SYNTAX, "Expected '@import'.");
     }
-    current_token = get_next_token(scanner);
+    parser_state.current_token = get_next_token(scanner);
 
     expect_token(TOKEN_LEFT_PAREN, scanner);
 
-    if (current_token.type != TOKEN_STRING_LITERAL || strcmp(current_token.lexeme, "ifj24.zig") != 0)
+    if (parser_state.current_token.type != TOKEN_STRING_LITERAL || strcmp(parser_state.current_token.lexeme, "ifj24.zig") != 0)
     {
-        error_exit(ERR_SYNTAX, "Expected string literal \"ifj24.zig\". Got: %s", current_token.lexeme);
+        error_exit(ERR_SYNTAX, "Expected string literal \"ifj24.zig\". Got: %s", parser_state.current_token.lexeme);
     }
-    char *import_value = string_duplicate(current_token.lexeme);
-    current_token = get_next_token(scanner);
+    char *import_value = string_duplicate(parser_state.current_token.lexeme);
+    parser_state.current_token = get_next_token(scanner);
 
     expect_token(TOKEN_RIGHT_PAREN, scanner);
 
@@ -1189,15 +1188,15 @@ ASTNode *parse_import(Scanner *scanner)
  */
 ASTNode *parse_builtin_function_call(Scanner *scanner, Symbol *symbol, char *identifier_name, char *function_name)
 {
-    identifier_name = construct_builtin_name("ifj", current_token.lexeme);
-    symbol = symtable_search(&symtable, identifier_name);
+    identifier_name = construct_builtin_name("ifj", parser_state.current_token.lexeme);
+    symbol = symtable_search(&parser_state.symtable, identifier_name);
     if (symbol == NULL)
     {
         error_exit(ERR_SEMANTIC_UNDEF, "Undefined builtin function");
     }
-    char *builtin_function_name = string_duplicate(current_token.lexeme);
+    char *builtin_function_name = string_duplicate(parser_state.current_token.lexeme);
 
-    current_token = get_next_token(scanner);
+    parser_state.current_token = get_next_token(scanner);
 
     expect_token(TOKEN_LEFT_PAREN, scanner);
 
@@ -1207,7 +1206,7 @@ ASTNode *parse_builtin_function_call(Scanner *scanner, Symbol *symbol, char *ide
     int builtin_index = get_builtin_function_index(builtin_function_name);
     int params_count = builtin_functions[builtin_index].param_count;
 
-    if (current_token.type != TOKEN_RIGHT_PAREN)
+    if (parser_state.current_token.type != TOKEN_RIGHT_PAREN)
     {
         arguments =  parse_arguments(scanner, symbol, arguments, params_count, &arg_count, function_name, builtin_function_name);
     }
@@ -1231,8 +1230,8 @@ ASTNode *parse_builtin_function_call(Scanner *scanner, Symbol *symbol, char *ide
  */
 ASTNode *parse_function_call(Scanner *scanner, Symbol *symbol, char *identifier_name, char *function_name)
 {
-    identifier_name = current_token.lexeme;
-    current_token = get_next_token(scanner);
+    identifier_name = parser_state.current_token.lexeme;
+    parser_state.current_token = get_next_token(scanner);
 
     expect_token(TOKEN_LEFT_PAREN, scanner);
 
@@ -1240,7 +1239,7 @@ ASTNode *parse_function_call(Scanner *scanner, Symbol *symbol, char *identifier_
     int params_count = symbol->declaration_node->param_count;
     int arg_count = 0;
 
-    if (current_token.type != TOKEN_RIGHT_PAREN)
+    if (parser_state.current_token.type != TOKEN_RIGHT_PAREN)
     {
         arguments = parse_arguments(scanner, symbol, arguments, params_count, &arg_count, function_name, NULL);
     }
@@ -1262,16 +1261,16 @@ ASTNode *parse_function_call(Scanner *scanner, Symbol *symbol, char *identifier_
  */
 ASTNode *parse_idendifier(Scanner *scanner, Symbol *symbol, char *identifier_name, char *function_name)
 {
-    symbol = search_variable_in_scopes(current_token.lexeme, function_name);
+    symbol = search_variable_in_scopes(parser_state.current_token.lexeme, function_name);
     if (symbol == NULL)
     {
-        error_exit(ERR_SEMANTIC_UNDEF, "Undefined variable or function. Got lexeme: %s. Line and column: %d %d\n", current_token.lexeme, current_token.line, current_token.column);
+        error_exit(ERR_SEMANTIC_UNDEF, "Undefined variable or function. Got lexeme: %s. Line and column: %d %d\n", parser_state.current_token.lexeme, parser_state.current_token.line, parser_state.current_token.column);
     }
     identifier_name = string_duplicate(symbol->name);
     ASTNode *identifier_node = create_identifier_node(identifier_name);
     identifier_node->data_type = symbol->data_type;
 
-    current_token = get_next_token(scanner);
+    parser_state.current_token = get_next_token(scanner);
     return identifier_node;
 }
 
@@ -1282,6 +1281,11 @@ ASTNode *parse_idendifier(Scanner *scanner, Symbol *symbol, char *identifier_nam
  */
 ASTNode **parse_arguments(Scanner *scanner, Symbol *symbol, ASTNode **arguments, int param_count, int *arg_count, char *function_name, char *builtin_function_name)
 {
+    // The first argument is checked against the first parameter
+    if (param_count == 0)
+    {
+        error_exit(ERR_SEMANTIC_PARAMS, "Too many arguments in function call to %s.", symbol->name);
+    }
 
     arguments = (ASTNode **)safe_malloc(sizeof(ASTNode *));
     arguments[(*arg_count)++] = parse_expression(scanner, function_name);
@@ -1290,10 +1294,10 @@ ASTNode **parse_arguments(Scanner *scanner, Symbol *symbol, ASTNode **arguments,
         error_exit(ERR_SEMANTIC_PARAMS, "Invalid type of arguments");
     }
 
-    while (current_token.type == TOKEN_COMMA)
+    while (parser_state.current_token.type == TOKEN_COMMA)
     {
-        current_token = get_next_token(scanner);
-        if (current_token.type == TOKEN_RIGHT_PAREN)
+        parser_state.current_token = get_next_token(scanner);
+        if (parser_state.current_token.type == TOKEN_RIGHT_PAREN)
             break;
         if (*arg_count >= param_count)
         {
@@ -1349,9 +1353,9 @@ bool is_builtin_function(const char *identifier, Scanner *scanner)
     {
         return false;
     }
-    current_token = get_next_token(scanner);
+    parser_state.current_token = get_next_token(scanner);
     expect_token(TOKEN_DOT, scanner);
-    identifier = current_token.lexeme;
+    identifier = parser_state.current_token.lexeme;
     for (size_t i = 0; i < sizeof(builtin_functions) / sizeof(builtin_functions[0]); i++)
     {
         if (strcmp(identifier, builtin_functions[i].name) == 0)
@@ -1402,11 +1406,11 @@ void scope_check_identifiers_in_tree(ASTNode *root)
     // If it is identifier - check it
     if ((root->type == NODE_IDENTIFIER || root->type == NODE_ASSIGNMENT) && strcmp(root->name, "_") != 0)
     {
-        Symbol *symbol = symtable_search(&symtable, root->name);
+        Symbol *symbol = symtable_search(&parser_state.symtable, root->name);
         ASTNode *declaration_node;
         if (symbol->symbol_type == SYMBOL_PARAMETER)
         {
-            Symbol *parent_function = symtable_search(&symtable, symbol->parent_function);
+            Symbol *parent_function = symtable_search(&parser_state.symtable, symbol->parent_function);
             declaration_node = parent_function->declaration_node;
             bool found = scope_check(declaration_node, root);
             if (!found)
@@ -1476,13 +1480,17 @@ bool scope_check(ASTNode *node_decl, ASTNode *node_identifier)
 void parse_functions_declaration(Scanner *scanner, ASTNode *program_node)
 {
     Scanner saved_scanner_state = *scanner;
-    FILE saved_input = *scanner->input;
-    Token saved_token = current_token;
+    long saved_position = ftell(scanner->input);
+    Token saved_token = parser_state.current_token;
+    if (saved_position < 0)
+    {
+        error_exit(ERR_INTERNAL, "Source file is not seekable.");
+    }
 
     ASTNode *current_function = NULL;
-    while (current_token.type != TOKEN_EOF)
+    while (parser_state.current_token.type != TOKEN_EOF)
     {
-        if ((current_token.type == TOKEN_PUB) || (current_token.type == TOKEN_FN))
+        if ((parser_state.current_token.type == TOKEN_PUB) || (parser_state.current_token.type == TOKEN_FN))
         {
             ASTNode *function_node = parse_function(scanner, false);
             if (program_node->body == NULL)
@@ -1497,12 +1505,15 @@ void parse_functions_declaration(Scanner *scanner, ASTNode *program_node)
         }
         else
         {
-            error_exit(ERR_SYNTAX, "Expected function definition. Line: %d, Column: %d", current_token.line, current_token.column);
+            error_exit(ERR_SYNTAX, "Expected function definition. Line: %d, Column: %d", parser_state.current_token.line, parser_state.current_token.column);
         }
     }
     *scanner = saved_scanner_state;
-    *scanner->input = saved_input;
-    current_token = saved_token;
+    if (fseek(scanner->input, saved_position, SEEK_SET) != 0)
+    {
+        error_exit(ERR_INTERNAL, "Cannot rewind source file after pre-run.");
+    }
+    parser_state.current_token = saved_token;
 
     return;
 }
@@ -1512,47 +1523,47 @@ void parse_functions_declaration(Scanner *scanner, ASTNode *program_node)
  */
 DataType parse_type(Scanner *scanner)
 {
-    if (current_token.type == TOKEN_I32)
+    if (parser_state.current_token.type == TOKEN_I32)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return TYPE_INT;
     }
-    else if (current_token.type == TOKEN_F64)
+    else if (parser_state.current_token.type == TOKEN_F64)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return TYPE_FLOAT;
     }
-    else if (current_token.type == TOKEN_U8)
+    else if (parser_state.current_token.type == TOKEN_U8)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return TYPE_U8;
     }
-    else if (current_token.type == TOKEN_VOID)
+    else if (parser_state.current_token.type == TOKEN_VOID)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return TYPE_VOID;
     }
-    else if (current_token.type == TOKEN_ASSIGN)
+    else if (parser_state.current_token.type == TOKEN_ASSIGN)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return TYPE_UNKNOWN;
     }
-    else if (current_token.type == TOKEN_QUESTION)
+    else if (parser_state.current_token.type == TOKEN_QUESTION)
     {
-        current_token = get_next_token(scanner);
-        if (current_token.type == TOKEN_I32)
+        parser_state.current_token = get_next_token(scanner);
+        if (parser_state.current_token.type == TOKEN_I32)
         {
-            current_token = get_next_token(scanner);
+            parser_state.current_token = get_next_token(scanner);
             return TYPE_INT_NULLABLE;
         }
-        else if (current_token.type == TOKEN_F64)
+        else if (parser_state.current_token.type == TOKEN_F64)
         {
-            current_token = get_next_token(scanner);
+            parser_state.current_token = get_next_token(scanner);
             return TYPE_FLOAT_NULLABLE;
         }
-        else if (current_token.type == TOKEN_U8)
+        else if (parser_state.current_token.type == TOKEN_U8)
         {
-            current_token = get_next_token(scanner);
+            parser_state.current_token = get_next_token(scanner);
             return TYPE_U8_NULLABLE;
         }
     }
@@ -1564,42 +1575,42 @@ DataType parse_type(Scanner *scanner)
 // Function to parse the return type (same as parameter type parsing)
 DataType parse_return_type(Scanner *scanner)
 {
-    if (current_token.type == TOKEN_I32)
+    if (parser_state.current_token.type == TOKEN_I32)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return TYPE_INT;
     }
-    else if (current_token.type == TOKEN_F64)
+    else if (parser_state.current_token.type == TOKEN_F64)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return TYPE_FLOAT;
     }
-    else if (current_token.type == TOKEN_U8)
+    else if (parser_state.current_token.type == TOKEN_U8)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return TYPE_U8;
     }
-    else if (current_token.type == TOKEN_VOID)
+    else if (parser_state.current_token.type == TOKEN_VOID)
     {
-        current_token = get_next_token(scanner);
+        parser_state.current_token = get_next_token(scanner);
         return TYPE_VOID;
     }
-    else if (current_token.type == TOKEN_QUESTION)
+    else if (parser_state.current_token.type == TOKEN_QUESTION)
     {
-        current_token = get_next_token(scanner);
-        if (current_token.type == TOKEN_I32)
+        parser_state.current_token = get_next_token(scanner);
+        if (parser_state.current_token.type == TOKEN_I32)
         {
-            current_token = get_next_token(scanner);
+            parser_state.current_token = get_next_token(scanner);
             return TYPE_INT_NULLABLE;
         }
-        else if (current_token.type == TOKEN_F64)
+        else if (parser_state.current_token.type == TOKEN_F64)
         {
-            current_token = get_next_token(scanner);
+            parser_state.current_token = get_next_token(scanner);
             return TYPE_FLOAT_NULLABLE;
         }
-        else if (current_token.type == TOKEN_U8)
+        else if (parser_state.current_token.type == TOKEN_U8)
         {
-            current_token = get_next_token(scanner);
+            parser_state.current_token = get_next_token(scanner);
             return TYPE_U8_NULLABLE;
         }
     }
@@ -1689,14 +1700,16 @@ void check_return_types(ASTNode *function_node, DataType return_type, int *block
 {
     if (return_type == TYPE_VOID)
     {
-        if (function_node != NULL)
+        // Empty body
+        if (function_node == NULL)
         {
-            if (function_node->type == NODE_RETURN)
+            return;
+        }
+        if (function_node->type == NODE_RETURN)
+        {
+            if (function_node->data_type != TYPE_VOID)
             {
-                if (function_node->data_type != TYPE_VOID)
-                {
-                    error_exit(ERR_SEMANTIC_RETURN, "Function VOID expects return(void)");
-                }
+                error_exit(ERR_SEMANTIC_RETURN, "Function VOID expects return(void)");
             }
         }
         if (function_node->body != NULL)
@@ -1727,58 +1740,14 @@ void check_return_types(ASTNode *function_node, DataType return_type, int *block
 }
 
 
-bool can_assign_type(DataType expected_type, DataType actual_type)
-{
-    if (expected_type == actual_type)
-        return true;
-
-    // Allowing implicit conversion from int to float
-    if (expected_type == TYPE_FLOAT && actual_type == TYPE_INT)
-        return true;
-
-    // Allow assignment of a non-nullable value to a nullable variable
-    if (is_nullable(expected_type) && !is_nullable(actual_type) && detach_nullable(expected_type) == actual_type)
-        return true;
-
-    // We do not allow the assignment of a nullable value to a non-nullable variable
-    if (!is_nullable(expected_type) && is_nullable(actual_type))
-        return false;
-
-    // Allow assignment of null to nullable variable
-    if (is_nullable(expected_type) && actual_type == TYPE_NULL)
-        return true;
-
-    return false;
-}
-
-bool is_nullable(DataType type_nullable)
-{
-    return (type_nullable == TYPE_INT_NULLABLE || type_nullable == TYPE_FLOAT_NULLABLE || type_nullable == TYPE_U8_NULLABLE);
-}
-
-/**
- * Function that detaches nullable from type
- */
-DataType detach_nullable(DataType type_nullable)
-{
-    if (type_nullable == TYPE_INT_NULLABLE)
-        type_nullable = TYPE_INT;
-    else if (type_nullable == TYPE_FLOAT_NULLABLE)
-        type_nullable = TYPE_FLOAT;
-    else if (type_nullable == TYPE_U8_NULLABLE)
-        type_nullable = TYPE_U8;
-
-    return type_nullable;
-}
-
 /**
  *  Function to expect a specific token type
  */
 static void expect_token(TokenType expected_type, Scanner *scanner)
 {
-    if (current_token.type != expected_type)
+    if (parser_state.current_token.type != expected_type)
     {
-        error_exit(ERR_SYNTAX, "Unexpected token. Expected: %d, got: %d\nLine and column: %d %d\n", expected_type, current_token.type, current_token.line, current_token.column);
+        error_exit(ERR_SYNTAX, "Unexpected token. Expected: %d, got: %d\nLine and column: %d %d\n", expected_type, parser_state.current_token.type, parser_state.current_token.line, parser_state.current_token.column);
     }
-    current_token = get_next_token(scanner);
+    parser_state.current_token = get_next_token(scanner);
 }
\ No newline at end of file
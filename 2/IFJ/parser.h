@@ -19,6 +19,7 @@
 #include "symtable.h"
 #include "ast.h"
 #include "scanner.h"
+#include "type_rules.h"
 #include "string.h"
 #include "error.h"
 #include "scanner.h"
@@ -26,12 +27,43 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#define MAX_SCOPE_DEPTH 100
+
+/**
+ * State of the parser for one compilation (part of CompilerContext).
+ */
+typedef struct {
+    SymTable symtable;                 // Global symbol table for the program
+    int scope_stack[MAX_SCOPE_DEPTH];
+    int scope_stack_top;
+    int scope_counter;
+    Token current_token;               // Global token storage
+} ParserState;
+
 // Initializes the parser
 void parser_init(Scanner *scanner);
 
+// Resets the parser state before the next compilation in the same process
+void parser_reset(void);
+
+// Called for every function in streaming mode once it passed all checks,
+// storage_mark is the pointer storage mark taken before the function was parsed
+typedef void (*FunctionEmitter)(ASTNode *function_node, size_t storage_mark);
+
 // Starts parsing the input program
 ASTNode* parse_program(Scanner *scanner);
 
+// Parses the program and hands every function to emit_function right after it is parsed
+ASTNode *parse_program_streaming(Scanner *scanner, FunctionEmitter emit_function);
+
+// Removes parameters and variables of an emitted function from the symtable
+void parser_forget_function(ASTNode *function_node);
+
+// Single parts of a program for the incremental analysis, the parser must be initialized at their first token
+ASTNode *parse_program_import(Scanner *scanner);
+ASTNode *parse_function_declaration(Scanner *scanner);
+ASTNode *parse_function_definition(Scanner *scanner, ASTNode *declaration_node);
+
 bool check_arguments_compability(Symbol *symbol, ASTNode **arguments, int *arg_count, char *builtin_function_name);
 
 int get_builtin_function_index(const char *function_name);
@@ -40,8 +72,6 @@ int get_builtin_function_index(const char *function_name);
 DataType parse_type(Scanner *scanner);
 DataType parse_return_type(Scanner *scanner);
 
-DataType detach_nullable(DataType type_nullable);
-
 // Return types check
 void check_return_types(ASTNode *function_node, DataType return_type, int *block_layer);
 bool check_return_types_recursive(ASTNode *function_node, DataType return_type);
@@ -53,13 +83,10 @@ bool scope_check(ASTNode *node_decl, ASTNode *node_identifier);
 
 void parse_functions_declaration(Scanner *scanner, ASTNode *program_node);
 bool type_convertion(ASTNode *main_node);
-bool can_assign_type(DataType expected_type, DataType actual_type);
-DataType detach_nullable(DataType type_nullable);
 int get_builtin_function_index(const char *function_name);
 
 bool is_builtin_function(const char *identifier, Scanner *scanner);
 ASTNode *convert_to_float_node(ASTNode *node);
-bool is_nullable(DataType type_nullable);
 
 size_t get_num_builtin_functions();
 
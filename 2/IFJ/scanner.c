@@ -16,6 +16,7 @@
 #include "error.h"
 #include "tokens.h"
 #include "utils.h"
+#include "timing.h"
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +25,24 @@
 
 #define MAX_LEXEME_LENGTH 256
 
+/**
+ * Reads the next character, counting the characters consumed
+ */
+static int read_char(Scanner *scanner)
+{
+    scanner->offset++;
+    return fgetc(scanner->input);
+}
+
+/**
+ * Puts a character read by read_char back to the input
+ */
+static void unread_char(Scanner *scanner, int c)
+{
+    scanner->offset--;
+    ungetc(c, scanner->input);
+}
+
 // Function prototypes
 static void skip_whitespace_and_comments(Scanner *scanner);
 static Token scan_identifier_or_keyword(Scanner *scanner);
@@ -63,19 +82,19 @@ static void skip_whitespace_and_comments(Scanner *scanner)
             {
                 scanner->column++;
             }
-            scanner->current_char = fgetc(scanner->input);
+            scanner->current_char = read_char(scanner);
         }
 
         // Check for comments
         if (scanner->current_char == '/')
         {
-            int next_char = fgetc(scanner->input);
+            int next_char = read_char(scanner);
             if (next_char == '/')
             {
                 // Single-line comment, skip until end of line
                 while (scanner->current_char != '\n' && scanner->current_char != EOF)
                 {
-                    scanner->current_char = fgetc(scanner->input);
+                    scanner->current_char = read_char(scanner);
                     scanner->column++;
                 }
                 continue; // Continue skipping whitespace and comments
@@ -83,7 +102,7 @@ static void skip_whitespace_and_comments(Scanner *scanner)
             else
             {
                 // Not a comment, return the character
-                ungetc(next_char, scanner->input);
+                unread_char(scanner, next_char);
                 skipping = false;
             }
         }
@@ -154,7 +173,7 @@ static Token scan_identifier_or_keyword(Scanner *scanner)
     {
         check_buffer_length(index);
         lexeme_buffer[index++] = scanner->current_char;
-        scanner->current_char = fgetc(scanner->input);
+        scanner->current_char = read_char(scanner);
         scanner->column++;
     }
     if (index == 0)
@@ -176,7 +195,7 @@ static void read_digits(Scanner *scanner, char *buffer, int *index)
     {
         check_buffer_length(*index);
         buffer[(*index)++] = scanner->current_char;
-        scanner->current_char = fgetc(scanner->input);
+        scanner->current_char = read_char(scanner);
         scanner->column++;
     }
 }
@@ -187,7 +206,7 @@ static void read_digits(Scanner *scanner, char *buffer, int *index)
 static void handle_exponent(Scanner *scanner, char *buffer, int *index)
 {
     buffer[(*index)++] = scanner->current_char;
-    scanner->current_char = fgetc(scanner->input);
+    scanner->current_char = read_char(scanner);
     scanner->column++;
 
     // Optional '+' or '-'
@@ -195,7 +214,7 @@ static void handle_exponent(Scanner *scanner, char *buffer, int *index)
     {
         check_buffer_length(*index);
         buffer[(*index)++] = scanner->current_char;
-        scanner->current_char = fgetc(scanner->input);
+        scanner->current_char = read_char(scanner);
         scanner->column++;
     }
 
@@ -226,7 +245,7 @@ static Token scan_number_literal(Scanner *scanner)
         is_float = 1;
         check_buffer_length(index);
         number_buffer[index++] = scanner->current_char;
-        scanner->current_char = fgetc(scanner->input);
+        scanner->current_char = read_char(scanner);
         scanner->column++;
 
         // At least one digit required after the decimal point
@@ -268,7 +287,7 @@ static Token scan_number_literal(Scanner *scanner)
  */
 static char handle_escape_sequence(Scanner *scanner)
 {
-    scanner->current_char = fgetc(scanner->input);
+    scanner->current_char = read_char(scanner);
     scanner->column++;
 
     switch (scanner->current_char)
@@ -283,7 +302,7 @@ static char handle_escape_sequence(Scanner *scanner)
         char hex_digits[3] = {0};
         for (int i = 0; i < 2; i++)
         {
-            scanner->current_char = fgetc(scanner->input);
+            scanner->current_char = read_char(scanner);
             scanner->column++;
             if (!isxdigit(scanner->current_char))
             {
@@ -307,7 +326,7 @@ static Token scan_string_literal(Scanner *scanner)
     char string_buffer[MAX_LEXEME_LENGTH];
     int index = 0;
 
-    scanner->current_char = fgetc(scanner->input); // Skip the opening quote
+    scanner->current_char = read_char(scanner); // Skip the opening quote
     scanner->column++;
 
     while (scanner->current_char != '"' && scanner->current_char != EOF)
@@ -331,7 +350,7 @@ static Token scan_string_literal(Scanner *scanner)
             string_buffer[index++] = scanner->current_char;
         }
 
-        scanner->current_char = fgetc(scanner->input);
+        scanner->current_char = read_char(scanner);
         scanner->column++;
     }
 
@@ -340,7 +359,7 @@ static Token scan_string_literal(Scanner *scanner)
         error_exit(ERR_LEXICAL, "Unterminated string literal.");
     }
 
-    scanner->current_char = fgetc(scanner->input); // Skip the closing quote
+    scanner->current_char = read_char(scanner); // Skip the closing quote
     scanner->column++;
 
     string_buffer[index] = '\0';
@@ -368,7 +387,7 @@ static Token create_simple_token(Scanner *scanner, TokenType type)
     token.lexeme[0] = scanner->current_char;
     token.lexeme[1] = '\0';
 
-    scanner->current_char = fgetc(scanner->input);
+    scanner->current_char = read_char(scanner);
     scanner->column++;
 
     return token;
@@ -395,21 +414,21 @@ static Token scan_operator_or_delimiter(Scanner *scanner)
         return create_simple_token(scanner, TOKEN_DIVIDE);
     case '=':
     {
-        int next_char = fgetc(scanner->input);
+        int next_char = read_char(scanner);
         scanner->column++;
         if (next_char == '=')
         {
             token.type = TOKEN_EQUAL;
             token.lexeme = string_duplicate("==");
-            scanner->current_char = fgetc(scanner->input);
+            scanner->current_char = read_char(scanner);
             scanner->column++;
         }
         else
         {
-            ungetc(next_char, scanner->input);
+            unread_char(scanner, next_char);
             token.lexeme = string_duplicate("=");
             token.type = TOKEN_ASSIGN;
-            scanner->current_char = fgetc(scanner->input);
+            scanner->current_char = read_char(scanner);
             scanner->column++;
         }
         return token;
@@ -430,42 +449,42 @@ static Token scan_operator_or_delimiter(Scanner *scanner)
         return create_simple_token(scanner, TOKEN_SEMICOLON);
     case '<':
     {
-        int next_char = fgetc(scanner->input);
+        int next_char = read_char(scanner);
         scanner->column++;
         if (next_char == '=')
         {
             token.type = TOKEN_LESS_EQUAL;
             token.lexeme = string_duplicate("<=");
-            scanner->current_char = fgetc(scanner->input);
+            scanner->current_char = read_char(scanner);
             scanner->column++;
         }
         else
         {
-            ungetc(next_char, scanner->input);
+            unread_char(scanner, next_char);
             token.lexeme = string_duplicate("<");
             token.type = TOKEN_LESS;
-            scanner->current_char = fgetc(scanner->input);
+            scanner->current_char = read_char(scanner);
             scanner->column++;
         }
         return token;
     }
     case '>':
     {
-        int next_char = fgetc(scanner->input);
+        int next_char = read_char(scanner);
         scanner->column++;
         if (next_char == '=')
         {
             token.type = TOKEN_GREATER_EQUAL;
             token.lexeme = string_duplicate(">=");
-            scanner->current_char = fgetc(scanner->input);
+            scanner->current_char = read_char(scanner);
             scanner->column++;
         }
         else
         {
-            ungetc(next_char, scanner->input);
+            unread_char(scanner, next_char);
             token.lexeme = string_duplicate(">");
             token.type = TOKEN_GREATER;
-            scanner->current_char = fgetc(scanner->input);
+            scanner->current_char = read_char(scanner);
             scanner->column++;
         }
         return token;
@@ -478,13 +497,13 @@ static Token scan_operator_or_delimiter(Scanner *scanner)
         return create_simple_token(scanner, TOKEN_QUESTION);
     case '!':
     {
-        int next_char = fgetc(scanner->input);
+        int next_char = read_char(scanner);
         scanner->column++;
         if (next_char == '=')
         {
             token.type = TOKEN_NOT_EQUAL;
             token.lexeme = string_duplicate("!=");
-            scanner->current_char = fgetc(scanner->input);
+            scanner->current_char = read_char(scanner);
             scanner->column++;
         }
         else
@@ -509,6 +528,10 @@ static Token get_next_token_internal(Scanner *scanner)
 {
     skip_whitespace_and_comments(scanner);
 
+    // The current character was the last one read
+    scanner->token_offset = scanner->offset - 1;
+    scanner->token_column = scanner->column;
+
     if (scanner->current_char == EOF)
     {
         Token token;
@@ -542,7 +565,11 @@ static Token get_next_token_internal(Scanner *scanner)
  */
 Token get_next_token(Scanner *scanner)
 {
-    return get_next_token_internal(scanner);
+    // Called once per token, so only a sample of the calls reads the clocks (timing.c)
+    bool sampled = timing_begin_sampled(PHASE_SCANNER);
+    Token token = get_next_token_internal(scanner);
+    timing_end_sampled(PHASE_SCANNER, sampled);
+    return token;
 }
 
 /**
@@ -550,12 +577,45 @@ Token get_next_token(Scanner *scanner)
  */
 void scanner_init(FILE *input_file, Scanner *scanner)
 {
+    // The pre-run rewinds the input, copy pipes (stdin) into a seekable temporary file
+    scanner->input_copy = NULL;
+    if (fseek(input_file, 0, SEEK_CUR) != 0)
+    {
+        FILE *copy = tmpfile();
+        if (copy == NULL)
+        {
+            error_exit(ERR_INTERNAL, "Cannot create temporary file for the source.");
+        }
+        int c;
+        while ((c = fgetc(input_file)) != EOF)
+        {
+            fputc(c, copy);
+        }
+        rewind(copy);
+        input_file = copy;
+        scanner->input_copy = copy;
+    }
     scanner->input = input_file;
-    scanner->current_char = fgetc(scanner->input);
+    scanner->offset = 0;
+    scanner->token_offset = 0;
+    scanner->token_column = 1;
+    scanner->current_char = read_char(scanner);
     scanner->column = 1;
     scanner->line = 1;
 }
 
+/**
+ * Close the temporary copy of a piped input
+ */
+void scanner_close(Scanner *scanner)
+{
+    if (scanner->input_copy != NULL)
+    {
+        fclose(scanner->input_copy);
+        scanner->input_copy = NULL;
+    }
+}
+
 /**
  * Free the memory occupied by a token
  */
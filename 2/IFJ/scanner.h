@@ -26,11 +26,18 @@ typedef struct {
     int line;            
     int column;          
     int current_char;   
+    long offset;         // Characters read since scanner_init
+    long token_offset;   // Offset of the first character of the last token
+    int token_column;    // Column where the last token starts
+    FILE *input_copy;    // Seekable copy of a piped input, closed by scanner_close
 } Scanner;
 
 // Scanner initialization function
 void scanner_init(FILE *input_file, Scanner *scanner);
 
+// Closes the copy of a piped input, the input itself belongs to the caller
+void scanner_close(Scanner *scanner);
+
 // Public function to get the next token
 Token get_next_token();
 
@@ -0,0 +1,283 @@
+/**
+ * @file server.c
+ *
+ * Implementation of the compile server.
+ * Requests are handled one at a time. The source is read from memory, the
+ * generated code is written to a memory stream and stderr is redirected into
+ * a temporary file, so the client gets exactly what the command line
+ * compiler would print. error_exit jumps back here instead of ending the
+ * process and compiler_reset clears the global state after every request.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "server.h"
+#include "server_io.h"
+#include "compiler.h"
+#include "error.h"
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * Reads the whole content of a temporary file into a malloc'd buffer.
+ */
+static char *read_stream(FILE *stream, size_t *size)
+{
+    fflush(stream);
+    long length = ftell(stream);
+    char *data = malloc(length > 0 ? (size_t)length : 1);
+    *size = 0;
+    if (data != NULL && length > 0)
+    {
+        rewind(stream);
+        *size = fread(data, 1, (size_t)length, stream);
+    }
+    return data;
+}
+
+/**
+ * Opens the source of a request as a seekable stream.
+ */
+static FILE *open_source(char *source, size_t size)
+{
+    if (size == 0)
+    {
+        // fmemopen does not accept an empty buffer
+        return tmpfile();
+    }
+    return fmemopen(source, size, "r");
+}
+
+/**
+ * Reads the --emit-ast or --ast-cache path of a request into a malloc'd string.
+ * A path that is empty, too long or contains a zero byte is refused.
+ */
+static char *read_path(int fd)
+{
+    uint32_t length;
+    if (!read_u32(fd, &length) || length == 0 || length > SERVER_MAX_PATH_SIZE)
+    {
+        return NULL;
+    }
+    char *path = malloc(length + 1);
+    if (path == NULL || !read_exact(fd, path, length))
+    {
+        free(path);
+        return NULL;
+    }
+    path[length] = '\0';
+    if (strlen(path) != length)
+    {
+        free(path);
+        return NULL;
+    }
+    return path;
+}
+
+/**
+ * Compiles the source of one request with error_exit redirected back here.
+ * Output and stderr of the compilation end up in the given streams.
+ */
+static int compile_request(char *source, size_t source_size, uint32_t flags, const char *emit_ast,
+                           const char *ast_cache, FILE *output, FILE *errors)
+{
+    CompileOptions options = {
+        (flags & SERVER_FLAG_NULL_REPORT) != 0,
+        (flags & (SERVER_FLAG_TIME_PASSES | SERVER_FLAG_TIME_PASSES_JSON)) != 0,
+        (flags & SERVER_FLAG_TIME_PASSES_JSON) ? TIMING_FORMAT_JSON : TIMING_FORMAT_TABLE,
+        (flags & SERVER_FLAG_LOW_MEMORY) != 0,
+        (flags & SERVER_FLAG_TAIL_CALL_REPORT) != 0,
+        (flags & SERVER_FLAG_INSTRUMENT) != 0,
+        emit_ast,
+        ast_cache,
+        (flags & SERVER_FLAG_BINARY) != 0};
+
+    FILE *source_file = open_source(source, source_size);
+    if (source_file == NULL)
+    {
+        fprintf(errors, "ERROR %i: Cannot open the source of the request\n", ERR_INTERNAL);
+        return ERR_INTERNAL;
+    }
+
+    // stderr of the compiler is the temporary file for the duration of the request
+    fflush(stderr);
+    int saved_stderr = dup(STDERR_FILENO);
+    dup2(fileno(errors), STDERR_FILENO);
+
+    jmp_buf recovery;
+    int result;
+    if (setjmp(recovery) == 0)
+    {
+        error_set_recovery(&recovery);
+        result = compiler_compile(source_file, NULL, output, &options);
+    }
+    else
+    {
+        result = current_context->error_code;
+    }
+    error_set_recovery(NULL);
+
+    fflush(stderr);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stderr);
+
+    fclose(source_file);
+    compiler_reset();
+    return result;
+}
+
+/**
+ * Handles one connection: reads the request, compiles it and sends the response.
+ * Returns true if the client asked the server to shut down, such a request is not compiled.
+ */
+static bool handle_connection(int client)
+{
+    uint32_t flags;
+    uint32_t source_size;
+    if (!read_u32(client, &flags) || !read_u32(client, &source_size) || source_size > SERVER_MAX_SOURCE_SIZE)
+    {
+        return false;
+    }
+
+    char *source = malloc(source_size > 0 ? source_size : 1);
+    if (source == NULL || !read_exact(client, source, source_size))
+    {
+        free(source);
+        return false;
+    }
+
+    // Paths of the AST file options follow the source, the client made them absolute
+    char *emit_ast = NULL;
+    char *ast_cache = NULL;
+    if (((flags & SERVER_FLAG_EMIT_AST) && (emit_ast = read_path(client)) == NULL) ||
+        ((flags & SERVER_FLAG_AST_CACHE) && (ast_cache = read_path(client)) == NULL))
+    {
+        free(emit_ast);
+        free(source);
+        return false;
+    }
+
+    char *output_data = NULL;
+    size_t output_size = 0;
+    FILE *output = open_memstream(&output_data, &output_size);
+    FILE *errors = tmpfile();
+    int result = ERR_INTERNAL;
+
+    if (flags & SERVER_FLAG_SHUTDOWN)
+    {
+        // A shutdown request carries no source, it is only answered
+        result = ERR_OK;
+    }
+    else if (output != NULL && errors != NULL)
+    {
+        result = compile_request(source, source_size, flags, emit_ast, ast_cache, output, errors);
+    }
+    if (output != NULL)
+    {
+        fclose(output);
+    }
+
+    size_t errors_size = 0;
+    char *errors_data = errors != NULL ? read_stream(errors, &errors_size) : NULL;
+
+    if (!write_u32(client, (uint32_t)result) || !write_block(client, output_data, output_size) ||
+        !write_block(client, errors_data, errors_size))
+    {
+        fprintf(stderr, "Compile server: cannot send the response\n");
+    }
+
+    if (errors != NULL)
+    {
+        fclose(errors);
+    }
+    free(errors_data);
+    free(output_data);
+    free(ast_cache);
+    free(emit_ast);
+    free(source);
+    return (flags & SERVER_FLAG_SHUTDOWN) != 0;
+}
+
+/**
+ * Creates the listening socket, an old socket file on the same path is replaced.
+ */
+static int open_server_socket(const char *socket_path)
+{
+    struct sockaddr_un address;
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "Socket path is too long: %s\n", socket_path);
+        return -1;
+    }
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    unlink(socket_path);
+
+    if (bind(server, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(server, 64) < 0)
+    {
+        perror(socket_path);
+        close(server);
+        return -1;
+    }
+    return server;
+}
+
+/**
+ * Runs the server loop.
+ */
+int server_run(const char *socket_path)
+{
+    int server = open_server_socket(socket_path);
+    if (server < 0)
+    {
+        return ERR_INTERNAL;
+    }
+
+    // A client that disconnects early must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+    compiler_reset();
+
+    bool running = true;
+    while (running)
+    {
+        int client = accept(server, NULL, NULL);
+        if (client < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("accept");
+            break;
+        }
+        running = !handle_connection(client);
+        close(client);
+    }
+
+    close(server);
+    unlink(socket_path);
+    return ERR_OK;
+}
@@ -0,0 +1,44 @@
+/**
+ * @file server.h
+ *
+ * Header file for the compile server.
+ * The server listens on a local Unix socket and compiles one source per
+ * connection, so repeated compilations do not pay for process startup.
+ *
+ * Protocol, all numbers are 32-bit unsigned integers in network byte order:
+ *   request:  flags, source length, source bytes, then the length and bytes of
+ *             the --emit-ast path and of the --ast-cache path if their flags are set
+ *   response: exit code, output length, output bytes, stderr length, stderr bytes
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef SERVER_H
+#define SERVER_H
+
+#define SERVER_DEFAULT_SOCKET "/tmp/ifj24_compiler.sock"
+#define SERVER_SOCKET_ENV "IFJ24_SERVER_SOCKET" // Overrides the socket used by the client
+
+#define SERVER_MAX_SOURCE_SIZE (64u * 1024u * 1024u)
+#define SERVER_MAX_PATH_SIZE 4096u // Longest path of --emit-ast and --ast-cache, they are absolute
+
+// Request flags, they mirror the command line options
+#define SERVER_FLAG_NULL_REPORT 0x1u
+#define SERVER_FLAG_TIME_PASSES 0x2u
+#define SERVER_FLAG_TIME_PASSES_JSON 0x4u
+#define SERVER_FLAG_SHUTDOWN 0x8u // Stops the server after the response
+#define SERVER_FLAG_LOW_MEMORY 0x10u
+#define SERVER_FLAG_TAIL_CALL_REPORT 0x20u
+#define SERVER_FLAG_INSTRUMENT 0x40u
+#define SERVER_FLAG_BINARY 0x80u
+#define SERVER_FLAG_EMIT_AST 0x100u  // The request carries the path of --emit-ast
+#define SERVER_FLAG_AST_CACHE 0x200u // The request carries the path of --ast-cache
+
+// Serves compile requests on the socket until a shutdown request, returns the exit code
+int server_run(const char *socket_path);
+
+#endif // SERVER_H
@@ -0,0 +1,113 @@
+/**
+ * @file server_io.c
+ *
+ * Implementation of the wire format of the compile server.
+ * Every function retries interrupted calls and loops until the whole
+ * buffer is transferred, a short read means the peer closed the connection.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "server_io.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * Reads exactly size bytes, returns false on error or end of stream.
+ */
+bool read_exact(int fd, void *buffer, size_t size)
+{
+    char *position = buffer;
+    while (size > 0)
+    {
+        ssize_t count = read(fd, position, size);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return false;
+        }
+        position += count;
+        size -= (size_t)count;
+    }
+    return true;
+}
+
+/**
+ * Writes exactly size bytes, returns false on error.
+ */
+bool write_exact(int fd, const void *buffer, size_t size)
+{
+    const char *position = buffer;
+    while (size > 0)
+    {
+        ssize_t count = write(fd, position, size);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count < 0)
+        {
+            return false;
+        }
+        position += count;
+        size -= (size_t)count;
+    }
+    return true;
+}
+
+bool read_u32(int fd, uint32_t *value)
+{
+    unsigned char bytes[4];
+    if (!read_exact(fd, bytes, sizeof(bytes)))
+    {
+        return false;
+    }
+    *value = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+    return true;
+}
+
+bool write_u32(int fd, uint32_t value)
+{
+    unsigned char bytes[4] = {
+        (unsigned char)(value >> 24), (unsigned char)(value >> 16),
+        (unsigned char)(value >> 8), (unsigned char)value};
+    return write_exact(fd, bytes, sizeof(bytes));
+}
+
+/**
+ * Reads one length-prefixed block of the response into a malloc'd buffer.
+ */
+char *read_block(int fd, size_t *size)
+{
+    uint32_t length;
+    if (!read_u32(fd, &length))
+    {
+        return NULL;
+    }
+    char *data = malloc(length > 0 ? length : 1);
+    if (data == NULL || !read_exact(fd, data, length))
+    {
+        free(data);
+        return NULL;
+    }
+    *size = length;
+    return data;
+}
+
+/**
+ * Writes one length-prefixed block of the response.
+ */
+bool write_block(int fd, const char *data, size_t size)
+{
+    return write_u32(fd, (uint32_t)size) && (size == 0 || write_exact(fd, data, size));
+}
@@ -0,0 +1,39 @@
+/**
+ * @file server_io.h
+ *
+ * Header file for the wire format of the compile server.
+ * Reading and writing of whole buffers and of the 32-bit numbers and
+ * length-prefixed blocks of the protocol (server.h), shared by the server
+ * and its client (tools/ifj24_client.c).
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef SERVER_IO_H
+#define SERVER_IO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Reads exactly size bytes, returns false on error or end of stream
+bool read_exact(int fd, void *buffer, size_t size);
+
+// Writes exactly size bytes, returns false on error
+bool write_exact(int fd, const void *buffer, size_t size);
+
+// Reads and writes one 32-bit number in network byte order
+bool read_u32(int fd, uint32_t *value);
+bool write_u32(int fd, uint32_t value);
+
+// Reads one length-prefixed block into a malloc'd buffer, returns NULL on error
+char *read_block(int fd, size_t *size);
+
+// Writes one length-prefixed block
+bool write_block(int fd, const char *data, size_t size);
+
+#endif // SERVER_IO_H
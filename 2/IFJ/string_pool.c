@@ -0,0 +1,169 @@
+/**
+ * @file string_pool.c
+ *
+ * Implementation of the string literal pool.
+ * The pool is a hash table with separate chaining. New entries are put at the
+ * front of their bucket, so the entries of the last parsed function can be
+ * removed from the fronts again in low memory mode.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#include "string_pool.h"
+#include "compiler.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+
+// Literal pool of the compilation running in this thread
+#define string_pool_state (current_context->string_pool)
+
+#define STRING_POOL_INITIAL_BUCKETS 64
+
+/**
+ * Hash function for literals (djb2, same as the symbol table).
+ */
+static size_t string_pool_hash(const char *text)
+{
+    size_t hash = 5381;
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++)
+    {
+        hash = ((hash << 5) + hash) + *c; // hash * 33 + c
+    }
+    return hash;
+}
+
+/**
+ * Finds an entry with the given text.
+ */
+static StringPoolEntry *string_pool_find(const char *text)
+{
+    if (string_pool_state.bucket_count == 0)
+    {
+        return NULL;
+    }
+    size_t index = string_pool_hash(text) & (string_pool_state.bucket_count - 1);
+    for (StringPoolEntry *entry = string_pool_state.buckets[index]; entry != NULL; entry = entry->next)
+    {
+        if (strcmp(entry->text, text) == 0)
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Puts an entry at the front of its bucket.
+ */
+static void string_pool_link(StringPoolEntry *entry)
+{
+    size_t index = string_pool_hash(entry->text) & (string_pool_state.bucket_count - 1);
+    entry->next = string_pool_state.buckets[index];
+    string_pool_state.buckets[index] = entry;
+}
+
+/**
+ * Doubles the number of buckets once the pool holds more entries than buckets.
+ * Entries are linked again from the oldest one, so newer entries stay in front.
+ */
+static void string_pool_grow(void)
+{
+    size_t bucket_count = string_pool_state.bucket_count ? string_pool_state.bucket_count * 2 : STRING_POOL_INITIAL_BUCKETS;
+    StringPoolEntry **buckets = safe_malloc(bucket_count * sizeof(StringPoolEntry *));
+    memset(buckets, 0, bucket_count * sizeof(StringPoolEntry *));
+
+    safe_free(string_pool_state.buckets);
+    string_pool_state.buckets = buckets;
+    string_pool_state.bucket_count = bucket_count;
+    for (size_t i = 0; i < string_pool_state.entry_count; i++)
+    {
+        string_pool_link(string_pool_state.entries[i]);
+    }
+}
+
+/**
+ * Adds a literal to the pool, the escaped form is made once here.
+ */
+StringPoolEntry *string_pool_intern(const char *text)
+{
+    StringPoolEntry *entry = string_pool_find(text);
+    if (entry != NULL)
+    {
+        return entry;
+    }
+
+    if (string_pool_state.entry_count >= string_pool_state.bucket_count)
+    {
+        string_pool_grow();
+    }
+    if (string_pool_state.entry_count == string_pool_state.entry_capacity)
+    {
+        string_pool_state.entry_capacity = string_pool_state.entry_capacity ? string_pool_state.entry_capacity * 2 : STRING_POOL_INITIAL_BUCKETS;
+        string_pool_state.entries = safe_realloc(string_pool_state.entries,
+                                                 string_pool_state.entry_capacity * sizeof(StringPoolEntry *));
+    }
+
+    size_t storage_mark = pointers_storage_mark();
+    entry = safe_malloc(sizeof(StringPoolEntry));
+    entry->text = string_duplicate(text);
+    entry->escaped = escape_ifj24_string(text);
+    entry->storage_mark = storage_mark;
+    string_pool_link(entry);
+    string_pool_state.entries[string_pool_state.entry_count++] = entry;
+    return entry;
+}
+
+/**
+ * Removes the newest entries down to the storage mark. They are the first ones
+ * in their buckets, the memory itself is freed by release_pointers_since.
+ */
+void string_pool_release_since(size_t storage_mark)
+{
+    while (string_pool_state.entry_count > 0 &&
+           string_pool_state.entries[string_pool_state.entry_count - 1]->storage_mark >= storage_mark)
+    {
+        StringPoolEntry *entry = string_pool_state.entries[--string_pool_state.entry_count];
+        size_t index = string_pool_hash(entry->text) & (string_pool_state.bucket_count - 1);
+        string_pool_state.buckets[index] = entry->next;
+    }
+}
+
+/**
+ * Forgets the pool, the memory is released by cleanup_pointers_storage.
+ */
+void string_pool_reset(void)
+{
+    memset(&string_pool_state, 0, sizeof(string_pool_state));
+}
+
+/**
+ * Escapes special characters in a string for IFJcode24.
+ */
+char *escape_ifj24_string(const char *input)
+{
+    size_t length = strlen(input);
+    size_t buffer_size = length * 4 + 1; // Reserve space for escaping
+    char *escaped_string = safe_malloc(buffer_size);
+    size_t index = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = input[i];
+
+        if (c <= 32 || c == 35 || c == 92 || c >= 127) // ASCII 0-32, 35 (#), 92 (\), 127+ (non-printable)
+        {
+            index += snprintf(escaped_string + index, buffer_size - index, "\\%03d", c);
+        }
+        else
+        {
+            escaped_string[index++] = c;
+        }
+    }
+
+    escaped_string[index] = '\0';
+    return escaped_string;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file string_pool.h
+ *
+ * Header file for the string literal pool.
+ * Every distinct string literal of a compilation is stored once together with
+ * its IFJcode24 escaped form, so code generation does not escape it at every use.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <stddef.h>
+
+/** Interned literal */
+typedef struct StringPoolEntry {
+    char *text;                   // Literal as written in the AST
+    char *escaped;                // Text for the string@ operand of IFJcode24
+    size_t storage_mark;          // Pointer storage count when the entry was created
+    struct StringPoolEntry *next; // Entry in the same bucket, newer entries first
+} StringPoolEntry;
+
+/** Literal pool of one compilation (part of CompilerContext) */
+typedef struct {
+    StringPoolEntry **buckets;
+    size_t bucket_count;
+    StringPoolEntry **entries; // All entries in the order they were added
+    size_t entry_count;
+    size_t entry_capacity;
+} StringPoolState;
+
+// Adds a literal to the pool if it is not there yet, returns its entry
+StringPoolEntry *string_pool_intern(const char *text);
+
+// Removes the entries allocated after a pointer storage mark, before release_pointers_since frees them
+void string_pool_release_since(size_t storage_mark);
+
+// Forgets the pool of the previous compilation
+void string_pool_reset(void);
+
+// Escapes special characters of a string for IFJcode24, the result is allocated with safe_malloc
+char *escape_ifj24_string(const char *input);
+
+#endif // STRING_POOL_H
@@ -15,6 +15,7 @@
 #include "symtable.h"
 #include "error.h"
 #include "parser.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +25,10 @@
 
 extern BuiltinFunctionInfo builtin_functions[];
 
+// Table with "_" and the built-in functions, copied by symtable_init_builtins
+static SymTable builtin_symtable;
+static pthread_once_t builtin_symtable_once = PTHREAD_ONCE_INIT;
+
 static void symtable_grow(SymTable *symtable);
 
 /**
@@ -43,30 +48,75 @@ void symtable_init(SymTable *symtable)
 }
 
 /**
- * Loads the built-in functions into the symbol table.
+ * Builds the table with "_" and the built-in functions once per process.
+ * It is never freed and never changed, the names of its symbols are shared by every copy.
  */
-void load_builtin_functions(SymTable *symtable, ASTNode *import_node)
+static void build_builtin_symtable(void)
 {
     size_t num_functions = get_num_builtin_functions();
-    import_node = import_node;
+    builtin_symtable.size = INITIAL_SYMTABLE_SIZE;
+    builtin_symtable.table = (Symbol **)calloc(builtin_symtable.size, sizeof(Symbol *));
+    Symbol *symbols = (Symbol *)calloc(num_functions + 1, sizeof(Symbol));
+    if (builtin_symtable.table == NULL || symbols == NULL)
+    {
+        error_exit(ERR_INTERNAL, "Memory allocation failed");
+    }
+
+    symbols[0].name = "_";
+    symbols[0].symbol_type = SYMBOL_VARIABLE;
+    symbols[0].data_type = TYPE_ALL;
+    symbols[0].is_defined = true;
+    symbols[0].is_used = true;
+    symtable_insert(&builtin_symtable, "_", &symbols[0]);
+
     for (size_t i = 0; i < num_functions; i++)
     {
-        char *name_with_prefix = (char *)safe_malloc(strlen("ifj.") + strlen(builtin_functions[i].name) + 1);
+        char *name_with_prefix = (char *)malloc(strlen("ifj.") + strlen(builtin_functions[i].name) + 1);
+        if (name_with_prefix == NULL)
+        {
+            error_exit(ERR_INTERNAL, "Memory allocation failed");
+        }
         strcpy(name_with_prefix, "ifj.");
         strcat(name_with_prefix, builtin_functions[i].name);
 
-        Symbol *new_function = (Symbol *)safe_malloc(sizeof(Symbol));
+        Symbol *new_function = &symbols[i + 1];
         new_function->name = name_with_prefix;
         new_function->symbol_type = SYMBOL_FUNCTION;
         new_function->data_type = builtin_functions[i].return_type;
         new_function->is_defined = true;
-        new_function->is_used = false;
         new_function->is_constant = true;
-        new_function->parent_function = NULL;
-        new_function->declaration_node = NULL;
-        new_function->next = NULL;
 
-        symtable_insert(symtable, name_with_prefix, new_function);
+        symtable_insert(&builtin_symtable, name_with_prefix, new_function);
+    }
+}
+
+/**
+ * Initializes the symbol table with "_" and the built-in functions.
+ * The prebuilt table is copied, so a compilation costs two allocations
+ * instead of building and hashing every built-in again.
+ */
+void symtable_init_builtins(SymTable *symtable)
+{
+    // Compilations of a batch share the prebuilt table
+    pthread_once(&builtin_symtable_once, build_builtin_symtable);
+
+    symtable->size = builtin_symtable.size;
+    symtable->count = builtin_symtable.count;
+    symtable->table = (Symbol **)safe_malloc(sizeof(Symbol *) * symtable->size);
+    Symbol *symbols = (Symbol *)safe_malloc(sizeof(Symbol) * builtin_symtable.count);
+
+    // Chains are copied in their order, so lookups see the same table as after inserting one by one
+    int copied = 0;
+    for (int i = 0; i < symtable->size; i++)
+    {
+        Symbol **tail = &symtable->table[i];
+        for (Symbol *symbol = builtin_symtable.table[i]; symbol != NULL; symbol = symbol->next)
+        {
+            symbols[copied] = *symbol;
+            *tail = &symbols[copied++];
+            tail = &(*tail)->next;
+        }
+        *tail = NULL;
     }
 }
 
@@ -82,6 +132,8 @@ void insert_underscore(SymTable *symtable)
     underscore->is_defined = true;
     underscore->is_used = true;
     underscore->is_constant = false;
+    underscore->parent_function = NULL;
+    underscore->declaration_node = NULL;
     underscore->next = NULL;
 
     symtable_insert(symtable, "_", underscore);
@@ -224,6 +276,61 @@ void is_symtable_all_used(SymTable *symtable)
     return;
 }
 
+/**
+ * Checks if all parameters and variables of one function are used.
+ */
+void is_function_all_used(SymTable *symtable, const char *function_name)
+{
+    for (int i = 0; i < symtable->size; i++)
+    {
+        for (Symbol *current = symtable->table[i]; current != NULL; current = current->next)
+        {
+            if (current->symbol_type != SYMBOL_FUNCTION && current->parent_function != NULL &&
+                strcmp(current->parent_function, function_name) == 0 && !current->is_used)
+            {
+                error_exit(ERR_SEMANTIC_UNUSED, "Unused variable");
+            }
+        }
+    }
+}
+
+/**
+ * Removes all parameters and variables of one function from the table.
+ */
+void symtable_remove_function_symbols(SymTable *symtable, const char *function_name)
+{
+    for (int i = 0; i < symtable->size; i++)
+    {
+        Symbol *current = symtable->table[i];
+        Symbol *prev = NULL;
+        while (current != NULL)
+        {
+            Symbol *next = current->next;
+            if (current->symbol_type != SYMBOL_FUNCTION && current->parent_function != NULL &&
+                strcmp(current->parent_function, function_name) == 0)
+            {
+                if (prev == NULL)
+                {
+                    symtable->table[i] = next;
+                }
+                else
+                {
+                    prev->next = next;
+                }
+                safe_free(current->name);
+                safe_free(current->parent_function);
+                safe_free(current);
+                symtable->count--;
+            }
+            else
+            {
+                prev = current;
+            }
+            current = next;
+        }
+    }
+}
+
 /**
  * Checks if the main function is defined correctly.
  */
@@ -63,7 +63,7 @@ typedef struct {
 
 // Function prototypes
 void symtable_init(SymTable *symtable);
-void load_builtin_functions(SymTable *symtable, struct ASTNode *import_node);
+void symtable_init_builtins(SymTable *symtable);
 void insert_underscore(SymTable *symtable);
 void symtable_free(SymTable *symtable);
 // Symbol table operations
@@ -72,6 +72,8 @@ Symbol *symtable_search(SymTable *symtable, char *key);
 void symtable_remove(SymTable *symtable, char *key);
 // Helper functions
 void is_symtable_all_used(SymTable *symtable);
+void is_function_all_used(SymTable *symtable, const char *function_name);
+void symtable_remove_function_symbols(SymTable *symtable, const char *function_name);
 void is_main_correct(SymTable *symtable);
 // Hash function
 unsigned int symtable_hash(char *key, int size);
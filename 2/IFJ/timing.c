@@ -0,0 +1,333 @@
+/**
+ * @file timing.c
+ *
+ * Implementation of the compiler phase timing module.
+ * Running phases form a stack, time between two hooks is added to the phase
+ * on the top of the stack only, so the reported numbers do not overlap.
+ * The scanner runs once per token, reading both clocks around every token would
+ * cost more than the token itself. Its time is estimated from a sample of its calls.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#define _XOPEN_SOURCE 600
+
+#include "timing.h"
+#include "error.h"
+#include "compiler.h"
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+// Measuring state of the compilation running in this thread
+#define timing_state (current_context->timing)
+
+static const char *phase_names[PHASE_COUNT] = {
+    "scanner",
+    "pre_run",
+    "parse",
+    "scope_check",
+    "symtable_check",
+    "codegen",
+    "cleanup"};
+
+/**
+ * Reads a clock in seconds.
+ */
+static double read_clock(clockid_t clock_id)
+{
+    struct timespec now;
+    clock_gettime(clock_id, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * Adds the time since the last hook to the phase on the top of the stack.
+ */
+static void account_elapsed_time(void)
+{
+    double wall_time = read_clock(CLOCK_MONOTONIC);
+    double cpu_time = read_clock(CLOCK_PROCESS_CPUTIME_ID);
+
+    if (timing_state.phase_stack_top >= 0)
+    {
+        PhaseStats *stats = &timing_state.phase_stats[timing_state.phase_stack[timing_state.phase_stack_top]];
+        stats->wall_time += wall_time - timing_state.last_wall_time;
+        stats->cpu_time += cpu_time - timing_state.last_cpu_time;
+    }
+
+    timing_state.last_wall_time = wall_time;
+    timing_state.last_cpu_time = cpu_time;
+}
+
+/**
+ * Turns measuring on.
+ */
+void timing_enable(void)
+{
+    timing_state.enabled = true;
+
+    // The cheapest of a few back to back reads is the cost of the clock itself
+    timing_state.clock_read_time = 1.0;
+    double previous = read_clock(CLOCK_MONOTONIC);
+    for (int i = 0; i < 16; i++)
+    {
+        double now = read_clock(CLOCK_MONOTONIC);
+        if (now - previous < timing_state.clock_read_time)
+        {
+            timing_state.clock_read_time = now - previous;
+        }
+        previous = now;
+    }
+}
+
+/**
+ * Checks if measuring is on.
+ */
+bool timing_is_enabled(void)
+{
+    return timing_state.enabled;
+}
+
+/**
+ * Turns measuring off and clears the values of all phases.
+ */
+void timing_reset(void)
+{
+    memset(&timing_state, 0, sizeof(timing_state));
+    timing_state.phase_stack_top = -1;
+}
+
+/**
+ * Starts a phase, the running phase is paused until this one ends.
+ */
+void timing_begin(CompilerPhase phase)
+{
+    if (!timing_state.enabled)
+    {
+        return;
+    }
+    if (timing_state.phase_stack_top >= MAX_PHASE_DEPTH - 1)
+    {
+        error_exit(ERR_INTERNAL, "Phase stack overflow");
+    }
+    account_elapsed_time();
+    timing_state.phase_stack[++timing_state.phase_stack_top] = phase;
+}
+
+/**
+ * Ends a phase and resumes the phase that was running before it.
+ */
+void timing_end(CompilerPhase phase)
+{
+    if (!timing_state.enabled)
+    {
+        return;
+    }
+    if (timing_state.phase_stack_top < 0 || timing_state.phase_stack[timing_state.phase_stack_top] != phase)
+    {
+        error_exit(ERR_INTERNAL, "Phase %s ended out of order", phase_names[phase]);
+    }
+    account_elapsed_time();
+    timing_state.phase_stack_top--;
+}
+
+/**
+ * Starts a sampled phase. The phase is put on the stack without reading the clocks,
+ * so allocations are attributed to it, but its time stays with the interrupted phase.
+ * Every TIMING_SAMPLE_PERIOD-th call is timed with the wall clock alone.
+ * Returns whether this call is timed.
+ */
+bool timing_begin_sampled(CompilerPhase phase)
+{
+    if (!timing_state.enabled)
+    {
+        return false;
+    }
+    if (timing_state.phase_stack_top >= MAX_PHASE_DEPTH - 1)
+    {
+        error_exit(ERR_INTERNAL, "Phase stack overflow");
+    }
+    if (timing_state.phase_stack_top >= 0)
+    {
+        timing_state.phase_calls[phase][timing_state.phase_stack[timing_state.phase_stack_top]]++;
+    }
+    timing_state.phase_stack[++timing_state.phase_stack_top] = phase;
+
+    if (timing_state.sample_counter++ % TIMING_SAMPLE_PERIOD != 0)
+    {
+        return false;
+    }
+    timing_state.sample_start = read_clock(CLOCK_MONOTONIC);
+    return true;
+}
+
+/**
+ * Ends a sampled phase started by timing_begin_sampled.
+ */
+void timing_end_sampled(CompilerPhase phase, bool sampled)
+{
+    if (!timing_state.enabled)
+    {
+        return;
+    }
+    if (sampled)
+    {
+        double elapsed = read_clock(CLOCK_MONOTONIC) - timing_state.sample_start - timing_state.clock_read_time;
+        timing_state.sampled_wall_time[phase] += elapsed > 0.0 ? elapsed : 0.0;
+        timing_state.sampled_calls[phase]++;
+    }
+    if (timing_state.phase_stack_top < 0 || timing_state.phase_stack[timing_state.phase_stack_top] != phase)
+    {
+        error_exit(ERR_INTERNAL, "Phase %s ended out of order", phase_names[phase]);
+    }
+    timing_state.phase_stack_top--;
+}
+
+/**
+ * Computes the reported values: the average time of a sampled call times the number
+ * of calls is moved from every interrupted phase to the sampled phase. CPU time is
+ * moved in the proportion of CPU and wall time of the interrupted phase.
+ */
+static void estimate_sampled_phases(void)
+{
+    memcpy(timing_state.report_stats, timing_state.phase_stats, sizeof(timing_state.report_stats));
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+    {
+        if (timing_state.sampled_calls[phase] == 0)
+        {
+            continue;
+        }
+        double time_per_call = timing_state.sampled_wall_time[phase] / (double)timing_state.sampled_calls[phase];
+
+        for (int parent = 0; parent < PHASE_COUNT; parent++)
+        {
+            PhaseStats *parent_stats = &timing_state.report_stats[parent];
+            if (timing_state.phase_calls[phase][parent] == 0 || parent_stats->wall_time <= 0.0)
+            {
+                continue;
+            }
+            double wall_time = time_per_call * (double)timing_state.phase_calls[phase][parent];
+            wall_time = wall_time < parent_stats->wall_time ? wall_time : parent_stats->wall_time;
+            double cpu_time = wall_time * parent_stats->cpu_time / parent_stats->wall_time;
+
+            parent_stats->wall_time -= wall_time;
+            parent_stats->cpu_time -= cpu_time;
+            timing_state.report_stats[phase].wall_time += wall_time;
+            timing_state.report_stats[phase].cpu_time += cpu_time;
+        }
+    }
+}
+
+/**
+ * Attributes an allocation to the running phase.
+ */
+void timing_record_allocation(size_t size)
+{
+    if (!timing_state.enabled || timing_state.phase_stack_top < 0)
+    {
+        return;
+    }
+    PhaseStats *stats = &timing_state.phase_stats[timing_state.phase_stack[timing_state.phase_stack_top]];
+    stats->alloc_count++;
+    stats->alloc_bytes += size;
+}
+
+/**
+ * Attributes a pointer registry lookup to the running phase.
+ */
+void timing_record_registry_scan(size_t entries)
+{
+    if (!timing_state.enabled || timing_state.phase_stack_top < 0)
+    {
+        return;
+    }
+    timing_state.phase_stats[timing_state.phase_stack[timing_state.phase_stack_top]].registry_scans += entries;
+}
+
+/**
+ * Returns the values measured for a phase.
+ */
+const PhaseStats *timing_get_stats(CompilerPhase phase)
+{
+    estimate_sampled_phases();
+    return &timing_state.report_stats[phase];
+}
+
+/**
+ * Returns the name of a phase used in the report.
+ */
+const char *timing_phase_name(CompilerPhase phase)
+{
+    return phase_names[phase];
+}
+
+/**
+ * Returns the peak resident set size of the process in kilobytes.
+ */
+long timing_peak_rss_kb(void)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+/**
+ * Prints the report as a table or as a JSON object.
+ * Times are printed in milliseconds.
+ */
+void timing_print_report(FILE *output, TimingFormat format)
+{
+    PhaseStats total = {0.0, 0.0, 0, 0, 0};
+    estimate_sampled_phases();
+
+    if (format == TIMING_FORMAT_JSON)
+    {
+        fprintf(output, "{\"phases\": [");
+    }
+    else
+    {
+        fprintf(output, "%-16s %12s %12s %12s %14s %16s\n", "phase", "wall (ms)", "cpu (ms)", "allocs", "bytes", "registry scans");
+    }
+
+    for (int i = 0; i < PHASE_COUNT; i++)
+    {
+        PhaseStats *stats = &timing_state.report_stats[i];
+        if (format == TIMING_FORMAT_JSON)
+        {
+            fprintf(output, "%s{\"name\": \"%s\", \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"allocs\": %zu, \"bytes\": %zu, \"registry_scans\": %zu}",
+                    i == 0 ? "" : ", ", phase_names[i], stats->wall_time * 1000.0, stats->cpu_time * 1000.0,
+                    stats->alloc_count, stats->alloc_bytes, stats->registry_scans);
+        }
+        else
+        {
+            fprintf(output, "%-16s %12.3f %12.3f %12zu %14zu %16zu\n", phase_names[i], stats->wall_time * 1000.0,
+                    stats->cpu_time * 1000.0, stats->alloc_count, stats->alloc_bytes, stats->registry_scans);
+        }
+        total.wall_time += stats->wall_time;
+        total.cpu_time += stats->cpu_time;
+        total.alloc_count += stats->alloc_count;
+        total.alloc_bytes += stats->alloc_bytes;
+        total.registry_scans += stats->registry_scans;
+    }
+
+    if (format == TIMING_FORMAT_JSON)
+    {
+        fprintf(output, "], \"total\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"allocs\": %zu, \"bytes\": %zu, \"registry_scans\": %zu}, \"peak_rss_kb\": %ld}\n",
+                total.wall_time * 1000.0, total.cpu_time * 1000.0, total.alloc_count, total.alloc_bytes, total.registry_scans,
+                timing_peak_rss_kb());
+    }
+    else
+    {
+        fprintf(output, "%-16s %12.3f %12.3f %12zu %14zu %16zu\n", "total", total.wall_time * 1000.0,
+                total.cpu_time * 1000.0, total.alloc_count, total.alloc_bytes, total.registry_scans);
+        fprintf(output, "peak RSS: %ld kB\n", timing_peak_rss_kb());
+    }
+}
@@ -0,0 +1,109 @@
+/**
+ * @file timing.h
+ *
+ * Header file for the compiler phase timing module (--time-passes).
+ * Measures wall time, CPU time and allocations of each compiler phase.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Phases of the compiler pipeline
+typedef enum {
+    PHASE_SCANNER,
+    PHASE_PRE_RUN,
+    PHASE_PARSE,
+    PHASE_SCOPE_CHECK,
+    PHASE_SYMTABLE_CHECK,
+    PHASE_CODEGEN,
+    PHASE_CLEANUP,
+    PHASE_COUNT
+} CompilerPhase;
+
+// Output formats of the report
+typedef enum {
+    TIMING_FORMAT_TABLE,
+    TIMING_FORMAT_JSON
+} TimingFormat;
+
+/**
+ * Measured values of one phase.
+ * Nested phases are exclusive, time spent in the scanner while parsing
+ * is counted only to the scanner (estimated from a sample of its calls).
+ */
+typedef struct {
+    double wall_time;      // Seconds
+    double cpu_time;       // Seconds
+    size_t alloc_count;    // Number of safe_malloc/safe_realloc calls
+    size_t alloc_bytes;    // Bytes requested by those calls
+    size_t registry_scans; // Pointer registry entries visited by safe_free/safe_realloc
+} PhaseStats;
+
+#define MAX_PHASE_DEPTH 16
+
+// Only every TIMING_SAMPLE_PERIOD-th call of a sampled phase reads the clock
+#define TIMING_SAMPLE_PERIOD 32
+
+/**
+ * Measuring state of one compilation (part of CompilerContext).
+ */
+typedef struct {
+    bool enabled;
+    PhaseStats phase_stats[PHASE_COUNT];
+    CompilerPhase phase_stack[MAX_PHASE_DEPTH];
+    int phase_stack_top;
+    double last_wall_time;
+    double last_cpu_time;
+    size_t sample_counter;
+    double sample_start;                             // Wall time when the running sampled call started
+    double clock_read_time;                          // Cost of one clock read, taken out of every sample
+    size_t sampled_calls[PHASE_COUNT];               // Calls of a sampled phase that were timed
+    double sampled_wall_time[PHASE_COUNT];           // and their time
+    size_t phase_calls[PHASE_COUNT][PHASE_COUNT];    // All calls of a sampled phase, by the phase they interrupted
+    PhaseStats report_stats[PHASE_COUNT];            // Measured values with the estimated time of sampled phases
+} TimingState;
+
+// Turns measuring on, without it the hooks below do nothing
+void timing_enable(void);
+bool timing_is_enabled(void);
+
+// Turns measuring off and clears all measured values
+void timing_reset(void);
+
+// Marks the start and the end of a phase, phases can be nested
+void timing_begin(CompilerPhase phase);
+void timing_end(CompilerPhase phase);
+
+// Same for a phase entered very often (the scanner, once per token). Allocations are attributed exactly,
+// but the time stays with the interrupted phase and the report moves an estimate from a sample of the calls.
+// timing_end_sampled gets the value returned by timing_begin_sampled.
+bool timing_begin_sampled(CompilerPhase phase);
+void timing_end_sampled(CompilerPhase phase, bool sampled);
+
+// Attributes an allocation to the phase that is currently running
+void timing_record_allocation(size_t size);
+
+// Attributes a linear lookup in the pointer registry to the phase that is currently running
+void timing_record_registry_scan(size_t entries);
+
+// Returns the values measured for a phase, with the estimated time of sampled phases
+const PhaseStats *timing_get_stats(CompilerPhase phase);
+const char *timing_phase_name(CompilerPhase phase);
+
+// Returns the peak resident set size of the process in kilobytes
+long timing_peak_rss_kb(void);
+
+// Prints the report of all phases
+void timing_print_report(FILE *output, TimingFormat format);
+
+#endif // TIMING_H
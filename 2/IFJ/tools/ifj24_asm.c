@@ -0,0 +1,112 @@
+/**
+ * @file ifj24_asm.c
+ *
+ * Assembler of IFJcode24, turns the text form into the compact binary form
+ * written by ifj24_compiler --binary (ifjcode.h). ifj24_disasm converts back.
+ *
+ * Usage: ifj24_asm [input_file [output_file]]
+ * The input is read from stdin and the output written to stdout when no file is given.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#include "../ifjcode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Reads the whole stream, returns NULL on failure.
+ */
+static char *read_stream(FILE *file, size_t *length)
+{
+    size_t capacity = 4096;
+    char *text = malloc(capacity);
+    *length = 0;
+    size_t read;
+    while (text != NULL && (read = fread(text + *length, 1, capacity - *length, file)) > 0)
+    {
+        *length += read;
+        if (*length == capacity)
+        {
+            capacity *= 2;
+            char *grown = realloc(text, capacity);
+            if (grown == NULL)
+            {
+                free(text);
+            }
+            text = grown;
+        }
+    }
+    if (text != NULL && ferror(file))
+    {
+        free(text);
+        text = NULL;
+    }
+    return text;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 3 || (argc > 1 && argv[1][0] == '-' && argv[1][1] != '\0'))
+    {
+        fprintf(stderr, "Usage: %s [input_file [output_file]]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *input = argc > 1 && strcmp(argv[1], "-") != 0 ? fopen(argv[1], "rb") : stdin;
+    if (input == NULL)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+    size_t length;
+    char *text = read_stream(input, &length);
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+    if (text == NULL)
+    {
+        fprintf(stderr, "Cannot read the input\n");
+        return 1;
+    }
+
+    IfjcodeProgram program;
+    memset(&program, 0, sizeof(program));
+    int result = 0;
+    if (ifjcode_parse_text(&program, text, length) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argc > 1 ? argv[1] : "stdin", program.error);
+        result = 1;
+    }
+    else
+    {
+        FILE *output = argc > 2 ? fopen(argv[2], "wb") : stdout;
+        if (output == NULL)
+        {
+            fprintf(stderr, "Cannot open %s\n", argv[2]);
+            result = 1;
+        }
+        else
+        {
+            if (ifjcode_write_binary(&program, output) != 0)
+            {
+                fprintf(stderr, "%s\n", program.error);
+                result = 1;
+            }
+            if (output != stdout)
+            {
+                fclose(output);
+            }
+        }
+    }
+
+    ifjcode_free(&program);
+    free(text);
+    return result;
+}
@@ -0,0 +1,247 @@
+/**
+ * @file ifj24_client.c
+ *
+ * Client of the compile server (ifj24_compiler --server).
+ * Takes the same arguments as ifj24_compiler, sends the source to the server
+ * and prints the generated code, the diagnostics and the exit code the
+ * compiler would produce.
+ *
+ * Usage: ifj24_client [--null-report] [--tail-call-report] [--time-passes[=json]] [--low-memory] [--instrument] [--binary] [--emit-ast=file] [--ast-cache=file] [source_file] [output_file]
+ *        ifj24_client --shutdown stops the server, it reads no source and writes no output.
+ * The socket is taken from IFJ24_SERVER_SOCKET, /tmp/ifj24_compiler.sock by default.
+ * Paths of --emit-ast and --ast-cache are sent as absolute paths, the server
+ * opens them in its own working directory.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../server.h"
+#include "../server_io.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define ERR_INTERNAL 99
+
+/**
+ * Reads the whole source into memory.
+ */
+static char *read_source(FILE *input, size_t *size)
+{
+    size_t capacity = 4096;
+    char *data = malloc(capacity);
+    *size = 0;
+    while (data != NULL)
+    {
+        *size += fread(data + *size, 1, capacity - *size, input);
+        if (*size < capacity)
+        {
+            break;
+        }
+        capacity *= 2;
+        char *grown = realloc(data, capacity);
+        if (grown == NULL)
+        {
+            free(data);
+            return NULL;
+        }
+        data = grown;
+    }
+    return data;
+}
+
+/**
+ * Sends the path of an AST file option, a relative path is joined to the working directory first.
+ */
+static bool write_path(int fd, const char *path)
+{
+    char absolute[SERVER_MAX_PATH_SIZE + 1];
+    size_t length = 0;
+    if (path[0] != '/')
+    {
+        if (getcwd(absolute, sizeof(absolute)) == NULL)
+        {
+            return false;
+        }
+        length = strlen(absolute);
+        absolute[length++] = '/';
+    }
+    if (length + strlen(path) > SERVER_MAX_PATH_SIZE)
+    {
+        return false;
+    }
+    strcpy(absolute + length, path);
+    return write_block(fd, absolute, strlen(absolute));
+}
+
+/**
+ * Connects to the compile server.
+ */
+static int connect_server(const char *socket_path)
+{
+    struct sockaddr_un address;
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *source_filename = NULL;
+    const char *output_filename = NULL;
+    const char *emit_ast = NULL;
+    const char *ast_cache = NULL;
+    uint32_t flags = 0;
+    FILE *source_file = stdin;
+
+    // Same options as ifj24_compiler
+    int positional_count = 0;
+    bool usage_error = false;
+    for (int i = 1; i < argc && !usage_error; i++)
+    {
+        if (strcmp(argv[i], "--null-report") == 0)
+            flags |= SERVER_FLAG_NULL_REPORT;
+        else if (strcmp(argv[i], "--time-passes") == 0)
+            flags |= SERVER_FLAG_TIME_PASSES;
+        else if (strcmp(argv[i], "--time-passes=json") == 0)
+            flags |= SERVER_FLAG_TIME_PASSES | SERVER_FLAG_TIME_PASSES_JSON;
+        else if (strcmp(argv[i], "--low-memory") == 0)
+            flags |= SERVER_FLAG_LOW_MEMORY;
+        else if (strcmp(argv[i], "--tail-call-report") == 0)
+            flags |= SERVER_FLAG_TAIL_CALL_REPORT;
+        else if (strcmp(argv[i], "--instrument") == 0)
+            flags |= SERVER_FLAG_INSTRUMENT;
+        else if (strcmp(argv[i], "--binary") == 0)
+            flags |= SERVER_FLAG_BINARY;
+        else if (strncmp(argv[i], "--emit-ast=", 11) == 0 && argv[i][11] != '\0')
+        {
+            emit_ast = argv[i] + 11;
+            flags |= SERVER_FLAG_EMIT_AST;
+        }
+        else if (strncmp(argv[i], "--ast-cache=", 12) == 0 && argv[i][12] != '\0')
+        {
+            ast_cache = argv[i] + 12;
+            flags |= SERVER_FLAG_AST_CACHE;
+        }
+        else if (strcmp(argv[i], "--shutdown") == 0)
+            flags |= SERVER_FLAG_SHUTDOWN;
+        else if (strncmp(argv[i], "--", 2) == 0 || positional_count >= 2)
+            usage_error = true;
+        else if (positional_count++ == 0)
+            source_filename = argv[i];
+        else
+            output_filename = argv[i];
+    }
+
+    // Function by function generation never holds the whole AST
+    usage_error = usage_error || ((flags & SERVER_FLAG_LOW_MEMORY) && (emit_ast || ast_cache));
+    if (usage_error)
+    {
+        fprintf(stderr, "Usage: %s [--null-report] [--tail-call-report] [--time-passes[=json]] [--low-memory] [--instrument] [--binary] [--emit-ast=file] [--ast-cache=file] [--shutdown] [source_file] [output_file]\n", argv[0]);
+        return ERR_INTERNAL;
+    }
+
+    // A shutdown request carries no source, so nothing is read
+    size_t source_size = 0;
+    char *source = NULL;
+    if (!(flags & SERVER_FLAG_SHUTDOWN))
+    {
+        if (source_filename)
+        {
+            source_file = fopen(source_filename, "r");
+            if (!source_file)
+            {
+                fprintf(stderr, "Error opening file: %s\n", source_filename);
+                return ERR_INTERNAL;
+            }
+        }
+
+        source = read_source(source_file, &source_size);
+        fclose(source_file);
+        if (source == NULL || source_size > SERVER_MAX_SOURCE_SIZE)
+        {
+            fprintf(stderr, "Cannot read the source\n");
+            return ERR_INTERNAL;
+        }
+    }
+
+    const char *socket_path = getenv(SERVER_SOCKET_ENV);
+    if (socket_path == NULL || *socket_path == '\0')
+    {
+        socket_path = SERVER_DEFAULT_SOCKET;
+    }
+    int server = connect_server(socket_path);
+    if (server < 0)
+    {
+        fprintf(stderr, "Cannot connect to the compile server at %s\n", socket_path);
+        free(source);
+        return ERR_INTERNAL;
+    }
+
+    uint32_t result = ERR_INTERNAL;
+    size_t output_size = 0;
+    size_t errors_size = 0;
+    char *output = NULL;
+    char *errors = NULL;
+    bool ok = write_u32(server, flags) && write_u32(server, (uint32_t)source_size) &&
+              write_exact(server, source, source_size) && (emit_ast == NULL || write_path(server, emit_ast)) &&
+              (ast_cache == NULL || write_path(server, ast_cache)) && read_u32(server, &result) &&
+              (output = read_block(server, &output_size)) != NULL &&
+              (errors = read_block(server, &errors_size)) != NULL;
+    close(server);
+    free(source);
+
+    if (!ok)
+    {
+        fprintf(stderr, "Compile server closed the connection\n");
+        free(output);
+        return ERR_INTERNAL;
+    }
+
+    // The compiler opens the output only once parsing succeeded, which is when code is produced
+    if (!(flags & SERVER_FLAG_SHUTDOWN) && (output_size > 0 || result == 0))
+    {
+        FILE *output_file = output_filename ? fopen(output_filename, "w") : stdout;
+        if (!output_file)
+        {
+            fprintf(stderr, "ERROR %i: Error: Cannot open output file %s for writing.\n\n", ERR_INTERNAL, output_filename);
+            free(output);
+            free(errors);
+            return ERR_INTERNAL;
+        }
+        fwrite(output, 1, output_size, output_file);
+        fclose(output_file);
+    }
+    fwrite(errors, 1, errors_size, stderr);
+
+    free(output);
+    free(errors);
+    return (int)result;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file ifj24_disasm.c
+ *
+ * Disassembler of IFJcode24, turns the binary form written by
+ * ifj24_compiler --binary or ifj24_asm (ifjcode.h) back into the text form.
+ *
+ * Usage: ifj24_disasm [input_file [output_file]]
+ * The input is read from stdin and the output written to stdout when no file is given.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#include "../ifjcode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Reads the whole stream, returns NULL on failure.
+ */
+static unsigned char *read_stream(FILE *file, size_t *size)
+{
+    size_t capacity = 4096;
+    unsigned char *data = malloc(capacity);
+    *size = 0;
+    size_t read;
+    while (data != NULL && (read = fread(data + *size, 1, capacity - *size, file)) > 0)
+    {
+        *size += read;
+        if (*size == capacity)
+        {
+            capacity *= 2;
+            unsigned char *grown = realloc(data, capacity);
+            if (grown == NULL)
+            {
+                free(data);
+            }
+            data = grown;
+        }
+    }
+    if (data != NULL && ferror(file))
+    {
+        free(data);
+        data = NULL;
+    }
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 3 || (argc > 1 && argv[1][0] == '-' && argv[1][1] != '\0'))
+    {
+        fprintf(stderr, "Usage: %s [input_file [output_file]]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *input = argc > 1 && strcmp(argv[1], "-") != 0 ? fopen(argv[1], "rb") : stdin;
+    if (input == NULL)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+    size_t size;
+    unsigned char *data = read_stream(input, &size);
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+    if (data == NULL)
+    {
+        fprintf(stderr, "Cannot read the input\n");
+        return 1;
+    }
+
+    IfjcodeProgram program;
+    memset(&program, 0, sizeof(program));
+    int result = 0;
+    if (ifjcode_load_binary(&program, data, size) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argc > 1 ? argv[1] : "stdin", program.error);
+        result = 1;
+    }
+    else
+    {
+        FILE *output = argc > 2 ? fopen(argv[2], "w") : stdout;
+        if (output == NULL)
+        {
+            fprintf(stderr, "Cannot open %s\n", argv[2]);
+            result = 1;
+        }
+        else
+        {
+            if (ifjcode_write_text(&program, output) != 0)
+            {
+                fprintf(stderr, "%s\n", program.error);
+                result = 1;
+            }
+            if (output != stdout)
+            {
+                fclose(output);
+            }
+        }
+    }
+
+    ifjcode_free(&program);
+    free(data);
+    return result;
+}
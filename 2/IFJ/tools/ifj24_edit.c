@@ -0,0 +1,246 @@
+/**
+ * @file ifj24_edit.c
+ *
+ * Replays text edits on an incremental session (incremental.h), like an editor
+ * would send them, and prints the diagnostics and the time of every update.
+ *
+ * Usage: ifj24_edit [-c] source_file [offset:removed:text]...
+ *   -c  after every edit analyse the whole text in a new session and compare
+ *       the tokens and diagnostics with the incremental result
+ * The inserted text may contain \n, \t and \\ escapes.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "../incremental.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Returns the monotonic time in milliseconds.
+ */
+static double now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+/**
+ * Reads the whole file, returns NULL on failure.
+ */
+static char *read_file(const char *filename, size_t *length)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    size_t capacity = 4096;
+    char *text = malloc(capacity);
+    *length = 0;
+    size_t read;
+    while (text != NULL && (read = fread(text + *length, 1, capacity - *length, file)) > 0)
+    {
+        *length += read;
+        if (*length == capacity)
+        {
+            capacity *= 2;
+            char *grown = realloc(text, capacity);
+            if (grown == NULL)
+            {
+                free(text);
+            }
+            text = grown;
+        }
+    }
+    fclose(file);
+    return text;
+}
+
+/**
+ * Splits an edit argument, the escapes of the text are replaced in place.
+ */
+static int parse_edit(char *argument, size_t *offset, size_t *removed, char **text, size_t *text_length)
+{
+    char *end;
+    *offset = strtoul(argument, &end, 10);
+    if (*end != ':')
+    {
+        return -1;
+    }
+    *removed = strtoul(end + 1, &end, 10);
+    if (*end != ':')
+    {
+        return -1;
+    }
+    *text = end + 1;
+
+    char *write = *text;
+    for (char *read = *text; *read != '\0'; read++)
+    {
+        if (*read == '\\' && read[1] != '\0')
+        {
+            read++;
+            *write++ = *read == 'n' ? '\n' : *read == 't' ? '\t' : *read;
+        }
+        else
+        {
+            *write++ = *read;
+        }
+    }
+    *text_length = (size_t)(write - *text);
+    return 0;
+}
+
+/**
+ * Prints the diagnostics of a session.
+ */
+static void print_diagnostics(const IncrementalSession *session)
+{
+    size_t count;
+    const IncrementalDiagnostic *diagnostics = incremental_diagnostics(session, &count);
+    if (count == 0)
+    {
+        printf("  no errors\n");
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        printf("  %d:%d error %d: %s\n", diagnostics[i].line, diagnostics[i].column,
+               diagnostics[i].error_code, diagnostics[i].message);
+    }
+}
+
+/**
+ * Compares the session with a new session of the same text.
+ * Returns 0 when the tokens and the diagnostics are the same.
+ */
+static int check_session(const IncrementalSession *session)
+{
+    IncrementalSession *full = incremental_open(session->text, session->length);
+    if (full == NULL)
+    {
+        fprintf(stderr, "check: cannot analyse the text\n");
+        return -1;
+    }
+
+    int result = 0;
+    if (full->token_count != session->token_count)
+    {
+        fprintf(stderr, "check: %zu tokens, %zu expected\n", session->token_count, full->token_count);
+        result = -1;
+    }
+    for (size_t i = 0; i < full->token_count && result == 0; i++)
+    {
+        const IncrementalToken *a = &session->tokens[i];
+        const IncrementalToken *b = &full->tokens[i];
+        if (a->type != b->type || a->offset != b->offset || a->length != b->length || a->line != b->line ||
+            a->column != b->column)
+        {
+            fprintf(stderr, "check: token %zu is %d at %zu+%zu %d:%d, expected %d at %zu+%zu %d:%d\n", i, a->type,
+                    a->offset, a->length, a->line, a->column, b->type, b->offset, b->length, b->line, b->column);
+            result = -1;
+        }
+    }
+
+    size_t count;
+    size_t full_count;
+    const IncrementalDiagnostic *diagnostics = incremental_diagnostics(session, &count);
+    const IncrementalDiagnostic *full_diagnostics = incremental_diagnostics(full, &full_count);
+    if (count != full_count)
+    {
+        fprintf(stderr, "check: %zu diagnostics, %zu expected\n", count, full_count);
+        result = -1;
+    }
+    for (size_t i = 0; i < count && i < full_count; i++)
+    {
+        if (memcmp(&diagnostics[i], &full_diagnostics[i], offsetof(IncrementalDiagnostic, message)) != 0 ||
+            strcmp(diagnostics[i].message, full_diagnostics[i].message) != 0)
+        {
+            fprintf(stderr, "check: diagnostic %zu is %d:%d %s, expected %d:%d %s\n", i, diagnostics[i].line,
+                    diagnostics[i].column, diagnostics[i].message, full_diagnostics[i].line,
+                    full_diagnostics[i].column, full_diagnostics[i].message);
+            result = -1;
+        }
+    }
+    incremental_close(full);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int first = 1;
+    int check = 0;
+    if (argc > 1 && strcmp(argv[1], "-c") == 0)
+    {
+        check = 1;
+        first++;
+    }
+    if (first >= argc)
+    {
+        fprintf(stderr, "Usage: %s [-c] source_file [offset:removed:text]...\n", argv[0]);
+        return 1;
+    }
+
+    size_t length;
+    char *text = read_file(argv[first], &length);
+    if (text == NULL)
+    {
+        fprintf(stderr, "Cannot read %s\n", argv[first]);
+        return 1;
+    }
+
+    double start = now_ms();
+    IncrementalSession *session = incremental_open(text, length);
+    double elapsed = now_ms() - start;
+    free(text);
+    if (session == NULL)
+    {
+        fprintf(stderr, "Cannot analyse %s\n", argv[first]);
+        return 1;
+    }
+    printf("open: %zu tokens, %zu functions, %.3f ms\n", session->token_count, session->function_count, elapsed);
+    print_diagnostics(session);
+
+    int result = 0;
+    for (int i = first + 1; i < argc; i++)
+    {
+        size_t offset;
+        size_t removed;
+        char *inserted;
+        size_t inserted_length;
+        if (parse_edit(argv[i], &offset, &removed, &inserted, &inserted_length) != 0)
+        {
+            fprintf(stderr, "Invalid edit %s\n", argv[i]);
+            result = 1;
+            break;
+        }
+
+        start = now_ms();
+        bool ok = incremental_edit(session, offset, removed, inserted, inserted_length);
+        elapsed = now_ms() - start;
+        if (!ok)
+        {
+            fprintf(stderr, "Edit %s failed\n", argv[i]);
+            result = 1;
+            break;
+        }
+        printf("edit %d: %zu tokens lexed, %zu functions parsed, %.3f ms\n", i - first, session->relexed_tokens,
+               session->reparsed_functions, elapsed);
+        print_diagnostics(session);
+        if (check && check_session(session) != 0)
+        {
+            result = 1;
+        }
+    }
+
+    incremental_close(session);
+    return result;
+}
@@ -0,0 +1,267 @@
+/**
+ * @file ifj24_prof.c
+ *
+ * Profiler of IFJ24 programs compiled with ifj24_compiler --instrument.
+ * Reads the output of the instrumented program, finds the counter report
+ * written after main returns and maps the counts back to the source lines.
+ * Prints the source with the counts of every line and the hottest places.
+ *
+ * Usage: ifj24_prof [-t top] source_file [program_output]
+ *   -t  number of places in the hot list (default 10)
+ * The program output is read from stdin when no file is given.
+ * Columns of the report start at 0 like Token columns, the hot list prints them from 1.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_MARKER "#ifj24-profile"
+#define MAX_LINE_LENGTH 4096
+
+/**
+ * One counter of the report
+ */
+typedef struct {
+    char kind[16]; // function, loop, then or else
+    int line;
+    int column;
+    long count;
+} ProfileRecord;
+
+/**
+ * Source split into lines
+ */
+typedef struct {
+    char **lines;
+    int count;
+} SourceLines;
+
+/**
+ * Reads the source file, every line without its line break.
+ */
+static int read_source_lines(const char *filename, SourceLines *source)
+{
+    FILE *file = fopen(filename, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    char buffer[MAX_LINE_LENGTH];
+    int capacity = 0;
+    source->lines = NULL;
+    source->count = 0;
+    while (fgets(buffer, sizeof(buffer), file) != NULL)
+    {
+        buffer[strcspn(buffer, "\r\n")] = '\0';
+        if (source->count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            char **lines = realloc(source->lines, (size_t)capacity * sizeof(char *));
+            if (lines == NULL)
+            {
+                fclose(file);
+                return -1;
+            }
+            source->lines = lines;
+        }
+        source->lines[source->count] = malloc(strlen(buffer) + 1);
+        if (source->lines[source->count] == NULL)
+        {
+            fclose(file);
+            return -1;
+        }
+        strcpy(source->lines[source->count++], buffer);
+    }
+    fclose(file);
+    return 0;
+}
+
+/**
+ * Reads the records that follow the last report marker in the program output.
+ * Lines before the marker are the output of the program itself.
+ */
+static ProfileRecord *read_profile(FILE *input, int *record_count)
+{
+    char buffer[MAX_LINE_LENGTH];
+    ProfileRecord *records = NULL;
+    int capacity = 0;
+    *record_count = -1;
+
+    while (fgets(buffer, sizeof(buffer), input) != NULL)
+    {
+        buffer[strcspn(buffer, "\r\n")] = '\0';
+        if (strcmp(buffer, PROFILE_MARKER) == 0)
+        {
+            // A program may print the marker itself, the report is the last one
+            *record_count = 0;
+            continue;
+        }
+        if (*record_count < 0)
+        {
+            continue;
+        }
+
+        ProfileRecord record;
+        if (sscanf(buffer, "%15s %d %d %ld", record.kind, &record.line, &record.column, &record.count) != 4)
+        {
+            continue;
+        }
+        if (*record_count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            ProfileRecord *grown = realloc(records, (size_t)capacity * sizeof(ProfileRecord));
+            if (grown == NULL)
+            {
+                free(records);
+                *record_count = -1;
+                return NULL;
+            }
+            records = grown;
+        }
+        records[(*record_count)++] = record;
+    }
+    return records;
+}
+
+/**
+ * Orders records by count, the hottest first, then by position.
+ */
+static int compare_records(const void *a, const void *b)
+{
+    const ProfileRecord *left = a;
+    const ProfileRecord *right = b;
+    if (left->count != right->count)
+    {
+        return left->count < right->count ? 1 : -1;
+    }
+    if (left->line != right->line)
+    {
+        return left->line - right->line;
+    }
+    return left->column - right->column;
+}
+
+/**
+ * Prints every source line with the counters placed on it.
+ */
+static void print_annotated_source(const SourceLines *source, const ProfileRecord *records, int record_count)
+{
+    for (int line = 1; line <= source->count; line++)
+    {
+        char counts[128] = "";
+        size_t length = 0;
+        for (int i = 0; i < record_count; i++)
+        {
+            if (records[i].line == line && length < sizeof(counts))
+            {
+                length += (size_t)snprintf(counts + length, sizeof(counts) - length, "%s%s=%ld",
+                                           length ? " " : "", records[i].kind, records[i].count);
+            }
+        }
+        printf("%-32s %5d | %s\n", counts, line, source->lines[line - 1]);
+    }
+}
+
+/**
+ * Prints the places with the highest counts.
+ */
+static void print_hot_list(const SourceLines *source, ProfileRecord *records, int record_count, int top)
+{
+    qsort(records, (size_t)record_count, sizeof(ProfileRecord), compare_records);
+
+    printf("\n%12s  %-8s %9s  %s\n", "count", "kind", "position", "source");
+    for (int i = 0; i < record_count && i < top; i++)
+    {
+        const char *text = "";
+        if (records[i].line >= 1 && records[i].line <= source->count)
+        {
+            text = source->lines[records[i].line - 1];
+            text += strspn(text, " \t");
+        }
+        char position[32];
+        snprintf(position, sizeof(position), "%d:%d", records[i].line, records[i].column + 1);
+        printf("%12ld  %-8s %9s  %s\n", records[i].count, records[i].kind, position, text);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int top = 10;
+    const char *source_filename = NULL;
+    const char *output_filename = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            top = atoi(argv[++i]);
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            source_filename = NULL;
+            break;
+        }
+        else if (source_filename == NULL)
+        {
+            source_filename = argv[i];
+        }
+        else if (output_filename == NULL)
+        {
+            output_filename = argv[i];
+        }
+        else
+        {
+            source_filename = NULL;
+            break;
+        }
+    }
+    if (source_filename == NULL || top < 0)
+    {
+        fprintf(stderr, "Usage: %s [-t top] source_file [program_output]\n", argv[0]);
+        return 1;
+    }
+
+    SourceLines source;
+    if (read_source_lines(source_filename, &source) != 0)
+    {
+        fprintf(stderr, "Cannot read source file %s\n", source_filename);
+        return 1;
+    }
+
+    FILE *input = stdin;
+    if (output_filename != NULL && (input = fopen(output_filename, "r")) == NULL)
+    {
+        fprintf(stderr, "Cannot read program output %s\n", output_filename);
+        return 1;
+    }
+    int record_count;
+    ProfileRecord *records = read_profile(input, &record_count);
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+    if (record_count < 0)
+    {
+        fprintf(stderr, "No profile found, compile with ifj24_compiler --instrument and run the program to the end\n");
+        return 1;
+    }
+
+    print_annotated_source(&source, records, record_count);
+    print_hot_list(&source, records, record_count, top);
+
+    free(records);
+    for (int i = 0; i < source.count; i++)
+    {
+        free(source.lines[i]);
+    }
+    free(source.lines);
+    return 0;
+}
@@ -0,0 +1,239 @@
+/**
+ * @file type_rules.c
+ *
+ * Implementation of the type rules table.
+ * The table is built once per process from the typing rules of IFJ24,
+ * type checking of an operator node is then a single lookup.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#include "type_rules.h"
+#include "error.h"
+#include <pthread.h>
+
+/** Nullability of one type */
+typedef struct {
+    bool nullable;
+    DataType base; // Type without the nullability
+} TypeInfo;
+
+static const TypeInfo type_info[TYPE_COUNT] = {
+    [TYPE_NULL] = {false, TYPE_NULL},
+    [TYPE_INT] = {false, TYPE_INT},
+    [TYPE_FLOAT] = {false, TYPE_FLOAT},
+    [TYPE_ALL] = {false, TYPE_ALL},
+    [TYPE_VOID] = {false, TYPE_VOID},
+    [TYPE_BOOL] = {false, TYPE_BOOL},
+    [TYPE_U8] = {false, TYPE_U8},
+    [TYPE_UNKNOWN] = {false, TYPE_UNKNOWN},
+    [TYPE_INT_NULLABLE] = {true, TYPE_INT},
+    [TYPE_FLOAT_NULLABLE] = {true, TYPE_FLOAT},
+    [TYPE_U8_NULLABLE] = {true, TYPE_U8},
+};
+
+static TypeRule type_rules[TYPE_OPERATOR_COUNT][TYPE_COUNT][TYPE_COUNT];
+static pthread_once_t type_rules_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Returns a rule that reports the error.
+ */
+static TypeRule type_error(int error_code, const char *message)
+{
+    TypeRule rule = {TYPE_UNKNOWN, CONVERSION_NONE, error_code, message};
+    return rule;
+}
+
+/**
+ * Returns a rule that allows the operands.
+ */
+static TypeRule type_result(DataType result, TypeConversion conversion)
+{
+    TypeRule rule = {result, conversion, ERR_OK, NULL};
+    return rule;
+}
+
+/**
+ * Typing of == and !=
+ * 1. Null can only be compared with a nullable type
+ * 2. Base types must match, an int literal is converted to float
+ */
+static TypeRule build_equality_rule(DataType left_type, DataType right_type)
+{
+    DataType left_base = type_info[left_type].base;
+    DataType right_base = type_info[right_type].base;
+
+    if (left_type == TYPE_NULL || right_type == TYPE_NULL)
+    {
+        if ((type_info[left_type].nullable && right_type == TYPE_NULL) ||
+            (left_type == TYPE_NULL && type_info[right_type].nullable))
+        {
+            return type_result(TYPE_BOOL, CONVERSION_NONE);
+        }
+        return type_error(ERR_SEMANTIC_TYPE, "Cannot compare non-nullable type with null");
+    }
+    if (left_base == right_base)
+    {
+        return type_result(TYPE_BOOL, CONVERSION_NONE);
+    }
+
+    TypeRule rule = type_error(ERR_SEMANTIC_TYPE, "Cannot compare types of operands with operator '%s'");
+    if (left_base == TYPE_INT && right_base == TYPE_FLOAT)
+    {
+        rule.result = TYPE_BOOL;
+        rule.conversion = CONVERSION_LEFT_LITERAL;
+    }
+    else if (left_base == TYPE_FLOAT && right_base == TYPE_INT)
+    {
+        rule.result = TYPE_BOOL;
+        rule.conversion = CONVERSION_RIGHT_LITERAL;
+    }
+    return rule;
+}
+
+/**
+ * Typing of arithmetic and relational operators
+ * 1. Operands must be int or float and cannot be nullable
+ * 2. An int literal is converted to float when the other operand is float
+ */
+static TypeRule build_numeric_rule(TypeOperator type_operator, DataType left_type, DataType right_type)
+{
+    bool is_boolean = type_operator == TYPE_OPERATOR_RELATIONAL;
+
+    if (type_info[left_type].nullable || type_info[right_type].nullable ||
+        left_type == TYPE_NULL || right_type == TYPE_NULL)
+    {
+        return type_error(ERR_SEMANTIC_TYPE, "Cannot perform operator '%s' on nullable types or null");
+    }
+    if (left_type == right_type)
+    {
+        if (left_type == TYPE_INT || left_type == TYPE_FLOAT)
+        {
+            return type_result(is_boolean ? TYPE_BOOL : left_type, CONVERSION_NONE);
+        }
+        return type_error(ERR_SEMANTIC_TYPE, "Invalid operand types for operator '%s'");
+    }
+
+    TypeRule rule = type_error(ERR_SEMANTIC_TYPE, "Cannot implicitly convert int variable to float");
+    if (left_type == TYPE_INT && right_type == TYPE_FLOAT)
+    {
+        rule.conversion = CONVERSION_LEFT_LITERAL;
+    }
+    else if (left_type == TYPE_FLOAT && right_type == TYPE_INT)
+    {
+        rule.conversion = CONVERSION_RIGHT_LITERAL;
+    }
+    else
+    {
+        return type_error(ERR_SEMANTIC_TYPE, "Incompatible operand types for operator '%s'");
+    }
+    rule.result = is_boolean ? TYPE_BOOL : TYPE_FLOAT;
+    return rule;
+}
+
+/**
+ * Typing of an assignment of a right_type value to a left_type target
+ * 1. Int is converted to float
+ * 2. Non-nullable values and null can be assigned to nullable targets
+ */
+static TypeRule build_assign_rule(DataType expected_type, DataType actual_type)
+{
+    const TypeInfo *expected = &type_info[expected_type];
+    const TypeInfo *actual = &type_info[actual_type];
+
+    if (expected_type == actual_type)
+    {
+        return type_result(expected_type, CONVERSION_NONE);
+    }
+    if (expected_type == TYPE_FLOAT && actual_type == TYPE_INT)
+    {
+        return type_result(expected_type, CONVERSION_RIGHT);
+    }
+    if (expected->nullable && !actual->nullable && (expected->base == actual_type || actual_type == TYPE_NULL))
+    {
+        return type_result(expected_type, CONVERSION_NONE);
+    }
+    return type_error(ERR_SEMANTIC_TYPE, "Type mismatch in assignment with operator '%s'");
+}
+
+/**
+ * Builds the rule of one operator class and pair of operand types.
+ */
+static TypeRule build_rule(TypeOperator type_operator, DataType left_type, DataType right_type)
+{
+    if (type_operator == TYPE_OPERATOR_ASSIGN)
+    {
+        return build_assign_rule(left_type, right_type);
+    }
+    // Strings have no operators
+    if (type_info[left_type].base == TYPE_U8 || type_info[right_type].base == TYPE_U8)
+    {
+        return type_error(ERR_SEMANTIC_TYPE, "Invalid operand types for operator '%s'");
+    }
+    if (type_operator == TYPE_OPERATOR_EQUALITY)
+    {
+        return build_equality_rule(left_type, right_type);
+    }
+    return build_numeric_rule(type_operator, left_type, right_type);
+}
+
+/**
+ * Fills the whole table.
+ */
+static void build_type_rules(void)
+{
+    for (int type_operator = 0; type_operator < TYPE_OPERATOR_COUNT; type_operator++)
+    {
+        for (int left_type = 0; left_type < TYPE_COUNT; left_type++)
+        {
+            for (int right_type = 0; right_type < TYPE_COUNT; right_type++)
+            {
+                type_rules[type_operator][left_type][right_type] =
+                    build_rule((TypeOperator)type_operator, (DataType)left_type, (DataType)right_type);
+            }
+        }
+    }
+}
+
+const TypeRule *type_rule(TypeOperator type_operator, DataType left_type, DataType right_type)
+{
+    // Compilations of a batch share the table
+    pthread_once(&type_rules_once, build_type_rules);
+    return &type_rules[type_operator][left_type][right_type];
+}
+
+TypeOperator type_operator_of(TokenType token_type)
+{
+    switch (token_type)
+    {
+    case TOKEN_LESS:
+    case TOKEN_LESS_EQUAL:
+    case TOKEN_GREATER:
+    case TOKEN_GREATER_EQUAL:
+        return TYPE_OPERATOR_RELATIONAL;
+    case TOKEN_EQUAL:
+    case TOKEN_NOT_EQUAL:
+        return TYPE_OPERATOR_EQUALITY;
+    default:
+        return TYPE_OPERATOR_ARITHMETIC;
+    }
+}
+
+bool is_nullable(DataType type_nullable)
+{
+    return type_info[type_nullable].nullable;
+}
+
+DataType detach_nullable(DataType type_nullable)
+{
+    return type_info[type_nullable].base;
+}
+
+bool can_assign_type(DataType expected_type, DataType actual_type)
+{
+    return type_rule(TYPE_OPERATOR_ASSIGN, expected_type, actual_type)->error_code == ERR_OK;
+}
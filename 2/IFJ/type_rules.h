@@ -0,0 +1,64 @@
+/**
+ * @file type_rules.h
+ *
+ * Header file for the type rules table.
+ * Every operator class and pair of operand types has one precomputed rule with
+ * the result type, the implicit conversion to insert and the error to report,
+ * so the parser type checks an expression node with a single lookup.
+ *
+ * IFJ Project 2024, Team 'xstepa77'
+ *
+ * @author <xlitvi02> Gleb Litvinchuk
+ * @author <xstepa77> Pavel Stepanov
+ * @author <xkovin00> Viktoriia Kovina
+ * @author <xshmon00> Gleb Shmonin
+ */
+#ifndef TYPE_RULES_H
+#define TYPE_RULES_H
+
+#include <stdbool.h>
+#include "symtable.h"
+#include "tokens.h"
+
+#define TYPE_COUNT (TYPE_U8_NULLABLE + 1)
+
+/** Operator classes with the same typing */
+typedef enum {
+    TYPE_OPERATOR_ARITHMETIC, // + - * /
+    TYPE_OPERATOR_RELATIONAL, // < > <= >=
+    TYPE_OPERATOR_EQUALITY,   // == !=
+    TYPE_OPERATOR_ASSIGN,     // Left is the type of the target, right the type of the value
+    TYPE_OPERATOR_COUNT
+} TypeOperator;
+
+/** Implicit conversion of an operand from int to float */
+typedef enum {
+    CONVERSION_NONE,
+    CONVERSION_LEFT_LITERAL,  // Only an int literal on the left can be converted, other operands are an error
+    CONVERSION_RIGHT_LITERAL, // Only an int literal on the right can be converted
+    CONVERSION_RIGHT          // The value on the right is converted
+} TypeConversion;
+
+/** Typing of one operator class and pair of operand types */
+typedef struct {
+    DataType result;           // TYPE_UNKNOWN for errors
+    TypeConversion conversion;
+    int error_code;            // ERR_OK, or the error when the conversion cannot be made
+    const char *message;       // Format of the error, takes the operator name
+} TypeRule;
+
+// Rule of the operator class for the operand types
+const TypeRule *type_rule(TypeOperator type_operator, DataType left_type, DataType right_type);
+
+// Operator class of a binary operator token
+TypeOperator type_operator_of(TokenType token_type);
+
+bool is_nullable(DataType type_nullable);
+
+// Type without the nullability, other types are returned unchanged
+DataType detach_nullable(DataType type_nullable);
+
+// Whether a value of actual_type can be assigned to a target of expected_type
+bool can_assign_type(DataType expected_type, DataType actual_type);
+
+#endif // TYPE_RULES_H
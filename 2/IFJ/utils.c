@@ -15,6 +15,8 @@
 #include <stdio.h>
 #include "utils.h"
 #include "parser.h"
+#include "timing.h"
+#include "compiler.h"
 
 /**
  *  Function to safely duplicate a string
@@ -92,7 +94,8 @@ char *construct_builtin_name(const char *str1, const char *str2)
     return result;
 }
 
-PointerStorage global_storage;
+// Pointer storage of the compilation running in this thread
+#define global_storage (current_context->storage)
 
 /**
  * Initialize the global pointer storage with an initial capacity
@@ -137,6 +140,7 @@ void *safe_malloc(size_t size)
         error_exit(ERR_INTERNAL, "Memory allocation failed.\n");
     }
     add_pointer_to_storage(ptr); // Add pointer to the global storage
+    timing_record_allocation(size);
     return ptr;
 }
 
@@ -155,14 +159,18 @@ void *safe_realloc(void *ptr, size_t new_size)
     {
         error_exit(ERR_INTERNAL, "Memory reallocation failed.\n");
     }
-    for (size_t i = 0; i < global_storage.count; i++)
+    timing_record_allocation(new_size);
+    // Newest pointers first, they are the ones usually reallocated and freed
+    size_t i;
+    for (i = global_storage.count; i > 0; i--)
     {
-        if (global_storage.pointers[i] == ptr)
+        if (global_storage.pointers[i - 1] == ptr)
         {
-            global_storage.pointers[i] = new_ptr;
+            global_storage.pointers[i - 1] = new_ptr;
             break;
         }
     }
+    timing_record_registry_scan(global_storage.count - i + 1);
 
     return new_ptr;
 }
@@ -177,10 +185,11 @@ void safe_free(void *ptr)
         return;
     }
 
-    for (size_t i = 0; i < global_storage.count; i++)
+    for (size_t i = global_storage.count; i-- > 0;)
     {
         if (global_storage.pointers[i] == ptr)
         {
+            timing_record_registry_scan(global_storage.count - i);
             free(ptr);
 
             for (size_t j = i; j < global_storage.count - 1; j++)
@@ -195,9 +204,46 @@ void safe_free(void *ptr)
         }
     }
 
+    timing_record_registry_scan(global_storage.count);
     fprintf(stderr, "Error: Pointer not found in storage.\n");
 }
 
+/**
+ * Get the number of stored pointers, used as a mark for release_pointers_since
+ */
+size_t pointers_storage_mark(void)
+{
+    return global_storage.count;
+}
+
+/**
+ * Free all pointers allocated after the mark, pointers listed in keep stay allocated.
+ * Entries before the mark are never touched, if some of them were freed in the meantime
+ * the newer entries moved below the mark and are kept until cleanup_pointers_storage.
+ */
+void release_pointers_since(size_t mark, void *const *keep, size_t keep_count)
+{
+    size_t kept = mark;
+    for (size_t i = mark; i < global_storage.count; i++)
+    {
+        void *ptr = global_storage.pointers[i];
+        bool keep_pointer = false;
+        for (size_t j = 0; j < keep_count && !keep_pointer; j++)
+        {
+            keep_pointer = keep[j] == ptr;
+        }
+        if (keep_pointer)
+        {
+            global_storage.pointers[kept++] = ptr;
+        }
+        else
+        {
+            free(ptr);
+        }
+    }
+    global_storage.count = kept;
+}
+
 /**
  * Clean up the global pointer storage and free all stored pointers
  */
@@ -37,7 +37,6 @@ typedef struct {
     size_t capacity;
 } PointerStorage;
 
-extern PointerStorage global_storage;
 
 // Function to initialize the pointer storage
 void init_pointers_storage(size_t initial_capacity);
@@ -51,5 +50,9 @@ void *safe_realloc(void *ptr, size_t new_size);
 void safe_free(void *ptr);
 // Function to clean up the pointer storage to prevent memory leaks
 void cleanup_pointers_storage(void);
+// Function to get a mark of the pointers allocated so far
+size_t pointers_storage_mark(void);
+// Function to free the pointers allocated since the mark, except the kept ones
+void release_pointers_since(size_t mark, void *const *keep, size_t keep_count);
 
 #endif // UTILS_H
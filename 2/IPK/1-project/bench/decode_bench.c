@@ -0,0 +1,283 @@
+#include "../src/decode_msg.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Benchmark of the message decoder on a recorded corpus of messages
+
+    Usage: decode_bench [-n iterations] udp_corpus tcp_corpus
+    - UDP corpus is a sequence of datagrams, each one preceded by its length (2 bytes, network byte order)
+    - TCP corpus is the received text, messages terminated with "\r\n"
+
+    Every corpus is decoded "iterations" times by the zero-copy decoder and by the previous decoder,
+    which copied every field with "strcpy();" (kept below as a baseline), and both have to agree on every event.
+*/
+
+#define RECEIVE_LENGTH 1536
+
+static volatile unsigned long benchmark_sink;
+
+typedef struct
+{
+    const char *data;
+    int length;
+} sRecord;
+
+//-------------------------BASELINE--------------------------------
+// Previous decoder, the receive buffer was cleared before every message and fields were copied out
+
+static eSystemEvent legacy_decode_msg(char *receive_buffer, char *users_name, char *msg_content)
+{
+    short int msg_result;
+
+    switch (receive_buffer[0])
+    {
+    case (char)0x01:
+        msg_result = receive_buffer[3];
+        receive_buffer += 6;
+        strcpy(msg_content, receive_buffer);
+        if (msg_result == 1)
+        {
+            strcpy(users_name, "Success");
+            return reply_ok_Event;
+        }
+        else if (msg_result == 0)
+        {
+            strcpy(users_name, "Failure");
+            return reply_nok_Event;
+        }
+        return error_Event;
+    case (char)0x04:
+        receive_buffer += 3;
+        strcpy(users_name, receive_buffer);
+        receive_buffer += strlen(users_name) + 1;
+        strcpy(msg_content, receive_buffer);
+        return msg_inc_Event;
+    case (char)0xfe:
+        receive_buffer += 3;
+        strcpy(users_name, receive_buffer);
+        receive_buffer += strlen(users_name) + 1;
+        strcpy(msg_content, receive_buffer);
+        return error_inc_Event;
+    case (char)0xff:
+        return bye_Event;
+    default:
+        return msg_error_Event;
+    }
+}
+
+static eSystemEvent legacy_decode_msg_tcp(char *receive_buffer, char *users_name, char *msg_content)
+{
+    char *token_result[6];
+    int count = 0;
+    eSystemEvent event = msg_error_Event;
+
+    token_result[0] = strtok(receive_buffer, " \r\n");
+    if (token_result[0] == NULL)
+        return msg_error_Event;
+    if (strcmp(token_result[0], "BYE") == 0)
+        return bye_Event;
+    if (strcmp(token_result[0], "REPLY") == 0)
+        count = 3;
+    else if (strcmp(token_result[0], "MSG") == 0 || strcmp(token_result[0], "ERR") == 0)
+        count = 4;
+    else
+        return msg_error_Event;
+
+    for (int i = 1; i <= count; i++)
+    {
+        token_result[i] = strtok(NULL, i == count ? "\r\n" : " ");
+        if (token_result[i] == NULL)
+            return msg_error_Event;
+    }
+
+    if (count == 3)
+    {
+        if (strcmp(token_result[2], "IS") != 0)
+            return msg_error_Event;
+        strcpy(msg_content, token_result[3]);
+        if (strcmp(token_result[1], "OK") == 0)
+        {
+            strcpy(users_name, "Success");
+            event = reply_ok_Event;
+        }
+        else if (strcmp(token_result[1], "NOK") == 0)
+        {
+            strcpy(users_name, "Failure");
+            event = reply_nok_Event;
+        }
+        return event;
+    }
+
+    if (strcmp(token_result[1], "FROM") != 0 || strcmp(token_result[3], "IS") != 0)
+        return msg_error_Event;
+    strcpy(users_name, token_result[2]);
+    strcpy(msg_content, token_result[4]);
+    return token_result[0][0] == 'M' ? msg_inc_Event : error_inc_Event;
+}
+
+//-------------------------BENCHMARK--------------------------------
+
+static double now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+static char *read_file(const char *filename, long *size)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = malloc(*size + 1);
+    if (data != NULL && fread(data, 1, *size, file) != (size_t)*size)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+// Splits the corpus into messages, returns their number or -1 for a damaged corpus
+static int split_corpus(char *data, long size, int tcp, sRecord **records)
+{
+    int count = 0;
+    *records = malloc(sizeof(sRecord) * (size / 2 + 1));
+    if (*records == NULL)
+        return -1;
+
+    long position = 0;
+    while (position < size)
+    {
+        sRecord *record = &(*records)[count++];
+        if (tcp)
+        {
+            char *end = strstr(data + position, "\r\n");
+            if (end == NULL)
+                return -1;
+            record->data = data + position;
+            record->length = end + 2 - record->data;
+        }
+        else
+        {
+            if (size - position < 2)
+                return -1;
+            record->length = ((unsigned char)data[position] << 8) | (unsigned char)data[position + 1];
+            record->data = data + position + 2;
+            if (record->length > RECEIVE_LENGTH || record->data + record->length > data + size)
+                return -1;
+        }
+        position = record->data + record->length - data;
+    }
+    return count;
+}
+
+static int bench_corpus(const char *filename, int tcp, int iterations)
+{
+    long size;
+    char *data = read_file(filename, &size);
+    if (data == NULL)
+    {
+        fprintf(stderr, "Cannot read %s\n", filename);
+        return 1;
+    }
+    data[size] = 0x00;
+
+    sRecord *records;
+    int count = split_corpus(data, size, tcp, &records);
+    if (count <= 0)
+    {
+        fprintf(stderr, "%s: damaged corpus\n", filename);
+        free(records);
+        free(data);
+        return 1;
+    }
+
+    static char receive_buff[RECEIVE_LENGTH + 1];
+    static char users_name[RECEIVE_LENGTH], msg_content[RECEIVE_LENGTH];
+    sDecodedMsg decoded;
+    unsigned long checksum = 0;
+    int mismatches = 0;
+
+    // Both decoders have to give the same event
+    for (int i = 0; i < count; i++)
+    {
+        memset(receive_buff, 0, sizeof(receive_buff));
+        memcpy(receive_buff, records[i].data, records[i].length);
+        eSystemEvent legacy = tcp ? legacy_decode_msg_tcp(receive_buff, users_name, msg_content)
+                                  : legacy_decode_msg(receive_buff, users_name, msg_content);
+        eSystemEvent event = tcp ? decode_msg_tcp(records[i].data, records[i].length, &decoded)
+                                 : decode_msg(records[i].data, records[i].length, &decoded);
+        if (legacy != event ||
+            (event != bye_Event && (strlen(msg_content) != (size_t)decoded.content.length ||
+                                    memcmp(msg_content, decoded.content.data, decoded.content.length) != 0)))
+            mismatches++;
+    }
+
+    double start = now_ms();
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            memset(receive_buff, 0, sizeof(receive_buff));
+            memcpy(receive_buff, records[i].data, records[i].length);
+            checksum += tcp ? legacy_decode_msg_tcp(receive_buff, users_name, msg_content)
+                            : legacy_decode_msg(receive_buff, users_name, msg_content);
+            checksum += msg_content[0];
+        }
+    }
+    double legacy_ms = now_ms() - start;
+
+    start = now_ms();
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            checksum += tcp ? decode_msg_tcp(records[i].data, records[i].length, &decoded)
+                            : decode_msg(records[i].data, records[i].length, &decoded);
+            checksum += decoded.content.length;
+        }
+    }
+    double zero_copy_ms = now_ms() - start;
+
+    double messages = (double)count * iterations;
+    printf("%-24s %8d %9ld %12.2f %12.2f %8.2fx %10d\n", filename, count, size, messages / legacy_ms / 1000.0,
+           messages / zero_copy_ms / 1000.0, legacy_ms / zero_copy_ms, mismatches);
+
+    // Results are used, so the compiler cannot leave the decoding out
+    benchmark_sink = checksum;
+
+    free(records);
+    free(data);
+    return mismatches != 0;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 2000;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        iterations = atoi(argv[2]);
+        first = 3;
+    }
+    if (argc - first != 2 || iterations < 1)
+    {
+        fprintf(stderr, "Usage: %s [-n iterations] udp_corpus tcp_corpus\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-24s %8s %9s %12s %12s %9s %10s\n", "corpus", "messages", "bytes", "strcpy M/s", "views M/s",
+           "speedup", "mismatches");
+    int result = bench_corpus(argv[first], 0, iterations);
+    result |= bench_corpus(argv[first + 1], 1, iterations);
+    return result;
+}
@@ -0,0 +1,571 @@
+#define _GNU_SOURCE
+#include "server.h"
+#include <errno.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Definition of the clients of the server and their FSM
+    TCP client has its own connection. UDP client is found by its address when its first datagram
+    comes to the welcome port, then it gets its own socket on a dynamic port and every further
+    message of the client goes there (as the specification of IPK24-CHAT describes).
+    Clients are never freed in the middle of the events returned by one "epoll_wait();",
+    a closed client only waits in the list of closed clients until "client_free_closed();".
+*/
+
+// Number of buckets of the table of UDP clients, has to be a power of two
+#define CLIENT_BUCKETS 4096
+
+// Largest datagram read, longer ones are truncated and so malformed
+#define RECEIVE_LENGTH 2048
+
+static int epoll_instance = -1;
+static sTimerWheel linger_wheel;
+
+static sChannel *channels;
+static sClient *udp_clients[CLIENT_BUCKETS];
+static sClient *closed_clients;
+
+static char receive_buff[RECEIVE_LENGTH];
+static char scratch[SEND_LENGTH];
+static char out_msg[SEND_LENGTH];
+
+static void client_fsm(sClient *client, eSystemEvent event, const sRequest *request);
+
+// "linger_tag" is given back in "data.ptr" of the epoll events of the linger timer
+int client_init(int epoll_fd, void *linger_tag)
+{
+    epoll_instance = epoll_fd;
+    return timer_wheel_init(&linger_wheel, epoll_fd, linger_tag);
+}
+
+static sMsgField text_field(const char *text)
+{
+    sMsgField field;
+    field.data = text;
+    field.length = strlen(text);
+    return field;
+}
+
+//-------------------------Clients-----------------------------
+static unsigned bucket(const struct sockaddr_in *address)
+{
+    return (ntohl(address->sin_addr.s_addr) * 31 + ntohs(address->sin_port)) & (CLIENT_BUCKETS - 1);
+}
+
+static sClient *find_udp(const struct sockaddr_in *address)
+{
+    sClient *client = udp_clients[bucket(address)];
+    while (client != NULL && (client->address.sin_addr.s_addr != address->sin_addr.s_addr ||
+                              client->address.sin_port != address->sin_port))
+        client = client->hash_next;
+    return client;
+}
+
+static void free_client(sClient *client)
+{
+    free(client->seen);
+    free(client->pending);
+    free(client->ring);
+    free(client->out);
+    free(client);
+}
+
+static sClient *new_client(int udp, int socket)
+{
+    sClient *client = calloc(1, sizeof(sClient));
+    if (client == NULL)
+        return NULL;
+    client->udp = udp;
+    client->socket = socket;
+    client->state = Auth_State;
+
+    if (udp)
+    {
+        client->seen = calloc(65536 / 8, 1);
+        client->pending = calloc(SERVER_WINDOW, sizeof(sPending *));
+    }
+    else
+    {
+        client->ring = malloc(sizeof(sTcpRing));
+        if (client->ring != NULL)
+            tcp_ring_init(client->ring);
+    }
+
+    struct epoll_event client_event;
+    client_event.events = EPOLLIN;
+    client_event.data.ptr = client;
+    if ((udp ? client->seen == NULL || client->pending == NULL : client->ring == NULL) ||
+        epoll_ctl(epoll_instance, EPOLL_CTL_ADD, socket, &client_event) == -1)
+    {
+        free_client(client);
+        return NULL;
+    }
+
+    stats.clients++;
+    if (stats.clients > stats.peak_clients)
+        stats.peak_clients = stats.clients;
+    return client;
+}
+
+// UDP client is no longer found by its address, it can already be unlinked by a new client on the same address
+static void unlink_udp(sClient *client)
+{
+    sClient **link = &udp_clients[bucket(&client->address)];
+    while (*link != NULL && *link != client)
+        link = &(*link)->hash_next;
+    if (*link != NULL)
+        *link = client->hash_next;
+}
+
+// Socket is closed at once, the memory only after the current events
+static void close_client(sClient *client)
+{
+    transport_forget(client);
+    if (client->udp)
+    {
+        unlink_udp(client);
+        timer_wheel_remove(&linger_wheel, &client->linger);
+    }
+    close(client->socket);
+    client->closed = 1;
+    client->zombie_next = closed_clients;
+    closed_clients = client;
+    stats.clients--;
+}
+
+void client_free_closed(void)
+{
+    while (closed_clients != NULL)
+    {
+        sClient *client = closed_clients;
+        closed_clients = client->zombie_next;
+        free_client(client);
+    }
+}
+
+//-------------------------Messages----------------------------
+static void send_reply(sClient *client, int result, uint16_t hRef_id, const char *text)
+{
+    int length;
+    if (client->udp)
+        length = encode_reply(out_msg, client->message_id++, result, hRef_id, text_field(text));
+    else
+        length = encode_reply_tcp(out_msg, result, text_field(text));
+    server_send(client, out_msg, length);
+}
+
+static void send_err(sClient *client, const char *text)
+{
+    int length;
+    if (client->udp)
+        length = encode_err(out_msg, client->message_id++, text_field(SERVER_NAME), text_field(text));
+    else
+        length = encode_err_tcp(out_msg, text_field(SERVER_NAME), text_field(text));
+    server_send(client, out_msg, length);
+}
+
+static void send_bye(sClient *client)
+{
+    int length;
+    if (client->udp)
+        length = encode_bye(out_msg, client->message_id++);
+    else
+        length = encode_bye_tcp(out_msg);
+    server_send(client, out_msg, length);
+}
+
+/* Sends MSG to every member of the channel except "sender"
+    Text of the TCP variant is the same for all members, so it is encoded only once.
+*/
+static void broadcast(sChannel *channel, sClient *sender, sMsgField display_name, sMsgField content)
+{
+    char tcp_msg[SEND_LENGTH];
+    int tcp_length = 0;
+
+    for (sClient *member = channel->members; member != NULL; member = member->channel_next)
+    {
+        if (member == sender || member->state != Open_State)
+            continue;
+        if (member->udp)
+        {
+            int length = encode_msg(out_msg, member->message_id++, display_name, content);
+            server_send(member, out_msg, length);
+        }
+        else
+        {
+            if (tcp_length == 0)
+                tcp_length = encode_msg_tcp(tcp_msg, display_name, content);
+            server_send(member, tcp_msg, tcp_length);
+        }
+    }
+}
+
+//-------------------------Channels----------------------------
+
+// Announces to the channel that the client has joined or left it
+static void announce(sChannel *channel, sClient *client, const char *action)
+{
+    char content[DISPLAY_NAME_LENGTH + CHANNEL_ID_LENGTH + 32];
+    snprintf(content, sizeof(content), "%s has %s %s.", client->display_name, action, channel->name);
+    broadcast(channel, NULL, text_field(SERVER_NAME), text_field(content));
+}
+
+static void join_channel(sClient *client, sMsgField channel_id)
+{
+    sChannel *channel = channels;
+    while (channel != NULL && ((int)strlen(channel->name) != channel_id.length ||
+                               memcmp(channel->name, channel_id.data, channel_id.length) != 0))
+        channel = channel->next;
+
+    if (channel == NULL)
+    {
+        channel = calloc(1, sizeof(sChannel));
+        if (channel == NULL)
+            return;
+        memcpy(channel->name, channel_id.data, channel_id.length);
+        channel->next = channels;
+        channels = channel;
+    }
+
+    client->channel = channel;
+    client->channel_prev = NULL;
+    client->channel_next = channel->members;
+    if (channel->members != NULL)
+        channel->members->channel_prev = client;
+    channel->members = client;
+    channel->member_count++;
+
+    // Joining client is announced to everybody in the channel, itself too
+    announce(channel, client, "joined");
+}
+
+// Empty channel is removed
+static void leave_channel(sClient *client)
+{
+    sChannel *channel = client->channel;
+    if (channel == NULL)
+        return;
+
+    if (client->channel_prev != NULL)
+        client->channel_prev->channel_next = client->channel_next;
+    else
+        channel->members = client->channel_next;
+    if (client->channel_next != NULL)
+        client->channel_next->channel_prev = client->channel_prev;
+    client->channel = NULL;
+    channel->member_count--;
+
+    if (channel->member_count > 0)
+    {
+        announce(channel, client, "left");
+        return;
+    }
+    sChannel **link = &channels;
+    while (*link != channel)
+        link = &(*link)->next;
+    *link = channel->next;
+    free(channel);
+}
+
+//-------------------------FSM---------------------------------
+static void set_display_name(sClient *client, sMsgField display_name)
+{
+    memcpy(client->display_name, display_name.data, display_name.length);
+    client->display_name[display_name.length] = '\0';
+}
+
+/* Ends the client, with BYE when "bye" is set
+    UDP client lingers, so that its repeated messages are still confirmed and the server's BYE
+    can be retransmitted. TCP client is closed as soon as all its messages are sent.
+*/
+static void end_client(sClient *client, int bye)
+{
+    leave_channel(client);
+    if (bye)
+        send_bye(client);
+    client->state = End_State;
+    if (client->udp)
+        timer_wheel_add(&linger_wheel, &client->linger, (uint32_t)udp_timeout * (max_retransmissions + 1) * 1000);
+}
+
+static void protocol_error(sClient *client, eSystemEvent event)
+{
+    send_err(client, event == msg_error_Event ? "Malformed message." : "Message not expected in this state.");
+    end_client(client, 1);
+}
+
+static void client_fsm(sClient *client, eSystemEvent event, const sRequest *request)
+{
+    switch (client->state)
+    {
+    case Auth_State:
+        if (auth_Event == event)
+        {
+            set_display_name(client, request->display_name);
+            send_reply(client, 1, request->hMessage_id, "Auth success.");
+            client->state = Open_State;
+            join_channel(client, text_field(DEFAULT_CHANNEL));
+        }
+        else if (bye_Event == event)
+            end_client(client, 0);
+        else if (error_inc_Event == event)
+            end_client(client, 1);
+        else
+            protocol_error(client, event);
+        break;
+    case Open_State:
+        if (join_Event == event)
+        {
+            set_display_name(client, request->display_name);
+            leave_channel(client);
+            send_reply(client, 1, request->hMessage_id, "Join success.");
+            join_channel(client, request->channel_id);
+        }
+        else if (msg_inc_Event == event)
+        {
+            set_display_name(client, request->display_name);
+            if (client->channel != NULL)
+                broadcast(client->channel, client, request->display_name, request->content);
+        }
+        else if (bye_Event == event)
+            end_client(client, 0);
+        else if (error_inc_Event == event)
+            end_client(client, 1);
+        else
+            protocol_error(client, event);
+        break;
+    default:
+        break;
+    }
+}
+
+// Definition of function that ends the UDP client, one of whose messages was never confirmed
+void client_lost(sClient *client)
+{
+    if (client->state != End_State)
+        end_client(client, 0);
+}
+
+// Definition of function that closes the ended client once nothing is left to be sent to it
+void client_check(sClient *client)
+{
+    if (client->closed || client->state != End_State || client->delayed > 0)
+        return;
+    if (client->udp ? !client->lingered || client->in_flight > 0 : client->out_length > 0)
+        return;
+    close_client(client);
+}
+
+// Definition of function that handles the end of linger time of UDP clients
+void client_linger_event(void)
+{
+    sTimerEntry *entry = timer_wheel_expire(&linger_wheel);
+    while (entry != NULL)
+    {
+        sTimerEntry *next = entry->next;
+        sClient *client = (sClient *)entry;
+
+        client->lingered = 1;
+        client_check(client);
+        // Some message is still waiting for CONFIRM or for its delay, the client is checked again later
+        if (!client->closed)
+            timer_wheel_add(&linger_wheel, &client->linger, (uint32_t)udp_timeout * 1000);
+        entry = next;
+    }
+}
+
+//-------------------------UDP---------------------------------
+static void udp_datagram(sClient *client, const char *data, int length)
+{
+    if (length < 3)
+        return;
+
+    uint16_t hMessage_id;
+    memcpy(&hMessage_id, data + 1, sizeof(hMessage_id));
+    if (data[0] == 0x00)
+    {
+        server_confirmed(client, hMessage_id);
+        return;
+    }
+
+    // Every message is confirmed, a repeated one too, since its first CONFIRM was lost
+    stats.received++;
+    server_send_confirm(client, hMessage_id);
+
+    // The bit of the MessageID half the range ahead is cleared, so MessageIDs can wrap around
+    uint16_t message_id = ntohs(hMessage_id);
+    if (client->seen[message_id / 8] & (1 << (message_id % 8)))
+    {
+        stats.duplicates++;
+        return;
+    }
+    client->seen[message_id / 8] |= 1 << (message_id % 8);
+    uint16_t old_id = message_id + 32768;
+    client->seen[old_id / 8] &= ~(1 << (old_id % 8));
+
+    if (client->state == End_State)
+        return;
+    sRequest request;
+    eSystemEvent event = decode_request(data, length, &request);
+    client_fsm(client, event, &request);
+}
+
+/* Definition of function that receives datagrams on the welcome port
+    Datagram from an unknown address, or from the address of an ended client, starts a new client with its own dynamic port.
+*/
+void client_welcome(int welcome_socket)
+{
+    for (;;)
+    {
+        struct sockaddr_in address;
+        socklen_t address_length = sizeof(address);
+        int length = recvfrom(welcome_socket, receive_buff, sizeof(receive_buff), MSG_DONTWAIT,
+                              (struct sockaddr *)&address, &address_length);
+        if (length == -1)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                perror("recvfrom");
+            return;
+        }
+        if (transport_drop())
+        {
+            stats.dropped_in++;
+            continue;
+        }
+
+        sClient *client = find_udp(&address);
+
+        // New session from the port of an ended client (the port was reused) is a new client,
+        // the ended one lingers on its dynamic port, where its own repeated messages come
+        if (client != NULL && client->state == End_State && length >= 3 && receive_buff[0] != 0x00)
+        {
+            unlink_udp(client);
+            client = NULL;
+        }
+
+        if (client == NULL)
+        {
+            // CONFIRM or garbage cannot start a client
+            if (length < 3 || receive_buff[0] == 0x00)
+                continue;
+
+            struct sockaddr_in dynamic_address;
+            memset(&dynamic_address, 0, sizeof(dynamic_address));
+            dynamic_address.sin_family = AF_INET;
+            dynamic_address.sin_addr.s_addr = htonl(INADDR_ANY);
+            dynamic_address.sin_port = 0;
+
+            int dynamic_socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (dynamic_socket == -1)
+            {
+                perror("socket");
+                continue;
+            }
+            if (bind(dynamic_socket, (struct sockaddr *)&dynamic_address, sizeof(dynamic_address)) == -1 ||
+                (client = new_client(1, dynamic_socket)) == NULL)
+            {
+                perror("client");
+                close(dynamic_socket);
+                continue;
+            }
+            client->address = address;
+            unsigned index = bucket(&address);
+            client->hash_next = udp_clients[index];
+            udp_clients[index] = client;
+            stats.accepted++;
+        }
+        udp_datagram(client, receive_buff, length);
+    }
+}
+
+//-------------------------TCP---------------------------------
+void client_accept(int listen_socket)
+{
+    for (;;)
+    {
+        struct sockaddr_in address;
+        socklen_t address_length = sizeof(address);
+        int socket = accept4(listen_socket, (struct sockaddr *)&address, &address_length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (socket == -1)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                perror("accept");
+            return;
+        }
+
+        // Every message is sent as soon as it is complete, latency measured by the client is not Nagle's delay
+        int enable = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        sClient *client = new_client(0, socket);
+        if (client == NULL)
+        {
+            perror("client");
+            close(socket);
+            continue;
+        }
+        client->address = address;
+        stats.accepted++;
+    }
+}
+
+// Connection closed by the client or broken, nothing more can be sent to it
+static void disconnect(sClient *client)
+{
+    leave_channel(client);
+    client->state = End_State;
+    close_client(client);
+}
+
+/* Definition of function that receives data on the socket of the client
+    UDP client reads all datagrams waiting on its dynamic port, datagrams from other addresses are ignored.
+    TCP client reads once into its ring and handles every complete message in it.
+*/
+void client_receive(sClient *client)
+{
+    if (client->udp)
+    {
+        for (;;)
+        {
+            struct sockaddr_in address;
+            socklen_t address_length = sizeof(address);
+            int length = recvfrom(client->socket, receive_buff, sizeof(receive_buff), MSG_DONTWAIT,
+                                  (struct sockaddr *)&address, &address_length);
+            if (length == -1)
+                return;
+            if (address.sin_addr.s_addr != client->address.sin_addr.s_addr || address.sin_port != client->address.sin_port)
+                continue;
+            if (transport_drop())
+            {
+                stats.dropped_in++;
+                continue;
+            }
+            udp_datagram(client, receive_buff, length);
+        }
+    }
+
+    int received = tcp_ring_recv(client->ring, client->socket);
+    if (received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+    if (received <= 0)
+    {
+        disconnect(client);
+        return;
+    }
+
+    const char *message;
+    int length;
+    while (client->state != End_State &&
+           (length = tcp_ring_next(client->ring, scratch, sizeof(scratch), &message)) != 0)
+    {
+        sRequest request;
+        stats.received++;
+        eSystemEvent event = length == -1 ? msg_error_Event : decode_request_tcp(message, length, &request);
+        client_fsm(client, event, &request);
+    }
+}
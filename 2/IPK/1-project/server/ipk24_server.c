@@ -0,0 +1,254 @@
+#include "server.h"
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Reference server of IPK24-CHAT for local benchmarking of the client
+    One thread and one epoll instance serve TCP and UDP clients on the same port.
+    Loss and delay can be injected (options --loss and --delay), so the reliability of the UDP variant
+    is tested against a known link instead of a real network.
+*/
+
+// Most epoll events handled by one "epoll_wait();"
+#define SERVER_EVENTS 256
+
+// Definitions of variables described in "server.h"
+uint16_t udp_timeout = 250;
+uint8_t max_retransmissions = 3;
+double loss_rate = 0;
+uint32_t delay_ms = 0;
+
+sServerStats stats;
+
+static char *listen_ip = "0.0.0.0";
+static uint16_t listen_port = 4567;
+static unsigned seed = 1;
+
+// Tags of the events that do not belong to a client, every other event is a client ("data.ptr")
+static char listen_tag, welcome_tag, retransmit_tag, delay_tag, linger_tag;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void stop_handler(int signal_number)
+{
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+// Definition of a function that parses program arguments
+static void argument_parse(int argc, char **argv)
+{
+    int opt;
+
+    // Options of the injection have only the long form
+    static const struct option long_options[] = {
+        {"loss", required_argument, NULL, 'O'},
+        {"delay", required_argument, NULL, 'D'},
+        {"seed", required_argument, NULL, 'E'},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "l:p:d:r:h", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'l':
+            listen_ip = optarg;
+            break;
+        case 'p':
+            listen_port = atoi(optarg);
+            break;
+        case 'd':
+            udp_timeout = atoi(optarg);
+            break;
+        case 'r':
+            max_retransmissions = atoi(optarg);
+            break;
+        case 'O':
+            loss_rate = atof(optarg) / 100;
+            if (loss_rate < 0 || loss_rate >= 1)
+            {
+                fprintf(stderr, "Option --loss requires a percentage from 0 to 99.\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'D':
+            if (atoi(optarg) < 0)
+            {
+                fprintf(stderr, "Option --delay requires a number of milliseconds.\n");
+                exit(EXIT_FAILURE);
+            }
+            delay_ms = atoi(optarg);
+            break;
+        case 'E':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'h':
+            printf("Usage: %s [-l listen_ip] [-p port] [-d udp_timeout] [-r max_retransmissions] [--loss percent] [--delay ms] [--seed number] [-h]\n", argv[0]);
+            exit(EXIT_SUCCESS);
+        case '?':
+            if (optopt == 'l' || optopt == 'p' || optopt == 'd' || optopt == 'r')
+                fprintf(stderr, "Option -%c requires an argument.\n", optopt);
+            else if (isprint(optopt))
+                fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+            else
+                fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+            exit(EXIT_FAILURE);
+        default:
+            abort();
+        }
+    }
+}
+
+// Creates nonblocking socket bound to the address and adds it to epoll with "tag"
+static int open_socket(int epoll_fd, const struct addrinfo *address, void *tag)
+{
+    int listen_socket = socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_socket == -1)
+        return -1;
+
+    int enable = 1;
+    setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if (bind(listen_socket, address->ai_addr, address->ai_addrlen) == -1 ||
+        (address->ai_socktype == SOCK_STREAM && listen(listen_socket, SOMAXCONN) == -1))
+    {
+        close(listen_socket);
+        return -1;
+    }
+
+    struct epoll_event socket_event;
+    socket_event.events = EPOLLIN;
+    socket_event.data.ptr = tag;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_socket, &socket_event) == -1)
+    {
+        close(listen_socket);
+        return -1;
+    }
+    return listen_socket;
+}
+
+static void print_stats(void)
+{
+    fprintf(stderr, "Clients: %lu accepted, %lu at most at once, %lu still connected\n", stats.accepted,
+            stats.peak_clients, stats.clients);
+    fprintf(stderr, "Messages: %lu received (%lu repeated), %lu sent, %lu CONFIRMs sent\n", stats.received,
+            stats.duplicates, stats.sent, stats.confirms);
+    fprintf(stderr, "UDP: %lu retransmitted, %lu clients lost, %lu messages over the window\n", stats.retransmitted,
+            stats.lost, stats.overflow);
+    fprintf(stderr, "Injected: %lu datagrams dropped in, %lu dropped out, %lu messages delayed\n", stats.dropped_in,
+            stats.dropped_out, stats.delayed);
+    if (stats.slow_clients > 0)
+        fprintf(stderr, "TCP: %lu slow clients disconnected\n", stats.slow_clients);
+}
+
+int main(int argc, char **argv)
+{
+    argument_parse(argc, argv);
+
+    // Resolve the listening address, TCP and UDP use the same one
+    struct addrinfo hints, *tcp_address = NULL, *udp_address = NULL;
+    char port_str[6];
+    snprintf(port_str, sizeof(port_str), "%hu", listen_port);
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_flags = AI_PASSIVE;
+    hints.ai_socktype = SOCK_STREAM;
+    int iResult = getaddrinfo(listen_ip, port_str, &hints, &tcp_address);
+    if (iResult == 0)
+    {
+        hints.ai_socktype = SOCK_DGRAM;
+        iResult = getaddrinfo(listen_ip, port_str, &hints, &udp_address);
+    }
+    if (iResult != 0)
+    {
+        fprintf(stderr, "GetAddrinfo: %s\n", gai_strerror(iResult));
+        return EXIT_FAILURE;
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1)
+    {
+        perror("epoll_create1");
+        return EXIT_FAILURE;
+    }
+
+    int listen_socket = open_socket(epoll_fd, tcp_address, &listen_tag);
+    int welcome_socket = open_socket(epoll_fd, udp_address, &welcome_tag);
+    freeaddrinfo(tcp_address);
+    freeaddrinfo(udp_address);
+    if (listen_socket == -1 || welcome_socket == -1)
+    {
+        perror("socket");
+        return EXIT_FAILURE;
+    }
+
+    if (transport_init(epoll_fd, &retransmit_tag, &delay_tag, seed) == -1 || client_init(epoll_fd, &linger_tag) == -1)
+    {
+        perror("timer");
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, stop_handler);
+    signal(SIGTERM, stop_handler);
+    fprintf(stderr, "Listening on %s:%hu (TCP and UDP), loss %g %%, delay %u ms\n", listen_ip, listen_port,
+            loss_rate * 100, delay_ms);
+
+    // Main cycle of the server, runs until SIGINT or SIGTERM
+    struct epoll_event events[SERVER_EVENTS];
+    while (!stop_requested)
+    {
+        int event_count = epoll_wait(epoll_fd, events, SERVER_EVENTS, -1);
+        if (event_count == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < event_count; i++)
+        {
+            void *tag = events[i].data.ptr;
+            if (tag == &listen_tag)
+                client_accept(listen_socket);
+            else if (tag == &welcome_tag)
+                client_welcome(welcome_socket);
+            else if (tag == &retransmit_tag)
+                transport_retransmit_event();
+            else if (tag == &delay_tag)
+                transport_delay_event();
+            else if (tag == &linger_tag)
+                client_linger_event();
+            else
+            {
+                // Case for client event, a client closed earlier in this batch is skipped
+                sClient *client = tag;
+                if (client->closed)
+                    continue;
+                if (events[i].events & EPOLLOUT)
+                    transport_writable(client);
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    client_receive(client);
+                client_check(client);
+            }
+        }
+
+        // Clients closed during this batch are freed, no event refers to them any more
+        client_free_closed();
+    }
+
+    print_stats();
+    close(listen_socket);
+    close(welcome_socket);
+    close(epoll_fd);
+    return 0;
+}
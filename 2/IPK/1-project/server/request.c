@@ -0,0 +1,199 @@
+#include "request.h"
+#include "encode_msg.h"
+#include <string.h>
+#include <strings.h>
+
+/*  Definition of function, that decodes a message sent by a client
+    Implemented in both variants (UDP and TCP), the counterpart of "decode_msg();" of the client.
+
+    Nothing is copied, every field of "sRequest" is a view (pointer and length) into the receive buffer.
+    Fields are validated as the specification of IPK24-CHAT defines them:
+    - Username, ChannelID and Secret have 1 to 20 (Secret 128) characters [A-Za-z0-9_-], ChannelID also "."
+    - DisplayName has 1 to 20 printable characters (0x21-0x7E)
+    - MessageContent has 1 to 1400 printable characters or spaces (0x20-0x7E)
+    Returned events are the events of the client FSM seen from the server:
+    auth_Event, join_Event, msg_inc_Event, error_inc_Event, bye_Event,
+    null_Event for CONFIRM and msg_error_Event for anything that cannot be decoded.
+*/
+
+static int is_id(sMsgField field, int max_length, int dot)
+{
+    if (field.length < 1 || field.length > max_length)
+        return 0;
+    for (int i = 0; i < field.length; i++)
+    {
+        char c = field.data[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' ||
+              (dot && c == '.')))
+            return 0;
+    }
+    return 1;
+}
+
+static int is_printable(sMsgField field, int max_length, char lowest)
+{
+    if (field.length < 1 || field.length > max_length)
+        return 0;
+    for (int i = 0; i < field.length; i++)
+    {
+        if (field.data[i] < lowest || field.data[i] > 0x7E)
+            return 0;
+    }
+    return 1;
+}
+
+static int is_display_name(sMsgField field)
+{
+    return is_printable(field, DISPLAY_NAME_LENGTH, 0x21);
+}
+
+static int is_content(sMsgField field)
+{
+    return is_printable(field, CONTENT_LENGTH, 0x20);
+}
+
+// Reads zero-terminated field starting at "offset", returns offset behind the terminating 0x00, or -1
+static int read_field(const char *receive_buffer, int length, int offset, sMsgField *field)
+{
+    if (offset < 0 || offset >= length)
+        return -1;
+    const char *end = memchr(receive_buffer + offset, 0x00, length - offset);
+    if (end == NULL)
+        return -1;
+
+    field->data = receive_buffer + offset;
+    field->length = end - field->data;
+    return offset + field->length + 1;
+}
+
+//-------------------------UDP--------------------------------
+eSystemEvent decode_request(const char *receive_buffer, int length, sRequest *request)
+{
+    int offset;
+
+    memset(request, 0, sizeof(*request));
+    if (length < 3)
+        return msg_error_Event;
+    memcpy(&request->hMessage_id, receive_buffer + 1, sizeof(uint16_t));
+
+    // Switch case for type of the message
+    switch ((unsigned char)receive_buffer[0])
+    {
+    case 0x00:
+        // Case for CONFIRM, nothing more to decode
+        return null_Event;
+    case 0x02:
+        // Case for AUTH
+        offset = read_field(receive_buffer, length, 3, &request->username);
+        offset = read_field(receive_buffer, length, offset, &request->display_name);
+        offset = read_field(receive_buffer, length, offset, &request->secret);
+        if (offset == -1 || !is_id(request->username, USERNAME_LENGTH, 0) || !is_display_name(request->display_name) ||
+            !is_id(request->secret, SECRET_LENGTH, 0))
+            return msg_error_Event;
+        return auth_Event;
+    case 0x03:
+        // Case for JOIN
+        offset = read_field(receive_buffer, length, 3, &request->channel_id);
+        offset = read_field(receive_buffer, length, offset, &request->display_name);
+        if (offset == -1 || !is_id(request->channel_id, CHANNEL_ID_LENGTH, 1) || !is_display_name(request->display_name))
+            return msg_error_Event;
+        return join_Event;
+    case 0x04:
+    case 0xfe:
+        // Case for MSG and ERROR
+        offset = read_field(receive_buffer, length, 3, &request->display_name);
+        offset = read_field(receive_buffer, length, offset, &request->content);
+        if (offset == -1 || !is_display_name(request->display_name) || !is_content(request->content))
+            return msg_error_Event;
+        return receive_buffer[0] == 0x04 ? msg_inc_Event : error_inc_Event;
+    case 0xff:
+        // Case for BYE
+        return bye_Event;
+    default:
+        // Case for unknown message, or a message only the server can send (REPLY)
+        return msg_error_Event;
+    }
+}
+
+//-----------------------------TCP------------------------------
+
+// Checks that the text at "*position" starts with "word" (keywords are case insensitive) and moves behind it
+static int match(const char **position, const char *end, const char *word)
+{
+    size_t word_length = strlen(word);
+    if ((size_t)(end - *position) < word_length || strncasecmp(*position, word, word_length) != 0)
+        return 0;
+    *position += word_length;
+    return 1;
+}
+
+// Reads one word terminated with a space or the end of the message, the space is skipped
+static int read_word(const char **position, const char *end, sMsgField *field)
+{
+    const char *space = memchr(*position, ' ', end - *position);
+    if (space == NULL)
+        space = end;
+
+    field->data = *position;
+    field->length = space - *position;
+    *position = space < end ? space + 1 : end;
+    return field->length > 0;
+}
+
+/* TCP variant of function checks the grammar directly on the received text
+    AUTH {Username} AS {DisplayName} USING {Secret}\r\n
+    JOIN {ChannelID} AS {DisplayName}\r\n
+    MSG FROM {DisplayName} IS {MessageContent}\r\n
+    ERR FROM {DisplayName} IS {MessageContent}\r\n
+    BYE\r\n
+*/
+eSystemEvent decode_request_tcp(const char *receive_buffer, int length, sRequest *request)
+{
+    const char *position = receive_buffer;
+    const char *end = receive_buffer + length;
+
+    memset(request, 0, sizeof(*request));
+
+    // Every message ends with "\r\n", which is not a part of any field
+    if (length < 2 || end[-2] != '\r' || end[-1] != '\n')
+        return msg_error_Event;
+    end -= 2;
+
+    if (match(&position, end, "AUTH "))
+    {
+        if (!read_word(&position, end, &request->username) || !match(&position, end, "AS ") ||
+            !read_word(&position, end, &request->display_name) || !match(&position, end, "USING ") ||
+            !read_word(&position, end, &request->secret) || position != end)
+            return msg_error_Event;
+        if (!is_id(request->username, USERNAME_LENGTH, 0) || !is_display_name(request->display_name) ||
+            !is_id(request->secret, SECRET_LENGTH, 0))
+            return msg_error_Event;
+        return auth_Event;
+    }
+    else if (match(&position, end, "JOIN "))
+    {
+        if (!read_word(&position, end, &request->channel_id) || !match(&position, end, "AS ") ||
+            !read_word(&position, end, &request->display_name) || position != end)
+            return msg_error_Event;
+        if (!is_id(request->channel_id, CHANNEL_ID_LENGTH, 1) || !is_display_name(request->display_name))
+            return msg_error_Event;
+        return join_Event;
+    }
+    else if (match(&position, end, "MSG FROM ") || match(&position, end, "ERR FROM "))
+    {
+        eSystemEvent event = (receive_buffer[0] == 'M' || receive_buffer[0] == 'm') ? msg_inc_Event : error_inc_Event;
+
+        if (!read_word(&position, end, &request->display_name) || !match(&position, end, "IS "))
+            return msg_error_Event;
+        request->content.data = position;
+        request->content.length = end - position;
+        if (!is_display_name(request->display_name) || !is_content(request->content))
+            return msg_error_Event;
+        return event;
+    }
+    else if (match(&position, end, "BYE") && (position == end || *position == ' '))
+    {
+        return bye_Event;
+    }
+    return msg_error_Event;
+}
@@ -0,0 +1,23 @@
+#ifndef REQUEST_H
+#define REQUEST_H
+#include "decode_msg.h"
+#include <stdint.h>
+
+// Declaration of the decoder of messages sent by clients to the server
+
+// Fields of a decoded message, every field is a view into the receive buffer
+typedef struct
+{
+    uint16_t hMessage_id;   // MessageID in network byte order (UDP)
+    sMsgField username;     // AUTH
+    sMsgField channel_id;   // JOIN
+    sMsgField display_name; // AUTH, JOIN, MSG, ERR
+    sMsgField secret;       // AUTH
+    sMsgField content;      // MSG, ERR
+} sRequest;
+
+eSystemEvent decode_request(const char *receive_buffer, int length, sRequest *request);
+
+eSystemEvent decode_request_tcp(const char *receive_buffer, int length, sRequest *request);
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include "encode_msg.h"
+#include "fsm.h"
+#include "request.h"
+#include "tcp_framer.h"
+#include "timer_wheel.h"
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Declaration of the reference server of IPK24-CHAT
+
+// Most unconfirmed UDP messages of one client, has to be a power of two
+#define SERVER_WINDOW 1024
+
+// Most bytes waiting for a slow TCP client, a client that does not read is disconnected
+#define SERVER_OUT_LIMIT (1 << 20)
+
+// Channel every client joins after AUTH, and the DisplayName of messages from the server
+#define DEFAULT_CHANNEL "general"
+#define SERVER_NAME "Server"
+
+struct sClient;
+
+// Declaration of a channel, members are linked through the clients
+typedef struct sChannel
+{
+    char name[CHANNEL_ID_LENGTH + 1];
+    struct sClient *members;
+    unsigned member_count;
+    struct sChannel *next;
+} sChannel;
+
+// Declaration of the outstanding UDP message, the timer entry has to be the first member
+typedef struct
+{
+    sTimerEntry timer;
+    struct sClient *client;
+    uint16_t hMessage_id; // MessageID in network byte order, as it is in the message
+    uint8_t retries;      // Retransmissions left
+    int length;
+    char data[];
+} sPending;
+
+// Declaration of one client, the linger timer entry has to be the first member
+typedef struct sClient
+{
+    sTimerEntry linger; // UDP client is kept a while after its end, to confirm repeated messages
+    int udp;
+    int socket; // TCP connection, or the socket of the dynamic port (UDP)
+    struct sockaddr_in address;
+    eSystemState state;
+    int closed;    // Socket is closed, the memory is freed after the current events
+    int lingered;  // Linger time of the UDP client has passed
+    unsigned delayed; // Messages of the client waiting in the delay queue
+    char display_name[DISPLAY_NAME_LENGTH + 1];
+
+    sChannel *channel;
+    struct sClient *channel_prev, *channel_next;
+    struct sClient *hash_next; // UDP clients by address
+    struct sClient *zombie_next;
+
+    // UDP: next MessageID, received MessageIDs, outstanding messages by MessageID
+    uint16_t message_id;
+    uint8_t *seen;
+    sPending **pending;
+    unsigned in_flight;
+    int lost; // Some message was never confirmed, the client is gone
+
+    // TCP: receive ring and data the socket did not take yet
+    sTcpRing *ring;
+    char *out;
+    size_t out_length, out_capacity;
+} sClient;
+
+// Counters printed when the server ends
+typedef struct
+{
+    unsigned long clients, peak_clients, accepted;
+    unsigned long received, duplicates, sent, confirms, retransmitted, lost, overflow;
+    unsigned long dropped_in, dropped_out, delayed, slow_clients;
+} sServerStats;
+
+// Arguments of the server, defined in "ipk24_server.c"
+extern uint16_t udp_timeout;
+extern uint8_t max_retransmissions;
+extern double loss_rate;
+extern uint32_t delay_ms;
+
+extern sServerStats stats;
+
+//-------------------------transport.c-------------------------
+int transport_init(int epoll_fd, void *retransmit_tag, void *delay_tag, unsigned seed);
+
+int transport_drop(void);
+
+void server_send(sClient *client, const char *data, int length);
+
+void server_send_confirm(sClient *client, uint16_t hRef_id);
+
+void server_confirmed(sClient *client, uint16_t hRef_id);
+
+void transport_retransmit_event(void);
+
+void transport_delay_event(void);
+
+void transport_writable(sClient *client);
+
+void transport_forget(sClient *client);
+
+//-------------------------client.c----------------------------
+int client_init(int epoll_fd, void *linger_tag);
+
+void client_accept(int listen_socket);
+
+void client_welcome(int welcome_socket);
+
+void client_receive(sClient *client);
+
+void client_lost(sClient *client);
+
+void client_check(sClient *client);
+
+void client_linger_event(void);
+
+void client_free_closed(void);
+
+#endif
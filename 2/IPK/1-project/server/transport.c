@@ -0,0 +1,361 @@
+#include "server.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Definition of the transport of the server, everything between a decoded message and the socket
+    - UDP reliability: every sent message (except CONFIRM) waits in the table of its client for CONFIRM,
+      its retransmission deadline is in a timer wheel (the one of the client). A client whose message
+      is not confirmed after all retries is gone.
+    - Loss injection (option --loss): every received and every sent datagram is thrown away
+      with the given probability, CONFIRMs too, as on a lossy link.
+    - Delay injection (option --delay): every sent message (both variants) waits in one queue for the given time.
+      The delay is the same for all messages, so the queue is ordered by deadline and needs only one timerfd,
+      and a TCP stream keeps its order.
+    - TCP output: a message the socket does not take at once waits in the buffer of the client
+      until the socket is writable, a client that does not read at all is disconnected.
+*/
+
+// Message waiting in the delay queue
+typedef struct sDelayed
+{
+    struct sDelayed *next;
+    uint64_t deadline_us;
+    sClient *client; // NULL when the client was closed in the meantime
+    int length;
+    char data[];
+} sDelayed;
+
+static int epoll_instance = -1;
+static sTimerWheel wheel;
+static unsigned random_state;
+
+static sDelayed *delay_head, *delay_tail;
+static int delay_fd = -1;
+
+// Current monotonic time in microseconds
+static uint64_t now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+// "retransmit_tag" and "delay_tag" are given back in "data.ptr" of the epoll events of both timers
+int transport_init(int epoll_fd, void *retransmit_tag, void *delay_tag, unsigned seed)
+{
+    epoll_instance = epoll_fd;
+    random_state = seed;
+    if (timer_wheel_init(&wheel, epoll_fd, retransmit_tag) == -1)
+        return -1;
+
+    delay_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (delay_fd == -1)
+        return -1;
+    struct epoll_event delay_event;
+    delay_event.events = EPOLLIN;
+    delay_event.data.ptr = delay_tag;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, delay_fd, &delay_event);
+}
+
+// Decides whether the datagram is lost, with the probability given by option --loss
+int transport_drop(void)
+{
+    return loss_rate > 0 && rand_r(&random_state) < loss_rate * ((double)RAND_MAX + 1);
+}
+
+static void transmit_udp(sClient *client, const char *data, int length)
+{
+    if (transport_drop())
+    {
+        stats.dropped_out++;
+        return;
+    }
+    if (sendto(client->socket, data, length, 0, (struct sockaddr *)&client->address, sizeof(client->address)) == -1 &&
+        errno != EAGAIN && errno != EWOULDBLOCK)
+        perror("sendto");
+}
+
+// The socket is watched for writability only while the buffer of the client is not empty
+static void watch_writable(sClient *client, int writable)
+{
+    struct epoll_event client_event;
+    client_event.events = EPOLLIN | (writable ? EPOLLOUT : 0);
+    client_event.data.ptr = client;
+    epoll_ctl(epoll_instance, EPOLL_CTL_MOD, client->socket, &client_event);
+}
+
+// A broken or too slow connection is shut down, its socket event then ends the client
+static void transmit_tcp(sClient *client, const char *data, int length)
+{
+    int sent = 0;
+    if (client->out_length == 0)
+    {
+        sent = send(client->socket, data, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent == length)
+            return;
+        if (sent == -1)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                shutdown(client->socket, SHUT_RDWR);
+                return;
+            }
+            sent = 0;
+        }
+    }
+
+    size_t rest = length - sent;
+    if (client->out_length + rest > SERVER_OUT_LIMIT)
+    {
+        stats.slow_clients++;
+        client->out_length = 0;
+        shutdown(client->socket, SHUT_RDWR);
+        return;
+    }
+    if (client->out_length + rest > client->out_capacity)
+    {
+        size_t capacity = client->out_capacity ? client->out_capacity : 4096;
+        while (capacity < client->out_length + rest)
+            capacity *= 2;
+        char *out = realloc(client->out, capacity);
+        if (out == NULL)
+        {
+            shutdown(client->socket, SHUT_RDWR);
+            return;
+        }
+        client->out = out;
+        client->out_capacity = capacity;
+    }
+    memcpy(client->out + client->out_length, data + sent, rest);
+    if (client->out_length == 0)
+        watch_writable(client, 1);
+    client->out_length += rest;
+}
+
+static void transmit_now(sClient *client, const char *data, int length)
+{
+    if (client->udp)
+        transmit_udp(client, data, length);
+    else
+        transmit_tcp(client, data, length);
+}
+
+// Arms the timerfd of the delay queue to its first message
+static void arm_delay(void)
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (delay_head != NULL)
+    {
+        spec.it_value.tv_sec = delay_head->deadline_us / 1000000;
+        spec.it_value.tv_nsec = (delay_head->deadline_us % 1000000) * 1000;
+    }
+    timerfd_settime(delay_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+static void transmit(sClient *client, const char *data, int length)
+{
+    if (delay_ms == 0)
+    {
+        transmit_now(client, data, length);
+        return;
+    }
+
+    sDelayed *entry = malloc(sizeof(sDelayed) + length);
+    if (entry == NULL)
+        return;
+    entry->next = NULL;
+    entry->deadline_us = now_us() + (uint64_t)delay_ms * 1000;
+    entry->client = client;
+    entry->length = length;
+    memcpy(entry->data, data, length);
+    client->delayed++;
+    stats.delayed++;
+
+    if (delay_tail != NULL)
+        delay_tail->next = entry;
+    else
+    {
+        delay_head = entry;
+        arm_delay();
+    }
+    delay_tail = entry;
+}
+
+/* Definition of function that sends a message to the client
+    UDP message is kept until its CONFIRM comes, a message whose slot is still taken
+    (SERVER_WINDOW messages of the client are unconfirmed) is thrown away and counted.
+*/
+void server_send(sClient *client, const char *data, int length)
+{
+    if (client->closed)
+        return;
+
+    if (client->udp && data[0] != 0x00)
+    {
+        uint16_t hMessage_id;
+        memcpy(&hMessage_id, data + 1, sizeof(hMessage_id));
+        sPending **slot = &client->pending[ntohs(hMessage_id) & (SERVER_WINDOW - 1)];
+        if (*slot != NULL)
+        {
+            stats.overflow++;
+            return;
+        }
+
+        sPending *message = malloc(sizeof(sPending) + length);
+        if (message == NULL)
+            return;
+        memset(&message->timer, 0, sizeof(message->timer));
+        message->client = client;
+        message->hMessage_id = hMessage_id;
+        message->retries = max_retransmissions;
+        message->length = length;
+        memcpy(message->data, data, length);
+        *slot = message;
+        client->in_flight++;
+        timer_wheel_add(&wheel, &message->timer, (uint32_t)udp_timeout * 1000);
+    }
+
+    stats.sent++;
+    transmit(client, data, length);
+}
+
+void server_send_confirm(sClient *client, uint16_t hRef_id)
+{
+    char confirm_msg[3];
+    stats.confirms++;
+    transmit(client, confirm_msg, encode_confirm(confirm_msg, hRef_id));
+}
+
+static void release(sPending *message)
+{
+    sClient *client = message->client;
+    timer_wheel_remove(&wheel, &message->timer);
+    client->pending[ntohs(message->hMessage_id) & (SERVER_WINDOW - 1)] = NULL;
+    client->in_flight--;
+    free(message);
+}
+
+// CONFIRM of unknown or already confirmed message is ignored
+void server_confirmed(sClient *client, uint16_t hRef_id)
+{
+    sPending *message = client->pending[ntohs(hRef_id) & (SERVER_WINDOW - 1)];
+    if (message != NULL && message->hMessage_id == hRef_id)
+        release(message);
+}
+
+// Definition of function that retransmits every message whose timeout has expired
+void transport_retransmit_event(void)
+{
+    sTimerEntry *entry = timer_wheel_expire(&wheel);
+    while (entry != NULL)
+    {
+        sTimerEntry *next = entry->next;
+        sPending *message = (sPending *)entry;
+        sClient *client = message->client;
+
+        if (client->lost)
+        {
+            // Client is already gone, its other messages are only forgotten
+            release(message);
+        }
+        else if (message->retries == 0)
+        {
+            stats.lost++;
+            client->lost = 1;
+            release(message);
+            client_lost(client);
+        }
+        else
+        {
+            // Another try to send message, with the same timeout
+            message->retries--;
+            stats.retransmitted++;
+            transmit(client, message->data, message->length);
+            timer_wheel_add(&wheel, &message->timer, (uint32_t)udp_timeout * 1000);
+        }
+        entry = next;
+    }
+}
+
+// Definition of function that sends every delayed message whose time has come
+void transport_delay_event(void)
+{
+    // Reading only resets the readiness of the timerfd
+    uint64_t expirations;
+    if (read(delay_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN)
+        perror("read");
+
+    uint64_t now = now_us();
+    while (delay_head != NULL && delay_head->deadline_us <= now)
+    {
+        sDelayed *entry = delay_head;
+        delay_head = entry->next;
+        if (delay_head == NULL)
+            delay_tail = NULL;
+
+        if (entry->client != NULL)
+        {
+            entry->client->delayed--;
+            transmit_now(entry->client, entry->data, entry->length);
+            client_check(entry->client);
+        }
+        free(entry);
+    }
+    arm_delay();
+}
+
+// Definition of function that sends the buffered data of the TCP client when its socket is writable
+void transport_writable(sClient *client)
+{
+    size_t sent = 0;
+    while (sent < client->out_length)
+    {
+        int result = send(client->socket, client->out + sent, client->out_length - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (result == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                shutdown(client->socket, SHUT_RDWR);
+                sent = client->out_length;
+            }
+            break;
+        }
+        sent += result;
+    }
+
+    memmove(client->out, client->out + sent, client->out_length - sent);
+    client->out_length -= sent;
+    if (client->out_length == 0)
+        watch_writable(client, 0);
+}
+
+// Definition of function that forgets everything that is still to be sent to the client, before it is closed
+void transport_forget(sClient *client)
+{
+    if (client->pending != NULL)
+    {
+        for (int i = 0; i < SERVER_WINDOW; i++)
+        {
+            if (client->pending[i] != NULL)
+                release(client->pending[i]);
+        }
+    }
+    for (sDelayed *entry = delay_head; entry != NULL; entry = entry->next)
+    {
+        if (entry->client == client)
+            entry->client = NULL;
+    }
+    client->delayed = 0;
+    client->out_length = 0;
+}
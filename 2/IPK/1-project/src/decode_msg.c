@@ -1,181 +1,199 @@
 #include "decode_msg.h"
-#include "udp_send.h"
-#include <stdio.h>
+#include "encode_msg.h"
 #include <string.h>
-/*  Definition of function, that decodes received message and sending corresponding confirm message 
+
+/*  Definition of function, that decodes received message
     Implementet in both variants (UDP and TCP)
+
+    Nothing is copied, every field of "sDecodedMsg" is a view (pointer and length) into the receive buffer,
+    so the buffer has to stay untouched until the message is printed.
+    The whole message is validated in one pass from left to right:
+    - DisplayName has 1 to 20 printable characters (0x21-0x7E)
+    - MessageContent has at most 1400 characters
 */
 
+static const sMsgField success_name = {"Success", 7};
+static const sMsgField failure_name = {"Failure", 7};
+
+static int is_display_name(const char *data, int length)
+{
+    if (length < 1 || length > DISPLAY_NAME_LENGTH)
+        return 0;
+    for (int i = 0; i < length; i++)
+    {
+        if (data[i] < 0x21 || data[i] > 0x7E)
+            return 0;
+    }
+    return 1;
+}
+
+// Reads zero-terminated field starting at "offset", returns offset behind the terminating 0x00, or -1
+static int read_field(const char *receive_buffer, int length, int offset, sMsgField *field)
+{
+    const char *end = memchr(receive_buffer + offset, 0x00, length - offset);
+    if (end == NULL)
+        return -1;
+
+    field->data = receive_buffer + offset;
+    field->length = end - field->data;
+    return offset + field->length + 1;
+}
+
 //-------------------------UDP--------------------------------
-eSystemEvent decode_msg(char *receive_buffer, char *users_name, char *msg_content)
+eSystemEvent decode_msg(const char *receive_buffer, int length, sDecodedMsg *decoded)
 {
-    short int msg_result;
-    char confirm_msg[3];
+    int offset;
 
-    // Constructing and sending corresponding confirm message
-    confirm_msg[0] = 0x00;
-    *((uint16_t *)(confirm_msg + 1)) = *((uint16_t *)(receive_buffer + 1));
-    udp_send(confirm_msg, "", 3);
+    decoded->name.data = decoded->content.data = "";
+    decoded->name.length = decoded->content.length = 0;
+    if (length < 3)
+        return msg_error_Event;
+    memcpy(&decoded->hMessage_id, receive_buffer + 1, sizeof(uint16_t));
+    decoded->hRef_id = decoded->hMessage_id;
 
     // Switch case for type of the message
-    switch (receive_buffer[0])
+    switch ((unsigned char)receive_buffer[0])
+    {
+    case 0x00:
     {
-    case (char)0x01:
+        // Case for CONFIRM, nothing more to decode
+        return null_Event;
+    }
+    case 0x01:
     {
         // Case for REPLY
-        msg_result = receive_buffer[3];
-        receive_buffer += 6;
-        strcpy(msg_content, receive_buffer);
-        if (msg_result == 1)
+        if (length < 6)
+            return msg_error_Event;
+        memcpy(&decoded->hRef_id, receive_buffer + 4, sizeof(uint16_t));
+        offset = read_field(receive_buffer, length, 6, &decoded->content);
+        if (offset == -1 || decoded->content.length > CONTENT_LENGTH)
+            return msg_error_Event;
+
+        if (receive_buffer[3] == 1)
         {
-            strcpy(users_name, "Success");
+            decoded->name = success_name;
             return reply_ok_Event;
         }
-        else if (msg_result == 0)
+        else if (receive_buffer[3] == 0)
         {
-            strcpy(users_name, "Failure");
+            decoded->name = failure_name;
             return reply_nok_Event;
         }
         else
             return error_Event;
-        break;
-    }
-    case (char)0x04:
-    {
-        // Case for MSG
-        receive_buffer += 3;
-        strcpy(users_name, receive_buffer);
-        receive_buffer += strlen(users_name) + 1;
-        strcpy(msg_content, receive_buffer);
-        return msg_inc_Event;
-        break;
     }
-    case (char)0xfe:
+    case 0x04:
+    case 0xfe:
     {
-        // Case for ERROR
-        receive_buffer += 3;
-        strcpy(users_name, receive_buffer);
-        receive_buffer += strlen(users_name) + 1;
-        strcpy(msg_content, receive_buffer);
-        msg_result = 0;
-        return error_inc_Event;
-        break;
+        // Case for MSG and ERROR
+        offset = read_field(receive_buffer, length, 3, &decoded->name);
+        if (offset == -1 || !is_display_name(decoded->name.data, decoded->name.length))
+            return msg_error_Event;
+        offset = read_field(receive_buffer, length, offset, &decoded->content);
+        if (offset == -1 || decoded->content.length > CONTENT_LENGTH)
+            return msg_error_Event;
+
+        return receive_buffer[0] == 0x04 ? msg_inc_Event : error_inc_Event;
     }
-    case (char)0xff:
+    case 0xff:
     {
-        // Case for BYE 
+        // Case for BYE
         return bye_Event;
     }
     default:
         // Case for unknown message
         return msg_error_Event;
-        break;
     }
-
-    return 0;
 }
 
 //-----------------------------TCP------------------------------
-// TCP variant of function uses same principle with token parsing, that used in "input_parse();"
-eSystemEvent decode_msg_tcp(char *receive_buffer, char *users_name, char *msg_content)
+
+// Checks that the text at "*position" starts with "word" and moves behind it
+static int match(const char **position, const char *end, const char *word)
 {
-    char *token_result[6];
+    size_t word_length = strlen(word);
+    if ((size_t)(end - *position) < word_length || memcmp(*position, word, word_length) != 0)
+        return 0;
+    *position += word_length;
+    return 1;
+}
 
-    // Token check for command type
-    token_result[0] = strtok(receive_buffer, " ");
-    if (strcmp(token_result[0], "REPLY") == 0)
-    {
-        // Check if tokens are correct
-        for (int i = 1; i <= 3; i++)
-        {
-            if (i == 3)
-                token_result[i] = strtok(NULL, "\r\n");
-            else
-                token_result[i] = strtok(NULL, " ");
-
-            if (token_result[i] == NULL)
-            {
-                return msg_error_Event;
-            }
-        }
+// Reads DisplayName terminated with one space, the space is skipped
+static int read_display_name(const char **position, const char *end, sMsgField *field)
+{
+    const char *space = memchr(*position, ' ', end - *position);
+    if (space == NULL || !is_display_name(*position, space - *position))
+        return 0;
+
+    field->data = *position;
+    field->length = space - *position;
+    *position = space + 1;
+    return 1;
+}
 
-        if (strcmp(token_result[2], "IS") != 0)
-            return msg_error_Event;
+// Reads MessageContent up to the end of the message, it cannot be empty
+static int read_content(const char *position, const char *end, sMsgField *field)
+{
+    if (position >= end || end - position > CONTENT_LENGTH)
+        return 0;
 
-        strcpy(msg_content, token_result[3]);
+    field->data = position;
+    field->length = end - position;
+    return 1;
+}
 
-        if (strcmp(token_result[1], "OK") == 0)
-        {
-            strcpy(users_name, "Success");
-            return reply_ok_Event;
-        }
-        else if (strcmp(token_result[1], "NOK") == 0)
+/* TCP variant of function checks the grammar directly on the received text
+    REPLY {OK|NOK} IS {MessageContent}\r\n
+    MSG FROM {DisplayName} IS {MessageContent}\r\n
+    ERR FROM {DisplayName} IS {MessageContent}\r\n
+    BYE\r\n
+*/
+eSystemEvent decode_msg_tcp(const char *receive_buffer, int length, sDecodedMsg *decoded)
+{
+    const char *position = receive_buffer;
+    const char *end = receive_buffer + length;
+
+    decoded->hMessage_id = decoded->hRef_id = 0;
+    decoded->name.data = decoded->content.data = "";
+    decoded->name.length = decoded->content.length = 0;
+
+    // Every message ends with "\r\n", which is not a part of any field
+    if (length < 2 || end[-2] != '\r' || end[-1] != '\n')
+        return msg_error_Event;
+    end -= 2;
+
+    if (match(&position, end, "REPLY "))
+    {
+        eSystemEvent event;
+        if (match(&position, end, "OK "))
         {
-            strcpy(users_name, "Failure");
-            return reply_nok_Event;
+            decoded->name = success_name;
+            event = reply_ok_Event;
         }
-    }
-    else if (strcmp(token_result[0], "MSG") == 0)
-    {
-        // Check if tokens are correct
-        for (int i = 1; i <= 4; i++)
+        else if (match(&position, end, "NOK "))
         {
-            if (i == 4)
-                token_result[i] = strtok(NULL, "\r\n");
-            else
-                token_result[i] = strtok(NULL, " ");
-
-            if (token_result[i] == NULL)
-            {
-                return msg_error_Event;
-            }
+            decoded->name = failure_name;
+            event = reply_nok_Event;
         }
-
-        if (strcmp(token_result[1], "FROM") != 0)
+        else
             return msg_error_Event;
 
-        if (strcmp(token_result[3], "IS") != 0)
+        if (!match(&position, end, "IS ") || !read_content(position, end, &decoded->content))
             return msg_error_Event;
-
-        strcpy(users_name, token_result[2]);
-        strcpy(msg_content, token_result[4]);
-
-        return msg_inc_Event;
+        return event;
     }
-    else if (strcmp(token_result[0], "ERR") == 0)
+    else if (match(&position, end, "MSG FROM ") || match(&position, end, "ERR FROM "))
     {
-        // Check if tokens are correct
-        for (int i = 1; i <= 4; i++)
-        {
-            if (i == 4)
-                token_result[i] = strtok(NULL, "\r\n");
-            else
-                token_result[i] = strtok(NULL, " ");
-
-            if (token_result[i] == NULL)
-            {
-                return msg_error_Event;
-            }
-        }
+        eSystemEvent event = receive_buffer[0] == 'M' ? msg_inc_Event : error_inc_Event;
 
-        if (strcmp(token_result[1], "FROM") != 0)
+        if (!read_display_name(&position, end, &decoded->name) || !match(&position, end, "IS ") ||
+            !read_content(position, end, &decoded->content))
             return msg_error_Event;
-
-        if (strcmp(token_result[3], "IS") != 0)
-            return msg_error_Event;
-
-        strcpy(users_name, token_result[2]);
-        strcpy(msg_content, token_result[4]);
-
-        return error_inc_Event;
+        return event;
     }
-    else if (strcmp(token_result[0], "BYE") == 0)
+    else if (match(&position, end, "BYE") && (position == end || *position == ' '))
     {
         return bye_Event;
     }
-    else
-    {
-        return msg_error_Event;
-    }
-    return null_Event;
-}
\ No newline at end of file
+    return msg_error_Event;
+}
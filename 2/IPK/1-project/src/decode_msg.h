@@ -1,8 +1,26 @@
+#ifndef DECODE_MSG_H
+#define DECODE_MSG_H
 #include "fsm.h"
 #include <stdint.h>
-#include <sys/socket.h>
 
-eSystemEvent decode_msg(char *receive_buffer, char *users_name, char *msg_content);
+// View of one field of a received message, points straight into the receive buffer and is not terminated
+typedef struct
+{
+    const char *data;
+    int length;
+} sMsgField;
 
-eSystemEvent decode_msg_tcp(char *receive_buffer, char *users_name, char *msg_content);
-               
+// Fields of a decoded message
+typedef struct
+{
+    uint16_t hMessage_id; // MessageID in network byte order (UDP)
+    uint16_t hRef_id;     // refMessageID in network byte order (UDP CONFIRM and REPLY)
+    sMsgField name;       // DisplayName, or "Success" / "Failure" for REPLY
+    sMsgField content;    // MessageContent
+} sDecodedMsg;
+
+eSystemEvent decode_msg(const char *receive_buffer, int length, sDecodedMsg *decoded);
+
+eSystemEvent decode_msg_tcp(const char *receive_buffer, int length, sDecodedMsg *decoded);
+
+#endif
@@ -0,0 +1,160 @@
+#include "encode_msg.h"
+#include <arpa/inet.h>
+#include <string.h>
+
+/* Definition of message encoders for both variants (UDP and TCP)
+    Every encoder writes the whole frame into "buffer" and returns its exact length.
+    Fields are given as views (pointer and length), so nothing has to be terminated or measured again.
+    Callers check the lengths of fields against the limits in "encode_msg.h",
+    so every frame fits into a buffer of SEND_LENGTH bytes.
+*/
+
+// Copies the field and moves behind it
+static char *put_field(char *position, sMsgField field)
+{
+    memcpy(position, field.data, field.length);
+    return position + field.length;
+}
+
+// Copies the text without its terminating 0x00 and moves behind it
+static char *put_text(char *position, const char *text)
+{
+    size_t length = strlen(text);
+    memcpy(position, text, length);
+    return position + length;
+}
+
+// Writes the header of the UDP message: type and MessageID in network byte order
+static char *put_header(char *position, unsigned char type, uint16_t message_id)
+{
+    uint16_t hMessage_id = htons(message_id);
+    position[0] = type;
+    memcpy(position + 1, &hMessage_id, sizeof(hMessage_id));
+    return position + 3;
+}
+
+//-------------------------UDP--------------------------------
+
+int encode_confirm(char *buffer, uint16_t hRef_id)
+{
+    buffer[0] = 0x00;
+    memcpy(buffer + 1, &hRef_id, sizeof(hRef_id));
+    return 3;
+}
+
+int encode_auth(char *buffer, uint16_t message_id, sMsgField username, sMsgField display_name, sMsgField secret)
+{
+    char *position = put_header(buffer, 0x02, message_id);
+    position = put_field(position, username);
+    *position++ = 0x00;
+    position = put_field(position, display_name);
+    *position++ = 0x00;
+    position = put_field(position, secret);
+    *position++ = 0x00;
+    return position - buffer;
+}
+
+int encode_join(char *buffer, uint16_t message_id, sMsgField channel_id, sMsgField display_name)
+{
+    char *position = put_header(buffer, 0x03, message_id);
+    position = put_field(position, channel_id);
+    *position++ = 0x00;
+    position = put_field(position, display_name);
+    *position++ = 0x00;
+    return position - buffer;
+}
+
+// MSG and ERR messages have the same fields
+static int encode_content(char *buffer, unsigned char type, uint16_t message_id, sMsgField display_name,
+                          sMsgField content)
+{
+    char *position = put_header(buffer, type, message_id);
+    position = put_field(position, display_name);
+    *position++ = 0x00;
+    position = put_field(position, content);
+    *position++ = 0x00;
+    return position - buffer;
+}
+
+int encode_msg(char *buffer, uint16_t message_id, sMsgField display_name, sMsgField content)
+{
+    return encode_content(buffer, 0x04, message_id, display_name, content);
+}
+
+int encode_err(char *buffer, uint16_t message_id, sMsgField display_name, sMsgField content)
+{
+    return encode_content(buffer, 0xfe, message_id, display_name, content);
+}
+
+int encode_bye(char *buffer, uint16_t message_id)
+{
+    return put_header(buffer, 0xff, message_id) - buffer;
+}
+
+// REPLY is sent only by the server (server/ipk24_server)
+int encode_reply(char *buffer, uint16_t message_id, int result, uint16_t hRef_id, sMsgField content)
+{
+    char *position = put_header(buffer, 0x01, message_id);
+    *position++ = result ? 1 : 0;
+    memcpy(position, &hRef_id, sizeof(hRef_id));
+    position = put_field(position + sizeof(hRef_id), content);
+    *position++ = 0x00;
+    return position - buffer;
+}
+
+//-------------------------TCP--------------------------------
+
+int encode_auth_tcp(char *buffer, sMsgField username, sMsgField display_name, sMsgField secret)
+{
+    char *position = put_text(buffer, "AUTH ");
+    position = put_field(position, username);
+    position = put_text(position, " AS ");
+    position = put_field(position, display_name);
+    position = put_text(position, " USING ");
+    position = put_field(position, secret);
+    position = put_text(position, "\r\n");
+    return position - buffer;
+}
+
+int encode_join_tcp(char *buffer, sMsgField channel_id, sMsgField display_name)
+{
+    char *position = put_text(buffer, "JOIN ");
+    position = put_field(position, channel_id);
+    position = put_text(position, " AS ");
+    position = put_field(position, display_name);
+    position = put_text(position, "\r\n");
+    return position - buffer;
+}
+
+int encode_msg_tcp(char *buffer, sMsgField display_name, sMsgField content)
+{
+    char *position = put_text(buffer, "MSG FROM ");
+    position = put_field(position, display_name);
+    position = put_text(position, " IS ");
+    position = put_field(position, content);
+    position = put_text(position, "\r\n");
+    return position - buffer;
+}
+
+int encode_err_tcp(char *buffer, sMsgField display_name, sMsgField content)
+{
+    char *position = put_text(buffer, "ERR FROM ");
+    position = put_field(position, display_name);
+    position = put_text(position, " IS ");
+    position = put_field(position, content);
+    position = put_text(position, "\r\n");
+    return position - buffer;
+}
+
+int encode_bye_tcp(char *buffer)
+{
+    return put_text(buffer, "BYE\r\n") - buffer;
+}
+
+int encode_reply_tcp(char *buffer, int result, sMsgField content)
+{
+    char *position = put_text(buffer, result ? "REPLY OK IS " : "REPLY NOK IS ");
+    position = put_field(position, content);
+    position = put_text(position, "\r\n");
+    return position - buffer;
+}
@@ -0,0 +1,46 @@
+#ifndef ENCODE_MSG_H
+#define ENCODE_MSG_H
+#include "decode_msg.h"
+#include <stdint.h>
+
+// Declaration of message encoders for both variants (UDP and TCP)
+
+// Longest allowed fields, longer fields are rejected before encoding
+#define USERNAME_LENGTH 20
+#define SECRET_LENGTH 128
+#define DISPLAY_NAME_LENGTH 20
+#define CHANNEL_ID_LENGTH 20
+#define CONTENT_LENGTH 1400
+
+// Size of the send buffer, the longest frame of both variants (MSG with the longest fields) fits into it
+#define SEND_LENGTH 1536
+
+//-------------------------UDP--------------------------------
+int encode_confirm(char *buffer, uint16_t hRef_id);
+
+int encode_auth(char *buffer, uint16_t message_id, sMsgField username, sMsgField display_name, sMsgField secret);
+
+int encode_join(char *buffer, uint16_t message_id, sMsgField channel_id, sMsgField display_name);
+
+int encode_msg(char *buffer, uint16_t message_id, sMsgField display_name, sMsgField content);
+
+int encode_err(char *buffer, uint16_t message_id, sMsgField display_name, sMsgField content);
+
+int encode_bye(char *buffer, uint16_t message_id);
+
+int encode_reply(char *buffer, uint16_t message_id, int result, uint16_t hRef_id, sMsgField content);
+
+//-------------------------TCP--------------------------------
+int encode_auth_tcp(char *buffer, sMsgField username, sMsgField display_name, sMsgField secret);
+
+int encode_join_tcp(char *buffer, sMsgField channel_id, sMsgField display_name);
+
+int encode_msg_tcp(char *buffer, sMsgField display_name, sMsgField content);
+
+int encode_err_tcp(char *buffer, sMsgField display_name, sMsgField content);
+
+int encode_bye_tcp(char *buffer);
+
+int encode_reply_tcp(char *buffer, int result, sMsgField content);
+
+#endif
@@ -9,6 +9,7 @@ typedef enum
     Auth_State,
     Open_State,
     Error_State,
+    End_State, // Connection is ended, by BYE from either side
 } eSystemState;
 
 
@@ -0,0 +1,162 @@
+#include "input_buffer.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/* Definition of the buffered reader of STDIN
+    One "read();" takes everything that is available on STDIN, which can be many lines when
+    STDIN is a pipe or a file, so the lines are taken from the buffer one by one and sent back to back.
+    Lines stay in the buffer while they cannot be sent (full UDP window, waiting for REPLY),
+    and STDIN is taken out of epoll only when the buffer is full or the input has ended.
+
+    A regular file cannot be added to epoll, it is always readable, so it is read directly
+    whenever the buffer has no complete line.
+*/
+
+static char buffer[INPUT_BUFFER_SIZE];
+static size_t start;   // Index of the first not yet taken byte
+static size_t length;  // Number of not yet taken bytes
+static size_t scanned; // Number of bytes already searched for the end of line
+
+static int end_of_input = 0;
+static int skipping = 0; // Rest of a too long line is thrown away
+static int registered = 0;
+static int regular_file = 0;
+static int epoll_instance = -1;
+static void *epoll_tag = NULL; // "data.ptr" of STDIN events, the main loop knows them by it
+
+// STDIN is in epoll only while there is a free place in the buffer
+static void update_stdin(void)
+{
+    int wanted = !end_of_input && !regular_file && length < INPUT_BUFFER_SIZE;
+    if (wanted == registered)
+        return;
+
+    struct epoll_event stdin_event;
+    stdin_event.events = EPOLLIN;
+    stdin_event.data.ptr = epoll_tag;
+    epoll_ctl(epoll_instance, wanted ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, 0, &stdin_event);
+    registered = wanted;
+}
+
+int input_init(int epoll_fd, void *tag)
+{
+    struct epoll_event stdin_event;
+    stdin_event.events = EPOLLIN;
+    stdin_event.data.ptr = tag;
+
+    epoll_instance = epoll_fd;
+    epoll_tag = tag;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, 0, &stdin_event) == 0)
+        registered = 1;
+    else if (errno == EPERM)
+        regular_file = 1;
+    else
+        return -1;
+    return 0;
+}
+
+/* Definition of function that reads everything available on STDIN into the buffer
+    Returns the same value as "read();", 0 when the input has ended
+*/
+int input_read(void)
+{
+    // Taken lines are removed from the front, so the whole free space is in one piece
+    if (start > 0)
+    {
+        memmove(buffer, buffer + start, length);
+        start = 0;
+    }
+    if (length == INPUT_BUFFER_SIZE)
+        return -1;
+
+    int received = read(0, buffer + length, INPUT_BUFFER_SIZE - length);
+    if (received > 0)
+        length += received;
+    else if (received == 0)
+        end_of_input = 1;
+    else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+    {
+        perror("read");
+        end_of_input = 1;
+    }
+    update_stdin();
+    return received;
+}
+
+static void discard(size_t count)
+{
+    start += count;
+    length -= count;
+    scanned = 0;
+    if (length == 0)
+        start = 0;
+    update_stdin();
+}
+
+/* Definition of function that tells whether a line can be taken by "input_next();"
+    Line is complete when it ends with "\n", or when it is the last one of the input.
+    Every byte is searched for the end of line only once, no matter how many times it is asked.
+*/
+int input_ready(void)
+{
+    while (1)
+    {
+        char *end = memchr(buffer + start + scanned, '\n', length - scanned);
+        if (end != NULL)
+        {
+            scanned = end - (buffer + start);
+            if (!skipping)
+                return 1;
+
+            // End of the too long line, the next line is taken normally
+            skipping = 0;
+            discard(scanned + 1);
+            continue;
+        }
+        scanned = length;
+
+        if (skipping || length == INPUT_BUFFER_SIZE)
+        {
+            // Line longer than the whole buffer can never be sent
+            if (!skipping)
+                fprintf(stderr, "ERR: command error: too long\n");
+            skipping = 1;
+            discard(length);
+        }
+        else if (end_of_input)
+            return length > 0;
+
+        if (!regular_file || end_of_input || input_read() <= 0)
+            return 0;
+    }
+}
+
+/* Definition of function that takes the next line from the buffer
+    "*line" points to the line directly in the buffer, without "\n" (or "\r\n"),
+    and stays valid until the next "input_read();".
+    Returns length of the line, -1 if there is no complete line yet
+*/
+int input_next(const char **line)
+{
+    if (!input_ready())
+        return -1;
+
+    // Last line of the input does not have to end with "\n"
+    size_t line_length = scanned;
+    size_t consumed = scanned < length ? scanned + 1 : length;
+
+    *line = buffer + start;
+    if (line_length > 0 && buffer[start + line_length - 1] == '\r')
+        line_length--;
+    discard(consumed);
+    return line_length;
+}
+
+// Definition of function that tells whether the input has ended and every line was taken
+int input_closed(void)
+{
+    return end_of_input && length == 0;
+}
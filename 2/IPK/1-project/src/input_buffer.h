@@ -0,0 +1,19 @@
+#ifndef INPUT_BUFFER_H
+#define INPUT_BUFFER_H
+
+// Declaration of the buffered reader of lines from STDIN
+
+// Size of the buffer, a longer line is thrown away
+#define INPUT_BUFFER_SIZE 65536
+
+int input_init(int epoll_fd, void *tag);
+
+int input_read(void);
+
+int input_ready(void);
+
+int input_next(const char **line);
+
+int input_closed(void);
+
+#endif
@@ -1,398 +1,165 @@
 #include "input_parse.h"
-#include "avars.h"
-#include <arpa/inet.h>
+#include "encode_msg.h"
 #include <stdio.h>
 #include <string.h>
-#define INPUT_LENGTH 1400
+
+// Command with the most words is "/auth {Username} {Secret} {DisplayName}"
+#define MAX_WORDS 4
+#define COMMAND_LENGTH 10
 
 /* Definition of function input parse implemented in both variants (UDP and TCP)
-    This function provides parsing of arguments provided by user in STDIN,
+    This function provides parsing of one line provided by user in STDIN (without its end),
     and returns an event on the basis of which it will be decided whether to send a message or not.
+    The variant, DisplayName and MessageID are taken from the session the line belongs to.
 
-    Function also constructing a message, determine lenght of this message
-    and assigns it to a variables "char *msg" and "int *msg_length".
+    The line is split into words in one pass and is never changed, every word is a view
+    (pointer and length) into the line. Only DisplayName is copied, it is needed for later messages.
+    Message is then built by the encoder of the variant into "msg" (SEND_LENGTH bytes),
+    which also gives its exact length in "int *msg_length".
 */
-eSystemEvent input_parse(char *command, char *username, char *secret, char *display_name,
-                         char *channel_id, char *read_buff, char *msg, int *msg_length)
-{
-    // Assign message ID to network byte order
-    uint16_t hMessage_id = htons(message_id);
-
-    char *token_result;
-
-    // Assign a variable adrres pointing to an array msg for later determination of message length
-    char *start_msg_length = msg;
 
-    memset(command, 0, 10);
-
-    // Fgets LOL :)
-    memset(read_buff, 0, INPUT_LENGTH);
-    fgets(read_buff, INPUT_LENGTH, stdin);
-
-    /* IF-ELSE down bellow is decideing which of the commands is provided by user
-    if read_buff is starting with "/", else it will imply, that user provided an MESSAGE, not an command
-    */
-    if (read_buff[0] == '/')
+// Splits the line into words separated by spaces, returns number of words (at most max_words + 1)
+static int split_line(const char *line, int line_length, sMsgField *words, int max_words)
+{
+    int count = 0;
+    for (const char *position = line; position < line + line_length; position++)
     {
-        // Case for command
+        if (*position == ' ')
+            continue;
 
-        // Removing "\n" char from read_buff, so it can easier work with tokens
-        read_buff[strlen(read_buff) - 1] = 0x00;
-
-        // Splitting into tokens using "strtok();"
-        token_result = strtok(read_buff, " ");
-        if (token_result == NULL || strlen(token_result) > 10)
-        {
-            fprintf(stderr, "ERR: command error\n");
-            return null_Event;
-        }
-        strcpy(command, token_result);
-        if (strcmp(command, "/auth") == 0)
-        {
-            // Case for /auth
-
-            memset(username, 0, 20);
-            memset(secret, 0, 128);
-            memset(channel_id, 0, 20);
-            memset(display_name, 0, 20);
-
-            // Cheking if command format is correct
-            token_result = strtok(NULL, " ");
-            if (token_result == NULL || strlen(token_result) > 20)
-            {
-                fprintf(stderr, "ERR: command error\n");
-                return null_Event;
-            }
-            strcpy(username, token_result);
-
-            token_result = strtok(NULL, " ");
-            if (token_result == NULL || strlen(token_result) > 128)
-            {
-                fprintf(stderr, "ERR: command error\n");
-                return null_Event;
-            }
-            strcpy(secret, token_result);
-
-            token_result = strtok(NULL, " ");
-            if (token_result == NULL || strlen(token_result) > 20)
-            {
-                fprintf(stderr, "ERR: command error\n");
-                return null_Event;
-            }
-            strcpy(display_name, token_result);
-
-            token_result = strtok(NULL, " ");
-            if (token_result != NULL)
-            {
-                fprintf(stderr, "ERR: command error: too long\n");
-                return null_Event;
-            }
-
-            // Constructing message to be send by moving pointer to an array "msg"
-            // to make sure, that 0x00 bytes will be included into a message
-            msg[0] = 0x02;
-            msg++;
-            *((uint16_t *)(msg + 1)) = hMessage_id;
-            msg += 2;
-            strcpy(msg, username);
-            msg += strlen(username) + 1;
-
-            strcpy(msg, display_name);
-            msg += strlen(display_name) + 1;
-
-            strcpy(msg, secret);
-            msg += strlen(secret) + 1;
-
-            // Finalising determination of message length by substracting
-            *msg_length = msg - start_msg_length;
-
-            return auth_Event;
-        }
-        else if (strcmp(command, "/join") == 0)
+        if (position == line || position[-1] == ' ')
         {
-            // Case for "/join"
-
-            // Cheking if command format is correct
-            token_result = strtok(NULL, " ");
-            if (token_result == NULL || strlen(token_result) > 20)
-            {
-                fprintf(stderr, "ERR: command error\n");
-                return null_Event;
-            }
-            memset(channel_id, 0, 20);
-            strcpy(channel_id, token_result);
-
-            token_result = strtok(NULL, " ");
-            if (token_result != NULL)
-            {
-                fprintf(stderr, "ERR: command error: too long\n");
-                return null_Event;
-            }
-
-            // Constructing message to be send by moving pointer to an array "msg"
-            // to make sure, that 0x00 bytes will be included into a message
-            msg[0] = 0x03;
-            *((uint16_t *)(msg + 1)) = hMessage_id;
-            msg += 3;
-
-            strcpy(msg, channel_id);
-            msg += strlen(channel_id) + 1;
-
-            strcpy(msg, display_name);
-            msg += strlen(display_name) + 1;
-
-            // Finalising determination of message length by substracting
-            *msg_length = msg - start_msg_length;
-
-            return join_Event;
+            // More words than any command has, the rest is not needed
+            if (count == max_words + 1)
+                break;
+            words[count].data = position;
+            words[count].length = 0;
+            count++;
         }
-        else if (strcmp(command, "/rename") == 0)
-        {
-            // Case for "/rename"
-
-            // Cheking if command format is correct
-            token_result = strtok(NULL, " ");
-            if (token_result == NULL || strlen(token_result) > 20)
-            {
-                fprintf(stderr, "ERR: command error\n");
-                return null_Event;
-            }
-
-            memset(display_name, 0, 20);
-            strcpy(display_name, token_result);
-
-            token_result = strtok(NULL, " ");
-            if (token_result != NULL)
-            {
-                fprintf(stderr, "ERR: command error: too long\n");
-                return null_Event;
-            }
+        words[count - 1].length++;
+    }
+    return count;
+}
 
-            // Rename is an local command so no need to send message
-            return null_Event;
-        }
-        else if (strcmp(command, "/help") == 0)
-        {
-            printf("    /auth 	    {Username} {Secret} {DisplayName}\n");
-            printf("    /join 	    {ChannelID}\n");
-            printf("    /rename 	{DisplayName}\n");
-            printf("    /help \n");
+static int is_word(sMsgField word, const char *text)
+{
+    return (size_t)word.length == strlen(text) && memcmp(word.data, text, word.length) == 0;
+}
 
-            // No need to send message
-            return null_Event;
-        }
-        else
+// Checks number of arguments of the command and their lengths, prints the error
+static int check_arguments(int count, int expected, sMsgField *words, const int *max_lengths)
+{
+    for (int i = 1; i <= expected; i++)
+    {
+        if (i >= count || words[i].length > max_lengths[i - 1])
         {
-            fprintf(stderr, "ERR: unknown command\n");
-            return null_Event;
+            fprintf(stderr, "ERR: command error\n");
+            return 0;
         }
     }
-    else
+    if (count > expected + 1)
     {
-        // Case for MSG message
-
-        memset(msg, 0 , 1400);
-
-        // Check if frist symbol is printable
-        if (!(read_buff[0] >= 0x21 && read_buff[0] <= 0x7E))
-            return null_Event;
-
-        // Constructing message to be send by moving pointer to an array "msg"
-        // to make sure, that 0x00 bytes will be included into a message
-        msg[0] = 0x04;
-        *((uint16_t *)(msg + 1)) = hMessage_id;
-
-        msg += 3;
-        strcpy(msg, display_name);
-
-        msg += strlen(display_name) + 1;
-        strcpy(msg, read_buff);
-
-        msg += strlen(read_buff) + 1;
-        *msg_length = msg - start_msg_length;
-
-        return msg_outc_Event;
+        fprintf(stderr, "ERR: command error: too long\n");
+        return 0;
     }
-    return null_Event;
+    return 1;
 }
 
-// TCP message construct is way more simplier than UDP variant
-eSystemEvent input_parse_tcp(char *command, char *username, char *secret, char *display_name,
-                             char *channel_id, char *read_buff, char *msg, int *msg_length)
+static void set_display_name(char *display_name, sMsgField word)
 {
-    char *token_result;
+    memcpy(display_name, word.data, word.length);
+    display_name[word.length] = 0x00;
+}
 
-    // Assign a variable adrres pointing to an array msg for later determination of message length
-    char *start_msg_length = msg;
+static sMsgField display_name_field(const char *display_name)
+{
+    sMsgField field = {display_name, strlen(display_name)};
+    return field;
+}
 
-    memset(command, 0, 10);
+eSystemEvent input_parse(sSession *session, const char *line, int line_length, char *msg, int *msg_length)
+{
+    sMsgField words[MAX_WORDS + 1];
+    int tcp = !session->udp;
+    char *display_name = session->display_name;
 
-    memset(read_buff, 0, INPUT_LENGTH);
-    fgets(read_buff, INPUT_LENGTH, stdin);
+    if (line_length == 0)
+        return null_Event;
 
     /* IF-ELSE down bellow is decideing which of the commands is provided by user
-    if read_buff is starting with "/", else it will imply, that user provided an MESSAGE, not an command
+    if line is starting with "/", else it will imply, that user provided an MESSAGE, not an command
     */
-    if (read_buff[0] == '/')
+    if (line[0] == '/')
     {
         // Case for command
-
-        // Removing "\n" char from read_buff, so it can easier work with tokens
-        read_buff[strlen(read_buff) - 1] = 0x00;
-
-        // Splitting into tokens using "strtok();"
-        token_result = strtok(read_buff, " ");
-        if (token_result == NULL || strlen(token_result) > 10)
+        int count = split_line(line, line_length, words, MAX_WORDS);
+        if (words[0].length > COMMAND_LENGTH)
         {
             fprintf(stderr, "ERR: command error\n");
             return null_Event;
         }
-        strcpy(command, token_result);
-        if (strcmp(command, "/auth") == 0)
-        {
-            // Case for "/auth"
-
-            memset(username, 0, 20);
-            memset(secret, 0, 128);
-            memset(channel_id, 0, 20);
-            memset(display_name, 0, 20);
-
-            // Cheking if command format is correct
-            token_result = strtok(NULL, " ");
-            if (token_result == NULL || strlen(token_result) > 20)
-            {
-                fprintf(stderr, "ERR: command error\n");
-                return null_Event;
-            }
-            strcpy(username, token_result);
-
-            token_result = strtok(NULL, " ");
-            if (token_result == NULL || strlen(token_result) > 128)
-            {
-                fprintf(stderr, "ERR: command error\n");
-                return null_Event;
-            }
-            strcpy(secret, token_result);
 
-            token_result = strtok(NULL, " ");
-            if (token_result == NULL || strlen(token_result) > 20)
-            {
-                fprintf(stderr, "ERR: command error\n");
-                return null_Event;
-            }
-            strcpy(display_name, token_result);
-
-            token_result = strtok(NULL, " ");
-            if (token_result != NULL)
-            {
-                fprintf(stderr, "ERR: command error: too long\n");
+        if (is_word(words[0], "/auth"))
+        {
+            // Case for "/auth {Username} {Secret} {DisplayName}"
+            static const int max_lengths[] = {USERNAME_LENGTH, SECRET_LENGTH, DISPLAY_NAME_LENGTH};
+            if (!check_arguments(count, 3, words, max_lengths))
                 return null_Event;
-            }
-
-            // Constructing message
-            strcpy(msg, "AUTH ");
-            msg += strlen(msg);
-            strcpy(msg, username);
-            msg += strlen(msg);
-
-            strcpy(msg, " AS ");
-            msg += strlen(msg);
-
-            strcpy(msg, display_name);
-            msg += strlen(msg);
-
-            strcpy(msg, " USING ");
-            msg += strlen(msg);
-
-            strcpy(msg, secret);
-            msg += strlen(msg);
-            *msg = 0x0D;
-            msg++;
-            *msg = 0x0A;
-
-            // Finalising determination of message length
-            *msg_length = strlen(start_msg_length);
 
+            set_display_name(display_name, words[3]);
+            if (tcp)
+                *msg_length = encode_auth_tcp(msg, words[1], words[3], words[2]);
+            else
+                *msg_length = encode_auth(msg, session->message_id, words[1], words[3], words[2]);
             return auth_Event;
         }
-        else if (strcmp(command, "/join") == 0)
+        else if (is_word(words[0], "/join"))
         {
-            // Case for "/join"
-
-            // Cheking if command format is correct
-            token_result = strtok(NULL, " ");
-            if (token_result == NULL || strlen(token_result) > 20)
-            {
-                fprintf(stderr, "ERR: command error\n");
-                return null_Event;
-            }
-            memset(channel_id, 0, 20);
-            strcpy(channel_id, token_result);
-
-            token_result = strtok(NULL, " ");
-            if (token_result != NULL)
-            {
-                fprintf(stderr, "ERR: command error: too long\n");
+            // Case for "/join {ChannelID}"
+            static const int max_lengths[] = {CHANNEL_ID_LENGTH};
+            if (!check_arguments(count, 1, words, max_lengths))
                 return null_Event;
-            }
-
-            // Constructing message
-            strcpy(msg, "JOIN ");
-            msg += strlen(msg);
-
-            strcpy(msg, channel_id);
-            msg += strlen(msg);
-
-            strcpy(msg, " AS ");
-            msg += strlen(msg);
-
-            strcpy(msg, display_name);
-            msg += strlen(msg);
-            *msg = 0x0D;
-            msg++;
-            *msg = 0x0A;
 
-            // Finalising determination of message length
-            *msg_length = strlen(start_msg_length);
+            if (tcp)
+                *msg_length = encode_join_tcp(msg, words[1], display_name_field(display_name));
+            else
+                *msg_length = encode_join(msg, session->message_id, words[1], display_name_field(display_name));
             return join_Event;
         }
-        else if (strcmp(command, "/rename") == 0)
+        else if (is_word(words[0], "/rename"))
         {
-            // Case for "/rename"
-
-            // Cheking if command format is correct
-            token_result = strtok(NULL, " ");
-            if (token_result == NULL || strlen(token_result) > 20)
-            {
-                fprintf(stderr, "ERR: command error\n");
-                return null_Event;
-            }
-            memset(display_name, 0, 20);
-            strcpy(display_name, token_result);
-            
-            token_result = strtok(NULL, " ");
-            if (token_result != NULL)
-            {
-                fprintf(stderr, "ERR: command error: too long\n");
+            // Case for "/rename {DisplayName}"
+            static const int max_lengths[] = {DISPLAY_NAME_LENGTH};
+            if (!check_arguments(count, 1, words, max_lengths))
                 return null_Event;
-            }
 
             // Rename is an local command so no need to send message
+            set_display_name(display_name, words[1]);
             return null_Event;
         }
-        else if (strcmp(command, "/help") == 0)
+        else if (is_word(words[0], "/help"))
         {
             printf("    /auth 	    {Username} {Secret} {DisplayName}\n");
             printf("    /join 	    {ChannelID}\n");
             printf("    /rename 	{DisplayName}\n");
+            if (!tcp)
+                printf("    /stats\n");
             printf("    /help \n");
 
             // No need to send message
             return null_Event;
         }
+        else if (!tcp && is_word(words[0], "/stats"))
+        {
+            // Case for "/stats", prints round-trip time estimation and retransmission counters
+            udp_print_stats(session);
+
+            // Stats is an local command so no need to send message
+            return null_Event;
+        }
         else
         {
-            fprintf(stderr, "ERR: Unknown command");
+            fprintf(stderr, "ERR: unknown command\n");
             return null_Event;
         }
     }
@@ -400,30 +167,22 @@ eSystemEvent input_parse_tcp(char *command, char *username, char *secret, char *
     {
         // Case for MSG message
 
-        memset(msg, 0, 1400);
         // Check if frist symbol is printable
-        if (!(read_buff[0] >= 0x21 && read_buff[0] <= 0x7E))
+        if (!(line[0] >= 0x21 && line[0] <= 0x7E))
             return null_Event;
 
-        // Constructing message
-        strcpy(msg, "MSG FROM ");
-        msg += strlen(msg);
-
-        strcpy(msg, display_name);
-        msg += strlen(msg);
-
-        strcpy(msg, " IS ");
-        msg += strlen(msg);
-
-        strcpy(msg, read_buff);
-        msg += strlen(msg);
-        *msg = 0x0D;
-        msg++;
-        *msg = 0x0A;
+        if (line_length > CONTENT_LENGTH)
+        {
+            fprintf(stderr, "ERR: message too long\n");
+            return null_Event;
+        }
 
-        // Finalising determination of message length
-        *msg_length = strlen(start_msg_length);
+        // Content is the whole line
+        sMsgField content = {line, line_length};
+        if (tcp)
+            *msg_length = encode_msg_tcp(msg, display_name_field(display_name), content);
+        else
+            *msg_length = encode_msg(msg, session->message_id, display_name_field(display_name), content);
         return msg_outc_Event;
     }
-    return null_Event;
-}
\ No newline at end of file
+}
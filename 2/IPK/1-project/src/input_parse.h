@@ -1,10 +1,5 @@
 #include <stdint.h>
 #include "fsm.h"
+#include "session.h"
 
-eSystemEvent input_parse(char *command, char * username, char *secret, char *display_name,
-                         char *channel_id, char *read_buff, char *msg
-                         ,int *msg_lenght);
-
-eSystemEvent input_parse_tcp(char *command, char * username, char *secret, char *display_name,
-                         char *channel_id, char *read_buff, char *msg
-                         ,int *msg_lenght);
\ No newline at end of file
+eSystemEvent input_parse(sSession *session, const char *line, int line_length, char *msg, int *msg_length);
@@ -0,0 +1,566 @@
+#include "load.h"
+#include "avars.h"
+#include "encode_msg.h"
+#include "input_parse.h"
+#include "session.h"
+#include "timer_wheel.h"
+#include "udp_send.h"
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+
+/* Definition of the load generator
+    Instead of one chat session driven by STDIN, "--load N" opens N sessions from one process and one epoll loop.
+    Every session runs the same script (option --script, or AUTH, JOIN and "--messages" messages),
+    one line per tick of its own pacing timer ("--rate" lines per second), and ends it with BYE.
+    "$i" in a line is replaced by the number of the session, so every session can have its own Username.
+
+    Pacing timers of all sessions are kept in one timer wheel of their own (the same kind that drives
+    UDP retransmissions), so the number of sessions costs nothing while they wait. A tick is skipped while the session waits
+    for a REPLY or its UDP window is full. The tick also checks the REPLY deadline: a session whose REPLY
+    does not come in LOAD_REPLY_TIMEOUT_US, or one of whose UDP messages is given up (the connection
+    is lost), ends with an error, so every session ends even when the server does not answer.
+
+    Every sent MSG gets " #S.Q" appended (session S, its Q-th message). When the server broadcasts it
+    to another session of the process, the tag gives the time it was sent, so its delivery is measured.
+    Measured latencies:
+    - AUTH and JOIN, from sending to its REPLY
+    - MSG, from sending to its delivery to another session (needs a server that broadcasts to the channel)
+    - every UDP message, from its first sending to its CONFIRM
+    The report ends the program, percentiles of every latency, throughput and retransmissions are printed.
+*/
+
+// Kinds of measured latencies
+typedef enum
+{
+    Auth_Reply,
+    Join_Reply,
+    Msg_Delivery,
+    Auth_Confirm,
+    Join_Confirm,
+    Msg_Confirm,
+    Bye_Confirm,
+    Latency_Kinds,
+} eLatency;
+
+static const char *latency_names[Latency_Kinds] = {
+    "AUTH -> REPLY", "JOIN -> REPLY", "MSG delivery", "AUTH -> CONFIRM", "JOIN -> CONFIRM", "MSG -> CONFIRM", "BYE -> CONFIRM",
+};
+
+// Declaration of the samples of one kind of latency, in microseconds
+typedef struct
+{
+    uint32_t *samples;
+    size_t count;
+    size_t capacity;
+} sLatency;
+
+// Declaration of one session of the load generator, the pacing timer has to be the first member
+typedef struct
+{
+    sTimerEntry timer;
+    sSession session;
+    uint32_t index;
+    uint32_t line;    // Next line of the script
+    int failed; // Session has ended with an error, which is already counted
+    int closed;
+    int reply_kind;   // Latency measured by the next REPLY, -1 if none
+    uint64_t reply_sent_us;
+    uint32_t msg_count; // Number of sent MSGs, the tag of the next one
+    uint64_t msg_sent_us[LOAD_TRACK];
+} sLoadSession;
+
+static sLoadSession *sessions;
+static uint32_t session_count, active_count;
+
+static sMsgField *script;
+static uint32_t script_length;
+static char *script_data;
+
+static sTimerWheel pacing;
+static uint32_t interval_us;
+
+// Tags of the timer events, every other event belongs to a session ("data.ptr")
+static char pacing_tag;
+static void *retransmit_tag;
+
+static sLatency latencies[Latency_Kinds];
+static unsigned long sent_count[4]; // AUTH, JOIN, MSG, BYE
+static unsigned long received_count, rejected_count, error_count, timeout_count, skipped_ticks;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static char line_buff[2 * SEND_LENGTH], msg[SEND_LENGTH];
+
+// Current monotonic time in microseconds
+static uint64_t now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+static void record(eLatency kind, uint64_t latency_us)
+{
+    sLatency *latency = &latencies[kind];
+    if (latency->count == latency->capacity)
+    {
+        size_t capacity = latency->capacity ? latency->capacity * 2 : 1024;
+        uint32_t *samples = realloc(latency->samples, capacity * sizeof(uint32_t));
+        if (samples == NULL)
+            return;
+        latency->samples = samples;
+        latency->capacity = capacity;
+    }
+    latency->samples[latency->count++] = latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+}
+
+static sLoadSession *load_of(sSession *session)
+{
+    return (sLoadSession *)((char *)session - offsetof(sLoadSession, session));
+}
+
+/* Definition of function that reads the script, one line is one message or command
+    Without a script AUTH, JOIN and "--messages" messages are used
+*/
+static int load_script_lines(void)
+{
+    static sMsgField default_lines[] = {
+        {"/auth load$i secret load$i", 26},
+        {"/join load", 10},
+        {"load message", 12},
+    };
+
+    if (load_script == NULL)
+    {
+        script_length = 2 + load_messages;
+        script = malloc(script_length * sizeof(sMsgField));
+        if (script == NULL)
+            return -1;
+        for (uint32_t i = 0; i < script_length; i++)
+            script[i] = default_lines[i < 2 ? i : 2];
+        return 0;
+    }
+
+    FILE *file = fopen(load_script, "rb");
+    if (file == NULL)
+    {
+        perror(load_script);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    script_data = malloc(size + 1);
+    if (script_data == NULL || fread(script_data, 1, size, file) != (size_t)size)
+    {
+        fprintf(stderr, "ERR: cannot read %s\n", load_script);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    // Every line is a view into the file, empty lines are left out
+    script = malloc((size + 1) * sizeof(sMsgField));
+    if (script == NULL)
+        return -1;
+    char *line = script_data;
+    for (char *position = script_data; position <= script_data + size; position++)
+    {
+        if (position < script_data + size && *position != '\n')
+            continue;
+
+        int length = position - line;
+        if (length > 0 && line[length - 1] == '\r')
+            length--;
+        if (length > 0)
+        {
+            script[script_length].data = line;
+            script[script_length].length = length;
+            script_length++;
+        }
+        line = position + 1;
+    }
+    return 0;
+}
+
+// Copies the line of the script into "line_buff", "$i" is replaced by the number of the session
+static int expand_line(sMsgField line, uint32_t index)
+{
+    int length = 0;
+    for (int i = 0; i < line.length && length < (int)sizeof(line_buff) - 32; i++)
+    {
+        if (line.data[i] == '$' && i + 1 < line.length && line.data[i + 1] == 'i')
+        {
+            length += sprintf(line_buff + length, "%u", index);
+            i++;
+        }
+        else
+            line_buff[length++] = line.data[i];
+    }
+    return length;
+}
+
+static int send_message(sSession *session, int msg_length)
+{
+    if (session->udp)
+    {
+        udp_send(session, msg, msg_length);
+        return 0;
+    }
+    for (int sent = 0; sent < msg_length;)
+    {
+        int result = send(session->socket, msg + sent, msg_length - sent, 0);
+        if (result == -1 && errno == EINTR)
+            continue;
+        if (result <= 0)
+        {
+            perror("send failed");
+            return -1;
+        }
+        sent += result;
+    }
+    return 0;
+}
+
+/* Definition of function that sends the next line of the script of the session, or BYE after the last one
+    Lines that are not allowed in the current state are skipped, as in the chat client.
+*/
+static void load_send(sLoadSession *load)
+{
+    sSession *session = &load->session;
+    int msg_length;
+
+    if (session->bye_sent || (session->state != Auth_State && session->state != Open_State))
+        return;
+
+    // REPLY that did not come in time is not waited for any more
+    if (session->waiting_reply && now_us() - load->reply_sent_us >= LOAD_REPLY_TIMEOUT_US)
+    {
+        timeout_count++;
+        session->state = Error_State;
+        return;
+    }
+
+    // After Ctrl+C, BYE does not wait for a REPLY that may never come
+    if ((session->waiting_reply && !stop_requested) || (session->udp && !udp_window_free(session)))
+    {
+        skipped_ticks++;
+        return;
+    }
+
+    if (load->line >= script_length || stop_requested)
+    {
+        if (session_bye(session) == 0)
+            sent_count[3]++;
+        return;
+    }
+
+    int line_length = expand_line(script[load->line++], load->index);
+
+    // Every MSG is tagged, so its delivery to other sessions can be matched with the time it was sent
+    if (line_buff[0] != '/')
+        line_length += sprintf(line_buff + line_length, " #%u.%u", load->index, load->msg_count);
+
+    eSystemEvent event = input_parse(session, line_buff, line_length, msg, &msg_length);
+    if (event == null_Event || (session->state == Auth_State && event != auth_Event) ||
+        (session->state == Open_State && event == auth_Event))
+        return;
+
+    uint64_t now = now_us();
+    if (send_message(session, msg_length) == -1)
+    {
+        session->state = Error_State;
+        return;
+    }
+    if (event == auth_Event || event == join_Event)
+    {
+        session->waiting_reply = 1;
+        load->reply_kind = event == auth_Event ? Auth_Reply : Join_Reply;
+        load->reply_sent_us = now;
+        sent_count[event == auth_Event ? 0 : 1]++;
+    }
+    else
+    {
+        load->msg_sent_us[load->msg_count % LOAD_TRACK] = now;
+        load->msg_count++;
+        sent_count[2]++;
+    }
+}
+
+// Finds the tag " #S.Q" at the end of MessageContent, returns 0 if there is none
+static int parse_tag(sMsgField content, uint32_t *index, uint32_t *number)
+{
+    uint32_t values[2] = {0, 0};
+    int position = content.length - 1;
+
+    for (int value = 1; value >= 0; value--)
+    {
+        uint32_t scale = 1;
+        int digits = 0;
+        while (position >= 0 && content.data[position] >= '0' && content.data[position] <= '9' && digits < 9)
+        {
+            values[value] += (content.data[position--] - '0') * scale;
+            scale *= 10;
+            digits++;
+        }
+        if (digits == 0 || position < 0 || content.data[position--] != (value ? '.' : '#'))
+            return 0;
+    }
+    *index = values[0];
+    *number = values[1];
+    return 1;
+}
+
+// Observer of received messages, nothing is printed
+static void load_message(sSession *session, eSystemEvent event, const sDecodedMsg *decoded)
+{
+    sLoadSession *load = load_of(session);
+    uint32_t index, number;
+
+    switch (event)
+    {
+    case reply_ok_Event:
+    case reply_nok_Event:
+        // Repeated REPLY (UDP) does not measure anything
+        if (load->reply_kind != -1)
+        {
+            record(load->reply_kind, now_us() - load->reply_sent_us);
+            load->reply_kind = -1;
+        }
+        if (event == reply_nok_Event)
+            rejected_count++;
+        break;
+    case msg_inc_Event:
+        received_count++;
+        if (parse_tag(decoded->content, &index, &number) && index < session_count)
+        {
+            sLoadSession *sender = &sessions[index];
+            if (number < sender->msg_count && sender->msg_count - number <= LOAD_TRACK)
+                record(Msg_Delivery, now_us() - sender->msg_sent_us[number % LOAD_TRACK]);
+        }
+        break;
+    case error_inc_Event:
+    case msg_error_Event:
+        error_count++;
+        break;
+    default:
+        break;
+    }
+}
+
+// Observer of confirmed UDP messages
+static void load_confirm(sSession *session, unsigned char type, uint64_t latency_us)
+{
+    (void)session;
+    switch (type)
+    {
+    case 0x02:
+        record(Auth_Confirm, latency_us);
+        break;
+    case 0x03:
+        record(Join_Confirm, latency_us);
+        break;
+    case 0x04:
+        record(Msg_Confirm, latency_us);
+        break;
+    case 0xff:
+        record(Bye_Confirm, latency_us);
+        break;
+    }
+}
+
+// Observer of given up UDP messages, the connection is considered lost and the session ends at its next tick
+static void load_lost(sSession *session, unsigned char type)
+{
+    (void)type;
+    if (session->state == Auth_State || session->state == Open_State)
+        session->state = Error_State;
+}
+
+/* Definition of function that closes the session once it has ended
+    - after an error, BYE is sent and the session ends as after its own BYE
+    - after BYE from the server, the socket is only closed
+    - after own BYE, TCP is closed right away and UDP when BYE and every other message is confirmed or given up
+*/
+static void load_check(sLoadSession *load)
+{
+    sSession *session = &load->session;
+    if (load->closed)
+        return;
+
+    if (session->state == Error_State && !load->failed)
+    {
+        error_count++;
+        load->failed = 1;
+        if (!session->bye_sent && session_bye(session) == 0)
+            sent_count[3]++;
+    }
+    if (session->state != End_State && (!session->bye_sent || !session_idle(session)))
+        return;
+
+    session_close(session);
+    timer_wheel_remove(&pacing, &load->timer);
+    load->closed = 1;
+    active_count--;
+}
+
+static void load_interrupt(int signal)
+{
+    (void)signal;
+    stop_requested = 1;
+}
+
+static int compare_samples(const void *a, const void *b)
+{
+    uint32_t first = *(const uint32_t *)a, second = *(const uint32_t *)b;
+    return (first > second) - (first < second);
+}
+
+// Nearest-rank percentile of sorted samples, in milliseconds
+static double percentile(const sLatency *latency, double rank)
+{
+    size_t position = (size_t)(rank * latency->count + 0.999999);
+    if (position == 0)
+        position = 1;
+    if (position > latency->count)
+        position = latency->count;
+    return latency->samples[position - 1] / 1000.0;
+}
+
+static void print_report(double seconds)
+{
+    unsigned long total = sent_count[0] + sent_count[1] + sent_count[2] + sent_count[3];
+    unsigned long retransmitted = 0, lost = 0;
+    for (uint32_t i = 0; i < session_count; i++)
+    {
+        retransmitted += sessions[i].session.reliability.retransmitted_count;
+        lost += sessions[i].session.reliability.lost_count;
+    }
+
+    printf("Load: %u sessions (%s), %.3f s\n", session_count, protocol, seconds);
+    printf("    sent %lu messages (AUTH %lu, JOIN %lu, MSG %lu, BYE %lu), %.0f messages/s\n", total, sent_count[0],
+           sent_count[1], sent_count[2], sent_count[3], seconds > 0 ? total / seconds : 0);
+    printf("    received %lu MSG, %.0f messages/s\n", received_count, seconds > 0 ? received_count / seconds : 0);
+    printf("    rejected %lu, errors %lu (REPLY timeouts %lu), skipped ticks %lu\n", rejected_count, error_count,
+           timeout_count, skipped_ticks);
+    if (strcmp(protocol, "udp") == 0)
+        printf("    retransmitted %lu, lost %lu\n", retransmitted, lost);
+
+    printf("    %-16s %9s %9s %9s %9s %9s\n", "latency [ms]", "count", "p50", "p90", "p99", "max");
+    for (int kind = 0; kind < Latency_Kinds; kind++)
+    {
+        sLatency *latency = &latencies[kind];
+        if (latency->count == 0)
+            continue;
+        qsort(latency->samples, latency->count, sizeof(uint32_t), compare_samples);
+        printf("    %-16s %9zu %9.3f %9.3f %9.3f %9.3f\n", latency_names[kind], latency->count,
+               percentile(latency, 0.50), percentile(latency, 0.90), percentile(latency, 0.99),
+               percentile(latency, 1.0));
+    }
+}
+
+/* Definition of function that runs the load generator until every session has ended
+    The UDP reliability layer has to be initialized already, "timer_tag" is the tag of its timer.
+    Every session ticks until it is closed, so also a session whose BYE was never confirmed is closed
+    once the message is given up. Returns the exit code of the program.
+*/
+int load_run(int epoll_fd, const struct addrinfo *address, void *timer_tag)
+{
+    retransmit_tag = timer_tag;
+
+    if (load_script_lines() == -1)
+        return EXIT_FAILURE;
+
+    sessions = calloc(load_sessions, sizeof(sLoadSession));
+    if (sessions == NULL || timer_wheel_init(&pacing, epoll_fd, &pacing_tag) == -1)
+    {
+        perror("load");
+        return EXIT_FAILURE;
+    }
+    interval_us = load_rate >= 1e6 / TIMER_WHEEL_TICK_US ? TIMER_WHEEL_TICK_US : (uint32_t)(1e6 / load_rate);
+
+    // Opening every session, a session that cannot be opened stops opening the rest
+    for (session_count = 0; session_count < load_sessions; session_count++)
+    {
+        sLoadSession *load = &sessions[session_count];
+        if (session_open(&load->session, epoll_fd, address) == -1)
+        {
+            fprintf(stderr, "ERR: only %u sessions opened\n", session_count);
+            break;
+        }
+        load->index = session_count;
+        load->reply_kind = -1;
+        load->session.on_message = load_message;
+        load->session.on_confirm = load_confirm;
+        load->session.on_lost = load_lost;
+    }
+    if (session_count == 0)
+        return EXIT_FAILURE;
+
+    // First lines of the sessions are spread over one interval
+    for (uint32_t i = 0; i < session_count; i++)
+        timer_wheel_add(&pacing, &sessions[i].timer, (uint64_t)interval_us * i / session_count);
+
+    active_count = session_count;
+    // Ctrl+C ends every session with BYE at its next tick
+    signal(SIGINT, load_interrupt);
+
+    struct epoll_event events[LOAD_EVENTS];
+    eSystemEvent batch[TCP_MAX_BATCH > UDP_BATCH ? TCP_MAX_BATCH : UDP_BATCH];
+    uint64_t start_us = now_us();
+
+    while (active_count > 0)
+    {
+        int event_count = epoll_wait(epoll_fd, events, LOAD_EVENTS, -1);
+        if (event_count == -1 && errno != EINTR)
+        {
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < event_count; i++)
+        {
+            if (events[i].data.ptr == &pacing_tag)
+            {
+                // Case for PACING event, the next line of every session whose tick has come
+                sTimerEntry *entry = timer_wheel_expire(&pacing);
+                while (entry != NULL)
+                {
+                    sTimerEntry *next = entry->next;
+                    sLoadSession *load = (sLoadSession *)entry;
+                    timer_wheel_add(&pacing, &load->timer, interval_us);
+                    load_send(load);
+                    load_check(load);
+                    entry = next;
+                }
+            }
+            else if (events[i].data.ptr == retransmit_tag)
+            {
+                // Case for TIMER event of the UDP reliability layer
+                udp_timer_event();
+            }
+            else
+            {
+                // Case for SOCKET event
+                sLoadSession *load = load_of(events[i].data.ptr);
+                int batch_count = session_receive(&load->session, batch);
+                for (int j = 0; j < batch_count; j++)
+                    session_fsm(&load->session, batch[j]);
+                load_check(load);
+            }
+        }
+
+        // Messages, retransmissions and CONFIRMs of this event are sent at once
+        udp_send_queued();
+    }
+
+    print_report((now_us() - start_us) / 1e6);
+    return EXIT_SUCCESS;
+}
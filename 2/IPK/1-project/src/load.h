@@ -0,0 +1,18 @@
+#ifndef LOAD_H
+#define LOAD_H
+#include <netdb.h>
+
+// Declaration of the load generator, many sessions driven by one epoll loop (option --load)
+
+// Send times of the last messages of every session kept for matching their delivery
+#define LOAD_TRACK 1024
+
+// Most epoll events handled by one "epoll_wait();"
+#define LOAD_EVENTS 256
+
+// Session whose AUTH or JOIN gets no REPLY in this time (microseconds) ends with an error
+#define LOAD_REPLY_TIMEOUT_US 5000000
+
+int load_run(int epoll_fd, const struct addrinfo *address, void *timer_tag);
+
+#endif
@@ -1,10 +1,16 @@
 #include "avars.h"
-#include "decode_msg.h"
+#include "encode_msg.h"
+#include "input_buffer.h"
 #include "input_parse.h"
+#include "load.h"
+#include "session.h"
 #include "udp_send.h"
 #include <arpa/inet.h>
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <signal.h>
@@ -15,59 +21,66 @@
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
 int iResult;
 
-// Define the maximum number of events and the maximum input length
-#define MAX_EVENTS 5
-#define INPUT_LENGTH 1400
+// Define the maximum number of events
+#define MAX_EVENTS 64
 
-// Definition of variables to save text data for each of the tokens
-char command[10], username[20], secret[128], display_name[20], channel_id[20],
-    receive_buff[INPUT_LENGTH], msg[INPUT_LENGTH], read_buff[INPUT_LENGTH], msg_content[INPUT_LENGTH];
+// Size of the send buffer of the TCP variant, all messages encoded from one read of STDIN are sent at once
+#define TCP_SEND_SIZE 65536
 
-// Definitions of variables described in "avars.h"
-struct addrinfo *result = NULL;
-struct addrinfo hints;
+// Definition of buffers, every outgoing message is built into "msg" (or "tcp_send_buff") by its encoder
+char msg[SEND_LENGTH], tcp_send_buff[TCP_SEND_SIZE];
+
+// Session of the program, the chat with the server
+sSession session;
 
-struct sockaddr_in server_addr;
-socklen_t server_addr_len;
+// Tags of the STDIN and timer events, every other event belongs to a session ("data.ptr")
+static char stdin_tag, timer_tag;
 
-int client_socket;
+// Number of messages sent from STDIN and time of the first one, for option -b
+unsigned long input_messages = 0;
+struct timespec input_start;
 
-uint16_t message_id;
+// Definitions of variables described in "avars.h"
 char *protocol = NULL;
 char *host_ip = NULL;
 uint16_t server_port = 4567;
 uint16_t udp_timeout = 250;
 uint8_t max_retransmissions = 3;
+uint16_t udp_window = 1;
+uint8_t bulk_report = 0;
+uint32_t load_sessions = 0;
+char *load_script = NULL;
+double load_rate = 10;
+uint32_t load_messages = 100;
 
 // End definition
 
+// Set by SIGINT, the main loop ends the connection to the server (nothing else is safe inside a signal handler)
+static volatile sig_atomic_t stop_requested = 0;
+
 // Definition of handler to catch the SIGINT signal for ending the connection to the server for both variants
-void sigint_handler()
+void sigint_handler(int signal)
 {
-    if (strcmp(protocol, "tcp") == 0)
-    {
-        // sending BYE message for TCP
-        sendto(client_socket, "BYE\r\n", 5, 0, (struct sockaddr *)&server_addr, server_addr_len);
-    }
-    else
-    {
-        // constructing BYE message for UDP
-        char bye_msg[3];
-        bye_msg[0] = 0xff;
-        *((uint16_t *)(bye_msg + 1)) = htons(message_id);
-
-        // sending BYE message
-        udp_send(bye_msg, receive_buff, 3);
-    }
+    (void)signal;
+    stop_requested = 1;
+}
 
-    // Freeing all pointers
-    free(result);
-    close(client_socket);
-    exit(0);
+// Definition of function that prints the throughput of messages sent from STDIN (option -b)
+void print_throughput(void)
+{
+    if (input_messages == 0)
+        return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double seconds = (now.tv_sec - input_start.tv_sec) + (now.tv_nsec - input_start.tv_nsec) / 1e9;
+    fprintf(stderr, "Sent %lu messages in %.3f s, %.0f messages/s\n", input_messages, seconds,
+            seconds > 0 ? input_messages / seconds : 0);
 }
 
 // Definition of a function that parses program arguments
@@ -75,7 +88,16 @@ void argument_parse(int argc, char **argv)
 {
     int opt;
 
-    while ((opt = getopt(argc, argv, "t:s:p:d:r:h")) != -1)
+    // Options of the load generator have only the long form
+    static const struct option long_options[] = {
+        {"load", required_argument, NULL, 'L'},
+        {"script", required_argument, NULL, 'S'},
+        {"rate", required_argument, NULL, 'R'},
+        {"messages", required_argument, NULL, 'M'},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "t:s:p:d:r:w:bh", long_options, NULL)) != -1)
     {
         switch (opt)
         {
@@ -94,11 +116,45 @@ void argument_parse(int argc, char **argv)
         case 'r':
             max_retransmissions = atoi(optarg);
             break;
+        case 'w':
+            if (atoi(optarg) < 1 || atoi(optarg) > 1024)
+            {
+                fprintf(stderr, "Option -w requires a window from 1 to 1024.\n");
+                exit(EXIT_FAILURE);
+            }
+            udp_window = atoi(optarg);
+            break;
+        case 'b':
+            bulk_report = 1;
+            break;
+        case 'L':
+            if (atoi(optarg) < 1)
+            {
+                fprintf(stderr, "Option --load requires a number of sessions.\n");
+                exit(EXIT_FAILURE);
+            }
+            load_sessions = atoi(optarg);
+            break;
+        case 'S':
+            load_script = optarg;
+            break;
+        case 'R':
+            load_rate = atof(optarg);
+            if (load_rate <= 0)
+            {
+                fprintf(stderr, "Option --rate requires a positive number of lines per second.\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'M':
+            load_messages = atoi(optarg);
+            break;
         case 'h':
-            printf("Usage: %s [-t tcp|udp] [-s server_ip] [-p server_port] [-d udp_timeout] [-r max_retransmissions] [-h]\n", argv[0]);
+            printf("Usage: %s [-t tcp|udp] [-s server_ip] [-p server_port] [-d udp_timeout] [-r max_retransmissions] [-w udp_window] [-b] [-h]\n", argv[0]);
+            printf("       %s -t tcp|udp -s server_ip --load sessions [--script file | --messages count] [--rate lines_per_second]\n", argv[0]);
             exit(EXIT_SUCCESS);
         case '?':
-            if (optopt == 't' || optopt == 's' || optopt == 'p' || optopt == 'd' || optopt == 'r')
+            if (optopt == 't' || optopt == 's' || optopt == 'p' || optopt == 'd' || optopt == 'r' || optopt == 'w')
                 fprintf(stderr, "Option -%c requires an argument.\n", optopt);
             else if (isprint(optopt))
                 fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -119,219 +175,153 @@ void argument_parse(int argc, char **argv)
     return;
 }
 
-/* Definition of two submain functions for both variants "UDP" and "TCP"
-   This function waits for an event (on STDIN descriptor or socket descriptor) and provides actions:
-   - For STDIN event:
-     * Parsing arguments
-     * Checking if it supports the command for the current state
-     * Sending a message
-   - For SOCKET event:
-     * Receiving a message
-     * Decoding the message
-     * Printing the message (optionally taking actions in case of ERR or BYE)
-   This function returns the FSM event, which will provide later functionality in main.
-*/
-//-------------------------------UDP--------------------------
-eSystemEvent ReadEvent(eSystemState state, int epoll_fd, struct epoll_event *events, int max_events,
-                       int client_socket)
+// Check if input event is supported for the current state
+int input_allowed(eSystemState state, eSystemEvent input_event)
 {
-    if (state == Error_State)
+    if ((state == Auth_State && input_event != auth_Event) || (state == Open_State && input_event == auth_Event))
     {
-        return null_Event;
+        // fprintf(stderr, "Client: Your command is not supported by this state\n");
+        return 0;
     }
+    return input_event != null_Event;
+}
 
-    // Declaration of FSM events
-    eSystemEvent input_event, incoming_event = null_Event;
-
-    memset(msg, 0, sizeof(msg));
-    int msg_length = 0;
-    char server_username[20];
-    memset(server_username, 0, sizeof(server_username));
+// Counts a message sent from STDIN, after AUTH and JOIN no other line is sent until the REPLY comes
+void input_sent(eSystemEvent input_event)
+{
+    if (input_messages++ == 0)
+        clock_gettime(CLOCK_MONOTONIC, &input_start);
+    if (input_event == auth_Event || input_event == join_Event)
+        session.waiting_reply = 1;
+}
 
-    // Wait for an event
-    iResult = epoll_wait(epoll_fd, events, max_events, -1);
+/* Definition of functions that send every buffered line of STDIN
+    Lines are taken one after another while they can be sent:
+    - UDP sends every message right away while there is a free place in the window,
+      the confirmations come later as SOCKET events
+    - TCP encodes the messages back to back into one buffer, which is sent with one "send();"
+    Sending stops after AUTH or JOIN, the rest waits until its REPLY comes.
+*/
+void send_input_udp(void)
+{
+    const char *line;
+    int line_length, msg_length;
 
-    if (events[0].data.fd == 0)
+    while (!session.waiting_reply && udp_window_free(&session) && (line_length = input_next(&line)) != -1)
     {
-        // Case for STDIN event
-        input_event = input_parse(command, username, secret, display_name, channel_id, read_buff, msg, &msg_length);
-
-        // Check if input event is supported for the current state
-        if ((state == Auth_State && input_event != auth_Event) || (state == Open_State && input_event == auth_Event))
-        {
-            // fprintf(stderr, "Client: Your command is not supported by this state\n");
-            return null_Event;
-        }
-        if (input_event == null_Event)
-            return null_Event;
+        eSystemEvent input_event = input_parse(&session, line, line_length, msg, &msg_length);
+        if (!input_allowed(session.state, input_event))
+            continue;
 
-        // Sending message
-        incoming_event = udp_send(msg, receive_buff, msg_length);
-        memset(receive_buff, 0, sizeof(receive_buff));
+        // Sending message, the confirmation is matched later as a SOCKET event
+        input_sent(input_event);
+        udp_send(&session, msg, msg_length);
     }
-    else
-    {
-        // Case for SOCKET event
-        memset(receive_buff, 0, sizeof(receive_buff));
+}
 
-        // Receiving message
-        if (recvfrom(client_socket, receive_buff, INPUT_LENGTH, 0, (struct sockaddr *)&server_addr, &server_addr_len) == -1)
-        {
-            perror("recvfrom");
-            close(client_socket);
-            exit(EXIT_FAILURE);
-        }
+void send_input_tcp(void)
+{
+    const char *line;
+    int line_length, msg_length, send_length = 0;
 
-        // Decoding message
-        incoming_event = decode_msg(receive_buff, server_username, msg_content);
+    while (!session.waiting_reply && send_length <= TCP_SEND_SIZE - SEND_LENGTH &&
+           (line_length = input_next(&line)) != -1)
+    {
+        eSystemEvent input_event = input_parse(&session, line, line_length, tcp_send_buff + send_length, &msg_length);
+        if (!input_allowed(session.state, input_event))
+            continue;
 
-        // Switch that decides what type of message was received and optionally takes actions
-        switch (incoming_event)
+        input_sent(input_event);
+        send_length += msg_length;
+    }
+
+    // Sending messages, a stream socket can take only a part of them at once
+    for (int sent = 0; sent < send_length; sent += iResult)
+    {
+        iResult = send(session.socket, tcp_send_buff + sent, send_length - sent, 0);
+        if (iResult <= 0)
         {
-        case reply_ok_Event:
-            fprintf(stderr, "%s: %s\n", server_username, msg_content);
-            return incoming_event;
-        case reply_nok_Event:
-            fprintf(stderr, "%s: %s\n", server_username, msg_content);
-            return incoming_event;
-        case error_inc_Event:
-            fprintf(stderr, "ERR FROM %s: %s\n", server_username, msg_content);
-            return incoming_event;
-        case bye_Event:
-            return incoming_event;
-        case msg_error_Event:
-            fprintf(stderr, "\nERR: Failed to be parsed\n");
-
-            // Construct ERR message
-            char err_msg[20];
-            memset(err_msg, 0, sizeof(err_msg));
-            err_msg[0] = 0xfe;
-            *((uint16_t *)(err_msg + 1)) = htons(message_id);
-            *err_msg += 3;
-            strcpy(err_msg, "Failed to be parsed");
-
-            // Send ERR message
-            udp_send(err_msg, receive_buff, 20);
-
-            return incoming_event;
-        default:
-            printf("%s: %s\n", server_username, msg_content);
+            if (iResult == -1 && errno == EINTR)
+            {
+                iResult = 0;
+                continue;
+            }
+            perror("send failed");
+            return;
         }
     }
-    return incoming_event;
 }
 
-//--------------------------------TCP--------------------------------------
-
-eSystemEvent ReadEventTcp(eSystemState state, int epoll_fd, struct epoll_event *events, int max_events,
-                          int client_socket)
+void send_input(void)
 {
-    if (state == Error_State)
-    {
-        return null_Event;
-    }
+    // Nothing is sent after BYE
+    if (session.bye_sent)
+        return;
+    if (session.udp)
+        send_input_udp();
+    else
+        send_input_tcp();
+}
 
-    // Declaration of FSM events
-    eSystemEvent input_event, incoming_event = null_Event;
+/* Definition of function that waits for events and hands every one of them to its owner
+   Every event of epoll carries a tag in "data.ptr":
+   - STDIN event: every available line is read, parsed, checked against the state and sent
+   - TIMER event (UDP): messages without CONFIRM are retransmitted
+   - any other tag is the session the socket belongs to: its messages are received, decoded,
+     printed and their FSM events are given to the FSM of the session in order
+   Without any event, lines that are already read and can be sent now are sent.
+*/
+void handle_events(int epoll_fd, struct epoll_event *events)
+{
+    // Events of all messages received at once
+    eSystemEvent batch[TCP_MAX_BATCH > UDP_BATCH ? TCP_MAX_BATCH : UDP_BATCH];
 
-    memset(msg, 0, sizeof(msg));
-    int msg_length = 0;
-    char server_username[20];
+    // Wait for an event, lines that can be sent now only let the socket and timer go first
+    int input_waiting = !session.bye_sent && !session.waiting_reply && (!session.udp || udp_window_free(&session)) &&
+                        input_ready();
 
-    // Wait for an event
-    iResult = epoll_wait(epoll_fd, events, max_events, -1);
+    // STDIN has ended without any event, the main loop ends the program
+    if (input_closed() && !session.waiting_reply && !session.bye_sent)
+        return;
 
-    if (events[0].data.fd == 0)
+    int event_count = epoll_wait(epoll_fd, events, MAX_EVENTS, input_waiting ? 0 : -1);
+    if (event_count <= 0)
     {
-        // Case for STDIN event
-        input_event = input_parse_tcp(command, username, secret, display_name, channel_id, read_buff, msg, &msg_length);
-
-        // Check if input event is supported for the current state
-        if ((state == Auth_State && input_event != auth_Event) || (state == Open_State && input_event == auth_Event))
-        {
-            // fprintf(stderr, "ERR: Your command is not supported by this state\n");
-            return null_Event;
-        }
-        if (input_event == null_Event)
-            return null_Event;
+        if (input_waiting)
+            send_input();
+        return;
+    }
 
-        // Sending message
-        iResult = sendto(client_socket, msg, msg_length, 0, (struct sockaddr *)&server_addr, server_addr_len);
-        if (iResult <= 0)
+    for (int i = 0; i < event_count; i++)
+    {
+        if (events[i].data.ptr == &stdin_tag)
         {
-            perror("send failed");
-            return -1;
+            // Case for STDIN event
+            input_read();
+            send_input();
         }
-    }
-    else
-    {
-        // Case for SOCKET event
-        memset(receive_buff, 0, sizeof(receive_buff));
-
-        // Receiving message
-        if (recv(client_socket, receive_buff, INPUT_LENGTH, 0) == -1)
+        else if (events[i].data.ptr == &timer_tag)
         {
-            perror("recvfrom");
-            close(client_socket);
-            exit(EXIT_FAILURE);
+            // Case for TIMER event
+            udp_timer_event();
         }
-
-        // Decoding message
-        incoming_event = decode_msg_tcp(receive_buff, server_username, msg_content);
-
-        // Switch that decides what type of message was received and optionally takes actions
-        switch (incoming_event)
+        else
         {
-        case reply_ok_Event:
-            fprintf(stderr, "%s: %s\n", server_username, msg_content);
-            return incoming_event;
-        case reply_nok_Event:
-            fprintf(stderr, "%s: %s\n", server_username, msg_content);
-            return incoming_event;
-        case error_inc_Event:
-            fprintf(stderr, "ERR FROM %s: %s\n", server_username, msg_content);
-            return incoming_event;
-        case bye_Event:
-            return incoming_event;
-        case msg_error_Event:
-            fprintf(stderr, "ERR: Failed to be parsed\n");
-
-            // Construct ERR message
-            char err_msg[55];
-            memset(err_msg, 0, sizeof(err_msg));
-            strcat(err_msg, "ERR_FROM ");
-            strcat(err_msg, display_name);
-            strcat(err_msg, " IS ");
-            strcat(err_msg, "Failed to be parsed\r\n");
-            msg_length = strlen(err_msg);
-
-            // Send ERR message
-            iResult = sendto(client_socket, err_msg, msg_length, 0, (struct sockaddr *)&server_addr, server_addr_len);
-            if (iResult <= 0)
-            {
-                perror("send failed");
-                return null_Event;
-            }
-
-            return incoming_event;
-        default:
-            printf("%s: %s\n", server_username, msg_content);
+            // Case for SOCKET event, the FSM runs for every event of the batch in order
+            sSession *event_session = events[i].data.ptr;
+            int batch_count = session_receive(event_session, batch);
+            for (int j = 0; j < batch_count; j++)
+                session_fsm(event_session, batch[j]);
         }
     }
-    return incoming_event;
 }
 
 int main(int argc, char **argv)
 {
-    eSystemState eNextState = Auth_State;
-    eSystemEvent eNewEvent;
+    struct addrinfo *result = NULL;
+    struct addrinfo hints;
     argument_parse(argc, argv); // Parsing arguments
 
-    // Definition of structure to use option timeout with socket
-    struct timeval timeout;
-    timeout.tv_usec = udp_timeout * 1000;
-    timeout.tv_sec = 0;
-
     // Cases to define hints to function "getaddrinfo();" for both variants, and optionally exit program
     memset(&hints, 0, sizeof(struct addrinfo));
     if (strcmp(protocol, "udp") == 0)
@@ -361,118 +351,71 @@ int main(int argc, char **argv)
         return -1;
     }
 
-    // Initialization of socket, and adding timeout
-    client_socket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
-    if (client_socket <= 0)
-    {
-        perror("ERROR: socket");
-        return -1;
-    }
-    iResult = setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-    if (iResult == -1)
-        perror("sOPT");
-
-    // Initialization of connection for TCP, or migrating data from addrinfo to sockaddr_in for UDP
-    if (strcmp(protocol, "udp") == 0)
-    {
-        memset(&server_addr, 0, sizeof(server_addr));
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_addr.s_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr;
-        server_addr.sin_port = htons(server_port);
-        server_addr_len = sizeof(server_addr);
-    }
-    else
-    {
-        iResult = connect(client_socket, result->ai_addr, result->ai_addrlen);
-        if (iResult == -1)
-        {
-            perror("connect");
-            close(client_socket);
-            freeaddrinfo(result);
-            return EXIT_FAILURE;
-        }
-    }
-
     // Initialization of epoll instance
     int epoll_fd = epoll_create1(0);
     assert(epoll_fd != -1);
 
-    struct epoll_event sock_event;
-    struct epoll_event stdin_event;
+    // Initialization of the UDP reliability layer, its timer is driven by the same epoll instance
+    if (result->ai_socktype == SOCK_DGRAM)
+    {
+        iResult = udp_init(epoll_fd, &timer_tag);
+        assert(iResult == 0);
+    }
 
-    sock_event.events = EPOLLIN;
-    stdin_event.events = EPOLLIN;
+    // Load generator runs its own sessions instead of the chat session
+    if (load_sessions > 0)
+    {
+        iResult = load_run(epoll_fd, result, &timer_tag);
+        freeaddrinfo(result);
+        return iResult;
+    }
 
-    sock_event.data.fd = client_socket;
-    stdin_event.data.fd = 0;
+    // Initialization of the session, its socket is added to epoll
+    iResult = session_open(&session, epoll_fd, result);
+    freeaddrinfo(result);
+    if (iResult == -1)
+        return EXIT_FAILURE;
 
-    iResult = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_socket, &sock_event);
-    assert(iResult == 0);
-    iResult = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, 0, &stdin_event);
+    // STDIN is read into its own buffer, so every line that was not sent yet stays there
+    iResult = input_init(epoll_fd, &stdin_tag);
     assert(iResult == 0);
 
     struct epoll_event events[MAX_EVENTS];
 
+    // Throughput is printed however the program ends
+    if (bulk_report)
+        atexit(print_throughput);
+
     // Initialization of SIGINT handler
     signal(SIGINT, sigint_handler);
 
-    // Main cycle of program that provides FSM logic
+    // Main cycle of program, the FSM of the session runs inside "handle_events();"
     while (1)
     {
-        // Read event function for both variants
-        if (strcmp(protocol, "udp") == 0)
-            eNewEvent = ReadEvent(eNextState, epoll_fd, events, MAX_EVENTS, client_socket);
-        else
-            eNewEvent = ReadEventTcp(eNextState, epoll_fd, events, MAX_EVENTS, client_socket);
+        handle_events(epoll_fd, events);
 
-        // Actions for each state
-        switch (eNextState)
-        {
-        case Auth_State:
-        {
-            if (reply_ok_Event == eNewEvent)
-            {
-                eNextState = Open_State;
-            }
-            else if (reply_nok_Event == eNewEvent)
-            {
-            }
-            else if (error_Event == eNewEvent || msg_error_Event == eNewEvent || error_inc_Event == eNewEvent)
-            {
-                eNextState = Error_State;
-            }
-            else if (bye_Event == eNewEvent)
-            {
-                close(client_socket);
-                free(result);
-                return 0;
-            }
+        // Messages, retransmissions and CONFIRMs of this event are sent at once
+        udp_send_queued();
 
-            break;
-        }
-        case Open_State:
+        // Server ended the connection
+        if (session.state == End_State)
         {
-
-            if (auth_Event == eNewEvent)
-                fprintf(stderr, "ERR: Your command is not supportet by this state\n");
-            else if (error_Event == eNewEvent || msg_error_Event == eNewEvent || error_inc_Event == eNewEvent)
-            {
-                eNextState = Error_State;
-            }
-            else if (bye_Event == eNewEvent)
-            {
-                close(client_socket);
-                free(result);
-                return 0;
-            }
-            break;
+            session_close(&session);
+            return 0;
         }
-        case Error_State:
+
+        // After Ctrl+C, an error, or when STDIN has ended and every line was sent, the connection is ended with BYE
+        if (stop_requested || session.state == Error_State || (input_closed() && !session.waiting_reply))
         {
-            sigint_handler(2);
+            session_bye(&session);
+            udp_send_queued();
         }
 
-        default:
+        // UDP waits in the main loop until BYE and every other message is confirmed or given up
+        if (session.bye_sent && session_idle(&session))
+        {
+            session_close(&session);
+            return 0;
         }
     }
 
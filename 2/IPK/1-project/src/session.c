@@ -0,0 +1,335 @@
+#include "session.h"
+#include "avars.h"
+#include "decode_msg.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/* Definition of one chat session
+    Everything that belongs to one connection to the server (socket, FSM state, MessageID,
+    reliability state of UDP, receive ring of TCP) is kept in "sSession", so one process can
+    run as many sessions as it wants. The socket of the session is registered with the epoll
+    instance of the program with the session itself in "data.ptr", so the main loop gives every
+    event of the socket straight to its session ("session_receive();").
+*/
+
+// Longest received message, MSG with DisplayName of 20 characters and MessageContent of 1400 characters fits
+#define RECEIVE_LENGTH 1536
+
+// Message wrapped around the end of the TCP ring is copied here, it is used only while the ring is decoded
+static char receive_buff[RECEIVE_LENGTH];
+
+// Outgoing message built by the session itself (ERR, BYE)
+static char session_msg[SEND_LENGTH];
+
+/* Definition of function that connects the session to the server and registers it with epoll
+    Returns 0, or -1 when the session cannot be used (error is printed)
+*/
+int session_open(sSession *session, int epoll_fd, const struct addrinfo *address)
+{
+    memset(session, 0, sizeof(*session));
+    session->udp = address->ai_socktype == SOCK_DGRAM;
+    session->state = Auth_State;
+
+    // Initialization of socket, UDP timeouts are kept by the timer wheel (udp_send.c)
+    session->socket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (session->socket <= 0)
+    {
+        perror("ERROR: socket");
+        return -1;
+    }
+
+    // Initialization of connection for TCP, or migrating data from addrinfo to sockaddr_in for UDP
+    memcpy(&session->server_addr, address->ai_addr, sizeof(session->server_addr));
+    session->server_addr_len = sizeof(session->server_addr);
+    if (session->udp)
+    {
+        fcntl(session->socket, F_SETFL, fcntl(session->socket, F_GETFL) | O_NONBLOCK);
+        if (udp_session_init(session) == -1)
+        {
+            perror("udp_session_init");
+            close(session->socket);
+            return -1;
+        }
+    }
+    else
+    {
+        if (connect(session->socket, address->ai_addr, address->ai_addrlen) == -1)
+        {
+            perror("connect");
+            close(session->socket);
+            return -1;
+        }
+        tcp_ring_init(&session->tcp_ring);
+    }
+
+    struct epoll_event sock_event;
+    sock_event.events = EPOLLIN;
+    sock_event.data.ptr = session;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, session->socket, &sock_event) == -1)
+    {
+        perror("epoll_ctl");
+        session->state = End_State;
+        session_close(session);
+        return -1;
+    }
+    return 0;
+}
+
+// Sends ERR after a message that could not be parsed
+static void send_parse_error(sSession *session)
+{
+    sMsgField name = {session->display_name, strlen(session->display_name)};
+    sMsgField content = {"Failed to be parsed", 19};
+    int msg_length;
+
+    if (session->udp)
+    {
+        msg_length = encode_err(session_msg, session->message_id, name, content);
+        udp_send(session, session_msg, msg_length);
+    }
+    else
+    {
+        msg_length = encode_err_tcp(session_msg, name, content);
+        if (send(session->socket, session_msg, msg_length, 0) <= 0)
+            perror("send failed");
+    }
+}
+
+/* Prints the decoded message, returns 1 if no other message after it matters (ERR, BYE, unparsable)
+    Switch decides what type of message was received and optionally takes actions
+*/
+static int print_message(sSession *session, eSystemEvent incoming_event, sDecodedMsg *decoded)
+{
+    if (session->on_message != NULL)
+    {
+        session->on_message(session, incoming_event, decoded);
+        if (incoming_event == msg_error_Event)
+            send_parse_error(session);
+        return incoming_event == error_inc_Event || incoming_event == bye_Event || incoming_event == msg_error_Event;
+    }
+
+    switch (incoming_event)
+    {
+    case reply_ok_Event:
+    case reply_nok_Event:
+        fprintf(stderr, "%.*s: %.*s\n", decoded->name.length, decoded->name.data, decoded->content.length,
+                decoded->content.data);
+        return 0;
+    case error_inc_Event:
+        fprintf(stderr, "ERR FROM %.*s: %.*s\n", decoded->name.length, decoded->name.data, decoded->content.length,
+                decoded->content.data);
+        return 1;
+    case bye_Event:
+        return 1;
+    case msg_error_Event:
+        fprintf(stderr, session->udp ? "\nERR: Failed to be parsed\n" : "ERR: Failed to be parsed\n");
+        send_parse_error(session);
+        return 1;
+    default:
+        printf("%.*s: %.*s\n", decoded->name.length, decoded->name.data, decoded->content.length,
+               decoded->content.data);
+        return 0;
+    }
+}
+
+/* UDP variant receives every waiting datagram at once
+   CONFIRMs of received messages are only queued, the main loop sends them together with other messages.
+*/
+static int receive_udp(sSession *session, eSystemEvent *batch)
+{
+    int batch_count = 0;
+    int msg_length;
+    sDecodedMsg decoded;
+
+    int received = udp_receive(session);
+    if (received == -1)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return 0;
+        perror("recvmmsg");
+        batch[batch_count++] = error_Event;
+        return batch_count;
+    }
+
+    // After ERR, BYE or an unparsable message only the CONFIRMs of the batch are handled
+    int ended = 0;
+    for (int i = 0; i < received; i++)
+    {
+        const char *datagram = udp_datagram(session, i, &msg_length);
+
+        // Case for CONFIRM message
+        if (msg_length >= 3 && datagram[0] == 0x00)
+        {
+            udp_confirm(session, datagram);
+            continue;
+        }
+        if (ended)
+            continue;
+
+        // Every other message is confirmed, even if it cannot be decoded
+        if (msg_length >= 3)
+            udp_send_confirm(session, datagram);
+
+        // Decoding message, fields are printed straight from the receive buffer
+        batch[batch_count] = decode_msg(datagram, msg_length, &decoded);
+        ended = print_message(session, batch[batch_count++], &decoded);
+    }
+    return batch_count;
+}
+
+/* TCP variant collects received data in a ring buffer
+   One "recv();" can bring several coalesced messages, or only a part of one,
+   so every complete message is decoded and printed. Messages after the one that stopped decoding
+   are left in the ring.
+*/
+static int receive_tcp(sSession *session, eSystemEvent *batch)
+{
+    int batch_count = 0;
+    int msg_length;
+    sDecodedMsg decoded;
+    const char *message;
+
+    // Receiving data into the ring
+    int received = tcp_ring_recv(&session->tcp_ring, session->socket);
+    if (received == -1)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return 0;
+        perror("recv");
+        batch[batch_count++] = error_Event;
+        return batch_count;
+    }
+    if (received == 0)
+    {
+        // Server closed the connection, nothing more can come
+        fprintf(stderr, "ERR: connection closed by server\n");
+        batch[batch_count++] = bye_Event;
+        return batch_count;
+    }
+
+    // Extracting and decoding every complete message
+    while (batch_count < TCP_MAX_BATCH &&
+           (msg_length = tcp_ring_next(&session->tcp_ring, receive_buff, sizeof(receive_buff), &message)) != 0)
+    {
+        // Fields are printed straight from the ring, only a message wrapped around its end is in "receive_buff"
+        if (msg_length == -1)
+            batch[batch_count] = msg_error_Event;
+        else
+            batch[batch_count] = decode_msg_tcp(message, msg_length, &decoded);
+        if (print_message(session, batch[batch_count++], &decoded))
+            break;
+    }
+    return batch_count;
+}
+
+/* Definition of function that handles readability of the socket of the session
+   Returns the number of FSM events stored into "batch", which has to hold
+   TCP_MAX_BATCH or UDP_BATCH events (the larger of them).
+*/
+int session_receive(sSession *session, eSystemEvent *batch)
+{
+    // After an error, UDP still receives the CONFIRM of its BYE
+    if (session->state == End_State || (session->state == Error_State && !session->udp))
+        return 0;
+    return session->udp ? receive_udp(session, batch) : receive_tcp(session, batch);
+}
+
+// Definition of function that provides FSM logic, actions for each state
+void session_fsm(sSession *session, eSystemEvent event)
+{
+    // Lines waiting for the REPLY can be sent again
+    if (reply_ok_Event == event || reply_nok_Event == event)
+        session->waiting_reply = 0;
+
+    switch (session->state)
+    {
+    case Auth_State:
+    {
+        if (reply_ok_Event == event)
+        {
+            session->state = Open_State;
+        }
+        else if (reply_nok_Event == event)
+        {
+        }
+        else if (error_Event == event || msg_error_Event == event || error_inc_Event == event)
+        {
+            session->state = Error_State;
+        }
+        else if (bye_Event == event)
+        {
+            session->state = End_State;
+        }
+        break;
+    }
+    case Open_State:
+    {
+        if (auth_Event == event)
+            fprintf(stderr, "ERR: Your command is not supportet by this state\n");
+        else if (error_Event == event || msg_error_Event == event || error_inc_Event == event)
+        {
+            session->state = Error_State;
+        }
+        else if (bye_Event == event)
+        {
+            session->state = End_State;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/* Definition of function that sends BYE, the session is ending
+   Nothing is sent after BYE. UDP session is closed by the caller once "session_idle();" tells that BYE
+   and every other message is confirmed or given up, the main loop keeps running until then.
+   Returns 0, or -1 when BYE could not be sent
+*/
+int session_bye(sSession *session)
+{
+    if (session->bye_sent || session->state == End_State)
+        return 0;
+    session->bye_sent = 1;
+
+    int bye_length;
+    if (session->udp)
+    {
+        // constructing BYE message for UDP, it is confirmed later as any other message
+        bye_length = encode_bye(session_msg, session->message_id);
+        udp_send(session, session_msg, bye_length);
+        return 0;
+    }
+
+    // sending BYE message for TCP
+    bye_length = encode_bye_tcp(session_msg);
+    if (send(session->socket, session_msg, bye_length, 0) <= 0)
+    {
+        perror("send failed");
+        return -1;
+    }
+    return 0;
+}
+
+// Definition of function that tells whether everything sent by the session is confirmed or given up
+int session_idle(sSession *session)
+{
+    return !session->udp || udp_idle(session);
+}
+
+/* Definition of function that closes the session
+   Nothing is sent any more, outstanding UDP messages are forgotten. The socket is closed,
+   which also removes it from epoll.
+*/
+void session_close(sSession *session)
+{
+    if (session->udp)
+        udp_session_close(session);
+
+    close(session->socket);
+    session->state = End_State;
+}
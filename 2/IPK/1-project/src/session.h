@@ -0,0 +1,55 @@
+#ifndef SESSION_H
+#define SESSION_H
+#include "decode_msg.h"
+#include "encode_msg.h"
+#include "fsm.h"
+#include "tcp_framer.h"
+#include "udp_send.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+// Declaration of one chat session, everything that belongs to one connection to the server
+
+typedef struct sSession
+{
+    int socket;
+    int udp; // Variant of the session, 1 for UDP, 0 for TCP
+    eSystemState state;
+
+    // Address of the server, the UDP variant takes it from every received datagram (dynamic port)
+    struct sockaddr_in server_addr;
+    socklen_t server_addr_len;
+
+    uint16_t message_id;                        // MessageID of the next message (UDP)
+    int waiting_reply;                          // AUTH or JOIN was sent and its REPLY did not come yet
+    int bye_sent;                               // Session is ending, nothing is sent after its BYE
+    char display_name[DISPLAY_NAME_LENGTH + 1]; // DisplayName used in every message
+
+    sUdpState reliability; // Outstanding messages and round-trip time estimation (UDP)
+    sTcpRing tcp_ring;     // Receive ring buffer (TCP)
+
+    // Observers used by the load generator (option --load), NULL in the chat client
+    // With "on_message" set, received messages are handed to it instead of being printed
+    void (*on_message)(struct sSession *session, eSystemEvent event, const sDecodedMsg *decoded);
+    // Type of every confirmed UDP message and the time from its first sending to its CONFIRM
+    void (*on_confirm)(struct sSession *session, unsigned char type, uint64_t latency_us);
+    // Type of every UDP message given up after all retries, called instead of printing the error
+    // It must not close the session, it is called while the timer of the reliability layer is handled
+    void (*on_lost)(struct sSession *session, unsigned char type);
+} sSession;
+
+int session_open(sSession *session, int epoll_fd, const struct addrinfo *address);
+
+int session_receive(sSession *session, eSystemEvent *batch);
+
+void session_fsm(sSession *session, eSystemEvent event);
+
+int session_bye(sSession *session);
+
+int session_idle(sSession *session);
+
+void session_close(sSession *session);
+
+#endif
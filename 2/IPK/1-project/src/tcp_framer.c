@@ -0,0 +1,92 @@
+#include "tcp_framer.h"
+#include <string.h>
+#include <sys/uio.h>
+
+/* Definition of the framer of the TCP variant
+    TCP is a stream, so one "recv();" can return a part of a message or several messages
+    coalesced together. Received bytes are appended to a ring buffer and the framer extracts
+    every complete message terminated with "\r\n", a partial tail stays in the ring until the rest comes.
+    Every byte is searched for "\r\n" only once, no matter in how many parts the message comes.
+*/
+
+#define RING_MASK (TCP_RING_SIZE - 1)
+
+void tcp_ring_init(sTcpRing *ring)
+{
+    ring->start = 0;
+    ring->length = 0;
+    ring->scanned = 0;
+}
+
+/* Definition of function that receives data from socket into the free space of the ring
+    The free space can be split by the end of the array, so it is filled with one "readv();".
+    Returns the same value as "recv();", -1 with errno set, 0 when the server closed the connection
+*/
+int tcp_ring_recv(sTcpRing *ring, int socket)
+{
+    size_t end = (ring->start + ring->length) & RING_MASK;
+    size_t free_space = TCP_RING_SIZE - ring->length;
+
+    struct iovec parts[2];
+    parts[0].iov_base = ring->data + end;
+    parts[0].iov_len = TCP_RING_SIZE - end < free_space ? TCP_RING_SIZE - end : free_space;
+    parts[1].iov_base = ring->data;
+    parts[1].iov_len = free_space - parts[0].iov_len;
+
+    int received = readv(socket, parts, parts[1].iov_len > 0 ? 2 : 1);
+    if (received > 0)
+        ring->length += received;
+    return received;
+}
+
+/* Definition of function that extracts the next complete message from the ring
+    "*message" points to the message including "\r\n" directly in the ring. Only a message that wraps
+    around the end of the ring is copied into "scratch", so the decoder always gets it in one piece.
+    The message stays valid until the next "tcp_ring_recv();".
+    Returns length of the message, 0 if there is no complete message yet,
+    -1 if the message is longer than "scratch" or does not fit into the ring, such message is thrown away
+*/
+int tcp_ring_next(sTcpRing *ring, char *scratch, int size, const char **message)
+{
+    size_t i = ring->scanned;
+    for (; i < ring->length; i++)
+    {
+        if (ring->data[(ring->start + i) & RING_MASK] == '\n' && i > 0 &&
+            ring->data[(ring->start + i - 1) & RING_MASK] == '\r')
+            break;
+    }
+
+    if (i == ring->length)
+    {
+        ring->scanned = i;
+
+        // Ring is full and there is still no end of message, it can never be completed
+        if (ring->length == TCP_RING_SIZE)
+        {
+            tcp_ring_init(ring);
+            return -1;
+        }
+        return 0;
+    }
+
+    size_t message_length = i + 1;
+    int result = -1;
+    if (message_length <= (size_t)size)
+    {
+        size_t first_part = TCP_RING_SIZE - ring->start;
+        if (first_part >= message_length)
+            *message = ring->data + ring->start;
+        else
+        {
+            memcpy(scratch, ring->data + ring->start, first_part);
+            memcpy(scratch + first_part, ring->data, message_length - first_part);
+            *message = scratch;
+        }
+        result = message_length;
+    }
+
+    ring->start = (ring->start + message_length) & RING_MASK;
+    ring->length -= message_length;
+    ring->scanned = 0;
+    return result;
+}
@@ -0,0 +1,27 @@
+#ifndef TCP_FRAMER_H
+#define TCP_FRAMER_H
+#include <stddef.h>
+
+// Declaration of the receive ring buffer of the TCP variant and its framer
+
+// Size of the ring, has to be a power of two
+#define TCP_RING_SIZE 8192
+
+// Most messages one ring can hold, the shortest message is an empty line "\r\n"
+#define TCP_MAX_BATCH (TCP_RING_SIZE / 2)
+
+typedef struct
+{
+    char data[TCP_RING_SIZE];
+    size_t start;   // Index of the first not yet extracted byte
+    size_t length;  // Number of not yet extracted bytes
+    size_t scanned; // Number of bytes already searched for "\r\n"
+} sTcpRing;
+
+void tcp_ring_init(sTcpRing *ring);
+
+int tcp_ring_recv(sTcpRing *ring, int socket);
+
+int tcp_ring_next(sTcpRing *ring, char *scratch, int size, const char **message);
+
+#endif
@@ -0,0 +1,175 @@
+#include "timer_wheel.h"
+#include <stddef.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Definition of the timer wheel used for retransmission deadlines
+
+    Every entry is linked into the slot of its deadline tick (deadline % TIMER_WHEEL_SLOTS),
+    so adding and removing an entry costs O(1) no matter how many messages are in flight.
+    Deadlines further than one turn of the wheel stay in their slot until their round comes.
+
+    Only one timerfd is used, it is armed to the nearest non-empty slot and registered
+    with the epoll instance of the program, so the main loop is woken up exactly when
+    some deadline expires and never blocks on its own
+*/
+
+// Current monotonic time in microseconds
+static uint64_t now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+// Arms the timerfd to the start of the given tick, or disarms it for tick 0
+static void arm(sTimerWheel *wheel, uint64_t tick)
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+
+    if (tick != 0)
+    {
+        uint64_t us = tick * TIMER_WHEEL_TICK_US;
+        spec.it_value.tv_sec = us / 1000000;
+        spec.it_value.tv_nsec = (us % 1000000) * 1000;
+    }
+    timerfd_settime(wheel->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+    wheel->armed_tick = tick;
+}
+
+// Arms the timerfd to the first non-empty slot after the last expired one
+static void arm_next(sTimerWheel *wheel)
+{
+    if (wheel->count == 0)
+    {
+        arm(wheel, 0);
+        return;
+    }
+
+    for (uint64_t tick = wheel->last_tick + 1; tick <= wheel->last_tick + TIMER_WHEEL_SLOTS; tick++)
+    {
+        if (wheel->slots[tick % TIMER_WHEEL_SLOTS] != NULL)
+        {
+            if (tick != wheel->armed_tick)
+                arm(wheel, tick);
+            return;
+        }
+    }
+}
+
+// "tag" is given back in "data.ptr" of every epoll event of the wheel
+int timer_wheel_init(sTimerWheel *wheel, int epoll_fd, void *tag)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->last_tick = now_us() / TIMER_WHEEL_TICK_US;
+
+    wheel->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (wheel->timer_fd == -1)
+        return -1;
+
+    struct epoll_event timer_event;
+    timer_event.events = EPOLLIN;
+    timer_event.data.ptr = tag;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wheel->timer_fd, &timer_event) == -1)
+    {
+        close(wheel->timer_fd);
+        return -1;
+    }
+    return 0;
+}
+
+void timer_wheel_add(sTimerWheel *wheel, sTimerEntry *entry, uint32_t timeout_us)
+{
+    uint64_t now = now_us();
+
+    // Wheel was idle, nothing between the last expired tick and now has to be looked at
+    if (wheel->count == 0)
+        wheel->last_tick = now / TIMER_WHEEL_TICK_US;
+
+    // Deadline is rounded up to a whole tick, and never falls into an already expired slot
+    entry->deadline = (now + timeout_us + TIMER_WHEEL_TICK_US - 1) / TIMER_WHEEL_TICK_US;
+    if (entry->deadline <= wheel->last_tick)
+        entry->deadline = wheel->last_tick + 1;
+
+    sTimerEntry **slot = &wheel->slots[entry->deadline % TIMER_WHEEL_SLOTS];
+    entry->prev = NULL;
+    entry->next = *slot;
+    if (*slot != NULL)
+        (*slot)->prev = entry;
+    *slot = entry;
+    entry->active = 1;
+    wheel->count++;
+
+    if (wheel->armed_tick == 0 || entry->deadline < wheel->armed_tick)
+        arm(wheel, entry->deadline);
+}
+
+void timer_wheel_remove(sTimerWheel *wheel, sTimerEntry *entry)
+{
+    if (!entry->active)
+        return;
+
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        wheel->slots[entry->deadline % TIMER_WHEEL_SLOTS] = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+
+    entry->next = entry->prev = NULL;
+    entry->active = 0;
+    wheel->count--;
+
+    // Timer is left armed, an early wake up only finds nothing to expire
+    if (wheel->count == 0)
+        arm(wheel, 0);
+}
+
+/* Definition of function that is called when the timerfd becomes readable
+    Unlinks every entry whose deadline has passed and returns them as a list chained
+    through "next", the caller decides whether to add them again.
+    The timerfd is armed again for the remaining entries.
+*/
+sTimerEntry *timer_wheel_expire(sTimerWheel *wheel)
+{
+    // Reading only resets the readiness of the timerfd, the number of expirations is not needed
+    uint64_t expirations;
+    (void)read(wheel->timer_fd, &expirations, sizeof(expirations));
+
+    uint64_t now = now_us() / TIMER_WHEEL_TICK_US;
+    uint64_t first = wheel->last_tick + 1;
+    if (now - wheel->last_tick >= TIMER_WHEEL_SLOTS)
+        first = now - TIMER_WHEEL_SLOTS + 1;
+
+    sTimerEntry *expired = NULL;
+    for (uint64_t tick = first; tick <= now; tick++)
+    {
+        sTimerEntry *entry = wheel->slots[tick % TIMER_WHEEL_SLOTS];
+        while (entry != NULL)
+        {
+            sTimerEntry *next = entry->next;
+            if (entry->deadline <= now)
+            {
+                timer_wheel_remove(wheel, entry);
+                entry->next = expired;
+                expired = entry;
+            }
+            entry = next;
+        }
+    }
+
+    wheel->last_tick = now;
+    wheel->armed_tick = 0;
+    arm_next(wheel);
+    return expired;
+}
+
+void timer_wheel_close(sTimerWheel *wheel)
+{
+    close(wheel->timer_fd);
+    wheel->timer_fd = -1;
+}
@@ -0,0 +1,40 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+#include <stdint.h>
+
+// Declaration of the timer wheel that keeps retransmission deadlines of the UDP variant
+
+// Length of one tick of the wheel in microseconds and number of slots (one turn is ~410 ms)
+#define TIMER_WHEEL_TICK_US 100
+#define TIMER_WHEEL_SLOTS 4096
+
+// Entry of the wheel, embedded into the structure it belongs to
+typedef struct sTimerEntry
+{
+    struct sTimerEntry *next;
+    struct sTimerEntry *prev;
+    uint64_t deadline; // Absolute deadline in ticks
+    int active;
+} sTimerEntry;
+
+// Wheel driven by one timerfd, which is registered with an epoll instance
+typedef struct
+{
+    int timer_fd;
+    sTimerEntry *slots[TIMER_WHEEL_SLOTS];
+    uint64_t last_tick;  // Last tick whose slot was already expired
+    uint64_t armed_tick; // Tick the timerfd is armed to, 0 when disarmed
+    unsigned count;
+} sTimerWheel;
+
+int timer_wheel_init(sTimerWheel *wheel, int epoll_fd, void *tag);
+
+void timer_wheel_add(sTimerWheel *wheel, sTimerEntry *entry, uint32_t timeout_us);
+
+void timer_wheel_remove(sTimerWheel *wheel, sTimerEntry *entry);
+
+sTimerEntry *timer_wheel_expire(sTimerWheel *wheel);
+
+void timer_wheel_close(sTimerWheel *wheel);
+
+#endif
@@ -1,170 +1,462 @@
+#define _GNU_SOURCE
 #include "udp_send.h"
 #include "avars.h"
 #include "decode_msg.h"
+#include "encode_msg.h"
+#include "session.h"
+#include "timer_wheel.h"
 #include <arpa/inet.h>
+#include <errno.h>
 #include <unistd.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
 
-#define INPUT_LENGTH 1400
+#define RECEIVE_LENGTH 1536
 
-/* Definition of function to send UDP messages
-    This funcion only exists because of unreleability of UDP protocol,
+// Bounds of the retransmission timeout in microseconds, a lower -d value is the lower bound instead
+// and a higher one the upper bound
+// A few hundred microseconds of loopback RTT would give up after a stall of a few milliseconds,
+// and a timeout of a minute would stall a full window for minutes on a lossy link
+#define RTO_MIN_US 50000
+#define RTO_MAX_US 2000000
+
+/* Definition of the reliability layer of the UDP variant
+    This layer only exists because of unreleability of UDP protocol,
     to provide releability to UDP
 
-    Function sending an message to server, an waits to confirm message, according to default or user-provided timeout
-    and default or user-provided number of retries + 1
+    Every sent message (except CONFIRM) is copied into a table of outstanding messages of its session,
+    indexed by its MessageID, and its retransmission deadline is put into a timer wheel.
+    Sending never waits, so several unconfirmed messages can be in flight,
+    up to the window given by the user (option -w). A message sent while the window is full
+    (ERR or BYE of the session itself) waits in the backlog of the session and is sent as soon as
+    a CONFIRM frees a place, nothing ever blocks the main loop.
 
-    In case of while functions waits for an confirm message, receives not condirm message, this message will be parsed and,
-    some event will be assigned to "event" variable
-    In that case function returns an event on the basis of which it will be decided, to take some actions or not
+    The main loop gets three kinds of events from epoll:
+    - CONFIRM on the socket, the matching message is removed from the table ("udp_confirm();")
+    - expiration of the timerfd of the wheel, messages without CONFIRM are sent again
+      up to default or user-provided number of retries ("udp_timer_event();")
+    New lines from STDIN are sent only while "udp_window_free();" allows it, the rest waits in the input buffer
 
-    Else, returns null_event and no action is taken
+    Datagrams are not sent one by one. Messages, retransmissions and CONFIRMs are queued and the main loop
+    sends the whole queue with one "sendmmsg();" after every event ("udp_send_queued();"),
+    and every waiting datagram is received with one "recvmmsg();" ("udp_receive();").
 
+    The retransmission timeout is not fixed, it follows the measured round-trip time (RFC 6298):
+    smoothed RTT plus four times its variance, at least 50 ms (or -d, when it is lower). Default or
+    user-provided timeout is used only until the first CONFIRM arrives. Only messages confirmed on the
+    first try are measured (Karn's algorithm). Every retransmission doubles the timeout of the message
+    and the timeout of the session (RFC 6298 5.5), so lossy links are not flooded, until a new measurement.
+
+    Tables and estimations belong to the sessions, one wheel and both batches of datagrams
+    are shared by all sessions of the process, every outstanding message knows its session.
 */
-eSystemEvent udp_send(char *msg, char *receive_buff, int msg_length)
-{
-    int i2Result;
 
-    // Independent variable that controls number of messages, sended due one livetime of function
-    int msg_out_ctrl = 0;
+static sTimerWheel wheel;
 
+// Counters of system calls shown by "/stats", for the whole process
+static unsigned long send_calls, sent_datagrams, receive_calls, received_datagrams;
 
-    char *buffer = msg;
-    uint8_t cnt = max_retransmissions;
-    uint16_t hMessage_id = htons(message_id);
-    eSystemEvent event = null_Event;
+// Queue of datagrams to send, every one has its own copy of the server address
+// All queued datagrams belong to one socket, datagram of another socket sends the queue first
+static struct mmsghdr out_headers[UDP_BATCH];
+static struct iovec out_parts[UDP_BATCH];
+static struct sockaddr_in out_addresses[UDP_BATCH];
+static char out_data[UDP_BATCH][SEND_LENGTH];
+static int out_count;
+static int out_socket;
 
-    // First sending of message
-    i2Result = sendto(client_socket, buffer, msg_length, 0, (struct sockaddr *)&server_addr, server_addr_len);
-    msg_out_ctrl++;
-    if (i2Result <= 0)
-    {
-        perror("send failed");
-        return null_Event;
-    }
+// Datagrams received by the last "recvmmsg();"
+static struct mmsghdr in_headers[UDP_BATCH];
+static struct iovec in_parts[UDP_BATCH];
+static struct sockaddr_in in_addresses[UDP_BATCH];
+static char in_data[UDP_BATCH][RECEIVE_LENGTH];
 
-    // Case if this function has sended a confirm type message, so no need to wait to confirmation to that confirmation
-    if (buffer[0] == 0x00)
-        return null_Event;
+static uint64_t now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
 
+// Upper bound of the retransmission timeout, never below the -d value
+static uint64_t rto_max_us(void)
+{
+    return (uint64_t)udp_timeout * 1000 > RTO_MAX_US ? (uint64_t)udp_timeout * 1000 : RTO_MAX_US;
+}
 
-    // Waiting for response from server by timeout 
-    i2Result = recv(client_socket, receive_buff, INPUT_LENGTH, 0);
-    if (i2Result >= 0 && *((uint16_t *)(receive_buff + 1)) == hMessage_id && (receive_buff[0] == 0x00))
+// Updates the estimation with one measured round-trip time (RFC 6298)
+static void rtt_sample(sUdpState *udp, uint64_t rtt_us)
+{
+    if (udp->rtt_samples++ == 0)
+    {
+        udp->srtt_us = rtt_us;
+        udp->rttvar_us = rtt_us / 2;
+    }
+    else
     {
-        // If confirm message was received and refMessageID is matching sended MessageID, MessageID will be incremented and returned null_event 
-        message_id++;
+        uint64_t delta = udp->srtt_us > rtt_us ? udp->srtt_us - rtt_us : rtt_us - udp->srtt_us;
+        udp->rttvar_us = (3 * udp->rttvar_us + delta) / 4;
+        udp->srtt_us = (7 * udp->srtt_us + rtt_us) / 8;
     }
-    else if ((i2Result >= 0 && receive_buff[0] != 0x00))
+
+    // Variance never goes below the granularity of the timer
+    udp->rto_us = udp->srtt_us + (4 * udp->rttvar_us > TIMER_WHEEL_TICK_US ? 4 * udp->rttvar_us : TIMER_WHEEL_TICK_US);
+    uint64_t rto_min_us = (uint64_t)udp_timeout * 1000 < RTO_MIN_US ? (uint64_t)udp_timeout * 1000 : RTO_MIN_US;
+    if (udp->rto_us < rto_min_us)
+        udp->rto_us = rto_min_us;
+    if (udp->rto_us > rto_max_us())
+        udp->rto_us = rto_max_us();
+}
+
+// Slot of the table for MessageID in network byte order
+static sPendingMsg *pending_slot(sUdpState *udp, uint16_t hMessage_id)
+{
+    return &udp->pending[ntohs(hMessage_id) & (udp->pending_capacity - 1)];
+}
+
+static void send_backlog(sSession *session);
+
+// Place of the message is freed, a message waiting in the backlog can take it
+static void release(sPendingMsg *message)
+{
+    timer_wheel_remove(&wheel, &message->timer);
+    message->used = 0;
+    message->session->reliability.in_flight--;
+    send_backlog(message->session);
+}
+
+// Datagram is copied into the queue, the queue is sent when it is full or by "udp_send_queued();"
+static void send_datagram(sSession *session, const char *buffer, int msg_length)
+{
+    if (out_count == UDP_BATCH || (out_count > 0 && out_socket != session->socket))
+        udp_send_queued();
+
+    memcpy(out_data[out_count], buffer, msg_length);
+    out_parts[out_count].iov_len = msg_length;
+    out_addresses[out_count] = session->server_addr;
+    out_headers[out_count].msg_hdr.msg_namelen = session->server_addr_len;
+    out_socket = session->socket;
+    out_count++;
+}
+
+// Definition of function that sends every queued datagram with one "sendmmsg();"
+void udp_send_queued(void)
+{
+    int sent = 0;
+    while (sent < out_count)
     {
-        // Case if received message is not confirm message
-
-        // Simply decode that message and wait for confirm message
-        char server_username[20];
-        char msg_content[1400];
-        memset(msg_content, 0, sizeof(msg_content));
-        memset(server_username, 0 ,sizeof(server_username));
-        event = decode_msg(receive_buff, server_username, msg_content);
-        switch (event)
+        int i2Result = sendmmsg(out_socket, out_headers + sent, out_count - sent, 0);
+        send_calls++;
+        if (i2Result == -1)
         {
-        case reply_ok_Event:
-            fprintf(stderr, "%s: %s\n", server_username, msg_content);
-            event =  reply_ok_Event;
-            break;
-        case reply_nok_Event:
-            fprintf(stderr, "%s: %s\n", server_username, msg_content);
-            event =  reply_nok_Event;
-            break;
-        case error_inc_Event:
-            fprintf(stderr, "ERR FROM %s: %s\n", server_username, msg_content);
-            event =  error_inc_Event;
-            break;
-        case bye_Event:
-            event =  bye_Event;
-            break;
-        case msg_error_Event:
-            fprintf(stderr, "Failed to be parsed\n");
-            event =  msg_error_Event;
-            break;
-        default:
-            printf("%s: %s\n", server_username, msg_content);
+            if (errno == EINTR)
+                continue;
+
+            // Full socket buffer is handled as lost datagrams, the messages are sent again after the timeout
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("send failed");
             break;
         }
-            cnt++;
+        sent += i2Result;
+        sent_datagrams += i2Result;
     }
-    else
+    out_count = 0;
+}
+
+/* Definition of function that receives every waiting datagram of the session with one "recvmmsg();"
+    Returns the number of datagrams, which are taken by "udp_datagram();", or -1 with errno set
+*/
+int udp_receive(sSession *session)
+{
+    for (int i = 0; i < UDP_BATCH; i++)
+        in_headers[i].msg_hdr.msg_namelen = sizeof(in_addresses[i]);
+
+    int received = recvmmsg(session->socket, in_headers, UDP_BATCH, MSG_DONTWAIT, NULL);
+    receive_calls++;
+    if (received > 0)
+        received_datagrams += received;
+    return received;
+}
+
+// Definition of function that returns received datagram, the server address is taken from it as by "recvfrom();"
+const char *udp_datagram(sSession *session, int index, int *length)
+{
+    memcpy(&session->server_addr, &in_addresses[index], sizeof(session->server_addr));
+    session->server_addr_len = sizeof(session->server_addr);
+    *length = in_headers[index].msg_len;
+    return in_data[index];
+}
+
+// Definition of function that initializes everything shared by all sessions, "tag" identifies the timer in epoll
+int udp_init(int epoll_fd, void *timer_tag)
+{
+    // Every header of both batches points to its own buffer and address
+    for (int i = 0; i < UDP_BATCH; i++)
+    {
+        out_parts[i].iov_base = out_data[i];
+        out_headers[i].msg_hdr.msg_name = &out_addresses[i];
+        out_headers[i].msg_hdr.msg_iov = &out_parts[i];
+        out_headers[i].msg_hdr.msg_iovlen = 1;
+
+        in_parts[i].iov_base = in_data[i];
+        in_parts[i].iov_len = RECEIVE_LENGTH;
+        in_headers[i].msg_hdr.msg_name = &in_addresses[i];
+        in_headers[i].msg_hdr.msg_iov = &in_parts[i];
+        in_headers[i].msg_hdr.msg_iovlen = 1;
+    }
+    out_count = 0;
+
+    return timer_wheel_init(&wheel, epoll_fd, timer_tag);
+}
+
+// Definition of function that initializes the reliability state of one session
+int udp_session_init(sSession *session)
+{
+    sUdpState *udp = &session->reliability;
+    memset(udp, 0, sizeof(*udp));
+
+    udp->pending_capacity = 1;
+    while (udp->pending_capacity < udp_window)
+        udp->pending_capacity <<= 1;
+
+    udp->pending = calloc(udp->pending_capacity, sizeof(sPendingMsg));
+    if (udp->pending == NULL)
+        return -1;
+    for (int i = 0; i < udp->pending_capacity; i++)
+        udp->pending[i].session = session;
+
+    // Until the first measurement the timeout is the default or user-provided one
+    udp->rto_us = (uint64_t)udp_timeout * 1000;
+    return 0;
+}
+
+// Definition of function that forgets every outstanding message of the session
+void udp_session_close(sSession *session)
+{
+    sUdpState *udp = &session->reliability;
+    if (udp->pending == NULL)
+        return;
+
+    // Backlog goes first, so that releasing a message does not send it
+    while (udp->backlog != NULL)
+    {
+        sQueuedMsg *queued = udp->backlog;
+        udp->backlog = queued->next;
+        free(queued);
+    }
+    udp->backlog_tail = NULL;
+
+    for (int i = 0; i < udp->pending_capacity; i++)
+    {
+        if (udp->pending[i].used)
+            release(&udp->pending[i]);
+    }
+
+    // Nothing of this session can stay in the queue, its socket is going to be closed
+    if (out_count > 0 && out_socket == session->socket)
+        udp_send_queued();
+
+    free(udp->pending);
+    udp->pending = NULL;
+}
+
+/* Definition of function that matches a received CONFIRM message
+    The message with the same refMessageID is removed from the table,
+    CONFIRM of unknown or already confirmed message is ignored
+*/
+void udp_confirm(sSession *session, const char *receive_buff)
+{
+    sUdpState *udp = &session->reliability;
+    uint16_t hRef_id;
+    memcpy(&hRef_id, receive_buff + 1, sizeof(hRef_id));
+    sPendingMsg *message = pending_slot(udp, hRef_id);
+
+    if (message->used && message->hMessage_id == hRef_id)
+    {
+        uint64_t latency_us = now_us() - message->sent_us;
+        if (!message->retransmitted)
+            rtt_sample(udp, latency_us);
+        if (session->on_confirm != NULL)
+            session->on_confirm(session, (unsigned char)message->data[0], latency_us);
+        udp->confirmed_count++;
+        release(message);
+    }
+}
+
+// Definition of function that sends CONFIRM of a received message, a CONFIRM is sent only once
+void udp_send_confirm(sSession *session, const char *receive_buff)
+{
+    char confirm_msg[3];
+    uint16_t hRef_id;
+    memcpy(&hRef_id, receive_buff + 1, sizeof(hRef_id));
+    send_datagram(session, confirm_msg, encode_confirm(confirm_msg, hRef_id));
+}
+
+// Definition of function that retransmits every message whose timeout has expired, in any session
+void udp_timer_event(void)
+{
+    sTimerEntry *entry = timer_wheel_expire(&wheel);
+    while (entry != NULL)
     {
-        // Cycle for number of retries 
-        while (cnt-- > 0)
+        sTimerEntry *next = entry->next;
+        sPendingMsg *message = (sPendingMsg *)entry;
+        sUdpState *udp = &message->session->reliability;
+
+        if (message->retries == 0)
         {
-            // Check if number of sended messages is > 20
-            if (cnt > 20 || msg_out_ctrl > 20)
-            {
-                fprintf(stderr, "ERR: limit of max retransmissions reached 15");
-                free(result);
-                close(client_socket);
-                exit(EXIT_FAILURE);
-            }
-            // Another try to send message
-            i2Result = sendto(client_socket, buffer, msg_length, 0, (struct sockaddr *)&server_addr, server_addr_len);
-            msg_out_ctrl++;
-
-            if (i2Result <= 0)
-            {
-                perror("send failed");
-                return null_Event;
-            }
-
-            // Another waiting to receive message
-            i2Result = recv(client_socket, receive_buff, INPUT_LENGTH, 0);
-            if (i2Result >= 0 && *((uint16_t *)(receive_buff + 1)) == hMessage_id && (receive_buff[0] == 0x00))
-            {
-                message_id++;
-                break;
-            }
-            else if ((i2Result >= 0 && receive_buff[0] != 0x00))
-            {
-                // Another case if received message was not a confirm message
-                char server_username[20];
-                char msg_content[1400];
-                event = decode_msg(receive_buff, server_username, msg_content);
-                switch (event)
-                {
-                case reply_ok_Event:
-                    fprintf(stderr, "%s: %s\n", server_username, msg_content);
-                    event =  reply_ok_Event;
-                    break;
-                case reply_nok_Event:
-                    fprintf(stderr, "%s: %s\n", server_username, msg_content);
-                    event =  reply_nok_Event;
-                    break;
-                case error_inc_Event:
-                    fprintf(stderr, "ERR FROM %s: %s\n", server_username, msg_content);
-                    event =  error_inc_Event;
-                    break;
-                case bye_Event:
-                    event =  bye_Event;
-                    break;
-                case msg_error_Event:
-                    fprintf(stderr, "Failed to be parsed\n");
-                    event =  msg_error_Event;
-                    break;
-                default:
-                    printf("%s: %s\n", server_username, msg_content);
-                    break;
-                }
-                    cnt++;
-            }
-            if (cnt == 0)
+            udp->lost_count++;
+            if (message->session->on_lost != NULL)
+                message->session->on_lost(message->session, (unsigned char)message->data[0]);
+            else
                 fprintf(stderr, "ERR: NO CONFIRM RESPONSE\n");
+            release(message);
         }
+        else
+        {
+            // Another try to send message, with twice as long timeout
+            message->retries--;
+            message->retransmitted = 1;
+            message->timeout_us = message->timeout_us * 2 < rto_max_us() ? message->timeout_us * 2 : rto_max_us();
+
+            // Timeout of the session doubles too, only when the message was sent with the current one, so messages
+            // that expired together back it off once and a message already sent with a longer timeout does not
+            // raise it further
+            if (udp->rto_us < message->timeout_us && udp->rto_us * 2 >= message->timeout_us)
+                udp->rto_us = message->timeout_us;
+            udp->retransmitted_count++;
+            send_datagram(message->session, message->data, message->length);
+            timer_wheel_add(&wheel, &message->timer, message->timeout_us);
+        }
+        entry = next;
+    }
+}
+
+// Tells whether the message with the MessageID (network byte order) can be put into the table right now
+static int place_free(sUdpState *udp, uint16_t hMessage_id)
+{
+    return udp->in_flight < udp_window && !pending_slot(udp, hMessage_id)->used;
+}
+
+// Puts the message into the table of outstanding messages and sends it for the first time
+static void send_pending(sSession *session, const char *msg, int msg_length)
+{
+    sUdpState *udp = &session->reliability;
+    uint16_t hMessage_id;
+    memcpy(&hMessage_id, msg + 1, sizeof(hMessage_id));
+    sPendingMsg *message = pending_slot(udp, hMessage_id);
+
+    message->used = 1;
+    message->hMessage_id = hMessage_id;
+    message->retries = max_retransmissions;
+    message->retransmitted = 0;
+    message->timeout_us = udp->rto_us;
+    message->length = msg_length < SEND_LENGTH ? msg_length : SEND_LENGTH;
+    memcpy(message->data, msg, message->length);
+    udp->in_flight++;
+
+    // First sending of message
+    message->sent_us = now_us();
+    udp->sent_count++;
+    send_datagram(session, message->data, message->length);
+    timer_wheel_add(&wheel, &message->timer, message->timeout_us);
+}
+
+// Sends messages from the front of the backlog while they have a free place
+static void send_backlog(sSession *session)
+{
+    sUdpState *udp = &session->reliability;
+    while (udp->backlog != NULL)
+    {
+        sQueuedMsg *queued = udp->backlog;
+        uint16_t hMessage_id;
+        memcpy(&hMessage_id, queued->data + 1, sizeof(hMessage_id));
+        if (!place_free(udp, hMessage_id))
+            return;
+
+        udp->backlog = queued->next;
+        if (udp->backlog == NULL)
+            udp->backlog_tail = NULL;
+        send_pending(session, queued->data, queued->length);
+        free(queued);
+    }
+}
+
+/* Definition of function to send UDP messages
+    CONFIRM messages are only sent. Any other message is sent, saved to the table of outstanding
+    messages with default or user-provided number of retries and the MessageID is incremented.
+    Function does not wait for the confirmation, it comes later as an event of the main loop.
+    When the window is full, or a much older message with the same slot is still not confirmed,
+    the message waits in the backlog (after the messages already there) and is sent later.
+
+    Returns null_event, and no action is taken
+*/
+eSystemEvent udp_send(sSession *session, char *msg, int msg_length)
+{
+    sUdpState *udp = &session->reliability;
+
+    // Case if this function sends a confirm type message, so no need to wait to confirmation to that confirmation
+    if (msg[0] == 0x00)
+    {
+        send_datagram(session, msg, msg_length);
+        return null_Event;
+    }
+
+    uint16_t hMessage_id;
+    memcpy(&hMessage_id, msg + 1, sizeof(hMessage_id));
+    session->message_id++;
+
+    if (udp->backlog == NULL && place_free(udp, hMessage_id))
+    {
+        send_pending(session, msg, msg_length);
+        return null_Event;
+    }
+
+    int length = msg_length < SEND_LENGTH ? msg_length : SEND_LENGTH;
+    sQueuedMsg *queued = malloc(sizeof(sQueuedMsg) + length);
+    if (queued == NULL)
+    {
+        perror("udp_send");
+        return null_Event;
     }
-    memset(buffer, 0, sizeof(&buffer));
+    queued->next = NULL;
+    queued->length = length;
+    memcpy(queued->data, msg, length);
+    if (udp->backlog_tail != NULL)
+        udp->backlog_tail->next = queued;
+    else
+        udp->backlog = queued;
+    udp->backlog_tail = queued;
+    return null_Event;
+}
+
+// Definition of function that tells whether the next message can be sent without waiting for a CONFIRM
+int udp_window_free(sSession *session)
+{
+    sUdpState *udp = &session->reliability;
+    return udp->backlog == NULL && place_free(udp, htons(session->message_id));
+}
 
-    return event;
-}
\ No newline at end of file
+// Definition of function that tells whether every message of the session is confirmed or given up
+int udp_idle(sSession *session)
+{
+    return session->reliability.in_flight == 0 && session->reliability.backlog == NULL;
+}
+
+// Definition of function that prints the current round-trip time estimation for "/stats"
+void udp_print_stats(sSession *session)
+{
+    sUdpState *udp = &session->reliability;
+    printf("    RTT %.3f ms (variance %.3f ms, %lu samples), timeout %.3f ms\n", udp->srtt_us / 1000.0,
+           udp->rttvar_us / 1000.0, udp->rtt_samples, udp->rto_us / 1000.0);
+    printf("    sent %lu, retransmitted %lu, confirmed %lu, lost %lu, in flight %u\n", udp->sent_count,
+           udp->retransmitted_count, udp->confirmed_count, udp->lost_count, udp->in_flight);
+    printf("    datagrams sent %lu in %lu calls, received %lu in %lu calls\n", sent_datagrams, send_calls,
+           received_datagrams, receive_calls);
+}
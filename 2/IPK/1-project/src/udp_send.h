@@ -1,5 +1,81 @@
+#ifndef UDP_SEND_H
+#define UDP_SEND_H
 #include <stdint.h>
 #include <sys/socket.h>
+#include "encode_msg.h"
 #include "fsm.h"
+#include "timer_wheel.h"
 
-eSystemEvent udp_send(char *buffer, char *receive_buff, int msg_length);
\ No newline at end of file
+// Most datagrams sent or received by one system call
+#define UDP_BATCH 64
+
+struct sSession;
+
+// Declaration of the outstanding message, the timer entry has to be the first member
+typedef struct
+{
+    sTimerEntry timer;
+    struct sSession *session; // Session that sent the message
+    int used;
+    uint16_t hMessage_id; // MessageID in network byte order, as it is in the message
+    uint8_t retries;      // Retransmissions left
+    int retransmitted;
+    uint64_t sent_us;     // Time of the first sending
+    uint32_t timeout_us;  // Timeout of the current try
+    int length;
+    char data[SEND_LENGTH];
+} sPendingMsg;
+
+// Declaration of the message waiting for a free place in the table of outstanding messages
+typedef struct sQueuedMsg
+{
+    struct sQueuedMsg *next;
+    int length;
+    char data[];
+} sQueuedMsg;
+
+// Declaration of the reliability state of one session, times in microseconds
+typedef struct
+{
+    // Table of outstanding messages, the slot of a message is its MessageID modulo the capacity
+    sPendingMsg *pending;
+    uint16_t pending_capacity;
+    uint16_t in_flight;
+
+    // Messages sent while the window was full (ERR, BYE), they are sent in order as places free up
+    sQueuedMsg *backlog, *backlog_tail;
+
+    // Round-trip time estimation and counters shown by "/stats"
+    uint64_t srtt_us;
+    uint64_t rttvar_us;
+    uint64_t rto_us;
+    unsigned long rtt_samples, sent_count, retransmitted_count, confirmed_count, lost_count;
+} sUdpState;
+
+int udp_init(int epoll_fd, void *timer_tag);
+
+int udp_session_init(struct sSession *session);
+
+void udp_session_close(struct sSession *session);
+
+eSystemEvent udp_send(struct sSession *session, char *msg, int msg_length);
+
+void udp_send_queued(void);
+
+int udp_receive(struct sSession *session);
+
+const char *udp_datagram(struct sSession *session, int index, int *length);
+
+void udp_confirm(struct sSession *session, const char *receive_buff);
+
+void udp_send_confirm(struct sSession *session, const char *receive_buff);
+
+void udp_timer_event(void);
+
+int udp_window_free(struct sSession *session);
+
+int udp_idle(struct sSession *session);
+
+void udp_print_stats(struct sSession *session);
+
+#endif